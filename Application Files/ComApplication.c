@@ -52,7 +52,10 @@ extern Boolean			gSearchWrap;
 extern Boolean			gSearchWithCase;
 extern Str255			gSearchText;
 extern Str255			gSampleText;
+extern Str255			gReplaceText;
 extern TextMediaUPP		gTextProcUPP;
+extern QTTextCachePtr	gTextCache;
+extern Handle			gChapterSample;
 
 
 //////////
@@ -76,7 +79,10 @@ void QTApp_Init (UInt32 theStartPhase)
 #endif
 		QTText_CopyCStringToPascal(kSearchText, gSearchText);
 		QTText_CopyCStringToPascal(kSampleText, gSampleText);
+		QTText_CopyCStringToPascal(kReplaceText, gReplaceText);
 		gTextProcUPP = NewTextMediaUPP(QTText_TextProc);
+		gTextCache = QTTextEnc_NewCache(kQTTextEnc_DefaultCacheSize);
+		gChapterSample = NewHandle(0);
 	}
 
 	// do any start-up activities that should occur after the MDI frame window is created
@@ -115,7 +121,17 @@ void QTApp_Stop (UInt32 theStopPhase)
 		DisposeAEEventHandlerUPP(gHandlePrintDocAEUPP);
 		DisposeAEEventHandlerUPP(gHandleQuitAppAEUPP);
 #endif
-	
+		// dispose of the cache of converted text samples, and of any edit and reference indexes still around
+		// (for instance, those of a movie we made but never put in a window)
+		QTTextEnc_DisposeCache(gTextCache);
+		gTextCache = NULL;
+		QTText_FlushEditIndexes();
+		QTText_FlushRefIndexes();
+
+		// dispose of the handle that chapter samples are read into
+		if (gChapterSample != NULL)
+			DisposeHandle(gChapterSample);
+		gChapterSample = NULL;
 	}
 }
 
@@ -249,11 +265,20 @@ void QTApp_HandleContentClick (WindowReference theWindow, EventRecord *theEvent)
 
 Boolean QTApp_HandleKeyPress (char theCharCode)
 {
-	Boolean		isHandled = true;
+	WindowObject		myWindowObject = NULL;
+	Boolean				isHandled = true;
 	
 	switch (theCharCode) {
 	
-		// ***insert application-specific key-press processing here***
+		// move to the next or previous chapter of the front movie
+		case kNextChapterKey:
+		case kPreviousChapterKey:
+			myWindowObject = QTFrame_GetWindowObjectFromFrontWindow();
+			if (myWindowObject != NULL)
+				isHandled = (QTText_GoToRelativeChapter(myWindowObject, (theCharCode == kNextChapterKey) ? 1 : -1) == noErr);
+			else
+				isHandled = false;
+			break;
 
 		default:
 			isHandled = false;
@@ -313,6 +338,11 @@ Boolean QTApp_HandleMenu (UInt16 theMenuItem)
 			myIsHandled = true;
 			break;
 				
+		case IDM_REPLACE_TEXT:
+			QTText_ReplaceText(myWindowObject);
+			myIsHandled = true;
+			break;
+				
 		case IDM_SEARCH_FORWARD:
 			gSearchForward = true;	
 			myIsHandled = true;
@@ -371,7 +401,8 @@ Boolean QTApp_HandleMenu (UInt16 theMenuItem)
 				myTextTrack = QTText_AddTextTrack(myMovie, myStrings, myFrames, 11, VideoMediaType, isChapter);
 				if (myTextTrack != NULL) {
 
-					MCMovieChanged(myMC, myMovie);
+					// the controller hears about the new track (and rebuilds its chapter pop-up) when we're next idle
+					QTText_NoteMovieChanged(myWindowObject);
 
 					// stamp the movie as dirty and update our saved data
 					(**myWindowObject).fIsDirty = true;
@@ -416,6 +447,34 @@ Boolean QTApp_HandleMenu (UInt16 theMenuItem)
 			myIsHandled = true;
 			break;
 			
+		case IDM_EXPORT_TEXT:
+			QTText_ExportSubtitles(myWindowObject);
+			myIsHandled = true;
+			break;
+			
+		case IDM_IMPORT_TEXT:
+			{
+				Track	myTextTrack = NULL;
+				
+				myTextTrack = QTText_ImportSubtitles(myWindowObject);
+				if (myTextTrack != NULL) {
+
+					// the controller hears about the new track when we're next idle
+					QTText_NoteMovieChanged(myWindowObject);
+
+					// stamp the movie as dirty and, if it's the movie's first text track, update our saved data
+					(**myWindowObject).fIsDirty = true;
+					if (!(**myAppData).fMovieHasText) {
+						(**myAppData).fMovieHasText = true;
+						(**myAppData).fTextIsChapter = false;
+						(**myAppData).fTextTrack = myTextTrack;
+						(**myAppData).fTextHandler = GetMediaHandler(GetTrackMedia(myTextTrack));
+					}
+				}
+			}
+			myIsHandled = true;
+			break;
+			
 		default:
 			break;
 	} // switch (theMenuItem)
@@ -458,6 +517,7 @@ void QTApp_AdjustMenus (WindowReference theWindow, MenuReference theMenu)
 	QTFrame_SetMenuItemState(myMenu, IDM_SET_TEXT, kDisableMenuItem);
 	QTFrame_SetMenuItemState(myMenu, IDM_FIND_TEXT, kDisableMenuItem);
 	QTFrame_SetMenuItemState(myMenu, IDM_EDIT_TEXT, kDisableMenuItem);
+	QTFrame_SetMenuItemState(myMenu, IDM_REPLACE_TEXT, kDisableMenuItem);
 	QTFrame_SetMenuItemState(myMenu, IDM_SEARCH_FORWARD, kDisableMenuItem);
 	QTFrame_SetMenuItemState(myMenu, IDM_SEARCH_BACKWARD, kDisableMenuItem);
 	QTFrame_SetMenuItemState(myMenu, IDM_WRAP_SEARCH, kDisableMenuItem);
@@ -466,6 +526,8 @@ void QTApp_AdjustMenus (WindowReference theWindow, MenuReference theMenu)
 	QTFrame_SetMenuItemState(myMenu, IDM_CUT_TEXT_TRACK, kDisableMenuItem);
 	QTFrame_SetMenuItemState(myMenu, IDM_CHAPTER_TRACK, kDisableMenuItem);
 	QTFrame_SetMenuItemState(myMenu, IDM_HREF_TRACK, kDisableMenuItem);
+	QTFrame_SetMenuItemState(myMenu, IDM_EXPORT_TEXT, kDisableMenuItem);
+	QTFrame_SetMenuItemState(myMenu, IDM_IMPORT_TEXT, kDisableMenuItem);
 
 	// set check marks
 	QTFrame_SetMenuItemCheck(myMenu, IDM_SEARCH_FORWARD, gSearchForward);
@@ -477,16 +539,21 @@ void QTApp_AdjustMenus (WindowReference theWindow, MenuReference theMenu)
 	
 	if (myWindowObject != NULL) {
 		myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(myWindowObject);
+		if (myAppData != NULL)
+			QTFrame_SetMenuItemState(myMenu, IDM_IMPORT_TEXT, kEnableMenuItem);
+			
 		if ((myAppData != NULL) && ((**myAppData).fMovieHasText)) {
 			QTFrame_SetMenuItemState(myMenu, IDM_SET_TEXT, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_FIND_TEXT, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_EDIT_TEXT, kEnableMenuItem);
+			QTFrame_SetMenuItemState(myMenu, IDM_REPLACE_TEXT, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_SEARCH_FORWARD, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_SEARCH_BACKWARD, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_WRAP_SEARCH, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_USE_CASE, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_CHAPTER_TRACK, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_HREF_TRACK, kEnableMenuItem);
+			QTFrame_SetMenuItemState(myMenu, IDM_EXPORT_TEXT, kEnableMenuItem);
 			QTFrame_SetMenuItemState(myMenu, IDM_CUT_TEXT_TRACK, kEnableMenuItem);
 			QTFrame_SetMenuItemCheck(myMenu, IDM_CHAPTER_TRACK, (**myAppData).fTextIsChapter);
 			QTFrame_SetMenuItemCheck(myMenu, IDM_HREF_TRACK, (**myAppData).fTextIsHREF);
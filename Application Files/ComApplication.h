@@ -70,6 +70,9 @@
 #define kEditTextEditIndex		3
 #define kEditCancelIndex		4
 
+#define kNextChapterKey			']'		// key that moves the movie to the next chapter
+#define kPreviousChapterKey		'['		// key that moves the movie to the previous chapter
+
 
 //////////
 //
@@ -77,6 +80,40 @@
 //
 //////////
 
+// the bounds of the samples of a text track, in track time, decoded once into flat arrays (see QTText_GetSampleBounds);
+// the track duration and media sample count tell us whether the track has been edited since the index was built
+typedef struct QTTextSampleIndex {
+	Track						fTrack;				// the indexed track
+	TimeValue					fTrackDuration;		// the duration of the track when it was indexed
+	long						fMediaSampleCount;	// the number of samples in its media when it was indexed
+	long						fCount;				// the number of samples in the track
+	Handle						fStarts;			// the track time at which each sample starts (TimeValue[])
+	Handle						fDurations;			// the duration of each sample, in track time (TimeValue[])
+	Handle						fMediaDurations;	// the duration of each sample, in media time (TimeValue[])
+} QTTextSampleIndex, *QTTextSampleIndexPtr;
+
+// one chapter of a chapter track (see QTText_GetTableChapterTime)
+typedef struct QTTextChapter {
+	TimeValue					fStart;				// the track time at which the chapter starts
+	TimeValue					fDuration;			// the time until the next chapter starts (or the movie ends)
+	long						fTextOffset;		// the offset of the chapter's title in the chapter table's text
+	long						fTextLength;		// the length of the title, not counting its terminating null
+} QTTextChapter, *QTTextChapterPtr;
+
+// the chapters of a chapter track, read in one pass into a flat array; like the sample index, it's rebuilt
+// when the track's duration, modification time or media sample count change (except after our own edits,
+// which update it in place)
+typedef struct QTTextChapterTable {
+	Track						fTrack;				// the chapter track
+	TimeValue					fTrackDuration;		// the duration of the track when the table was built
+	unsigned long				fModificationTime;	// the modification time of the track when the table was built
+	long						fMediaSampleCount;	// the number of samples in its media when the table was built
+	long						fCount;				// the number of chapters
+	Handle						fChapters;			// the chapters, in time order (QTTextChapter[])
+	Handle						fText;				// the chapter titles, each followed by a null (char[])
+	long						fTextSize;			// the number of bytes of fText in use
+} QTTextChapterTable, *QTTextChapterTablePtr;
+
 // application-specific data
 typedef struct ApplicationDataRecord {
 	Boolean						fMovieHasText;		// does the movie have a text track?
@@ -84,6 +121,9 @@ typedef struct ApplicationDataRecord {
 	Boolean						fTextIsHREF;		// is the text track also an HREF track?
 	Track						fTextTrack;			// the (first) text track in the movie
 	MediaHandler				fTextHandler;		// the media handler for the text track	
+	QTTextSampleIndex			fSampleIndex;		// the sample bounds of the text track (built on demand)
+	QTTextChapterTable			fChapterTable;		// the chapters of the movie's chapter track (built on demand)
+	Boolean						fMovieChanged;		// has the movie changed since the movie controller was last told?
 } ApplicationDataRecord, *ApplicationDataPtr, **ApplicationDataHdl;
 
 
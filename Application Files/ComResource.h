@@ -61,6 +61,7 @@
 #define IDM_SET_TEXT				    33537	//((kTestMenuResID<<8)+(1))
 #define IDM_FIND_TEXT				    33538	//((kTestMenuResID<<8)+(2))
 #define IDM_EDIT_TEXT				    33539	//((kTestMenuResID<<8)+(3))
+#define IDM_REPLACE_TEXT				33540	//((kTestMenuResID<<8)+(4))
 #define IDM_SEARCH_FORWARD				33541	//((kTestMenuResID<<8)+(5))
 #define IDM_SEARCH_BACKWARD				33542	//((kTestMenuResID<<8)+(6))
 #define IDM_WRAP_SEARCH				    33544	//((kTestMenuResID<<8)+(8))
@@ -69,6 +70,8 @@
 #define IDM_CUT_TEXT_TRACK				33548	//((kTestMenuResID<<8)+(12))
 #define IDM_CHAPTER_TRACK				33550	//((kTestMenuResID<<8)+(14))
 #define IDM_HREF_TRACK					33551	//((kTestMenuResID<<8)+(15))
+#define IDM_EXPORT_TEXT					33553	//((kTestMenuResID<<8)+(17))
+#define IDM_IMPORT_TEXT					33554	//((kTestMenuResID<<8)+(18))
 
 // IDs for Window menu and menu items (Windows-only)
 #define IDS_WINDOWMENU                  1300
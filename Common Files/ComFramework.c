@@ -710,31 +710,43 @@ OSErr QTFrame_SaveAsMovieFile (WindowReference theWindow)
 				goto bail;
 		}
 		
-		myNewMovie = FlattenMovieData(	myMovie,
-										flattenAddMovieToDataFork | flattenForceMovieResourceBeforeMovieData,
-										&myFile,
-										sigMoviePlayer,
-										smSystemScript,
-										createMovieFileDeleteCurFile | createMovieFileDontCreateResFile);
-		myErr = GetMoviesError();
-		if ((myNewMovie == NULL) || (myErr != noErr))
-			goto bail;
+		// if all the movie's media data is in its own data-fork movie file, we can write the new file
+		// ourselves, in a single pass over the media data; otherwise, let FlattenMovieData do it
+		myErr = paramErr;
+		if (((**myWindowObject).fFileRefNum != kInvalidFileRefNum) && ((**myWindowObject).fFileResID == movieInDataForkResID)) {
+			FSSpec		mySrcFile = (**myWindowObject).fFileFSSpec;
+			
+			if ((mySrcFile.vRefNum != myFile.vRefNum) || (mySrcFile.parID != myFile.parID) || !EqualString(mySrcFile.name, myFile.name, false, true))
+				myErr = QTUtils_WriteFastStartMovieFile(myMovie, &mySrcFile, &myFile, kMovieAtomPadding);
+		}
+
+		if (myErr != noErr) {
+			myNewMovie = FlattenMovieData(	myMovie,
+											flattenAddMovieToDataFork | flattenForceMovieResourceBeforeMovieData,
+											&myFile,
+											sigMoviePlayer,
+											smSystemScript,
+											createMovieFileDeleteCurFile | createMovieFileDontCreateResFile);
+			myErr = GetMoviesError();
+			if ((myNewMovie == NULL) || (myErr != noErr))
+				goto bail;
 
-		// FlattenMovieData creates a new movie file and returns the movie to us; but it doesn't
-		// return the file reference number or the movie resource ID, which we want to have; so
-		// we will dump the movie returned by FlattenMovieData and open the movie file ourselves
-		DisposeMovie(myNewMovie);
+			// FlattenMovieData creates a new movie file and returns the movie to us; but it doesn't
+			// return the file reference number or the movie resource ID, which we want to have; so
+			// we will dump the movie returned by FlattenMovieData and open the movie file ourselves
+			DisposeMovie(myNewMovie);
 
-		// also, on MacOS, FlattenMovieData *always* creates a resource fork, even if we told it
-		// not to do so (didn't we say "createMovieFileDontCreateResFile"?); so we'll explicitly
-		// delete the resource fork now....
+			// also, on MacOS, FlattenMovieData *always* creates a resource fork, even if we told it
+			// not to do so (didn't we say "createMovieFileDontCreateResFile"?); so we'll explicitly
+			// delete the resource fork now....
 #if TARGET_OS_MAC
-		myErr = FSpOpenRF(&myFile, fsRdWrPerm, &myRefNum);
-		if (myErr == noErr) {
-			SetEOF(myRefNum, 0L);
-			FSClose(myRefNum);
-		}
+			myErr = FSpOpenRF(&myFile, fsRdWrPerm, &myRefNum);
+			if (myErr == noErr) {
+				SetEOF(myRefNum, 0L);
+				FSClose(myRefNum);
+			}
 #endif
+		}
 		
 		myErr = OpenMovieFile(&myFile, &myRefNum, fsRdWrPerm);
 		if (myErr != noErr)
@@ -819,10 +831,18 @@ Boolean QTFrame_UpdateMovieFile (WindowReference theWindow)
 	// update the current volume setting
 	QTUtils_UpdateMovieVolumeSetting(myMovie);
 	
-	if ((**myWindowObject).fFileRefNum == kInvalidFileRefNum)		// brand new movie, so no file attached to it
+	if ((**myWindowObject).fFileRefNum == kInvalidFileRefNum) {		// brand new movie, so no file attached to it
 		myErr = QTFrame_SaveAsMovieFile(theWindow);
-	else															// we have an existing file; just update the movie resource
-		myErr = UpdateMovieResource(myMovie, (**myWindowObject).fFileRefNum, (**myWindowObject).fFileResID, NULL);
+	} else {														// we have an existing file; just update the movie resource
+		myErr = paramErr;
+
+		// if the movie is in the data fork, try to rewrite just the movie atom, in place
+		if ((**myWindowObject).fFileResID == movieInDataForkResID)
+			myErr = QTUtils_UpdateMovieAtomInPlace(myMovie, (**myWindowObject).fFileRefNum, kMovieAtomPadding);
+
+		if (myErr != noErr)
+			myErr = UpdateMovieResource(myMovie, (**myWindowObject).fFileRefNum, (**myWindowObject).fFileResID, NULL);
+	}
 	
 	// TO DO: use QTInfo_MakeFilePreview here, which doesn't always create a resource fork
 	//MakeFilePreview((**myWindowObject).fFileRefNum, (ICMProgressProcRecordPtr)-1);
@@ -944,13 +964,17 @@ void QTFrame_CloseWindowObject (WindowObject theWindowObject)
 		(**theWindowObject).fFileRefNum = kInvalidFileRefNum;
 	}
 	
-	// dispose movie controller and movie 
+	// dispose movie controller
 	if ((**theWindowObject).fController != NULL) {
 		MCSetActionFilterWithRefCon((**theWindowObject).fController, NULL, 0L);
 		DisposeMovieController((**theWindowObject).fController);
 		(**theWindowObject).fController = NULL;
 	}
 	
+	// do any application-specific window clean-up, while the movie is still around
+	QTApp_RemoveWindowObject(theWindowObject);
+	
+	// dispose movie
 	if ((**theWindowObject).fMovie != NULL) {
 		DisposeMovie((**theWindowObject).fMovie);
 		(**theWindowObject).fMovie = NULL;
@@ -962,9 +986,6 @@ void QTFrame_CloseWindowObject (WindowObject theWindowObject)
 		(**theWindowObject).fGraphicsImporter = NULL;
 	}
 	
-	// do any application-specific window clean-up
-	QTApp_RemoveWindowObject(theWindowObject);
-	
 	DisposeHandle((Handle)theWindowObject);
 }
 
@@ -0,0 +1,2116 @@
+//////////
+//
+//	File:		QTFile.c
+//
+//	Contains:	Portable reading of QuickTime movie files, without QuickTime.
+//				All utilities start with the prefix "QTFile_".
+//
+//	Written by:	QuickTime Team
+//
+//	This file contains no QuickTime or Toolbox calls, and it depends only on the C library and on the
+//	operating system's file mapping calls; it builds on Windows and on any POSIX system. For instance:
+//
+//		cc -c -I"Common Files" "Common Files/QTFile.c"
+//
+// NOTES:
+//
+// *** (1) ***
+// We map the movie atom into memory and read its atoms in place. The media data is mapped through a window
+// of kQTFile_WindowSize bytes that slides along the file as samples are asked for; the sample data returned by
+// QTFile_GetSampleData points into that window, so nothing is copied, and the memory we map stays bounded no
+// matter how big the movie file is (QuickTime files of many gigabytes can't be mapped whole into a 32-bit
+// address space anyway). File offsets, sizes and times are 64-bit values throughout, so 'co64' chunk offsets,
+// version 1 headers and long movies with fine time scales work as they should. When the file is opened we read, for
+// each track, just the small atoms: the track header, the track references, the track name, the media header,
+// the handler and the first sample description. The sample table, which can be huge (a video track of a long
+// movie has hundreds of thousands of samples), is only located; it's decoded the first time a sample of that
+// track is asked for. So opening a movie and finding its text tracks doesn't depend on the size of its other
+// tracks' sample tables, and a damaged sample table makes only that track's samples unavailable.
+//
+// Since decoding a sample table changes the track, a movie must not be used by several threads at once.
+//
+// *** (2) ***
+// The sample table atoms ('stts', 'stsc', 'stsz' and 'stco' or 'co64') are run-length encoded, so finding the
+// sample at a given time or the offset of a given sample means walking them from the start. We decode them once,
+// into three flat arrays indexed by sample number: the start times (cumulative, with one extra entry for the end
+// of the last sample, so a sample's duration is the difference of two neighbours), the sizes and the file offsets.
+// Looking up a sample by number is then an array index, and by time a binary search (QTFile_GetSampleBounds).
+//
+// *** (3) ***
+// Track times and media times are related through the track's edit list ('elst'), which we read when the file is
+// opened; a track without an edit list has a single edit that plays all its media, once. A media time can be
+// played by several edits, or by none (QuickTime leaves the old sample in the media when a text sample is
+// edited, and takes it out of the track), so QTFile_MediaTimeToMovieTime returns the first time the track plays
+// it, or kQTFile_NoTime. To visit the samples of a track in the order it plays them (for instance, the chapters
+// of a chapter track), use QTFile_GetIndTrackSample rather than the media sample numbers; the list of track
+// samples is found, like the sample table, the first time it's needed. An edit whose media rate isn't positive
+// is taken to show the sample at its media time for the whole edit.
+//
+// *** (4) ***
+// Every offset and size read from the file is checked against the bounds of its parent atom (or of the file),
+// so a damaged file yields kQTFileErr_InvalidMovie or kQTFileErr_InvalidSampleTable rather than a crash. A track
+// whose atoms can't be read is left out of the movie (and counted in its fBadTrackCount field), so that one bad
+// track doesn't keep us from reading the others; only a missing or damaged movie header fails the whole open.
+//
+// *** (5) ***
+// The samples of a text track are small, and in an interleaved movie they're scattered through the file between
+// big chunks of video and sound; reading them through the window of note (1) means a page fault, and so a
+// synchronous read, for each one. QTFile_LoadTrackData instead reads the data of all the samples of a track
+// into one buffer (merging samples that are next to each other in the file into a single read), and keeps up
+// to kQTFile_ReadBatchSize reads in progress at once, so the disk or the network file system can reorder and
+// overlap them. On Linux we use io_uring, with the buffer registered with the kernel; elsewhere, or if the
+// kernel doesn't support io_uring, we fall back to one blocking read after the other.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#if !defined(_WIN32)
+#define _FILE_OFFSET_BITS				64				// for files larger than 2 GB
+#endif
+
+#include "QTFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if QTFILE_USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kTextDescFontOffset				46				// offset of defaultStyle.scrpFont in a text sample description
+#define kMaxLong						0x7FFFFFFFL
+#define kMaxTimeValue					((QTFileTimeValue)(~(QTFileUInt64)0 >> 1))
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// the sample table atoms of a track
+typedef struct QTFileSampleTable {
+	QTFileAtom						fTimeToSample;
+	QTFileAtom						fSampleToChunk;
+	QTFileAtom						fSampleSize;
+	QTFileAtom						fChunkOffset;
+	int								fIs64Bit;		// is fChunkOffset a 'co64' atom?
+} QTFileSampleTable, *QTFileSampleTablePtr;
+
+// the mapping information of an open movie file
+typedef struct QTFileMapping {
+#if defined(_WIN32)
+	HANDLE							fFile;			// the file
+	HANDLE							fFileMapping;	// the file mapping object
+#else
+	int								fFile;			// the file
+#endif
+	QTFileUInt64					fGranularity;	// the offset of a mapped view must be a multiple of this
+	void							*fMovieView;	// the view holding the movie atom
+	size_t							fMovieViewSize;
+	void							*fWindow;		// the view holding the current window onto the media data
+	size_t							fWindowSize;
+	QTFileUInt64					fWindowOffset;	// the offset in the file of fWindow
+} QTFileMapping, *QTFileMappingPtr;
+
+// a read of sample data into memory
+typedef struct QTFileRead {
+	QTFileUInt64					fOffset;		// the offset in the file of the data
+	long							fSize;			// the size of the data
+	unsigned char					*fData;			// where the data goes
+} QTFileRead, *QTFileReadPtr;
+
+#if QTFILE_USE_IO_URING
+// an io_uring instance; the submission and completion queues are shared with the kernel
+typedef struct QTFileRing {
+	int								fRing;			// the io_uring file descriptor
+	struct io_uring_params			fParams;		// the offsets of the fields of the queues, and their sizes
+	unsigned char					*fSubmitQueue;	// the mapped submission queue
+	size_t							fSubmitQueueSize;
+	unsigned char					*fCompleteQueue;// the mapped completion queue
+	size_t							fCompleteQueueSize;
+	struct io_uring_sqe				*fEntries;		// the mapped submission queue entries
+	size_t							fEntriesSize;
+} QTFileRing, *QTFileRingPtr;
+#endif
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static long					QTFile_OpenFile (const char *thePath, QTFileMoviePtr theMovie);
+static void					QTFile_CloseFile (QTFileMoviePtr theMovie);
+static const unsigned char	*QTFile_MapView (QTFileMoviePtr theMovie, QTFileUInt64 theOffset, QTFileUInt64 theSize, void **theView, size_t *theViewSize);
+static void					QTFile_UnmapView (void *theView, size_t theViewSize);
+static const unsigned char	*QTFile_GetWindow (QTFileMoviePtr theMovie, QTFileUInt64 theOffset, QTFileUInt64 theSize);
+static long					QTFile_ReadData (QTFileMoviePtr theMovie, QTFileUInt64 theOffset, unsigned char *theData, long theSize);
+static long					QTFile_ReadBatch (QTFileMoviePtr theMovie, const QTFileRead *theReads, long theReadCount, unsigned char *theBuffer, long theBufferSize);
+#if QTFILE_USE_IO_URING
+static long					QTFile_ReadBatchAsync (QTFileMoviePtr theMovie, const QTFileRead *theReads, long theReadCount, unsigned char *theBuffer, long theBufferSize);
+static long					QTFile_OpenRing (QTFileRingPtr theRing, unsigned theEntryCount);
+static void					QTFile_CloseRing (QTFileRingPtr theRing);
+#endif
+static long					QTFile_ParseMovieAtom (QTFileMoviePtr theMovie, const QTFileAtom *theMovieAtom);
+static long					QTFile_ParseTrackAtom (QTFileMoviePtr theMovie, const QTFileAtom *theTrackAtom, QTFileTrackPtr theTrack);
+static long					QTFile_ParseTrackReferences (const QTFileAtom *theRefAtom, QTFileTrackPtr theTrack);
+static void					QTFile_ParseTrackName (const QTFileAtom *theUserData, QTFileTrackPtr theTrack);
+static long					QTFile_ParseEditList (const QTFileAtom *theTrackAtom, QTFileTrackPtr theTrack);
+static long					QTFile_LoadSampleTable (QTFileTrackPtr theTrack);
+static long					QTFile_ParseSampleTable (QTFileMoviePtr theMovie, const QTFileSampleTable *theTable, QTFileTrackPtr theTrack);
+static long					QTFile_LoadTrackSamples (QTFileTrackPtr theTrack);
+static QTFileTimeValue		QTFile_EditMediaToTrack (QTFileTrackPtr theTrack, const QTFileEdit *theEdit, QTFileTimeValue theMediaOffset);
+static void					QTFile_DisposeTracks (QTFileMoviePtr theMovie);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Movie file utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_OpenMovie
+// Open the movie file having the specified path and read its movie atom; return the movie through theMovie.
+//
+// The caller is responsible for closing the movie (by calling QTFile_CloseMovie).
+//
+//////////
+
+long QTFile_OpenMovie (const char *thePath, QTFileMoviePtr *theMovie)
+{
+	QTFileMoviePtr		myMovie = NULL;
+	QTFileMappingPtr	myMapping = NULL;
+	const unsigned char	*myHeader = NULL;
+	QTFileAtom			myAtom;
+	QTFileUInt64		myOffset = 0;
+	QTFileUInt64		myAtomSize;
+	long				myHeaderSize;
+	long				myErr = kQTFileErr_NoErr;
+
+	if (theMovie == NULL)
+		return(kQTFileErr_Param);
+
+	*theMovie = NULL;
+
+	if (thePath == NULL)
+		return(kQTFileErr_Param);
+
+	myMovie = (QTFileMoviePtr)calloc(1, sizeof(QTFileMovie));
+	if (myMovie == NULL)
+		return(kQTFileErr_MemFull);
+
+	myErr = QTFile_OpenFile(thePath, myMovie);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	myMapping = (QTFileMappingPtr)myMovie->fMapping;
+
+	// find the movie atom among the top-level atoms; we look only at their headers, since the media data
+	// atoms can be gigabytes long
+	myErr = kQTFileErr_InvalidMovie;
+	while (myMovie->fSize - myOffset >= kQTFile_AtomHeaderSize) {
+		myHeaderSize = kQTFile_AtomHeaderSize;
+		if (myMovie->fSize - myOffset >= kQTFile_ExtendedAtomHeaderSize)
+			myHeaderSize = kQTFile_ExtendedAtomHeaderSize;
+
+		myHeader = QTFile_GetWindow(myMovie, myOffset, myHeaderSize);
+		if (myHeader == NULL) {
+			myErr = kQTFileErr_IO;
+			break;
+		}
+
+		myAtomSize = QTFile_Get32(myHeader);
+		myAtom.fType = QTFile_Get32(myHeader + 4);
+		if ((myAtomSize == 1) && (myHeaderSize == kQTFile_ExtendedAtomHeaderSize)) {
+			// a 64-bit atom size follows the type
+			myAtomSize = QTFile_Get64(myHeader + 8);
+		} else if (myAtomSize == 0) {
+			// the atom extends to the end of the file
+			myAtomSize = myMovie->fSize - myOffset;
+		} else {
+			myHeaderSize = kQTFile_AtomHeaderSize;
+		}
+
+		if ((myAtomSize < (QTFileUInt64)myHeaderSize) || (myAtomSize > myMovie->fSize - myOffset))
+			break;
+
+		if (myAtom.fType == kQTFile_MovieAtom) {
+			// the movie atom is read in place, so it must fit into memory
+			if (myAtomSize - myHeaderSize > (QTFileUInt64)kMaxLong)
+				break;
+
+			myAtom.fData = QTFile_MapView(myMovie, myOffset + myHeaderSize, myAtomSize - myHeaderSize, &myMapping->fMovieView, &myMapping->fMovieViewSize);
+			myAtom.fSize = (long)(myAtomSize - myHeaderSize);
+			if (myAtom.fData == NULL) {
+				myErr = kQTFileErr_IO;
+				break;
+			}
+
+			myErr = QTFile_ParseMovieAtom(myMovie, &myAtom);
+			break;
+		}
+
+		myOffset += myAtomSize;
+	}
+
+bail:
+	if (myErr != kQTFileErr_NoErr)
+		QTFile_CloseMovie(myMovie);
+	else
+		*theMovie = myMovie;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_CloseMovie
+// Close the specified movie and dispose of all the memory associated with it.
+//
+//////////
+
+void QTFile_CloseMovie (QTFileMoviePtr theMovie)
+{
+	if (theMovie == NULL)
+		return;
+
+	QTFile_DisposeTracks(theMovie);
+	QTFile_CloseFile(theMovie);
+	free(theMovie);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Track utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_GetTrackCount
+// Return the number of tracks in the specified movie.
+//
+//////////
+
+long QTFile_GetTrackCount (QTFileMoviePtr theMovie)
+{
+	return((theMovie != NULL) ? theMovie->fTrackCount : 0);
+}
+
+
+//////////
+//
+// QTFile_GetIndTrack
+// Return the track in the specified movie that has the specified index (starting at 1), or NULL.
+//
+//////////
+
+QTFileTrackPtr QTFile_GetIndTrack (QTFileMoviePtr theMovie, long theIndex)
+{
+	if ((theMovie == NULL) || (theIndex < 1) || (theIndex > theMovie->fTrackCount))
+		return(NULL);
+
+	return(&theMovie->fTracks[theIndex - 1]);
+}
+
+
+//////////
+//
+// QTFile_GetIndTrackType
+// Return the track in the specified movie that has the specified index among the tracks of the specified
+// media type, or NULL. As a special case, kQTFile_TextMediaType matches any kind of text track.
+//
+//////////
+
+QTFileTrackPtr QTFile_GetIndTrackType (QTFileMoviePtr theMovie, long theIndex, QTFileOSType theMediaType)
+{
+	long				myIndex;
+	long				myCount = 0;
+	QTFileTrackPtr		myTrack = NULL;
+
+	if ((theMovie == NULL) || (theIndex < 1))
+		return(NULL);
+
+	for (myIndex = 0; myIndex < theMovie->fTrackCount; myIndex++) {
+		myTrack = &theMovie->fTracks[myIndex];
+		if ((myTrack->fMediaType == theMediaType) || ((theMediaType == kQTFile_TextMediaType) && QTFile_IsTextTrack(myTrack)))
+			if (++myCount == theIndex)
+				return(myTrack);
+	}
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTFile_GetTrackByID
+// Return the track in the specified movie that has the specified track ID, or NULL.
+//
+//////////
+
+QTFileTrackPtr QTFile_GetTrackByID (QTFileMoviePtr theMovie, QTFileUInt32 theTrackID)
+{
+	long				myIndex;
+
+	if (theMovie == NULL)
+		return(NULL);
+
+	for (myIndex = 0; myIndex < theMovie->fTrackCount; myIndex++)
+		if (theMovie->fTracks[myIndex].fTrackID == theTrackID)
+			return(&theMovie->fTracks[myIndex]);
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTFile_GetTrackReferenceCount
+// Return the number of track references of the specified type in the specified track.
+//
+//////////
+
+long QTFile_GetTrackReferenceCount (QTFileTrackPtr theTrack, QTFileOSType theType)
+{
+	long				myIndex;
+	long				myCount = 0;
+
+	if (theTrack == NULL)
+		return(0);
+
+	for (myIndex = 0; myIndex < theTrack->fRefCount; myIndex++)
+		if (theTrack->fRefs[myIndex].fType == theType)
+			myCount++;
+
+	return(myCount);
+}
+
+
+//////////
+//
+// QTFile_GetTrackReference
+// Return the track referred to by the track reference of the specified type and index (starting at 1)
+// in the specified track, or NULL.
+//
+//////////
+
+QTFileTrackPtr QTFile_GetTrackReference (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, QTFileOSType theType, long theIndex)
+{
+	long				myIndex;
+	long				myCount = 0;
+
+	if ((theMovie == NULL) || (theTrack == NULL) || (theIndex < 1))
+		return(NULL);
+
+	for (myIndex = 0; myIndex < theTrack->fRefCount; myIndex++)
+		if (theTrack->fRefs[myIndex].fType == theType)
+			if (++myCount == theIndex)
+				return(QTFile_GetTrackByID(theMovie, theTrack->fRefs[myIndex].fTrackID));
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTFile_IsTextTrack
+// Is the specified track a text track (a QuickTime text track or an MPEG-4 timed text track)?
+//
+//////////
+
+int QTFile_IsTextTrack (QTFileTrackPtr theTrack)
+{
+	if (theTrack == NULL)
+		return(0);
+
+	return((theTrack->fMediaType == kQTFile_TextMediaType) || (theTrack->fMediaType == kQTFile_SubtitleMediaType) || (theTrack->fMediaType == kQTFile_MPEG4TextMediaType));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Sample utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_GetSampleCount
+// Return the number of media samples in the specified track.
+//
+//////////
+
+long QTFile_GetSampleCount (QTFileTrackPtr theTrack)
+{
+	if (QTFile_LoadSampleTable(theTrack) != kQTFileErr_NoErr)
+		return(0);
+
+	return(theTrack->fSampleCount);
+}
+
+
+//////////
+//
+// QTFile_GetSampleData
+// Return, through theData and theSize, the data of the sample in the specified track that has the specified
+// sample number (starting at 1).
+//
+// The data points into a mapped view of the file; it remains valid until the next call to QTFile_GetSampleData
+// for the same movie, or until the movie is closed. If the data of the track has been read into memory with
+// QTFile_LoadTrackData, the data points there instead, and remains valid until the data is unloaded.
+//
+//////////
+
+long QTFile_GetSampleData (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, long theSampleNum, const unsigned char **theData, long *theSize)
+{
+	long				myErr = kQTFileErr_NoErr;
+
+	if ((theMovie == NULL) || (theTrack == NULL) || (theData == NULL) || (theSize == NULL))
+		return(kQTFileErr_Param);
+
+	myErr = QTFile_LoadSampleTable(theTrack);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	if ((theSampleNum < 1) || (theSampleNum > theTrack->fSampleCount))
+		return(kQTFileErr_Param);
+
+	if (theTrack->fSampleData != NULL) {
+		*theData = theTrack->fSampleData + theTrack->fSampleDataOffsets[theSampleNum - 1];
+		*theSize = theTrack->fSampleSizes[theSampleNum - 1];
+		return(kQTFileErr_NoErr);
+	}
+
+	*theData = QTFile_GetWindow(theMovie, theTrack->fSampleOffsets[theSampleNum - 1], theTrack->fSampleSizes[theSampleNum - 1]);
+	*theSize = theTrack->fSampleSizes[theSampleNum - 1];
+
+	return((*theData != NULL) ? kQTFileErr_NoErr : kQTFileErr_IO);
+}
+
+
+//////////
+//
+// QTFile_LoadTrackData
+// Read the data of all the samples of the specified track into memory; see note (5).
+//
+// This is meant for text tracks, whose samples are small. We refuse (with kQTFileErr_Unimplemented) to read
+// more than kQTFile_MaxTrackDataSize bytes; the samples of such a track can still be had one at a time.
+//
+//////////
+
+long QTFile_LoadTrackData (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack)
+{
+	QTFileReadPtr		myReads = NULL;
+	QTFileUInt64		myDataSize = 0;
+	QTFileUInt64		myOffset;
+	long				mySize;
+	long				myReadCount = 0;
+	long				myIndex;
+	long				myErr = kQTFileErr_NoErr;
+
+	if ((theMovie == NULL) || (theTrack == NULL))
+		return(kQTFileErr_Param);
+
+	if (theTrack->fSampleData != NULL)
+		return(kQTFileErr_NoErr);
+
+	myErr = QTFile_LoadSampleTable(theTrack);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	// make sure that all the samples are in the file, and that they fit in memory
+	for (myIndex = 0; myIndex < theTrack->fSampleCount; myIndex++) {
+		myOffset = theTrack->fSampleOffsets[myIndex];
+		mySize = theTrack->fSampleSizes[myIndex];
+		if ((myOffset > theMovie->fSize) || ((QTFileUInt64)mySize > theMovie->fSize - myOffset))
+			return(kQTFileErr_InvalidSampleTable);
+
+		myDataSize += mySize;
+		if (myDataSize > kQTFile_MaxTrackDataSize)
+			return(kQTFileErr_Unimplemented);
+	}
+
+	theTrack->fSampleData = (unsigned char *)malloc((myDataSize > 0) ? (size_t)myDataSize : 1);
+	theTrack->fSampleDataOffsets = (long *)malloc((theTrack->fSampleCount + 1) * sizeof(long));
+	myReads = (QTFileReadPtr)malloc((theTrack->fSampleCount + 1) * sizeof(QTFileRead));
+	if ((theTrack->fSampleData == NULL) || (theTrack->fSampleDataOffsets == NULL) || (myReads == NULL)) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	// put the samples one after the other in the buffer; samples that are next to each other in the file
+	// (for instance, the samples in a chunk) are read together
+	myDataSize = 0;
+	for (myIndex = 0; myIndex < theTrack->fSampleCount; myIndex++) {
+		myOffset = theTrack->fSampleOffsets[myIndex];
+		mySize = theTrack->fSampleSizes[myIndex];
+		theTrack->fSampleDataOffsets[myIndex] = (long)myDataSize;
+
+		if (mySize == 0)
+			continue;
+
+		if ((myReadCount > 0) && (myReads[myReadCount - 1].fOffset + myReads[myReadCount - 1].fSize == myOffset)) {
+			myReads[myReadCount - 1].fSize += mySize;
+		} else {
+			myReads[myReadCount].fOffset = myOffset;
+			myReads[myReadCount].fSize = mySize;
+			myReads[myReadCount].fData = theTrack->fSampleData + myDataSize;
+			myReadCount++;
+		}
+
+		myDataSize += mySize;
+	}
+
+	myErr = QTFile_ReadBatch(theMovie, myReads, myReadCount, theTrack->fSampleData, (long)myDataSize);
+
+bail:
+	free(myReads);
+
+	if (myErr != kQTFileErr_NoErr)
+		QTFile_UnloadTrackData(theTrack);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_UnloadTrackData
+// Dispose of the copy of the sample data of the specified track made by QTFile_LoadTrackData, if any.
+//
+//////////
+
+void QTFile_UnloadTrackData (QTFileTrackPtr theTrack)
+{
+	if (theTrack == NULL)
+		return;
+
+	free(theTrack->fSampleData);
+	free(theTrack->fSampleDataOffsets);
+	theTrack->fSampleData = NULL;
+	theTrack->fSampleDataOffsets = NULL;
+}
+
+
+//////////
+//
+// QTFile_GetSampleTime
+// Return, through theTime and theDuration, the media time and duration of the sample in the specified track
+// that has the specified sample number (starting at 1).
+//
+//////////
+
+long QTFile_GetSampleTime (QTFileTrackPtr theTrack, long theSampleNum, QTFileTimeValue *theTime, QTFileTimeValue *theDuration)
+{
+	long				myErr = kQTFileErr_NoErr;
+
+	myErr = QTFile_LoadSampleTable(theTrack);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	if ((theSampleNum < 1) || (theSampleNum > theTrack->fSampleCount))
+		return(kQTFileErr_Param);
+
+	if (theTime != NULL)
+		*theTime = theTrack->fSampleTimes[theSampleNum - 1];
+
+	if (theDuration != NULL)
+		*theDuration = theTrack->fSampleTimes[theSampleNum] - theTrack->fSampleTimes[theSampleNum - 1];
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_MediaTimeToSampleNum
+// Return the number of the sample in the specified track that contains the specified media time, or 0.
+//
+//////////
+
+long QTFile_MediaTimeToSampleNum (QTFileTrackPtr theTrack, QTFileTimeValue theTime)
+{
+	long				mySampleNum = 0;
+
+	QTFile_GetSampleBounds(theTrack, theTime, &mySampleNum, NULL, NULL);
+
+	return(mySampleNum);
+}
+
+
+//////////
+//
+// QTFile_GetSampleBounds
+// Return, through theSampleNum, theStartTime and theEndTime, the number and the media start and end times
+// of the sample in the specified track that contains the specified media time.
+//
+// The sample start times are stored in ascending order, so this is a binary search. If several samples start
+// at the same time (that is, some have a duration of 0), we return the last of them, which is the one displayed.
+//
+//////////
+
+long QTFile_GetSampleBounds (QTFileTrackPtr theTrack, QTFileTimeValue theTime, long *theSampleNum, QTFileTimeValue *theStartTime, QTFileTimeValue *theEndTime)
+{
+	const QTFileTimeValue	*myTimes = NULL;
+	long				myLow = 0;
+	long				myHigh;
+	long				myMiddle;
+
+	if (theSampleNum != NULL)
+		*theSampleNum = 0;
+
+	if ((QTFile_LoadSampleTable(theTrack) != kQTFileErr_NoErr) || (theTrack->fSampleCount == 0))
+		return(kQTFileErr_Param);
+
+	myTimes = theTrack->fSampleTimes;
+	if ((theTime < myTimes[0]) || (theTime >= myTimes[theTrack->fSampleCount]))
+		return(kQTFileErr_Param);
+
+	// find the last sample that starts at or before the specified time
+	myHigh = theTrack->fSampleCount - 1;
+	while (myLow < myHigh) {
+		myMiddle = myLow + ((myHigh - myLow + 1) / 2);
+		if (myTimes[myMiddle] <= theTime)
+			myLow = myMiddle;
+		else
+			myHigh = myMiddle - 1;
+	}
+
+	if (theSampleNum != NULL)
+		*theSampleNum = myLow + 1;
+
+	if (theStartTime != NULL)
+		*theStartTime = myTimes[myLow];
+
+	if (theEndTime != NULL)
+		*theEndTime = myTimes[myLow + 1];
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_GetTrackSampleCount
+// Return the number of samples that the specified track plays; see note (3).
+//
+//////////
+
+long QTFile_GetTrackSampleCount (QTFileTrackPtr theTrack)
+{
+	if (QTFile_LoadTrackSamples(theTrack) != kQTFileErr_NoErr)
+		return(0);
+
+	return(theTrack->fTrackSampleCount);
+}
+
+
+//////////
+//
+// QTFile_GetIndTrackSample
+// Return, through theSampleNum and theTrackTime, the media sample number of the sample that the specified track
+// plays with the specified index (starting at 1), and the track time at which the track starts playing it.
+//
+//////////
+
+long QTFile_GetIndTrackSample (QTFileTrackPtr theTrack, long theIndex, long *theSampleNum, QTFileTimeValue *theTrackTime)
+{
+	long				myErr = kQTFileErr_NoErr;
+
+	myErr = QTFile_LoadTrackSamples(theTrack);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	if ((theIndex < 1) || (theIndex > theTrack->fTrackSampleCount))
+		return(kQTFileErr_Param);
+
+	if (theSampleNum != NULL)
+		*theSampleNum = theTrack->fTrackSamples[theIndex - 1].fSampleNum;
+
+	if (theTrackTime != NULL)
+		*theTrackTime = theTrack->fTrackSamples[theIndex - 1].fTrackTime;
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_MediaTimeToMovieTime
+// Convert the specified media time of the specified track into movie time; return kQTFile_NoTime if the track's
+// edits don't play that media time. If several edits play it, we return the time at which the first one does.
+//
+//////////
+
+QTFileTimeValue QTFile_MediaTimeToMovieTime (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, QTFileTimeValue theTime)
+{
+	const QTFileEdit	*myEdit = NULL;
+	long				myIndex;
+
+	if ((theMovie == NULL) || (theTrack == NULL) || (theTrack->fTimeScale <= 0))
+		return(theTime);
+
+	for (myIndex = 0; myIndex < theTrack->fEditCount; myIndex++) {
+		myEdit = &theTrack->fEdits[myIndex];
+		if ((myEdit->fMediaTime == kQTFile_NoTime) || (theTime < myEdit->fMediaTime))
+			continue;
+
+		// an edit that doesn't move through its media shows only the media at its start
+		if ((theTime < myEdit->fMediaTime + myEdit->fMediaDuration) || (theTime == myEdit->fMediaTime))
+			return(myEdit->fTrackTime + QTFile_EditMediaToTrack(theTrack, myEdit, theTime - myEdit->fMediaTime));
+	}
+
+	return(kQTFile_NoTime);
+}
+
+
+//////////
+//
+// QTFile_MovieTimeToMediaTime
+// Convert the specified movie time into media time of the specified track; return kQTFile_NoTime if the track
+// plays no media at that time (because it falls in an empty edit, or after the end of the track).
+//
+//////////
+
+QTFileTimeValue QTFile_MovieTimeToMediaTime (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, QTFileTimeValue theTime)
+{
+	const QTFileEdit	*myEdit = NULL;
+	QTFileTimeValue		myOffset;
+	long				myIndex;
+
+	if ((theMovie == NULL) || (theTrack == NULL) || (theMovie->fTimeScale <= 0))
+		return(theTime);
+
+	for (myIndex = 0; myIndex < theTrack->fEditCount; myIndex++) {
+		myEdit = &theTrack->fEdits[myIndex];
+		if ((theTime < myEdit->fTrackTime) || (theTime >= myEdit->fTrackTime + myEdit->fDuration))
+			continue;
+
+		if ((myEdit->fMediaTime == kQTFile_NoTime) || ((int)myEdit->fRate <= 0))
+			return(myEdit->fMediaTime);
+
+		myOffset = QTFile_ConvertTimeScale(theTime - myEdit->fTrackTime, theMovie->fTimeScale, theTrack->fTimeScale);
+		if (myEdit->fRate != kQTFile_UnityRate)
+			myOffset = (myOffset * (QTFileTimeValue)myEdit->fRate) / kQTFile_UnityRate;
+
+		return(myEdit->fMediaTime + myOffset);
+	}
+
+	return(kQTFile_NoTime);
+}
+
+
+//////////
+//
+// QTFile_ConvertTimeScale
+// Convert the specified time from one time scale to another.
+//
+//////////
+
+QTFileTimeValue QTFile_ConvertTimeScale (QTFileTimeValue theTime, long theOldScale, long theNewScale)
+{
+	if ((theOldScale <= 0) || (theOldScale == theNewScale))
+		return(theTime);
+
+	// scale the whole seconds and the remainder separately, so that long times don't overflow
+	return(((theTime / theOldScale) * theNewScale) + (((theTime % theOldScale) * theNewScale) / theOldScale));
+}
+
+
+//////////
+//
+// QTFile_Get32
+// Return the big-endian 32-bit value at the specified address.
+//
+//////////
+
+QTFileUInt32 QTFile_Get32 (const unsigned char *theData)
+{
+	return(((QTFileUInt32)theData[0] << 24) | ((QTFileUInt32)theData[1] << 16) | ((QTFileUInt32)theData[2] << 8) | (QTFileUInt32)theData[3]);
+}
+
+
+//////////
+//
+// QTFile_Get16
+// Return the big-endian 16-bit value at the specified address.
+//
+//////////
+
+QTFileUInt16 QTFile_Get16 (const unsigned char *theData)
+{
+	return((QTFileUInt16)(((QTFileUInt16)theData[0] << 8) | (QTFileUInt16)theData[1]));
+}
+
+
+//////////
+//
+// QTFile_Get64
+// Return the big-endian 64-bit value at the specified address.
+//
+//////////
+
+QTFileUInt64 QTFile_Get64 (const unsigned char *theData)
+{
+	return(((QTFileUInt64)QTFile_Get32(theData) << 32) | (QTFileUInt64)QTFile_Get32(theData + 4));
+}
+
+
+//////////
+//
+// QTFile_Put32
+// Store the specified 32-bit value, big-endian, at the specified address.
+//
+//////////
+
+void QTFile_Put32 (unsigned char *theData, QTFileUInt32 theValue)
+{
+	theData[0] = (unsigned char)(theValue >> 24);
+	theData[1] = (unsigned char)(theValue >> 16);
+	theData[2] = (unsigned char)(theValue >> 8);
+	theData[3] = (unsigned char)theValue;
+}
+
+
+//////////
+//
+// QTFile_Put16
+// Store the specified 16-bit value, big-endian, at the specified address.
+//
+//////////
+
+void QTFile_Put16 (unsigned char *theData, QTFileUInt16 theValue)
+{
+	theData[0] = (unsigned char)(theValue >> 8);
+	theData[1] = (unsigned char)theValue;
+}
+
+
+//////////
+//
+// QTFile_Put64
+// Store the specified 64-bit value, big-endian, at the specified address.
+//
+//////////
+
+void QTFile_Put64 (unsigned char *theData, QTFileUInt64 theValue)
+{
+	QTFile_Put32(theData, (QTFileUInt32)(theValue >> 32));
+	QTFile_Put32(theData + 4, (QTFileUInt32)theValue);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Atom utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_GetAtom
+// Get the atom at offset *theOffset in the specified data; advance *theOffset to the next atom.
+//
+// Return 1 if we got an atom, 0 at the end of the data or if the atom doesn't fit in the data.
+//
+//////////
+
+int QTFile_GetAtom (const unsigned char *theData, long theSize, long *theOffset, QTFileAtomPtr theAtom)
+{
+	long				myOffset = *theOffset;
+	long				myHeaderSize = kQTFile_AtomHeaderSize;
+	QTFileUInt64		myAtomSize;
+
+	if ((myOffset < 0) || (theSize - myOffset < kQTFile_AtomHeaderSize))
+		return(0);
+
+	myAtomSize = QTFile_Get32(theData + myOffset);
+	theAtom->fType = QTFile_Get32(theData + myOffset + 4);
+
+	if (myAtomSize == 1) {
+		// a 64-bit atom size follows the type
+		if (theSize - myOffset < kQTFile_ExtendedAtomHeaderSize)
+			return(0);
+
+		myAtomSize = QTFile_Get64(theData + myOffset + 8);
+		myHeaderSize = kQTFile_ExtendedAtomHeaderSize;
+	} else if (myAtomSize == 0) {
+		// the atom extends to the end of the data
+		myAtomSize = (QTFileUInt64)(theSize - myOffset);
+	}
+
+	if ((myAtomSize < (QTFileUInt64)myHeaderSize) || (myAtomSize > (QTFileUInt64)(theSize - myOffset)))
+		return(0);
+
+	theAtom->fData = theData + myOffset + myHeaderSize;
+	theAtom->fSize = (long)myAtomSize - myHeaderSize;
+	*theOffset = myOffset + (long)myAtomSize;
+
+	return(1);
+}
+
+
+//////////
+//
+// QTFile_FindChildAtom
+// Find the first child atom of the specified type in the specified parent atom.
+//
+//////////
+
+int QTFile_FindChildAtom (const QTFileAtom *theParent, QTFileOSType theType, QTFileAtomPtr theAtom)
+{
+	QTFileAtom			myAtom;
+	long				myOffset = 0;
+
+	// theAtom may be theParent, so don't change it until we've found the child
+	while (QTFile_GetAtom(theParent->fData, theParent->fSize, &myOffset, &myAtom))
+		if (myAtom.fType == theType) {
+			*theAtom = myAtom;
+			return(1);
+		}
+
+	return(0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Internal utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_OpenFile
+// Open the file having the specified path, for mapping.
+//
+//////////
+
+static long QTFile_OpenFile (const char *thePath, QTFileMoviePtr theMovie)
+{
+	QTFileMappingPtr	myMapping = NULL;
+#if defined(_WIN32)
+	SYSTEM_INFO			mySystemInfo;
+	DWORD				mySizeHigh = 0;
+	DWORD				mySize = 0;
+#else
+	struct stat			myStat;
+#endif
+
+	myMapping = (QTFileMappingPtr)calloc(1, sizeof(QTFileMapping));
+	if (myMapping == NULL)
+		return(kQTFileErr_MemFull);
+
+#if !defined(_WIN32)
+	myMapping->fFile = -1;
+#endif
+
+	theMovie->fMapping = (void *)myMapping;
+
+#if defined(_WIN32)
+	myMapping->fFile = CreateFileA(thePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (myMapping->fFile == INVALID_HANDLE_VALUE)
+		return(kQTFileErr_FileNotFound);
+
+	mySize = GetFileSize(myMapping->fFile, &mySizeHigh);
+	if ((mySize == INVALID_FILE_SIZE) && (GetLastError() != NO_ERROR))
+		return(kQTFileErr_IO);
+
+	theMovie->fSize = ((QTFileUInt64)mySizeHigh << 32) | mySize;
+	if (theMovie->fSize == 0)
+		return(kQTFileErr_InvalidMovie);
+
+	// the mapping object covers the whole file, but no part of it is mapped until we ask for a view
+	myMapping->fFileMapping = CreateFileMapping(myMapping->fFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (myMapping->fFileMapping == NULL)
+		return(kQTFileErr_IO);
+
+	GetSystemInfo(&mySystemInfo);
+	myMapping->fGranularity = mySystemInfo.dwAllocationGranularity;
+#else
+	myMapping->fFile = open(thePath, O_RDONLY);
+	if (myMapping->fFile < 0)
+		return(kQTFileErr_FileNotFound);
+
+	if ((fstat(myMapping->fFile, &myStat) != 0) || (myStat.st_size <= 0))
+		return(kQTFileErr_InvalidMovie);
+
+	theMovie->fSize = (QTFileUInt64)myStat.st_size;
+	myMapping->fGranularity = (QTFileUInt64)sysconf(_SC_PAGESIZE);
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_CloseFile
+// Unmap all the views of the file of the specified movie, and close it.
+//
+//////////
+
+static void QTFile_CloseFile (QTFileMoviePtr theMovie)
+{
+	QTFileMappingPtr	myMapping = (QTFileMappingPtr)theMovie->fMapping;
+
+	if (myMapping == NULL)
+		return;
+
+	QTFile_UnmapView(myMapping->fMovieView, myMapping->fMovieViewSize);
+	QTFile_UnmapView(myMapping->fWindow, myMapping->fWindowSize);
+
+#if defined(_WIN32)
+	if (myMapping->fFileMapping != NULL)
+		CloseHandle(myMapping->fFileMapping);
+	if (myMapping->fFile != INVALID_HANDLE_VALUE)
+		CloseHandle(myMapping->fFile);
+#else
+	if (myMapping->fFile >= 0)
+		close(myMapping->fFile);
+#endif
+
+	free(myMapping);
+	theMovie->fMapping = NULL;
+}
+
+
+//////////
+//
+// QTFile_MapView
+// Map theSize bytes at the specified offset of the file of the specified movie; return a pointer to the
+// first of those bytes, or NULL if they can't be mapped. The view (which starts at the mapping granularity
+// boundary at or before the offset) is returned through theView and theViewSize, for QTFile_UnmapView.
+//
+//////////
+
+static const unsigned char *QTFile_MapView (QTFileMoviePtr theMovie, QTFileUInt64 theOffset, QTFileUInt64 theSize, void **theView, size_t *theViewSize)
+{
+	QTFileMappingPtr	myMapping = (QTFileMappingPtr)theMovie->fMapping;
+	QTFileUInt64		myStart;
+	QTFileUInt64		myLength;
+	void				*myView = NULL;
+
+	*theView = NULL;
+	*theViewSize = 0;
+
+	if ((theOffset > theMovie->fSize) || (theSize > theMovie->fSize - theOffset))
+		return(NULL);
+
+	myStart = theOffset - (theOffset % myMapping->fGranularity);
+	myLength = (theOffset - myStart) + theSize;
+	if ((myLength == 0) || (myLength != (QTFileUInt64)(size_t)myLength))
+		return(NULL);
+
+#if defined(_WIN32)
+	myView = MapViewOfFile(myMapping->fFileMapping, FILE_MAP_READ, (DWORD)(myStart >> 32), (DWORD)myStart, (SIZE_T)myLength);
+	if (myView == NULL)
+		return(NULL);
+#else
+	myView = mmap(NULL, (size_t)myLength, PROT_READ, MAP_PRIVATE, myMapping->fFile, (off_t)myStart);
+	if (myView == MAP_FAILED)
+		return(NULL);
+#endif
+
+	*theView = myView;
+	*theViewSize = (size_t)myLength;
+
+	return((const unsigned char *)myView + (theOffset - myStart));
+}
+
+
+//////////
+//
+// QTFile_UnmapView
+// Unmap the specified view (if any).
+//
+//////////
+
+static void QTFile_UnmapView (void *theView, size_t theViewSize)
+{
+	if (theView == NULL)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile((LPCVOID)theView);
+#else
+	munmap(theView, theViewSize);
+#endif
+}
+
+
+//////////
+//
+// QTFile_GetWindow
+// Return a pointer to theSize bytes at the specified offset of the file of the specified movie, or NULL.
+//
+// The bytes are mapped through a single window, which we move (unmapping the old view) only when they don't
+// lie within it; so the pointer remains valid until the next call to this function.
+//
+//////////
+
+static const unsigned char *QTFile_GetWindow (QTFileMoviePtr theMovie, QTFileUInt64 theOffset, QTFileUInt64 theSize)
+{
+	QTFileMappingPtr	myMapping = (QTFileMappingPtr)theMovie->fMapping;
+	QTFileUInt64		myLength;
+	void				*myView = NULL;
+	size_t				myViewSize = 0;
+	const unsigned char	*myData = NULL;
+
+	if ((theOffset > theMovie->fSize) || (theSize > theMovie->fSize - theOffset))
+		return(NULL);
+
+	// there's nothing to map for an empty sample, but the caller still needs a valid pointer
+	if (theSize == 0)
+		return((const unsigned char *)"");
+
+	// are the bytes in the current window?
+	if ((myMapping->fWindow != NULL) && (theOffset >= myMapping->fWindowOffset) && (theOffset + theSize <= myMapping->fWindowOffset + myMapping->fWindowSize))
+		return((const unsigned char *)myMapping->fWindow + (theOffset - myMapping->fWindowOffset));
+
+	// no; map a new window, starting at the bytes (a sample bigger than the window gets a window of its own)
+	myLength = (theSize > kQTFile_WindowSize) ? theSize : kQTFile_WindowSize;
+	if (myLength > theMovie->fSize - theOffset)
+		myLength = theMovie->fSize - theOffset;
+
+	QTFile_UnmapView(myMapping->fWindow, myMapping->fWindowSize);
+	myMapping->fWindow = NULL;
+	myMapping->fWindowSize = 0;
+
+	myData = QTFile_MapView(theMovie, theOffset, myLength, &myView, &myViewSize);
+	if (myData == NULL)
+		return(NULL);
+
+	myMapping->fWindow = myView;
+	myMapping->fWindowSize = myViewSize;
+	myMapping->fWindowOffset = theOffset - (QTFileUInt64)(myData - (const unsigned char *)myView);
+
+	return(myData);
+}
+
+
+//////////
+//
+// QTFile_ReadData
+// Read theSize bytes at the specified offset of the file of the specified movie into theData.
+//
+//////////
+
+static long QTFile_ReadData (QTFileMoviePtr theMovie, QTFileUInt64 theOffset, unsigned char *theData, long theSize)
+{
+	QTFileMappingPtr	myMapping = (QTFileMappingPtr)theMovie->fMapping;
+#if defined(_WIN32)
+	OVERLAPPED			myOverlapped;
+	DWORD				myCount;
+
+	while (theSize > 0) {
+		// a synchronous read at an explicit offset
+		memset(&myOverlapped, 0, sizeof(myOverlapped));
+		myOverlapped.Offset = (DWORD)(theOffset & 0xFFFFFFFF);
+		myOverlapped.OffsetHigh = (DWORD)(theOffset >> 32);
+
+		if (!ReadFile(myMapping->fFile, theData, (DWORD)theSize, &myCount, &myOverlapped) || (myCount == 0))
+			return(kQTFileErr_IO);
+
+		theOffset += myCount;
+		theData += myCount;
+		theSize -= (long)myCount;
+	}
+#else
+	ssize_t				myCount;
+
+	while (theSize > 0) {
+		myCount = pread(myMapping->fFile, theData, (size_t)theSize, (off_t)theOffset);
+		if ((myCount < 0) && (errno == EINTR))
+			continue;
+		if (myCount <= 0)
+			return(kQTFileErr_IO);
+
+		theOffset += myCount;
+		theData += myCount;
+		theSize -= (long)myCount;
+	}
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_ReadBatch
+// Perform the specified reads from the file of the specified movie; all the data goes into theBuffer.
+//
+//////////
+
+static long QTFile_ReadBatch (QTFileMoviePtr theMovie, const QTFileRead *theReads, long theReadCount, unsigned char *theBuffer, long theBufferSize)
+{
+	long				myIndex;
+	long				myErr = kQTFileErr_NoErr;
+
+#if QTFILE_USE_IO_URING
+	if (QTFile_ReadBatchAsync(theMovie, theReads, theReadCount, theBuffer, theBufferSize) == kQTFileErr_NoErr)
+		return(kQTFileErr_NoErr);
+#endif
+
+	// no io_uring; read the data one piece after the other
+	for (myIndex = 0; (myIndex < theReadCount) && (myErr == kQTFileErr_NoErr); myIndex++)
+		myErr = QTFile_ReadData(theMovie, theReads[myIndex].fOffset, theReads[myIndex].fData, theReads[myIndex].fSize);
+
+	return(myErr);
+}
+
+
+#if QTFILE_USE_IO_URING
+
+//////////
+//
+// QTFile_ReadBatchAsync
+// Perform the specified reads from the file of the specified movie with io_uring, keeping as many of them in
+// progress at once as the ring has room for; all the data goes into theBuffer.
+//
+// A read that fails or comes up short is finished with QTFile_ReadData. If the ring itself can't be set up, we
+// return an error and the caller does all the reads synchronously. Whatever goes wrong, we don't close the ring
+// until every read submitted to it has completed, since the kernel would otherwise go on writing into theBuffer
+// after we've returned; if we can no longer wait for completions with io_uring_enter, we poll for them.
+//
+//////////
+
+static long QTFile_ReadBatchAsync (QTFileMoviePtr theMovie, const QTFileRead *theReads, long theReadCount, unsigned char *theBuffer, long theBufferSize)
+{
+	QTFileMappingPtr	myMapping = (QTFileMappingPtr)theMovie->fMapping;
+	QTFileRing			myRing;
+	struct iovec		myBuffer;
+	unsigned			*mySubmitTail;
+	unsigned			*mySubmitArray;
+	unsigned			mySubmitMask;
+	unsigned			*myCompleteHead;
+	unsigned			*myCompleteTail;
+	unsigned			myCompleteMask;
+	struct io_uring_cqe	*myCompletions;
+	unsigned			myHead;
+	long				myNext = 0;				// the next read to queue
+	long				myQueued = 0;			// the number of reads queued but not yet submitted
+	long				myInFlight = 0;			// the number of reads submitted but not yet completed
+	int					isFixed = 0;
+	int					canWait = 1;			// can we still wait for completions with io_uring_enter?
+	long				myResult;
+	long				myErr = kQTFileErr_NoErr;
+
+	myErr = QTFile_OpenRing(&myRing, kQTFile_ReadBatchSize);
+	if (myErr != kQTFileErr_NoErr) {
+		QTFile_CloseRing(&myRing);
+		return(myErr);
+	}
+
+	mySubmitTail = (unsigned *)(myRing.fSubmitQueue + myRing.fParams.sq_off.tail);
+	mySubmitArray = (unsigned *)(myRing.fSubmitQueue + myRing.fParams.sq_off.array);
+	mySubmitMask = *(unsigned *)(myRing.fSubmitQueue + myRing.fParams.sq_off.ring_mask);
+	myCompleteHead = (unsigned *)(myRing.fCompleteQueue + myRing.fParams.cq_off.head);
+	myCompleteTail = (unsigned *)(myRing.fCompleteQueue + myRing.fParams.cq_off.tail);
+	myCompleteMask = *(unsigned *)(myRing.fCompleteQueue + myRing.fParams.cq_off.ring_mask);
+	myCompletions = (struct io_uring_cqe *)(myRing.fCompleteQueue + myRing.fParams.cq_off.cqes);
+
+	// register the buffer, so that the kernel doesn't have to map it for each read; this fails if the buffer is
+	// over the caller's locked memory limit, in which case we just use ordinary reads
+	myBuffer.iov_base = theBuffer;
+	myBuffer.iov_len = (size_t)theBufferSize;
+	if (theBufferSize > 0)
+		isFixed = (syscall(__NR_io_uring_register, myRing.fRing, IORING_REGISTER_BUFFERS, &myBuffer, 1) == 0);
+
+	for (;;) {
+		// queue as many reads as the ring has room for (unless something has gone wrong)
+		while ((myErr == kQTFileErr_NoErr) && (myNext < theReadCount) && (myQueued + myInFlight < (long)myRing.fParams.sq_entries)) {
+			unsigned			myTail = *mySubmitTail;
+			unsigned			myIndex = myTail & mySubmitMask;
+			struct io_uring_sqe	*myEntry = &myRing.fEntries[myIndex];
+
+			memset(myEntry, 0, sizeof(struct io_uring_sqe));
+			myEntry->opcode = isFixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+			myEntry->fd = myMapping->fFile;
+			myEntry->addr = (unsigned long)theReads[myNext].fData;
+			myEntry->len = (unsigned)theReads[myNext].fSize;
+			myEntry->off = theReads[myNext].fOffset;
+			myEntry->buf_index = 0;
+			myEntry->user_data = (unsigned long)myNext;
+
+			mySubmitArray[myIndex] = myIndex;
+			__atomic_store_n(mySubmitTail, myTail + 1, __ATOMIC_RELEASE);
+
+			myQueued++;
+			myNext++;
+		}
+
+		// once something has gone wrong, we only wait for the reads already submitted
+		if ((myInFlight == 0) && ((myQueued == 0) || (myErr != kQTFileErr_NoErr)))
+			break;
+
+		// submit the queued reads, and wait for at least one read to complete
+		if (canWait) {
+			myResult = (long)syscall(__NR_io_uring_enter, myRing.fRing, (myErr == kQTFileErr_NoErr) ? (unsigned)myQueued : 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+			if (myResult < 0) {
+				if (errno == EINTR)
+					continue;
+
+				// submit nothing more, but collect the reads still in flight
+				myErr = kQTFileErr_IO;
+				canWait = 0;
+			} else if (myErr == kQTFileErr_NoErr) {
+				myQueued -= myResult;
+				myInFlight += myResult;
+			}
+		} else {
+			struct timespec		myDelay = {0, 1000000};
+
+			nanosleep(&myDelay, NULL);
+		}
+
+		// collect the completed reads
+		myHead = *myCompleteHead;
+		while (myHead != __atomic_load_n(myCompleteTail, __ATOMIC_ACQUIRE)) {
+			struct io_uring_cqe		*myCompletion = &myCompletions[myHead & myCompleteMask];
+			const QTFileRead		*myRead = &theReads[(long)myCompletion->user_data];
+			long					myCount = (myCompletion->res > 0) ? (long)myCompletion->res : 0;
+
+			// finish a failed or short read ourselves
+			if ((myCount < myRead->fSize) && (myErr == kQTFileErr_NoErr))
+				myErr = QTFile_ReadData(theMovie, myRead->fOffset + myCount, myRead->fData + myCount, myRead->fSize - myCount);
+
+			myInFlight--;
+			myHead++;
+		}
+
+		__atomic_store_n(myCompleteHead, myHead, __ATOMIC_RELEASE);
+	}
+
+	// no read is in flight any more, so the ring can go
+	QTFile_CloseRing(&myRing);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_OpenRing
+// Set up an io_uring instance with the specified number of entries, and map its queues.
+//
+// The caller is responsible for closing the ring (by calling QTFile_CloseRing), even if we return an error.
+//
+//////////
+
+static long QTFile_OpenRing (QTFileRingPtr theRing, unsigned theEntryCount)
+{
+	void				*myQueue;
+
+	memset(theRing, 0, sizeof(QTFileRing));
+
+	theRing->fRing = (int)syscall(__NR_io_uring_setup, theEntryCount, &theRing->fParams);
+	if (theRing->fRing < 0)
+		return(kQTFileErr_Unimplemented);
+
+	theRing->fSubmitQueueSize = theRing->fParams.sq_off.array + (theRing->fParams.sq_entries * sizeof(unsigned));
+	myQueue = mmap(NULL, theRing->fSubmitQueueSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, theRing->fRing, IORING_OFF_SQ_RING);
+	if (myQueue == MAP_FAILED)
+		return(kQTFileErr_MemFull);
+	theRing->fSubmitQueue = (unsigned char *)myQueue;
+
+	theRing->fCompleteQueueSize = theRing->fParams.cq_off.cqes + (theRing->fParams.cq_entries * sizeof(struct io_uring_cqe));
+	myQueue = mmap(NULL, theRing->fCompleteQueueSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, theRing->fRing, IORING_OFF_CQ_RING);
+	if (myQueue == MAP_FAILED)
+		return(kQTFileErr_MemFull);
+	theRing->fCompleteQueue = (unsigned char *)myQueue;
+
+	theRing->fEntriesSize = theRing->fParams.sq_entries * sizeof(struct io_uring_sqe);
+	myQueue = mmap(NULL, theRing->fEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, theRing->fRing, IORING_OFF_SQES);
+	if (myQueue == MAP_FAILED)
+		return(kQTFileErr_MemFull);
+	theRing->fEntries = (struct io_uring_sqe *)myQueue;
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_CloseRing
+// Unmap the queues of the specified io_uring instance, and close it.
+//
+//////////
+
+static void QTFile_CloseRing (QTFileRingPtr theRing)
+{
+	if (theRing->fEntries != NULL)
+		munmap(theRing->fEntries, theRing->fEntriesSize);
+
+	if (theRing->fCompleteQueue != NULL)
+		munmap(theRing->fCompleteQueue, theRing->fCompleteQueueSize);
+
+	if (theRing->fSubmitQueue != NULL)
+		munmap(theRing->fSubmitQueue, theRing->fSubmitQueueSize);
+
+	if (theRing->fRing >= 0)
+		close(theRing->fRing);
+}
+
+#endif	// QTFILE_USE_IO_URING
+
+
+//////////
+//
+// QTFile_ParseMovieAtom
+// Read the movie header and all the tracks in the specified movie atom; tracks that can't be read are skipped.
+//
+//////////
+
+static long QTFile_ParseMovieAtom (QTFileMoviePtr theMovie, const QTFileAtom *theMovieAtom)
+{
+	QTFileAtom			myAtom;
+	QTFileTrackPtr		myTrack = NULL;
+	long				myOffset = 0;
+	long				myCount = 0;
+	long				myErr = kQTFileErr_NoErr;
+
+	// read the movie header; version 1 headers have 64-bit times
+	if (!QTFile_FindChildAtom(theMovieAtom, kQTFile_MovieHeaderAtom, &myAtom) || (myAtom.fSize < 20))
+		return(kQTFileErr_InvalidMovie);
+
+	if (myAtom.fData[0] == 1) {
+		if (myAtom.fSize < 32)
+			return(kQTFileErr_InvalidMovie);
+		theMovie->fTimeScale = (long)QTFile_Get32(myAtom.fData + 20);
+		theMovie->fDuration = (QTFileTimeValue)QTFile_Get64(myAtom.fData + 24);
+	} else {
+		theMovie->fTimeScale = (long)QTFile_Get32(myAtom.fData + 12);
+		theMovie->fDuration = (QTFileTimeValue)QTFile_Get32(myAtom.fData + 16);
+	}
+
+	// count the tracks, so we can allocate them all at once
+	while (QTFile_GetAtom(theMovieAtom->fData, theMovieAtom->fSize, &myOffset, &myAtom))
+		if (myAtom.fType == kQTFile_TrackAtom)
+			myCount++;
+
+	if (myCount == 0)
+		return(kQTFileErr_NoErr);
+
+	theMovie->fTracks = (QTFileTrackPtr)calloc(myCount, sizeof(QTFileTrack));
+	if (theMovie->fTracks == NULL)
+		return(kQTFileErr_MemFull);
+
+	myOffset = 0;
+	while (QTFile_GetAtom(theMovieAtom->fData, theMovieAtom->fSize, &myOffset, &myAtom)) {
+		if (myAtom.fType != kQTFile_TrackAtom)
+			continue;
+
+		myTrack = &theMovie->fTracks[theMovie->fTrackCount];
+		myErr = QTFile_ParseTrackAtom(theMovie, &myAtom, myTrack);
+		if (myErr == kQTFileErr_NoErr) {
+			theMovie->fTrackCount++;
+			continue;
+		}
+
+		// throw away what we read of a damaged track, and go on with the next one; running out of memory is fatal
+		free(myTrack->fRefs);
+		free(myTrack->fEdits);
+		memset(myTrack, 0, sizeof(QTFileTrack));
+
+		if (myErr == kQTFileErr_MemFull)
+			return(myErr);
+
+		theMovie->fBadTrackCount++;
+	}
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_ParseTrackAtom
+// Read the specified track atom.
+//
+//////////
+
+static long QTFile_ParseTrackAtom (QTFileMoviePtr theMovie, const QTFileAtom *theTrackAtom, QTFileTrackPtr theTrack)
+{
+	QTFileAtom			myAtom;
+	QTFileAtom			myMediaAtom;
+	QTFileAtom			myInfoAtom;
+	QTFileAtom			myTableAtom;
+	const unsigned char	*myData = NULL;
+
+	theTrack->fMovie = theMovie;
+	theTrack->fSampleTableErr = kQTFile_NotLoaded;
+
+	// read the track header
+	if (!QTFile_FindChildAtom(theTrackAtom, kQTFile_TrackHeaderAtom, &myAtom) || (myAtom.fSize < 24))
+		return(kQTFileErr_InvalidTrack);
+
+	myData = myAtom.fData;
+	theTrack->fFlags = QTFile_Get32(myData) & 0x00FFFFFF;
+	if (myData[0] == 1) {
+		if (myAtom.fSize < 36)
+			return(kQTFileErr_InvalidTrack);
+		theTrack->fTrackID = QTFile_Get32(myData + 20);
+		theTrack->fDuration = (QTFileTimeValue)QTFile_Get64(myData + 28);
+	} else {
+		theTrack->fTrackID = QTFile_Get32(myData + 12);
+		theTrack->fDuration = (QTFileTimeValue)QTFile_Get32(myData + 20);
+	}
+
+	// read the track references and the track name, if any
+	if (QTFile_FindChildAtom(theTrackAtom, kQTFile_TrackReferenceAtom, &myAtom))
+		if (QTFile_ParseTrackReferences(&myAtom, theTrack) != kQTFileErr_NoErr)
+			return(kQTFileErr_MemFull);
+
+	if (QTFile_FindChildAtom(theTrackAtom, kQTFile_UserDataAtom, &myAtom))
+		QTFile_ParseTrackName(&myAtom, theTrack);
+
+	// read the media header and the handler
+	if (!QTFile_FindChildAtom(theTrackAtom, kQTFile_MediaAtom, &myMediaAtom))
+		return(kQTFileErr_InvalidTrack);
+
+	if (!QTFile_FindChildAtom(&myMediaAtom, kQTFile_MediaHeaderAtom, &myAtom) || (myAtom.fSize < 24))
+		return(kQTFileErr_InvalidTrack);
+
+	myData = myAtom.fData;
+	if (myData[0] == 1) {
+		if (myAtom.fSize < 36)
+			return(kQTFileErr_InvalidTrack);
+		theTrack->fTimeScale = (long)QTFile_Get32(myData + 20);
+		theTrack->fMediaDuration = (QTFileTimeValue)QTFile_Get64(myData + 24);
+		theTrack->fLanguage = (short)QTFile_Get16(myData + 32);
+	} else {
+		theTrack->fTimeScale = (long)QTFile_Get32(myData + 12);
+		theTrack->fMediaDuration = (QTFileTimeValue)QTFile_Get32(myData + 16);
+		theTrack->fLanguage = (short)QTFile_Get16(myData + 20);
+	}
+
+	if (QTFile_FindChildAtom(&myMediaAtom, kQTFile_HandlerAtom, &myAtom) && (myAtom.fSize >= 12))
+		theTrack->fMediaType = QTFile_Get32(myAtom.fData + 8);
+
+	// read the edit list; this needs both time scales
+	if (QTFile_ParseEditList(theTrackAtom, theTrack) != kQTFileErr_NoErr)
+		return(kQTFileErr_InvalidTrack);
+
+	// find the sample table
+	if (!QTFile_FindChildAtom(&myMediaAtom, kQTFile_MediaInfoAtom, &myInfoAtom) || !QTFile_FindChildAtom(&myInfoAtom, kQTFile_SampleTableAtom, &myTableAtom))
+		return(kQTFileErr_NoErr);
+
+	// read the first sample description: version/flags (4), entry count (4), then the entry itself
+	if (QTFile_FindChildAtom(&myTableAtom, kQTFile_SampleDescriptionAtom, &myAtom) && (myAtom.fSize >= 16) && (QTFile_Get32(myAtom.fData + 4) > 0)) {
+		long		myEntrySize = (long)QTFile_Get32(myAtom.fData + 8);
+
+		if ((myEntrySize >= 8) && (myEntrySize <= myAtom.fSize - 8)) {
+			theTrack->fDataFormat = QTFile_Get32(myAtom.fData + 12);
+			if ((theTrack->fDataFormat == kQTFile_TextDataFormat) && (myEntrySize >= kTextDescFontOffset + 2))
+				theTrack->fFontNumber = (short)QTFile_Get16(myAtom.fData + 8 + kTextDescFontOffset);
+		}
+	}
+
+	// remember where the sample table is; we decode it when we need it
+	theTrack->fSampleTable = myTableAtom;
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_ParseTrackReferences
+// Read the track references in the specified track reference atom.
+//
+//////////
+
+static long QTFile_ParseTrackReferences (const QTFileAtom *theRefAtom, QTFileTrackPtr theTrack)
+{
+	QTFileAtom			myAtom;
+	long				myOffset = 0;
+	long				myCount = 0;
+	long				myIndex;
+
+	// each child atom has the type of the reference and contains a list of track IDs
+	while (QTFile_GetAtom(theRefAtom->fData, theRefAtom->fSize, &myOffset, &myAtom))
+		myCount += myAtom.fSize / 4;
+
+	if (myCount == 0)
+		return(kQTFileErr_NoErr);
+
+	theTrack->fRefs = (QTFileTrackRefPtr)calloc(myCount, sizeof(QTFileTrackRef));
+	if (theTrack->fRefs == NULL)
+		return(kQTFileErr_MemFull);
+
+	myOffset = 0;
+	while (QTFile_GetAtom(theRefAtom->fData, theRefAtom->fSize, &myOffset, &myAtom)) {
+		for (myIndex = 0; myIndex < myAtom.fSize / 4; myIndex++) {
+			QTFileUInt32	myTrackID = QTFile_Get32(myAtom.fData + (myIndex * 4));
+
+			// a track ID of 0 is an unused reference
+			if (myTrackID != 0) {
+				theTrack->fRefs[theTrack->fRefCount].fType = myAtom.fType;
+				theTrack->fRefs[theTrack->fRefCount].fTrackID = myTrackID;
+				theTrack->fRefCount++;
+			}
+		}
+	}
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_ParseTrackName
+// Read the track name from the specified user data atom.
+//
+// QuickTime stores the name of a track as the text of a 'name' user data item.
+//
+//////////
+
+static void QTFile_ParseTrackName (const QTFileAtom *theUserData, QTFileTrackPtr theTrack)
+{
+	QTFileAtom			myAtom;
+	long				myLength;
+
+	if (!QTFile_FindChildAtom(theUserData, kQTFile_NameAtom, &myAtom))
+		return;
+
+	myLength = (myAtom.fSize < kQTFile_MaxTrackName) ? myAtom.fSize : kQTFile_MaxTrackName;
+	memcpy(theTrack->fName, myAtom.fData, myLength);
+	theTrack->fName[myLength] = '\0';
+}
+
+
+//////////
+//
+// QTFile_ParseEditList
+// Read the edit list of the specified track atom, if it has one; see note (3).
+//
+//////////
+
+static long QTFile_ParseEditList (const QTFileAtom *theTrackAtom, QTFileTrackPtr theTrack)
+{
+	QTFileAtom			myList;
+	QTFileEditPtr		myEdit = NULL;
+	QTFileTimeValue		myTrackTime = 0;
+	long				myEntryCount = 0;
+	long				myEntrySize = 12;
+	long				myIndex;
+
+	if (QTFile_FindChildAtom(theTrackAtom, kQTFile_EditAtom, &myList) && QTFile_FindChildAtom(&myList, kQTFile_EditListAtom, &myList)) {
+		if (myList.fSize < 8)
+			return(kQTFileErr_InvalidTrack);
+
+		// version 1 entries have a 64-bit duration and media time
+		myEntrySize = (myList.fData[0] == 1) ? 20 : 12;
+		myEntryCount = (long)QTFile_Get32(myList.fData + 4);
+		if ((myEntryCount < 0) || (myEntryCount > (myList.fSize - 8) / myEntrySize))
+			return(kQTFileErr_InvalidTrack);
+	}
+
+	theTrack->fEdits = (QTFileEditPtr)calloc((myEntryCount > 0) ? myEntryCount : 1, sizeof(QTFileEdit));
+	if (theTrack->fEdits == NULL)
+		return(kQTFileErr_MemFull);
+
+	// a track without an edit list plays its whole media, once
+	if (myEntryCount == 0) {
+		myEdit = theTrack->fEdits;
+		myEdit->fDuration = theTrack->fDuration;
+		if (myEdit->fDuration == 0)
+			myEdit->fDuration = QTFile_ConvertTimeScale(theTrack->fMediaDuration, theTrack->fTimeScale, theTrack->fMovie->fTimeScale);
+		myEdit->fMediaDuration = theTrack->fMediaDuration;
+		myEdit->fRate = kQTFile_UnityRate;
+		theTrack->fEditCount = 1;
+		return(kQTFileErr_NoErr);
+	}
+
+	for (myIndex = 0; myIndex < myEntryCount; myIndex++) {
+		const unsigned char	*myEntry = myList.fData + 8 + (myIndex * myEntrySize);
+
+		myEdit = &theTrack->fEdits[myIndex];
+		if (myEntrySize == 20) {
+			myEdit->fDuration = (QTFileTimeValue)QTFile_Get64(myEntry);
+			myEdit->fMediaTime = (QTFileTimeValue)QTFile_Get64(myEntry + 8);
+			myEdit->fRate = QTFile_Get32(myEntry + 16);
+		} else {
+			myEdit->fDuration = (QTFileTimeValue)QTFile_Get32(myEntry);
+			myEdit->fMediaTime = (QTFileTimeValue)(int)QTFile_Get32(myEntry + 4);
+			myEdit->fRate = QTFile_Get32(myEntry + 8);
+		}
+
+		if ((myEdit->fDuration < 0) || (myEdit->fDuration > kMaxTimeValue - myTrackTime))
+			return(kQTFileErr_InvalidTrack);
+
+		if (myEdit->fMediaTime < 0) {
+			myEdit->fMediaTime = kQTFile_NoTime;
+		} else if ((int)myEdit->fRate > 0) {
+			myEdit->fMediaDuration = QTFile_ConvertTimeScale(myEdit->fDuration, theTrack->fMovie->fTimeScale, theTrack->fTimeScale);
+			if (myEdit->fRate != kQTFile_UnityRate)
+				myEdit->fMediaDuration = (myEdit->fMediaDuration * (QTFileTimeValue)myEdit->fRate) / kQTFile_UnityRate;
+		}
+
+		myEdit->fTrackTime = myTrackTime;
+		myTrackTime += myEdit->fDuration;
+	}
+
+	theTrack->fEditCount = myEntryCount;
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_LoadSampleTable
+// Decode the sample table of the specified track, if that hasn't been done yet; return the result.
+//
+//////////
+
+static long QTFile_LoadSampleTable (QTFileTrackPtr theTrack)
+{
+	QTFileSampleTable	myTable;
+
+	if (theTrack == NULL)
+		return(kQTFileErr_Param);
+
+	if (theTrack->fSampleTableErr != kQTFile_NotLoaded)
+		return(theTrack->fSampleTableErr);
+
+	memset(&myTable, 0, sizeof(myTable));
+
+	// a track without a sample table has no samples
+	if (theTrack->fSampleTable.fData != NULL) {
+		QTFile_FindChildAtom(&theTrack->fSampleTable, kQTFile_TimeToSampleAtom, &myTable.fTimeToSample);
+		QTFile_FindChildAtom(&theTrack->fSampleTable, kQTFile_SampleToChunkAtom, &myTable.fSampleToChunk);
+		QTFile_FindChildAtom(&theTrack->fSampleTable, kQTFile_SampleSizeAtom, &myTable.fSampleSize);
+		if (!QTFile_FindChildAtom(&theTrack->fSampleTable, kQTFile_ChunkOffsetAtom, &myTable.fChunkOffset))
+			myTable.fIs64Bit = QTFile_FindChildAtom(&theTrack->fSampleTable, kQTFile_ChunkOffset64Atom, &myTable.fChunkOffset);
+	}
+
+	theTrack->fSampleTableErr = QTFile_ParseSampleTable(theTrack->fMovie, &myTable, theTrack);
+
+	// a track whose sample table is damaged has no samples
+	if (theTrack->fSampleTableErr != kQTFileErr_NoErr) {
+		free(theTrack->fSampleTimes);
+		theTrack->fSampleTimes = NULL;
+		theTrack->fSampleSizes = NULL;
+		theTrack->fSampleOffsets = NULL;
+		theTrack->fSampleCount = 0;
+	}
+
+	return(theTrack->fSampleTableErr);
+}
+
+
+//////////
+//
+// QTFile_ParseSampleTable
+// Decode the specified sample table atoms into the sample arrays of the specified track.
+//
+//////////
+
+static long QTFile_ParseSampleTable (QTFileMoviePtr theMovie, const QTFileSampleTable *theTable, QTFileTrackPtr theTrack)
+{
+	const unsigned char	*myData = NULL;
+	QTFileTimeValue		*myTimes = NULL;
+	QTFileUInt64		*myOffsets = NULL;
+	long				*mySizes = NULL;
+	long				mySampleCount;
+	long				myUniformSize;
+	long				myEntryCount;
+	long				myChunkCount;
+	long				myOffsetSize = theTable->fIs64Bit ? 8 : 4;
+	long				myIndex;
+	long				myEntry;
+	long				mySample;
+	QTFileTimeValue		myTime;
+
+	// the sample size atom tells us how many samples there are
+	if (theTable->fSampleSize.fData == NULL)
+		return(kQTFileErr_NoErr);
+
+	myData = theTable->fSampleSize.fData;
+	if (theTable->fSampleSize.fSize < 12)
+		return(kQTFileErr_InvalidSampleTable);
+
+	myUniformSize = (long)QTFile_Get32(myData + 4);
+	mySampleCount = (long)QTFile_Get32(myData + 8);
+	if ((mySampleCount < 0) || ((myUniformSize == 0) && (mySampleCount > (theTable->fSampleSize.fSize - 12) / 4)))
+		return(kQTFileErr_InvalidSampleTable);
+
+	if (mySampleCount == 0)
+		return(kQTFileErr_NoErr);
+
+	// the three arrays share a single block: mySampleCount + 1 start times, then the offsets, then the sizes
+	if (mySampleCount > (kMaxLong / (long)(sizeof(QTFileTimeValue) + sizeof(QTFileUInt64) + sizeof(long))) - 1)
+		return(kQTFileErr_InvalidSampleTable);
+
+	myTimes = (QTFileTimeValue *)calloc(1, ((mySampleCount + 1) * sizeof(QTFileTimeValue)) + (mySampleCount * (sizeof(QTFileUInt64) + sizeof(long))));
+	if (myTimes == NULL)
+		return(kQTFileErr_MemFull);
+
+	myOffsets = (QTFileUInt64 *)(myTimes + mySampleCount + 1);
+	mySizes = (long *)(myOffsets + mySampleCount);
+
+	theTrack->fSampleTimes = myTimes;
+	theTrack->fSampleSizes = mySizes;
+	theTrack->fSampleOffsets = myOffsets;
+	theTrack->fSampleCount = mySampleCount;
+
+	// sample sizes
+	for (myIndex = 0; myIndex < mySampleCount; myIndex++) {
+		mySizes[myIndex] = (myUniformSize != 0) ? myUniformSize : (long)QTFile_Get32(myData + 12 + (myIndex * 4));
+		if (mySizes[myIndex] < 0)
+			return(kQTFileErr_InvalidSampleTable);
+	}
+
+	// sample times and durations
+	if ((theTable->fTimeToSample.fData == NULL) || (theTable->fTimeToSample.fSize < 8))
+		return(kQTFileErr_InvalidSampleTable);
+
+	myData = theTable->fTimeToSample.fData;
+	myEntryCount = (long)QTFile_Get32(myData + 4);
+	if ((myEntryCount < 0) || (myEntryCount > (theTable->fTimeToSample.fSize - 8) / 8))
+		return(kQTFileErr_InvalidSampleTable);
+
+	mySample = 0;
+	myTime = 0;
+	for (myEntry = 0; (myEntry < myEntryCount) && (mySample < mySampleCount); myEntry++) {
+		QTFileUInt32	myCount = QTFile_Get32(myData + 8 + (myEntry * 8));
+		QTFileUInt32	myDuration = QTFile_Get32(myData + 12 + (myEntry * 8));
+
+		for (myIndex = 0; ((QTFileUInt32)myIndex < myCount) && (mySample < mySampleCount); myIndex++) {
+			if (myTime > kMaxTimeValue - myDuration)
+				return(kQTFileErr_InvalidSampleTable);
+
+			myTimes[mySample] = myTime;
+			myTime += myDuration;
+			mySample++;
+		}
+	}
+
+	// samples that the time-to-sample table doesn't cover have a duration of 0
+	while (mySample <= mySampleCount)
+		myTimes[mySample++] = myTime;
+
+	// sample offsets: the sample-to-chunk table gives the number of samples in each run of chunks
+	if ((theTable->fSampleToChunk.fData == NULL) || (theTable->fSampleToChunk.fSize < 8) || (theTable->fChunkOffset.fData == NULL) || (theTable->fChunkOffset.fSize < 8))
+		return(kQTFileErr_InvalidSampleTable);
+
+	myChunkCount = (long)QTFile_Get32(theTable->fChunkOffset.fData + 4);
+	if ((myChunkCount < 0) || (myChunkCount > (theTable->fChunkOffset.fSize - 8) / myOffsetSize))
+		return(kQTFileErr_InvalidSampleTable);
+
+	myData = theTable->fSampleToChunk.fData;
+	myEntryCount = (long)QTFile_Get32(myData + 4);
+	if ((myEntryCount < 0) || (myEntryCount > (theTable->fSampleToChunk.fSize - 8) / 12))
+		return(kQTFileErr_InvalidSampleTable);
+
+	mySample = 0;
+	for (myEntry = 0; (myEntry < myEntryCount) && (mySample < mySampleCount); myEntry++) {
+		long		myFirstChunk = (long)QTFile_Get32(myData + 8 + (myEntry * 12));
+		long		mySamplesPerChunk = (long)QTFile_Get32(myData + 12 + (myEntry * 12));
+		long		myLastChunk = myChunkCount;
+		long		myChunk;
+
+		if (myEntry + 1 < myEntryCount)
+			myLastChunk = (long)QTFile_Get32(myData + 8 + ((myEntry + 1) * 12)) - 1;
+
+		if ((myFirstChunk < 1) || (myLastChunk > myChunkCount))
+			return(kQTFileErr_InvalidSampleTable);
+
+		for (myChunk = myFirstChunk; (myChunk <= myLastChunk) && (mySample < mySampleCount); myChunk++) {
+			const unsigned char	*myOffsetData = theTable->fChunkOffset.fData + 8 + ((myChunk - 1) * myOffsetSize);
+			QTFileUInt64		myOffset;
+
+			myOffset = theTable->fIs64Bit ? QTFile_Get64(myOffsetData) : QTFile_Get32(myOffsetData);
+
+			for (myIndex = 0; (myIndex < mySamplesPerChunk) && (mySample < mySampleCount); myIndex++) {
+				// the sample must lie entirely within the file
+				if ((myOffset > theMovie->fSize) || ((QTFileUInt64)mySizes[mySample] > theMovie->fSize - myOffset))
+					return(kQTFileErr_InvalidSampleTable);
+
+				myOffsets[mySample] = myOffset;
+				myOffset += mySizes[mySample];
+				mySample++;
+			}
+		}
+	}
+
+	if (mySample < mySampleCount)
+		return(kQTFileErr_InvalidSampleTable);
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_LoadTrackSamples
+// Find the samples that the specified track plays, in the order it plays them, if that hasn't been done yet;
+// see note (3).
+//
+//////////
+
+static long QTFile_LoadTrackSamples (QTFileTrackPtr theTrack)
+{
+	const QTFileTimeValue	*myTimes = NULL;
+	QTFileTrackSamplePtr	myTrackSample = NULL;
+	QTFileTimeValue			myPrevMediaEnd = kQTFile_NoTime;	// the media time at which the previous edit stopped
+	QTFileTimeValue			myMediaEnd;
+	QTFileTimeValue			myStart;
+	QTFileTimeValue			myTime;
+	long					myCapacity;
+	long					mySample;
+	long					myIndex;
+	long					myErr = kQTFileErr_NoErr;
+
+	myErr = QTFile_LoadSampleTable(theTrack);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	if (theTrack->fTrackSamples != NULL)
+		return(kQTFileErr_NoErr);
+
+	// usually each sample is played once
+	myCapacity = theTrack->fSampleCount + theTrack->fEditCount + 1;
+	theTrack->fTrackSamples = (QTFileTrackSamplePtr)malloc(myCapacity * sizeof(QTFileTrackSample));
+	if (theTrack->fTrackSamples == NULL)
+		return(kQTFileErr_MemFull);
+
+	theTrack->fTrackSampleCount = 0;
+	myTimes = theTrack->fSampleTimes;
+
+	for (myIndex = 0; myIndex < theTrack->fEditCount; myIndex++) {
+		const QTFileEdit	*myEdit = &theTrack->fEdits[myIndex];
+
+		if ((myEdit->fMediaTime == kQTFile_NoTime) || (myEdit->fDuration == 0) || (QTFile_GetSampleBounds(theTrack, myEdit->fMediaTime, &mySample, NULL, NULL) != kQTFileErr_NoErr)) {
+			myPrevMediaEnd = kQTFile_NoTime;
+			continue;
+		}
+
+		// an edit that doesn't move through its media shows only the sample at its start
+		myMediaEnd = myEdit->fMediaTime + ((myEdit->fMediaDuration > 0) ? myEdit->fMediaDuration : 1);
+
+		for (; (mySample <= theTrack->fSampleCount) && (myTimes[mySample - 1] < myMediaEnd); mySample++) {
+			// a sample with no duration is never shown
+			if (myTimes[mySample] == myTimes[mySample - 1])
+				continue;
+
+			myStart = (myTimes[mySample - 1] > myEdit->fMediaTime) ? myTimes[mySample - 1] : myEdit->fMediaTime;
+			myTime = myEdit->fTrackTime + QTFile_EditMediaToTrack(theTrack, myEdit, myStart - myEdit->fMediaTime);
+			if (myTime >= myEdit->fTrackTime + myEdit->fDuration)
+				break;
+
+			// a sample that the previous edit was showing, and that this edit carries on with, is still one sample
+			if ((myStart == myEdit->fMediaTime) && (myEdit->fMediaTime == myPrevMediaEnd) && (theTrack->fTrackSampleCount > 0) && (theTrack->fTrackSamples[theTrack->fTrackSampleCount - 1].fSampleNum == mySample))
+				continue;
+
+			if (theTrack->fTrackSampleCount == myCapacity) {
+				myTrackSample = (QTFileTrackSamplePtr)realloc(theTrack->fTrackSamples, (myCapacity * 2) * sizeof(QTFileTrackSample));
+				if (myTrackSample == NULL) {
+					myErr = kQTFileErr_MemFull;
+					goto bail;
+				}
+
+				theTrack->fTrackSamples = myTrackSample;
+				myCapacity *= 2;
+			}
+
+			myTrackSample = &theTrack->fTrackSamples[theTrack->fTrackSampleCount++];
+			myTrackSample->fSampleNum = mySample;
+			myTrackSample->fTrackTime = myTime;
+		}
+
+		myPrevMediaEnd = myEdit->fMediaTime + myEdit->fMediaDuration;
+	}
+
+bail:
+	if (myErr != kQTFileErr_NoErr) {
+		free(theTrack->fTrackSamples);
+		theTrack->fTrackSamples = NULL;
+		theTrack->fTrackSampleCount = 0;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_EditMediaToTrack
+// Return the track time (in the movie's time scale) that the specified edit of the specified track takes to
+// play the specified amount of media time, starting at the edit's media time.
+//
+//////////
+
+static QTFileTimeValue QTFile_EditMediaToTrack (QTFileTrackPtr theTrack, const QTFileEdit *theEdit, QTFileTimeValue theMediaOffset)
+{
+	QTFileTimeValue		myTime;
+
+	if ((int)theEdit->fRate <= 0)
+		return(0);
+
+	myTime = QTFile_ConvertTimeScale(theMediaOffset, theTrack->fTimeScale, theTrack->fMovie->fTimeScale);
+	if (theEdit->fRate != kQTFile_UnityRate)
+		myTime = (myTime * kQTFile_UnityRate) / (QTFileTimeValue)theEdit->fRate;
+
+	return(myTime);
+}
+
+
+//////////
+//
+// QTFile_DisposeTracks
+// Dispose of the tracks of the specified movie.
+//
+//////////
+
+static void QTFile_DisposeTracks (QTFileMoviePtr theMovie)
+{
+	long				myIndex;
+
+	if (theMovie->fTracks == NULL)
+		return;
+
+	for (myIndex = 0; myIndex < theMovie->fTrackCount; myIndex++) {
+		free(theMovie->fTracks[myIndex].fRefs);
+		free(theMovie->fTracks[myIndex].fEdits);
+		free(theMovie->fTracks[myIndex].fSampleTimes);
+		free(theMovie->fTracks[myIndex].fTrackSamples);
+		QTFile_UnloadTrackData(&theMovie->fTracks[myIndex]);
+	}
+
+	free(theMovie->fTracks);
+	theMovie->fTracks = NULL;
+	theMovie->fTrackCount = 0;
+}
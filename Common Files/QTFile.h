@@ -0,0 +1,263 @@
+//////////
+//
+//	File:		QTFile.h
+//
+//	Contains:	Portable reading of QuickTime movie files, without QuickTime.
+//				All utilities start with the prefix "QTFile_".
+//
+//	Written by:	QuickTime Team
+//
+//////////
+
+#pragma once
+
+#ifndef __QTFile__
+#define __QTFile__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+
+//////////
+//
+// integer types
+//
+//////////
+
+#if defined(_MSC_VER)
+typedef unsigned __int64				QTFileUInt64;
+typedef __int64							QTFileInt64;
+#else
+#include <stdint.h>
+typedef uint64_t						QTFileUInt64;
+typedef int64_t							QTFileInt64;
+#endif
+
+typedef unsigned int					QTFileUInt32;
+typedef unsigned short					QTFileUInt16;
+typedef QTFileUInt32					QTFileOSType;
+typedef QTFileInt64						QTFileTimeValue;	// a movie or media time; 64 bits, so long movies with fine time scales don't overflow
+
+
+//////////
+//
+// constants
+//
+//////////
+
+// do we read the data of a whole track (QTFile_LoadTrackData) with io_uring? only Linux has it, and only if
+// the kernel headers know about it; if the kernel doesn't support it at run time, we read synchronously
+#ifndef QTFILE_USE_IO_URING
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define QTFILE_USE_IO_URING				1
+#endif
+#endif
+#endif
+
+#ifndef QTFILE_USE_IO_URING
+#define QTFILE_USE_IO_URING				0
+#endif
+
+// error codes; these have the same values as the corresponding Mac OS and QuickTime errors
+enum {
+	kQTFileErr_NoErr				= 0,			// noErr
+	kQTFileErr_Unimplemented		= -4,			// unimpErr
+	kQTFileErr_IO					= -36,			// ioErr
+	kQTFileErr_FileNotFound			= -43,			// fnfErr
+	kQTFileErr_Param				= -50,			// paramErr
+	kQTFileErr_MemFull				= -108,			// memFullErr
+	kQTFileErr_InvalidTrack			= -2009,		// invalidTrack
+	kQTFileErr_InvalidMovie			= -2010,		// invalidMovie
+	kQTFileErr_InvalidSampleTable	= -2011			// invalidSampleTable
+};
+
+// a four-character code, built so that it compares equal to the big-endian value read from a file
+#define QTFILE_FOURCC(a,b,c,d)			((((QTFileOSType)(a)) << 24) | (((QTFileOSType)(b)) << 16) | (((QTFileOSType)(c)) << 8) | ((QTFileOSType)(d)))
+
+#define kQTFile_AtomHeaderSize			8				// the size and type of an atom
+#define kQTFile_ExtendedAtomHeaderSize	16				// the size, type and 64-bit size of an atom
+
+// atom types
+#define kQTFile_MovieAtom				QTFILE_FOURCC('m','o','o','v')
+#define kQTFile_MovieHeaderAtom			QTFILE_FOURCC('m','v','h','d')
+#define kQTFile_TrackAtom				QTFILE_FOURCC('t','r','a','k')
+#define kQTFile_TrackHeaderAtom			QTFILE_FOURCC('t','k','h','d')
+#define kQTFile_TrackReferenceAtom		QTFILE_FOURCC('t','r','e','f')
+#define kQTFile_EditAtom				QTFILE_FOURCC('e','d','t','s')
+#define kQTFile_EditListAtom			QTFILE_FOURCC('e','l','s','t')
+#define kQTFile_UserDataAtom			QTFILE_FOURCC('u','d','t','a')
+#define kQTFile_NameAtom				QTFILE_FOURCC('n','a','m','e')
+#define kQTFile_MediaAtom				QTFILE_FOURCC('m','d','i','a')
+#define kQTFile_MediaHeaderAtom			QTFILE_FOURCC('m','d','h','d')
+#define kQTFile_HandlerAtom				QTFILE_FOURCC('h','d','l','r')
+#define kQTFile_MediaInfoAtom			QTFILE_FOURCC('m','i','n','f')
+#define kQTFile_SampleTableAtom			QTFILE_FOURCC('s','t','b','l')
+#define kQTFile_SampleDescriptionAtom	QTFILE_FOURCC('s','t','s','d')
+#define kQTFile_TimeToSampleAtom		QTFILE_FOURCC('s','t','t','s')
+#define kQTFile_SampleToChunkAtom		QTFILE_FOURCC('s','t','s','c')
+#define kQTFile_SampleSizeAtom			QTFILE_FOURCC('s','t','s','z')
+#define kQTFile_ChunkOffsetAtom			QTFILE_FOURCC('s','t','c','o')
+#define kQTFile_ChunkOffset64Atom		QTFILE_FOURCC('c','o','6','4')
+#define kQTFile_DataInfoAtom			QTFILE_FOURCC('d','i','n','f')
+#define kQTFile_DataReferenceAtom		QTFILE_FOURCC('d','r','e','f')
+#define kQTFile_FileTypeAtom			QTFILE_FOURCC('f','t','y','p')
+#define kQTFile_MovieDataAtom			QTFILE_FOURCC('m','d','a','t')
+#define kQTFile_FreeAtom				QTFILE_FOURCC('f','r','e','e')
+
+// data reference flags
+#define kQTFile_SelfReference			0x0001			// the media data is in the movie file itself
+
+// media types and data formats
+#define kQTFile_TextMediaType			QTFILE_FOURCC('t','e','x','t')
+#define kQTFile_SubtitleMediaType		QTFILE_FOURCC('s','b','t','l')
+#define kQTFile_MPEG4TextMediaType		QTFILE_FOURCC('s','u','b','t')
+#define kQTFile_VideoMediaType			QTFILE_FOURCC('v','i','d','e')
+#define kQTFile_SoundMediaType			QTFILE_FOURCC('s','o','u','n')
+#define kQTFile_TextDataFormat			QTFILE_FOURCC('t','e','x','t')
+#define kQTFile_TX3GDataFormat			QTFILE_FOURCC('t','x','3','g')
+
+// track reference types
+#define kQTFile_ChapterListReference	QTFILE_FOURCC('c','h','a','p')
+
+// track header flags
+#define kQTFile_TrackEnabled			0x0001
+
+#define kQTFile_UnityRate				0x00010000		// the media rate of an edit that plays at normal speed (16.16 fixed point)
+#define kQTFile_NoTime					((QTFileTimeValue)-1)	// a time that the edits of a track don't play
+
+#define kQTFile_MaxTrackName			255				// longest track name we keep
+#define kQTFile_NotLoaded				1				// the sample table of a track hasn't been decoded yet
+#define kQTFile_WindowSize				(16L * 1024L * 1024L)	// size of the window through which we map media data
+#define kQTFile_MaxTrackDataSize		(64L * 1024L * 1024L)	// the most sample data QTFile_LoadTrackData reads into memory
+#define kQTFile_ReadBatchSize			64				// the most reads QTFile_LoadTrackData has in progress at once
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// an atom located in memory (or in the mapped file)
+typedef struct QTFileAtom {
+	QTFileOSType					fType;			// the atom type
+	const unsigned char				*fData;			// the atom contents (just past the header)
+	long							fSize;			// the size of the atom contents
+} QTFileAtom, *QTFileAtomPtr;
+
+// a track reference (an entry in a 'tref' atom)
+typedef struct QTFileTrackRef {
+	QTFileOSType					fType;			// the type of the reference (for instance, 'chap')
+	QTFileUInt32					fTrackID;		// the ID of the referenced track
+} QTFileTrackRef, *QTFileTrackRefPtr;
+
+// an edit in the edit list of a track
+typedef struct QTFileEdit {
+	QTFileTimeValue					fTrackTime;		// the track time at which the edit starts, in the movie's time scale
+	QTFileTimeValue					fDuration;		// the duration of the edit, in the movie's time scale
+	QTFileTimeValue					fMediaTime;		// the media time at which it starts (kQTFile_NoTime for an empty edit)
+	QTFileTimeValue					fMediaDuration;	// the duration of the media it plays, in the media's time scale
+	QTFileUInt32					fRate;			// the media rate (16.16 fixed point)
+} QTFileEdit, *QTFileEditPtr;
+
+// a sample as a track plays it: a sample (or the part of one) shown by one of the track's edits
+typedef struct QTFileTrackSample {
+	long							fSampleNum;		// the media sample number (starting at 1)
+	QTFileTimeValue					fTrackTime;		// the track time at which it's shown, in the movie's time scale
+} QTFileTrackSample, *QTFileTrackSamplePtr;
+
+// a track in a movie file
+typedef struct QTFileTrack {
+	QTFileUInt32					fTrackID;		// the track ID
+	QTFileUInt32					fFlags;			// the track header flags
+	QTFileTimeValue					fDuration;		// the duration of the track, in the movie's time scale
+	QTFileOSType					fMediaType;		// the media type (the handler subtype: 'text', 'vide', ...)
+	long							fTimeScale;		// the time scale of the media
+	QTFileTimeValue					fMediaDuration;	// the duration of the media, in its own time scale
+	short							fLanguage;		// the language code of the media
+	QTFileOSType					fDataFormat;	// the data format of the first sample description
+	short							fFontNumber;	// for text media, the default font of the first sample description
+	char							fName[kQTFile_MaxTrackName + 1];	// the track name (from the user data), if any
+	QTFileTrackRefPtr				fRefs;			// the track references
+	long							fRefCount;		// the number of track references
+	QTFileEditPtr					fEdits;			// the edit list; a track without one has a single edit that plays all its media
+	long							fEditCount;		// the number of edits
+	struct QTFileMovie				*fMovie;		// the movie that contains the track
+	QTFileAtom						fSampleTable;	// the sample table atom, decoded the first time a sample is needed
+	long							fSampleTableErr;// the result of decoding the sample table (or kQTFile_NotLoaded)
+	QTFileTimeValue					*fSampleTimes;	// the media time at which each sample starts; fSampleTimes[fSampleCount] is the media end
+	QTFileUInt64					*fSampleOffsets;// the file offset of each sample
+	long							*fSampleSizes;	// the size of each sample
+	long							fSampleCount;	// the number of media samples
+	unsigned char					*fSampleData;	// the data of all the samples, if read by QTFile_LoadTrackData
+	long							*fSampleDataOffsets;	// the offset in fSampleData of each sample
+	QTFileTrackSamplePtr			fTrackSamples;	// the samples in the order the track plays them, found the first time they're needed
+	long							fTrackSampleCount;	// the number of samples the track plays
+} QTFileTrack, *QTFileTrackPtr;
+
+// an open movie file
+typedef struct QTFileMovie {
+	void							*fMapping;		// platform-specific mapping information (the file and its mapped views)
+	QTFileUInt64					fSize;			// the size of the file
+	long							fTimeScale;		// the movie time scale
+	QTFileTimeValue					fDuration;		// the movie duration, in the movie time scale
+	QTFileTrackPtr					fTracks;		// the tracks
+	long							fTrackCount;	// the number of tracks
+	long							fBadTrackCount;	// the number of tracks left out because they couldn't be read
+} QTFileMovie, *QTFileMoviePtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+long						QTFile_OpenMovie (const char *thePath, QTFileMoviePtr *theMovie);
+void						QTFile_CloseMovie (QTFileMoviePtr theMovie);
+
+long						QTFile_GetTrackCount (QTFileMoviePtr theMovie);
+QTFileTrackPtr				QTFile_GetIndTrack (QTFileMoviePtr theMovie, long theIndex);
+QTFileTrackPtr				QTFile_GetIndTrackType (QTFileMoviePtr theMovie, long theIndex, QTFileOSType theMediaType);
+QTFileTrackPtr				QTFile_GetTrackByID (QTFileMoviePtr theMovie, QTFileUInt32 theTrackID);
+long						QTFile_GetTrackReferenceCount (QTFileTrackPtr theTrack, QTFileOSType theType);
+QTFileTrackPtr				QTFile_GetTrackReference (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, QTFileOSType theType, long theIndex);
+int							QTFile_IsTextTrack (QTFileTrackPtr theTrack);
+
+long						QTFile_GetSampleCount (QTFileTrackPtr theTrack);
+long						QTFile_GetSampleData (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, long theSampleNum, const unsigned char **theData, long *theSize);
+long						QTFile_LoadTrackData (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack);
+void						QTFile_UnloadTrackData (QTFileTrackPtr theTrack);
+long						QTFile_GetSampleTime (QTFileTrackPtr theTrack, long theSampleNum, QTFileTimeValue *theTime, QTFileTimeValue *theDuration);
+long						QTFile_MediaTimeToSampleNum (QTFileTrackPtr theTrack, QTFileTimeValue theTime);
+long						QTFile_GetSampleBounds (QTFileTrackPtr theTrack, QTFileTimeValue theTime, long *theSampleNum, QTFileTimeValue *theStartTime, QTFileTimeValue *theEndTime);
+long						QTFile_GetTrackSampleCount (QTFileTrackPtr theTrack);
+long						QTFile_GetIndTrackSample (QTFileTrackPtr theTrack, long theIndex, long *theSampleNum, QTFileTimeValue *theTrackTime);
+QTFileTimeValue				QTFile_MediaTimeToMovieTime (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, QTFileTimeValue theTime);
+QTFileTimeValue				QTFile_MovieTimeToMediaTime (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, QTFileTimeValue theTime);
+QTFileTimeValue				QTFile_ConvertTimeScale (QTFileTimeValue theTime, long theOldScale, long theNewScale);
+
+int							QTFile_GetAtom (const unsigned char *theData, long theSize, long *theOffset, QTFileAtomPtr theAtom);
+int							QTFile_FindChildAtom (const QTFileAtom *theParent, QTFileOSType theType, QTFileAtomPtr theAtom);
+
+QTFileUInt32				QTFile_Get32 (const unsigned char *theData);
+QTFileUInt16				QTFile_Get16 (const unsigned char *theData);
+QTFileUInt64				QTFile_Get64 (const unsigned char *theData);
+void						QTFile_Put32 (unsigned char *theData, QTFileUInt32 theValue);
+void						QTFile_Put16 (unsigned char *theData, QTFileUInt16 theValue);
+void						QTFile_Put64 (unsigned char *theData, QTFileUInt64 theValue);
+
+#endif	// __QTFile__
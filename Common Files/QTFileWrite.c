@@ -0,0 +1,2694 @@
+//////////
+//
+//	File:		QTFileWrite.c
+//
+//	Contains:	Portable writing of QuickTime movie files, without QuickTime.
+//				All utilities start with the prefix "QTFile_".
+//
+//	Written by:	QuickTime Team
+//
+//	Like QTFile.c, this file contains no QuickTime or Toolbox calls; it builds on Windows and on any POSIX system.
+//
+// NOTES:
+//
+// *** (1) ***
+// QTFile_WriteFastStartMovie writes a "fast start" movie file: the movie atom comes first, so that a player
+// can start as soon as it has read it, followed by some free space (so that an updated movie atom can later be
+// written there; see QTUtils_UpdateMovieAtomInPlace) and then a single 'mdat' atom holding all the media
+// data. The caller supplies the movie atom (for instance, from PutMovieIntoHandle), whose chunk offsets refer
+// to the media data in the source file.
+//
+// *** (2) ***
+// Because the layout of the new file is known before we write anything (the media data keeps its order, and
+// the size of the movie atom depends only on the size of the file; see note (4)), we compute the new chunk
+// offsets first, write the movie atom once, and then copy the media data from the source file to the new file
+// in a single sequential pass, one 'mdat' atom at a time. Nothing is read back from the new file, and nothing
+// is written to it twice. On Linux the copy is done by the kernel, with copy_file_range; elsewhere we copy
+// through a large buffer.
+//
+// *** (3) ***
+// We copy whole 'mdat' atoms, so media data that no sample refers to anymore (for instance, the old text of an
+// edited text sample) is copied too; see note (7) for getting rid of it. Top-level atoms other than 'ftyp',
+// 'moov' and 'mdat' are dropped.
+//
+// *** (4) ***
+// We return kQTFileErr_Unimplemented, and write nothing, if the movie refers to media data in other files;
+// the caller should then fall back to some other way of writing the movie (for instance, FlattenMovieData).
+// If the new file is bigger than 4 GB, 32-bit chunk offsets ('stco') can't reach all of its media data, so
+// we write 64-bit chunk offset atoms ('co64') instead; the movie atom then grows by 4 bytes per chunk, which
+// we take into account before laying out the rest of the file.
+//
+// *** (5) ***
+// A fragment writer writes a movie whose text track can be read while it's still being written (for
+// instance, live captions). The movie atom, written first, describes an empty track; every few seconds the
+// writer emits a movie fragment ('moof') describing the samples collected since the last one, followed by
+// an 'mdat' atom holding their data. Players read the fragments as they arrive, so captions show up with a
+// delay of at most one fragment, and the writer never needs to go back and change what it has written.
+// The command-line tool QTLiveCaptionTool.c writes the lines it reads from its standard input as captions in
+// this way, and QTFragmentTest.c checks the fragments the writer produces; to build them, use (for instance)
+//
+//		cc -O2 -I"Common Files" -o qtlivecaption QTLiveCaptionTool.c "Common Files/QTFile.c" "Common Files/QTFileWrite.c" -lpthread
+//		cc -O2 -I"Common Files" -o qtfragmenttest QTFragmentTest.c "Common Files/QTFile.c" "Common Files/QTFileWrite.c" -lpthread
+//
+// *** (6) ***
+// The text track uses the 3GPP timed text sample description ('tx3g'), which the MPEG-4 file format expects;
+// the samples themselves have the same layout as QuickTime text media samples (a 16-bit length word followed
+// by the text), and are built by QTFile_PutTextSample, just as QTText_AddTextTrack builds the samples it adds
+// with AddMediaSample. The text is UTF-8.
+//
+// *** (7) ***
+// QuickTime never removes a sample from a media: QTText_EditText adds the new text as a new sample and removes
+// the old one only from the track, so every edit leaves dead bytes in the movie file. QTFile_CompactMovieFile
+// rewrites a movie file so that each text media holds only the samples its track plays, one after another in
+// the order in which they're played. It works on the movie file with the portable reader and writer, not on
+// the open QuickTime movie (QuickTime isn't thread-safe, and dead bytes only go away when the file is written
+// anew), so it can run on a thread of its own (see QTFile_StartCompaction) while the caller goes on. The only
+// caller is the command-line tool QTTextCompactTool.c (see note (9)); the QTText application itself doesn't
+// compact, since the movie must not be open in QuickTime while its file is rewritten (the edits made since it
+// was last saved would be lost, and on Windows an open file can't be replaced).
+//
+// *** (8) ***
+// The samples a text track keeps are found by walking its edit list: each edit plays the samples whose media
+// times fall in its range, and they are appended to the new media in that order (a sample where one edit ends
+// and the next begins is kept once). The edit's new media time is the new start of its first sample, plus the
+// offset of the edit into that sample, so the track plays exactly as before. A track without an edit list
+// keeps every sample, and so does a track of any other kind, whose sample table we leave alone.
+//
+// *** (9) ***
+// The compacted file is laid out like a fast-start file (see note (1)): the media data of the other tracks keeps
+// its order, and the kept text follows it; a single pass over the movie atom maps every chunk offset to the new
+// file. The new file is written next to the original (with kQTFile_CompactSuffix appended to its name), flushed
+// to disk, and then renamed over the original, so that a crash leaves either the old file or the new one. To
+// build the command-line tool QTTextCompactTool.c, which compacts several files at once, use (for instance)
+//
+//		cc -O2 -I"Common Files" -o qttextcompact QTTextCompactTool.c "Common Files/QTFile.c" "Common Files/QTFileWrite.c" -lpthread
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#if !defined(_WIN32)
+#define _GNU_SOURCE										// for copy_file_range
+#define _FILE_OFFSET_BITS				64				// for files larger than 2 GB
+#endif
+
+#include "QTFileWrite.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kMaxLong						0x7FFFFFFFL
+#define kMaxUInt32						0xFFFFFFFFUL
+
+#define kInitSegmentSize				1024			// room for the 'ftyp' and 'moov' atoms of a fragmented movie
+#define kFragmentHeaderSize				88				// size of a 'moof' atom, not counting its track run entries
+#define kTrackRunEntrySize				8				// size of a track run entry (sample duration and size)
+
+// flags of the track fragment atoms we write
+#define kTrackFragBaseIsMoof			0x020000		// 'tfhd': data offsets are relative to the 'moof' atom
+#define kTrackRunDataOffset				0x000001		// 'trun': the run has a data offset
+#define kTrackRunSampleDuration			0x000100		// 'trun': each entry has a sample duration
+#define kTrackRunSampleSize				0x000200		// 'trun': each entry has a sample size
+
+#define kTrackInMovieAndEnabled			0x000003		// 'tkhd': the track is enabled and used in the movie
+#define kUndeterminedLanguage			0x55C4			// 'mdhd': the packed ISO 639-2 code "und"
+#define kTextFontID						1				// 'tx3g': the ID of the one font in the font table
+#define kTextFontSize					18				// 'tx3g': the default font size
+#define kTextFontName					"Serif"			// 'tx3g': the default font name
+
+#define kCompactEntrySize				32				// the most bytes of new sample table a kept sample can need ('stts', 'stsc', 'stsz', 'co64')
+#define kCompactEditSize				20				// the most bytes an edit can need ('elst', version 1)
+#define kCompactTrackSlack				256				// room for the headers of the atoms we rebuild in a compacted track
+
+#if defined(_WIN32)
+#define kInvalidFile					INVALID_HANDLE_VALUE
+#else
+#define kInvalidFile					-1
+#endif
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// an open file
+#if defined(_WIN32)
+typedef HANDLE							QTFileRef;
+typedef HANDLE							QTFileThread;
+typedef CRITICAL_SECTION				QTFileLock;
+#else
+typedef int								QTFileRef;
+typedef pthread_t						QTFileThread;
+typedef pthread_mutex_t					QTFileLock;
+#endif
+
+// the media data in an 'mdat' atom of the source file
+typedef struct QTFileDataRegion {
+	QTFileUInt64					fSrcOffset;		// the offset of the data in the source file
+	QTFileUInt64					fSize;			// the size of the data
+	QTFileUInt64					fDstOffset;		// the offset of the data in the new file
+	const unsigned char				*fData;			// the data itself, if it isn't in the source file (or NULL)
+} QTFileDataRegion, *QTFileDataRegionPtr;
+
+// an edit of a text track being compacted
+typedef struct QTFileCompactEdit {
+	QTFileTimeValue					fDuration;		// the duration of the edit, in the movie's time scale
+	QTFileTimeValue					fMediaTime;		// the media time at which it starts (-1 for an empty edit)
+	QTFileUInt32					fRate;			// the media rate (16.16 fixed point)
+} QTFileCompactEdit, *QTFileCompactEditPtr;
+
+// a track of a movie being compacted, and (for a text track) the samples its new media keeps
+typedef struct QTFileCompactTrack {
+	QTFileTrackPtr					fTrack;			// the track
+	long							*fSamples;		// the numbers (in the old media) of the samples kept, in the order played
+	long							fCount;			// the number of samples kept
+	long							*fDescIndexes;	// the sample description index of each sample of the old media
+	long							fEditCount;		// the number of edits in the track's edit list
+	QTFileCompactEditPtr			fEdits;			// the new edit list, or NULL if the track has none
+	QTFileTimeValue					fMediaDuration;	// the duration of the new media
+	QTFileUInt64					fDataOffset;	// the offset of the kept samples in the compacted text
+	QTFileUInt64					fDataSize;		// their total size
+	QTFileUInt64					fDeadSize;		// the total size of the samples dropped
+	long							fDeadCount;		// the number of samples dropped
+} QTFileCompactTrack, *QTFileCompactTrackPtr;
+
+// a compaction running on a thread of its own
+struct QTFileCompactJob {
+	char							*fPath;			// the movie file
+	long							fPadding;		// the most free space to leave after the movie atom
+	QTFileThread					fThread;		// the thread doing the work
+	QTFileLock						fLock;			// protects fIsDone
+	int								fIsDone;		// nonzero once the thread has finished
+	long							fErr;			// the result of the compaction
+	QTFileCompactStats				fStats;			// its statistics
+};
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static long					QTFile_FindDataRegions (QTFileRef theFile, QTFileUInt64 *theFileTypeSize, QTFileDataRegionPtr theRegions, long *theRegionCount);
+static long					QTFile_CheckDataReferences (const QTFileAtom *theMovieAtom);
+static long					QTFile_RewriteChunkOffsets (unsigned char *theMovieAtom, long theSize, const QTFileDataRegion *theRegions, long theRegionCount, long *theChunkCount);
+static long					QTFile_PromoteChunkOffsets (const unsigned char *theData, long theSize, unsigned char *theNewData);
+static long					QTFile_MapChunkOffset (const QTFileDataRegion *theRegions, long theRegionCount, QTFileUInt64 theOffset, QTFileUInt64 *theNewOffset);
+static long					QTFile_WriteMovieFile (QTFileRef theSrcFile, QTFileUInt64 theFileTypeSize, const unsigned char *theMovieAtom, long theMovieAtomSize, long thePadding, QTFileDataRegionPtr theRegions, long theRegionCount, const char *theDstPath, int isDurable, QTFileFlattenStatsPtr theStats);
+static long					QTFile_ReadMovieAtom (QTFileRef theFile, QTFileUInt64 *theFileTypeSize, unsigned char **theData, long *theSize);
+static QTFileUInt32			QTFile_GetTrackAtomID (const QTFileAtom *theTrackAtom);
+static long					QTFile_PlanCompactTrack (QTFileMoviePtr theMovie, const QTFileAtom *theTrackAtom, QTFileCompactTrackPtr thePlan);
+static long					QTFile_GetDescIndexes (const QTFileAtom *theSampleTable, long theSampleCount, long *theIndexes);
+static void					QTFile_AppendCompactAtoms (unsigned char *theBuffer, long *theOffset, const QTFileAtom *theParent, const QTFileCompactTrack *thePlan, QTFileUInt64 theDataOffset, int use64);
+static void					QTFile_AppendCompactEdits (unsigned char *theBuffer, long *theOffset, const QTFileCompactTrack *thePlan);
+static void					QTFile_AppendCompactSampleTable (unsigned char *theBuffer, long *theOffset, const QTFileAtom *theSampleTable, const QTFileCompactTrack *thePlan, QTFileUInt64 theDataOffset, int use64);
+static void					QTFile_DisposeCompactTracks (QTFileCompactTrackPtr thePlans, long theCount);
+static int					QTFile_CompareRegions (const void *theFirst, const void *theSecond);
+#if defined(_WIN32)
+static DWORD WINAPI			QTFile_CompactThreadEntry (LPVOID theJob);
+#else
+static void					*QTFile_CompactThreadEntry (void *theJob);
+#endif
+static void					QTFile_InitLock (QTFileLock *theLock);
+static void					QTFile_DisposeLock (QTFileLock *theLock);
+static void					QTFile_Lock (QTFileLock *theLock);
+static void					QTFile_Unlock (QTFileLock *theLock);
+static QTFileRef			QTFile_OpenFile (const char *thePath, int forWriting);
+static void					QTFile_CloseFile (QTFileRef theFile);
+static long					QTFile_GetFileSize (QTFileRef theFile, QTFileUInt64 *theSize);
+static long					QTFile_ReadData (QTFileRef theFile, QTFileUInt64 theOffset, void *theData, long theSize);
+static long					QTFile_WriteData (QTFileRef theFile, const void *theData, long theSize);
+static long					QTFile_CopyData (QTFileRef theSrcFile, QTFileUInt64 theOffset, QTFileUInt64 theSize, QTFileRef theDstFile, unsigned char *theBuffer);
+static long					QTFile_SyncFile (QTFileRef theFile);
+static long					QTFile_ReplaceFile (const char *theNewPath, const char *thePath);
+static void					QTFile_DeleteFile (const char *thePath);
+static long					QTFile_BuildInitSegment (QTFileFragmentWriterPtr theWriter, unsigned char *theBuffer, short theWidth, short theHeight);
+static void					QTFile_PutFragment (QTFileFragmentWriterPtr theWriter, const unsigned char *theData, long theSize);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fast-start utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_WriteFastStartMovie
+// Write a new movie file at theDstPath, containing the specified movie atom, thePadding bytes of free space,
+// and the media data of the movie file at theSrcPath.
+//
+// If theDstPath already names a file, that file is replaced.
+//
+//////////
+
+long QTFile_WriteFastStartMovie (const char *theSrcPath, const unsigned char *theMovieAtom, long theMovieAtomSize, const char *theDstPath, long thePadding, QTFileFlattenStatsPtr theStats)
+{
+	QTFileRef			mySrcFile = kInvalidFile;
+	QTFileDataRegionPtr	myRegions = NULL;
+	QTFileAtom			myAtom;
+	QTFileUInt64		myFileTypeSize = 0;
+	long				myRegionCount = kQTFile_MaxDataRegions;
+	long				myOffset = 0;
+	long				myErr = kQTFileErr_NoErr;
+
+	if (theStats != NULL)
+		memset(theStats, 0, sizeof(QTFileFlattenStats));
+
+	if ((theSrcPath == NULL) || (theDstPath == NULL) || (theMovieAtom == NULL))
+		return(kQTFileErr_Param);
+
+	// make sure we were given exactly one movie atom
+	if (!QTFile_GetAtom(theMovieAtom, theMovieAtomSize, &myOffset, &myAtom) || (myAtom.fType != kQTFile_MovieAtom) || (myOffset != theMovieAtomSize))
+		return(kQTFileErr_InvalidMovie);
+
+	myErr = QTFile_CheckDataReferences(&myAtom);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	myRegions = (QTFileDataRegionPtr)malloc(kQTFile_MaxDataRegions * sizeof(QTFileDataRegion));
+	if (myRegions == NULL)
+		return(kQTFileErr_MemFull);
+
+	mySrcFile = QTFile_OpenFile(theSrcPath, 0);
+	if (mySrcFile == kInvalidFile) {
+		myErr = kQTFileErr_FileNotFound;
+		goto bail;
+	}
+
+	myErr = QTFile_FindDataRegions(mySrcFile, &myFileTypeSize, myRegions, &myRegionCount);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	myErr = QTFile_WriteMovieFile(mySrcFile, myFileTypeSize, theMovieAtom, theMovieAtomSize, thePadding, myRegions, myRegionCount, theDstPath, 0, theStats);
+
+bail:
+	if (mySrcFile != kInvalidFile)
+		QTFile_CloseFile(mySrcFile);
+
+	free(myRegions);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Compaction utilities.
+//
+// Editing a text track in QuickTime adds new samples to its media and removes the old ones from the track,
+// but never from the media: their bytes stay in the movie file for good. Compacting the movie file rewrites
+// it so that each text media holds only the samples its track plays, contiguous and in the order in which
+// they are played; see notes (7) through (9).
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_CompactMovieFile
+// Rewrite the movie file at thePath so that its text media hold only the samples their tracks play, and
+// return some statistics through theStats (which can be NULL). The movie file is replaced only once the
+// compacted file has been completely written; if we fail, the original file is left as it was.
+//
+// If no text media holds any sample its track doesn't play, or if dropping those samples wouldn't make the file
+// any smaller, the file is left alone. thePadding is the most free space we leave after the new movie atom; we
+// leave less, or none, rather than let the compacted file come out bigger than the original.
+//
+//////////
+
+long QTFile_CompactMovieFile (const char *thePath, long thePadding, QTFileCompactStatsPtr theStats)
+{
+	QTFileMoviePtr			myMovie = NULL;
+	QTFileRef				mySrcFile = kInvalidFile;
+	QTFileCompactTrackPtr	myPlans = NULL;
+	QTFileDataRegionPtr		myRegions = NULL;
+	unsigned char			*myMovieData = NULL;
+	unsigned char			*myNewMovie = NULL;
+	unsigned char			*myText = NULL;
+	char					*myTempPath = NULL;
+	QTFileAtom				myMovieAtom;
+	QTFileAtom				myAtom;
+	QTFileUInt64			myFileSize = 0;
+	QTFileUInt64			myFileTypeSize = 0;
+	QTFileUInt64			myTextSize = 0;
+	QTFileUInt64			myDeadSize = 0;
+	QTFileUInt64			myDataSize = 0;
+	QTFileUInt64			myLayoutSize;
+	long					myMovieSize = 0;
+	long					myNewSize = 0;
+	long					myMaxSize;
+	long					myRangeCount = 0;
+	long					myRegionCount = 0;
+	long					myPlanCount = 0;
+	long					myAtomStart;
+	long					myOffset = 0;
+	long					myIndex;
+	long					mySample;
+	long					myStart;
+	int						use64;
+	long					myErr = kQTFileErr_NoErr;
+
+	if (theStats != NULL)
+		memset(theStats, 0, sizeof(QTFileCompactStats));
+
+	if (thePath == NULL)
+		return(kQTFileErr_Param);
+
+	myErr = QTFile_OpenMovie(thePath, &myMovie);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	mySrcFile = QTFile_OpenFile(thePath, 0);
+	if (mySrcFile == kInvalidFile) {
+		myErr = kQTFileErr_FileNotFound;
+		goto bail;
+	}
+
+	myErr = QTFile_GetFileSize(mySrcFile, &myFileSize);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	myErr = QTFile_ReadMovieAtom(mySrcFile, &myFileTypeSize, &myMovieData, &myMovieSize);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	if (!QTFile_GetAtom(myMovieData, myMovieSize, &myOffset, &myMovieAtom)) {
+		myErr = kQTFileErr_InvalidMovie;
+		goto bail;
+	}
+
+	myErr = QTFile_CheckDataReferences(&myMovieAtom);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	// decide, track by track, which samples stay; only text tracks lose any
+	myPlans = (QTFileCompactTrackPtr)calloc(myMovie->fTrackCount + 1, sizeof(QTFileCompactTrack));
+	if (myPlans == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	myOffset = 0;
+	while (QTFile_GetAtom(myMovieAtom.fData, myMovieAtom.fSize, &myOffset, &myAtom)) {
+		QTFileTrackPtr		myTrack;
+
+		if (myAtom.fType != kQTFile_TrackAtom)
+			continue;
+
+		myTrack = QTFile_GetTrackByID(myMovie, QTFile_GetTrackAtomID(&myAtom));
+		if ((myTrack == NULL) || (myPlanCount == myMovie->fTrackCount)) {
+			myErr = kQTFileErr_InvalidMovie;
+			goto bail;
+		}
+
+		// we need to know where the samples of every track are, since we move them all
+		myRangeCount += QTFile_GetSampleCount(myTrack);
+		if (myTrack->fSampleTableErr != kQTFileErr_NoErr) {
+			myErr = myTrack->fSampleTableErr;
+			goto bail;
+		}
+
+		myPlans[myPlanCount].fTrack = myTrack;
+		if (QTFile_IsTextTrack(myTrack)) {
+			myErr = QTFile_PlanCompactTrack(myMovie, &myAtom, &myPlans[myPlanCount]);
+			if (myErr != kQTFileErr_NoErr)
+				goto bail;
+		}
+
+		myDeadSize += myPlans[myPlanCount].fDeadSize;
+		myPlanCount++;
+	}
+
+	if (myDeadSize == 0) {
+		// every text sample is in use, so there's nothing to reclaim
+		if (theStats != NULL)
+			theStats->fOldSize = theStats->fNewSize = myFileSize;
+		goto bail;
+	}
+
+	// the samples of the tracks we don't compact keep their order; collect the pieces of the file they occupy,
+	// and merge the pieces that touch or overlap, so that they can be copied in a few large runs
+	myRegions = (QTFileDataRegionPtr)malloc((myRangeCount + 1) * sizeof(QTFileDataRegion));
+	if (myRegions == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < myPlanCount; myIndex++) {
+		QTFileTrackPtr		myTrack = myPlans[myIndex].fTrack;
+
+		if (myPlans[myIndex].fDeadCount > 0)
+			continue;
+
+		for (mySample = 0; mySample < myTrack->fSampleCount; mySample++) {
+			myRegions[myRegionCount].fSrcOffset = myTrack->fSampleOffsets[mySample];
+			myRegions[myRegionCount].fSize = myTrack->fSampleSizes[mySample];
+			myRegions[myRegionCount].fDstOffset = 0;
+			myRegions[myRegionCount].fData = NULL;
+			myRegionCount++;
+		}
+	}
+
+	qsort(myRegions, myRegionCount, sizeof(QTFileDataRegion), QTFile_CompareRegions);
+
+	myRangeCount = myRegionCount;
+	myRegionCount = 0;
+	for (myIndex = 0; myIndex < myRangeCount; myIndex++) {
+		QTFileUInt64		myEnd = myRegions[myIndex].fSrcOffset + myRegions[myIndex].fSize;
+
+		if ((myRegionCount > 0) && (myRegions[myIndex].fSrcOffset <= myRegions[myRegionCount - 1].fSrcOffset + myRegions[myRegionCount - 1].fSize)) {
+			if (myEnd > myRegions[myRegionCount - 1].fSrcOffset + myRegions[myRegionCount - 1].fSize)
+				myRegions[myRegionCount - 1].fSize = myEnd - myRegions[myRegionCount - 1].fSrcOffset;
+		} else {
+			myRegions[myRegionCount++] = myRegions[myIndex];
+		}
+	}
+
+	// gather the samples the compacted tracks keep, track after track, in the order in which they're played
+	for (myIndex = 0; myIndex < myPlanCount; myIndex++) {
+		if (myPlans[myIndex].fDeadCount > 0) {
+			myPlans[myIndex].fDataOffset = myTextSize;
+			myTextSize += myPlans[myIndex].fDataSize;
+		}
+	}
+
+	if (myTextSize > kQTFile_MaxCompactTextSize) {
+		myErr = kQTFileErr_Unimplemented;
+		goto bail;
+	}
+
+	myText = (unsigned char *)malloc((size_t)myTextSize + 1);
+	if (myText == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < myPlanCount; myIndex++) {
+		QTFileCompactTrackPtr	myPlan = &myPlans[myIndex];
+		unsigned char			*myData = myText + myPlan->fDataOffset;
+
+		if (myPlan->fDeadCount == 0)
+			continue;
+
+		for (mySample = 0; mySample < myPlan->fCount; mySample++) {
+			const unsigned char	*mySampleData;
+			long				mySampleSize;
+
+			myErr = QTFile_GetSampleData(myMovie, myPlan->fTrack, myPlan->fSamples[mySample], &mySampleData, &mySampleSize);
+			if (myErr != kQTFileErr_NoErr)
+				goto bail;
+
+			memcpy(myData, mySampleData, mySampleSize);
+			myData += mySampleSize;
+		}
+	}
+
+	// the compacted text follows all the other media data; we give it a source offset just past the end of the
+	// source file, so that its chunk offsets are mapped to the new file along with everybody else's
+	myRegions[myRegionCount].fSrcOffset = myFileSize;
+	myRegions[myRegionCount].fSize = myTextSize;
+	myRegions[myRegionCount].fDstOffset = 0;
+	myRegions[myRegionCount].fData = myText;
+	myRegionCount++;
+
+	use64 = (myFileSize + myTextSize > kMaxUInt32);
+
+	// build the new movie atom, rebuilding the tracks we compact and copying everything else as it is
+	myMaxSize = myMovieSize;
+	for (myIndex = 0; myIndex < myPlanCount; myIndex++)
+		if (myPlans[myIndex].fDeadCount > 0)
+			myMaxSize += (myPlans[myIndex].fCount * kCompactEntrySize) + (myPlans[myIndex].fEditCount * kCompactEditSize) + kCompactTrackSlack;
+
+	myNewMovie = (unsigned char *)malloc(myMaxSize);
+	if (myNewMovie == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	myStart = QTFile_BeginAtom(myNewMovie, &myNewSize, kQTFile_MovieAtom);
+
+	myIndex = 0;
+	myOffset = 0;
+	myAtomStart = 0;
+	while (QTFile_GetAtom(myMovieAtom.fData, myMovieAtom.fSize, &myOffset, &myAtom)) {
+		if ((myAtom.fType == kQTFile_TrackAtom) && (myPlans[myIndex++].fDeadCount > 0)) {
+			QTFileCompactTrackPtr	myPlan = &myPlans[myIndex - 1];
+			long					myTrackStart;
+
+			myTrackStart = QTFile_BeginAtom(myNewMovie, &myNewSize, kQTFile_TrackAtom);
+			QTFile_AppendCompactAtoms(myNewMovie, &myNewSize, &myAtom, myPlan, myFileSize + myPlan->fDataOffset, use64);
+			QTFile_EndAtom(myNewMovie, myNewSize, myTrackStart);
+		} else {
+			QTFile_AppendData(myNewMovie, &myNewSize, myMovieAtom.fData + myAtomStart, myOffset - myAtomStart);
+		}
+
+		myAtomStart = myOffset;
+	}
+
+	QTFile_EndAtom(myNewMovie, myNewSize, myStart);
+
+	// work out how big the compacted file is without any free space, laying it out as QTFile_WriteMovieFile does
+	for (myIndex = 0; myIndex < myRegionCount; myIndex++)
+		myDataSize += myRegions[myIndex].fSize;
+
+	myLayoutSize = myFileTypeSize + myNewSize + myDataSize;
+	myLayoutSize += (myDataSize + kQTFile_AtomHeaderSize > kMaxUInt32) ? kQTFile_ExtendedAtomHeaderSize : kQTFile_AtomHeaderSize;
+	if (myLayoutSize > kMaxUInt32)
+		myLayoutSize += QTFile_PromoteChunkOffsets(myNewMovie, myNewSize, NULL) - myNewSize;
+
+	if (myLayoutSize >= myFileSize) {
+		// the old text takes up less room than the new tables would, so there's nothing to reclaim
+		if (theStats != NULL)
+			theStats->fOldSize = theStats->fNewSize = myFileSize;
+		goto bail;
+	}
+
+	// the free space comes out of what we reclaim; a 'free' atom can't be smaller than its header
+	if ((QTFileUInt64)thePadding > myFileSize - myLayoutSize)
+		thePadding = (long)(myFileSize - myLayoutSize);
+
+	if (thePadding < kQTFile_AtomHeaderSize)
+		thePadding = 0;
+
+	// write the compacted file next to the original and make sure it's on disk before it replaces the original
+	myTempPath = (char *)malloc(strlen(thePath) + strlen(kQTFile_CompactSuffix) + 1);
+	if (myTempPath == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	strcpy(myTempPath, thePath);
+	strcat(myTempPath, kQTFile_CompactSuffix);
+
+	myErr = QTFile_WriteMovieFile(mySrcFile, myFileTypeSize, myNewMovie, myNewSize, thePadding, myRegions, myRegionCount, myTempPath, 1, NULL);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	// the original file must be closed before it can be replaced (on Windows, at any rate)
+	QTFile_CloseMovie(myMovie);
+	myMovie = NULL;
+	QTFile_CloseFile(mySrcFile);
+	mySrcFile = kInvalidFile;
+
+	myErr = QTFile_ReplaceFile(myTempPath, thePath);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	if (theStats != NULL) {
+		mySrcFile = QTFile_OpenFile(thePath, 0);
+		if (mySrcFile != kInvalidFile)
+			QTFile_GetFileSize(mySrcFile, &theStats->fNewSize);
+
+		theStats->fOldSize = myFileSize;
+		theStats->fBytesReclaimed = (QTFileInt64)myFileSize - (QTFileInt64)theStats->fNewSize;
+		theStats->fDeadBytes = myDeadSize;
+
+		for (myIndex = 0; myIndex < myPlanCount; myIndex++) {
+			if (myPlans[myIndex].fDeadCount > 0) {
+				theStats->fTrackCount++;
+				theStats->fSampleCount += myPlans[myIndex].fCount;
+				theStats->fDroppedCount += myPlans[myIndex].fDeadCount;
+			}
+		}
+	}
+
+bail:
+	if ((myErr != kQTFileErr_NoErr) && (myTempPath != NULL))
+		QTFile_DeleteFile(myTempPath);
+
+	if (mySrcFile != kInvalidFile)
+		QTFile_CloseFile(mySrcFile);
+
+	if (myMovie != NULL)
+		QTFile_CloseMovie(myMovie);
+
+	QTFile_DisposeCompactTracks(myPlans, myPlanCount);
+
+	free(myTempPath);
+	free(myNewMovie);
+	free(myText);
+	free(myRegions);
+	free(myMovieData);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_StartCompaction
+// Start compacting the movie file at thePath on a thread of its own (see QTFile_CompactMovieFile), and return
+// the new compaction job through theJob. The caller must eventually call QTFile_FinishCompaction for the job.
+//
+//////////
+
+long QTFile_StartCompaction (const char *thePath, long thePadding, QTFileCompactJobPtr *theJob)
+{
+	QTFileCompactJobPtr		myJob = NULL;
+	int						isStarted;
+
+	if (theJob == NULL)
+		return(kQTFileErr_Param);
+
+	*theJob = NULL;
+
+	if (thePath == NULL)
+		return(kQTFileErr_Param);
+
+	myJob = (QTFileCompactJobPtr)calloc(1, sizeof(QTFileCompactJob));
+	if (myJob == NULL)
+		return(kQTFileErr_MemFull);
+
+	myJob->fPath = (char *)malloc(strlen(thePath) + 1);
+	if (myJob->fPath == NULL) {
+		free(myJob);
+		return(kQTFileErr_MemFull);
+	}
+
+	strcpy(myJob->fPath, thePath);
+	myJob->fPadding = thePadding;
+	QTFile_InitLock(&myJob->fLock);
+
+#if defined(_WIN32)
+	myJob->fThread = CreateThread(NULL, 0, QTFile_CompactThreadEntry, myJob, 0, NULL);
+	isStarted = (myJob->fThread != NULL);
+#else
+	isStarted = (pthread_create(&myJob->fThread, NULL, QTFile_CompactThreadEntry, myJob) == 0);
+#endif
+
+	if (!isStarted) {
+		QTFile_DisposeLock(&myJob->fLock);
+		free(myJob->fPath);
+		free(myJob);
+		return(kQTFileErr_MemFull);
+	}
+
+	*theJob = myJob;
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_IsCompactionDone
+// Return a nonzero value if the specified compaction job has finished (so that QTFile_FinishCompaction
+// won't have to wait for it).
+//
+//////////
+
+int QTFile_IsCompactionDone (QTFileCompactJobPtr theJob)
+{
+	int						isDone;
+
+	if (theJob == NULL)
+		return(1);
+
+	QTFile_Lock(&theJob->fLock);
+	isDone = theJob->fIsDone;
+	QTFile_Unlock(&theJob->fLock);
+
+	return(isDone);
+}
+
+
+//////////
+//
+// QTFile_FinishCompaction
+// Wait for the specified compaction job to finish, return its statistics through theStats (which can be
+// NULL), and dispose of the job; return the result of the compaction.
+//
+//////////
+
+long QTFile_FinishCompaction (QTFileCompactJobPtr theJob, QTFileCompactStatsPtr theStats)
+{
+	long					myErr;
+
+	if (theJob == NULL)
+		return(kQTFileErr_Param);
+
+#if defined(_WIN32)
+	WaitForSingleObject(theJob->fThread, INFINITE);
+	CloseHandle(theJob->fThread);
+#else
+	pthread_join(theJob->fThread, NULL);
+#endif
+
+	if (theStats != NULL)
+		*theStats = theJob->fStats;
+
+	myErr = theJob->fErr;
+
+	QTFile_DisposeLock(&theJob->fLock);
+	free(theJob->fPath);
+	free(theJob);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Text sample utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_PutTextSample
+// Build a text media sample holding the specified text at theData; return the size of the sample, or 0 if the
+// text is too long.
+//
+// A text media sample is a 16-bit length word followed by the text; theData must have room for
+// theLength + 2 bytes.
+//
+//////////
+
+long QTFile_PutTextSample (unsigned char *theData, const char *theText, long theLength)
+{
+	if ((theLength < 0) || (theLength > kQTFile_MaxTextLength))
+		return(0);
+
+	QTFile_Put16(theData, (QTFileUInt16)theLength);
+	memcpy(theData + sizeof(QTFileUInt16), theText, theLength);
+
+	return(sizeof(QTFileUInt16) + theLength);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Atom building utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_BeginAtom
+// Start an atom of the specified type at *theOffset in theBuffer; return the offset of the atom, to be
+// passed to QTFile_EndAtom once the contents of the atom have been appended.
+//
+//////////
+
+long QTFile_BeginAtom (unsigned char *theBuffer, long *theOffset, QTFileOSType theType)
+{
+	long				myStart = *theOffset;
+
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_Append32(theBuffer, theOffset, theType);
+
+	return(myStart);
+}
+
+
+//////////
+//
+// QTFile_EndAtom
+// Finish the atom that starts at theStart in theBuffer and ends at theOffset, by filling in its size.
+//
+//////////
+
+void QTFile_EndAtom (unsigned char *theBuffer, long theOffset, long theStart)
+{
+	QTFile_Put32(theBuffer + theStart, (QTFileUInt32)(theOffset - theStart));
+}
+
+
+//////////
+//
+// QTFile_Append16
+// Append the specified 16-bit value, big-endian, at *theOffset in theBuffer.
+//
+//////////
+
+void QTFile_Append16 (unsigned char *theBuffer, long *theOffset, QTFileUInt16 theValue)
+{
+	QTFile_Put16(theBuffer + *theOffset, theValue);
+	*theOffset += 2;
+}
+
+
+//////////
+//
+// QTFile_Append32
+// Append the specified 32-bit value, big-endian, at *theOffset in theBuffer.
+//
+//////////
+
+void QTFile_Append32 (unsigned char *theBuffer, long *theOffset, QTFileUInt32 theValue)
+{
+	QTFile_Put32(theBuffer + *theOffset, theValue);
+	*theOffset += 4;
+}
+
+
+//////////
+//
+// QTFile_Append64
+// Append the specified 64-bit value, big-endian, at *theOffset in theBuffer.
+//
+//////////
+
+void QTFile_Append64 (unsigned char *theBuffer, long *theOffset, QTFileUInt64 theValue)
+{
+	QTFile_Put64(theBuffer + *theOffset, theValue);
+	*theOffset += 8;
+}
+
+
+//////////
+//
+// QTFile_AppendZeros
+// Append theCount zero bytes at *theOffset in theBuffer.
+//
+//////////
+
+void QTFile_AppendZeros (unsigned char *theBuffer, long *theOffset, long theCount)
+{
+	memset(theBuffer + *theOffset, 0, theCount);
+	*theOffset += theCount;
+}
+
+
+//////////
+//
+// QTFile_AppendMatrix
+// Append an identity matrix at *theOffset in theBuffer.
+//
+//////////
+
+void QTFile_AppendMatrix (unsigned char *theBuffer, long *theOffset)
+{
+	QTFile_Append32(theBuffer, theOffset, 0x00010000);
+	QTFile_AppendZeros(theBuffer, theOffset, 12);
+	QTFile_Append32(theBuffer, theOffset, 0x00010000);
+	QTFile_AppendZeros(theBuffer, theOffset, 12);
+	QTFile_Append32(theBuffer, theOffset, 0x40000000);
+}
+
+
+//////////
+//
+// QTFile_AppendData
+// Append theSize bytes of the specified data at *theOffset in theBuffer.
+//
+//////////
+
+void QTFile_AppendData (unsigned char *theBuffer, long *theOffset, const void *theData, long theSize)
+{
+	memcpy(theBuffer + *theOffset, theData, theSize);
+	*theOffset += theSize;
+}
+
+
+//////////
+//
+// QTFile_AppendTextDescription
+// Append, at *theOffset in theBuffer, a 3GPP timed text sample description ('tx3g') for a text box of the
+// specified size: centered text at the bottom of the box, in a single font.
+//
+//////////
+
+void QTFile_AppendTextDescription (unsigned char *theBuffer, long *theOffset, short theWidth, short theHeight)
+{
+	long				myEntry;
+	long				myAtom;
+
+	myEntry = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_TX3GDataFormat);
+	QTFile_AppendZeros(theBuffer, theOffset, 6);
+	QTFile_Append16(theBuffer, theOffset, 1);						// data reference index
+	QTFile_Append32(theBuffer, theOffset, 0);						// display flags
+	theBuffer[(*theOffset)++] = 1;									// horizontal justification: center
+	theBuffer[(*theOffset)++] = 0xFF;								// vertical justification: bottom
+	QTFile_Append32(theBuffer, theOffset, 0);						// background color (transparent)
+	QTFile_Append16(theBuffer, theOffset, 0);						// text box
+	QTFile_Append16(theBuffer, theOffset, 0);
+	QTFile_Append16(theBuffer, theOffset, (QTFileUInt16)theHeight);
+	QTFile_Append16(theBuffer, theOffset, (QTFileUInt16)theWidth);
+	QTFile_Append32(theBuffer, theOffset, 0);						// default style: all the text...
+	QTFile_Append16(theBuffer, theOffset, kTextFontID);
+	theBuffer[(*theOffset)++] = 0;									// ...plain...
+	theBuffer[(*theOffset)++] = kTextFontSize;
+	QTFile_Append32(theBuffer, theOffset, 0xFFFFFFFF);				// ...and white
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_FontTableAtom);
+	QTFile_Append16(theBuffer, theOffset, 1);
+	QTFile_Append16(theBuffer, theOffset, kTextFontID);
+	theBuffer[(*theOffset)++] = sizeof(kTextFontName) - 1;
+	QTFile_AppendData(theBuffer, theOffset, kTextFontName, sizeof(kTextFontName) - 1);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	QTFile_EndAtom(theBuffer, *theOffset, myEntry);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fragment utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_BeginFragmentWriter
+// Prepare the specified fragment writer to write a fragmented movie with a single text track, whose media
+// has the specified time scale, and write out the beginning of the movie (its 'ftyp' and 'moov' atoms).
+//
+// A fragment is written whenever the samples collected make up at least theFragmentDuration (in the media
+// time scale); pass 0 to use kQTFile_DefaultFragmentSeconds. theWidth and theHeight are the size of the text box.
+//
+//////////
+
+long QTFile_BeginFragmentWriter (QTFileFragmentWriterPtr theWriter, QTFileWriteProcPtr theWriteProc, void *theRefCon, long theTimeScale, long theFragmentDuration, short theWidth, short theHeight)
+{
+	unsigned char		myBuffer[kInitSegmentSize];
+	long				mySize;
+
+	if ((theWriter == NULL) || (theWriteProc == NULL) || (theTimeScale <= 0))
+		return(kQTFileErr_Param);
+
+	memset(theWriter, 0, sizeof(QTFileFragmentWriter));
+
+	if (theFragmentDuration <= 0)
+		theFragmentDuration = theTimeScale * kQTFile_DefaultFragmentSeconds;
+
+	theWriter->fWriteProc = theWriteProc;
+	theWriter->fRefCon = theRefCon;
+	theWriter->fTrackID = 1;
+	theWriter->fTimeScale = theTimeScale;
+	theWriter->fFragmentDuration = theFragmentDuration;
+	theWriter->fMaxSamples = kQTFile_MinFragmentSamples;
+	theWriter->fMaxDataSize = kQTFile_MinFragmentDataSize;
+	theWriter->fEntries = (unsigned char *)malloc(theWriter->fMaxSamples * kTrackRunEntrySize);
+	theWriter->fData = (unsigned char *)malloc(theWriter->fMaxDataSize);
+	if ((theWriter->fEntries == NULL) || (theWriter->fData == NULL)) {
+		theWriter->fError = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	mySize = QTFile_BuildInitSegment(theWriter, myBuffer, theWidth, theHeight);
+	QTFile_PutFragment(theWriter, myBuffer, mySize);
+
+bail:
+	return(theWriter->fError);
+}
+
+
+//////////
+//
+// QTFile_WriteFragmentSample
+// Add a text sample having the specified (UTF-8) text and duration to the specified fragment writer.
+//
+// If the samples already collected make up a whole fragment, they are written out first; so a sample is
+// written out only once a later sample has been added, or when the writer is flushed.
+//
+//////////
+
+long QTFile_WriteFragmentSample (QTFileFragmentWriterPtr theWriter, const char *theText, long theLength, long theDuration)
+{
+	unsigned char		*myPtr = NULL;
+	long				mySize;
+
+	if ((theWriter == NULL) || (theLength < 0) || (theLength > kQTFile_MaxTextLength) || (theDuration < 0))
+		return(kQTFileErr_Param);
+
+	if (theWriter->fError != kQTFileErr_NoErr)
+		return(theWriter->fError);
+
+	if (theWriter->fDuration >= theWriter->fFragmentDuration)
+		QTFile_FlushFragment(theWriter);
+
+	// make sure there's room for the sample; the buffers grow to hold the biggest fragment written so far
+	if (theWriter->fSampleCount == theWriter->fMaxSamples) {
+		myPtr = (unsigned char *)realloc(theWriter->fEntries, 2 * theWriter->fMaxSamples * kTrackRunEntrySize);
+		if (myPtr == NULL)
+			return(kQTFileErr_MemFull);
+
+		theWriter->fEntries = myPtr;
+		theWriter->fMaxSamples *= 2;
+	}
+
+	mySize = sizeof(QTFileUInt16) + theLength;
+	if (theWriter->fDataSize + mySize > theWriter->fMaxDataSize) {
+		long		myMaxDataSize = 2 * theWriter->fMaxDataSize;
+
+		if (myMaxDataSize < theWriter->fDataSize + mySize)
+			myMaxDataSize = theWriter->fDataSize + mySize;
+
+		myPtr = (unsigned char *)realloc(theWriter->fData, myMaxDataSize);
+		if (myPtr == NULL)
+			return(kQTFileErr_MemFull);
+
+		theWriter->fData = myPtr;
+		theWriter->fMaxDataSize = myMaxDataSize;
+	}
+
+	QTFile_PutTextSample(theWriter->fData + theWriter->fDataSize, theText, theLength);
+
+	myPtr = theWriter->fEntries + (theWriter->fSampleCount * kTrackRunEntrySize);
+	QTFile_Put32(myPtr, (QTFileUInt32)theDuration);
+	QTFile_Put32(myPtr + 4, (QTFileUInt32)mySize);
+
+	theWriter->fDataSize += mySize;
+	theWriter->fDuration += theDuration;
+	theWriter->fSampleCount++;
+
+	return(theWriter->fError);
+}
+
+
+//////////
+//
+// QTFile_FlushFragment
+// Write out the samples collected by the specified fragment writer, as a movie fragment.
+//
+//////////
+
+long QTFile_FlushFragment (QTFileFragmentWriterPtr theWriter)
+{
+	unsigned char		myHeader[kFragmentHeaderSize + kQTFile_AtomHeaderSize];
+	long				myEntriesSize;
+	long				myOffset = 0;
+	long				myTrack;
+
+	if (theWriter == NULL)
+		return(kQTFileErr_Param);
+
+	if ((theWriter->fSampleCount == 0) || (theWriter->fError != kQTFileErr_NoErr))
+		return(theWriter->fError);
+
+	myEntriesSize = theWriter->fSampleCount * kTrackRunEntrySize;
+	theWriter->fSequenceNumber++;
+
+	// the movie fragment atom...
+	QTFile_Append32(myHeader, &myOffset, kFragmentHeaderSize + myEntriesSize);
+	QTFile_Append32(myHeader, &myOffset, kQTFile_MovieFragmentAtom);
+
+	QTFile_Append32(myHeader, &myOffset, 16);
+	QTFile_Append32(myHeader, &myOffset, kQTFile_MovieFragmentHeaderAtom);
+	QTFile_Append32(myHeader, &myOffset, 0);
+	QTFile_Append32(myHeader, &myOffset, theWriter->fSequenceNumber);
+
+	myTrack = myOffset;
+	QTFile_Append32(myHeader, &myOffset, kFragmentHeaderSize + myEntriesSize - myTrack);
+	QTFile_Append32(myHeader, &myOffset, kQTFile_TrackFragmentAtom);
+
+	QTFile_Append32(myHeader, &myOffset, 16);
+	QTFile_Append32(myHeader, &myOffset, kQTFile_TrackFragmentHeaderAtom);
+	QTFile_Append32(myHeader, &myOffset, kTrackFragBaseIsMoof);
+	QTFile_Append32(myHeader, &myOffset, theWriter->fTrackID);
+
+	// (version 1, so that the time can't overflow)
+	QTFile_Append32(myHeader, &myOffset, 20);
+	QTFile_Append32(myHeader, &myOffset, kQTFile_TrackFragmentTimeAtom);
+	QTFile_Append32(myHeader, &myOffset, 0x01000000);
+	QTFile_Append64(myHeader, &myOffset, theWriter->fFragmentTime);
+
+	QTFile_Append32(myHeader, &myOffset, 20 + myEntriesSize);
+	QTFile_Append32(myHeader, &myOffset, kQTFile_TrackRunAtom);
+	QTFile_Append32(myHeader, &myOffset, kTrackRunDataOffset | kTrackRunSampleDuration | kTrackRunSampleSize);
+	QTFile_Append32(myHeader, &myOffset, (QTFileUInt32)theWriter->fSampleCount);
+	QTFile_Append32(myHeader, &myOffset, kFragmentHeaderSize + myEntriesSize + kQTFile_AtomHeaderSize);
+
+	QTFile_PutFragment(theWriter, myHeader, myOffset);
+	QTFile_PutFragment(theWriter, theWriter->fEntries, myEntriesSize);
+
+	// ...and the media data atom
+	myOffset = 0;
+	QTFile_Append32(myHeader, &myOffset, kQTFile_AtomHeaderSize + theWriter->fDataSize);
+	QTFile_Append32(myHeader, &myOffset, kQTFile_MovieDataAtom);
+
+	QTFile_PutFragment(theWriter, myHeader, myOffset);
+	QTFile_PutFragment(theWriter, theWriter->fData, theWriter->fDataSize);
+
+	theWriter->fFragmentTime += theWriter->fDuration;
+	theWriter->fFragmentCount++;
+	theWriter->fDuration = 0;
+	theWriter->fSampleCount = 0;
+	theWriter->fDataSize = 0;
+
+	return(theWriter->fError);
+}
+
+
+//////////
+//
+// QTFile_EndFragmentWriter
+// Write out any samples still collected by the specified fragment writer, and release its buffers.
+//
+//////////
+
+long QTFile_EndFragmentWriter (QTFileFragmentWriterPtr theWriter)
+{
+	if (theWriter == NULL)
+		return(kQTFileErr_Param);
+
+	QTFile_FlushFragment(theWriter);
+
+	free(theWriter->fEntries);
+	free(theWriter->fData);
+	theWriter->fEntries = NULL;
+	theWriter->fData = NULL;
+	theWriter->fMaxSamples = 0;
+	theWriter->fMaxDataSize = 0;
+
+	return(theWriter->fError);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Internal utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFile_WriteMovieFile
+// Write a new movie file at theDstPath, containing the 'ftyp' atom of the source file (if theFileTypeSize
+// isn't 0), the specified movie atom, thePadding bytes of free space, and a single 'mdat' atom holding the
+// specified data regions, in order; the chunk offsets in the movie atom refer to the regions' source offsets.
+//
+// If isDurable is nonzero, the new file is flushed to disk before we return.
+//
+//////////
+
+static long QTFile_WriteMovieFile (QTFileRef theSrcFile, QTFileUInt64 theFileTypeSize, const unsigned char *theMovieAtom, long theMovieAtomSize, long thePadding, QTFileDataRegionPtr theRegions, long theRegionCount, const char *theDstPath, int isDurable, QTFileFlattenStatsPtr theStats)
+{
+	QTFileRef			myDstFile = kInvalidFile;
+	unsigned char		*myMovieAtom = NULL;
+	unsigned char		*myBuffer = NULL;
+	unsigned char		myHeader[kQTFile_ExtendedAtomHeaderSize];
+	QTFileUInt64		myDataSize = 0;
+	QTFileUInt64		myDataOffset;
+	long				myMovieAtomSize = theMovieAtomSize;
+	long				myChunkCount = 0;
+	long				myHeaderSize;
+	long				myOffset = 0;
+	long				myIndex;
+	long				myErr = kQTFileErr_NoErr;
+
+	// any free space must be big enough to hold the header of a 'free' atom
+	if ((thePadding > 0) && (thePadding < kQTFile_AtomHeaderSize))
+		thePadding = kQTFile_AtomHeaderSize;
+
+	myBuffer = (unsigned char *)malloc(kQTFile_CopyBufferSize);
+	if (myBuffer == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	// lay out the new file: 'ftyp' (if any), 'moov', 'free', and then one 'mdat' holding all the media data
+	for (myIndex = 0; myIndex < theRegionCount; myIndex++)
+		myDataSize += theRegions[myIndex].fSize;
+
+	myHeaderSize = (myDataSize + kQTFile_AtomHeaderSize > kMaxUInt32) ? kQTFile_ExtendedAtomHeaderSize : kQTFile_AtomHeaderSize;
+
+	// a file bigger than 4 GB needs 64-bit chunk offsets, which make the movie atom bigger
+	if (theFileTypeSize + theMovieAtomSize + thePadding + myHeaderSize + myDataSize > kMaxUInt32)
+		myMovieAtomSize = QTFile_PromoteChunkOffsets(theMovieAtom, theMovieAtomSize, NULL);
+
+	myMovieAtom = (unsigned char *)malloc(myMovieAtomSize);
+	if (myMovieAtom == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	myDataOffset = theFileTypeSize + myMovieAtomSize + thePadding + myHeaderSize;
+
+	for (myIndex = 0; myIndex < theRegionCount; myIndex++) {
+		theRegions[myIndex].fDstOffset = myDataOffset;
+		myDataOffset += theRegions[myIndex].fSize;
+	}
+
+	// point the chunk offsets in (our copy of) the movie atom at the new locations of the media data
+	if (myMovieAtomSize != theMovieAtomSize)
+		QTFile_PromoteChunkOffsets(theMovieAtom, theMovieAtomSize, myMovieAtom);
+	else
+		memcpy(myMovieAtom, theMovieAtom, theMovieAtomSize);
+
+	myErr = QTFile_RewriteChunkOffsets(myMovieAtom, myMovieAtomSize, theRegions, theRegionCount, &myChunkCount);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	// now write the new file, front to back
+	myDstFile = QTFile_OpenFile(theDstPath, 1);
+	if (myDstFile == kInvalidFile) {
+		myErr = kQTFileErr_IO;
+		goto bail;
+	}
+
+	if (theFileTypeSize > 0) {
+		myErr = QTFile_CopyData(theSrcFile, 0, theFileTypeSize, myDstFile, myBuffer);
+		if (myErr != kQTFileErr_NoErr)
+			goto bail;
+	}
+
+	myErr = QTFile_WriteData(myDstFile, myMovieAtom, myMovieAtomSize);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	if (thePadding > 0) {
+		long		myCount;
+
+		memset(myBuffer, 0, (thePadding < kQTFile_CopyBufferSize) ? thePadding : kQTFile_CopyBufferSize);
+		QTFile_Put32(myBuffer, (QTFileUInt32)thePadding);
+		QTFile_Put32(myBuffer + 4, kQTFile_FreeAtom);
+
+		for (myOffset = 0; myOffset < thePadding; myOffset += myCount) {
+			myCount = ((thePadding - myOffset) < kQTFile_CopyBufferSize) ? (thePadding - myOffset) : kQTFile_CopyBufferSize;
+			myErr = QTFile_WriteData(myDstFile, myBuffer, myCount);
+			if (myErr != kQTFileErr_NoErr)
+				goto bail;
+
+			if (myOffset == 0)
+				memset(myBuffer, 0, kQTFile_AtomHeaderSize);
+		}
+	}
+
+	if (myHeaderSize == kQTFile_ExtendedAtomHeaderSize) {
+		QTFile_Put32(myHeader, 1);
+		QTFile_Put32(myHeader + 4, kQTFile_MovieDataAtom);
+		QTFile_Put64(myHeader + 8, myDataSize + kQTFile_ExtendedAtomHeaderSize);
+	} else {
+		QTFile_Put32(myHeader, (QTFileUInt32)(myDataSize + kQTFile_AtomHeaderSize));
+		QTFile_Put32(myHeader + 4, kQTFile_MovieDataAtom);
+	}
+
+	myErr = QTFile_WriteData(myDstFile, myHeader, myHeaderSize);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	// a region is copied from the source file, unless we were handed its data
+	for (myIndex = 0; myIndex < theRegionCount; myIndex++) {
+		if (theRegions[myIndex].fData != NULL)
+			myErr = QTFile_WriteData(myDstFile, theRegions[myIndex].fData, (long)theRegions[myIndex].fSize);
+		else
+			myErr = QTFile_CopyData(theSrcFile, theRegions[myIndex].fSrcOffset, theRegions[myIndex].fSize, myDstFile, myBuffer);
+		if (myErr != kQTFileErr_NoErr)
+			goto bail;
+	}
+
+	if (isDurable)
+		myErr = QTFile_SyncFile(myDstFile);
+
+	if (theStats != NULL) {
+		theStats->fBytesCopied = myDataSize;
+		theStats->fRegionCount = theRegionCount;
+		theStats->fChunkCount = myChunkCount;
+	}
+
+bail:
+	if (myDstFile != kInvalidFile)
+		QTFile_CloseFile(myDstFile);
+
+	free(myMovieAtom);
+	free(myBuffer);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_ReadMovieAtom
+// Read the movie atom of the specified file into a new block of memory, and return the block and its size
+// through theData and theSize; also return the size of the file's 'ftyp' atom (or 0, if it has none) through
+// theFileTypeSize. The caller must free the block.
+//
+// We return kQTFileErr_Unimplemented for a fragmented movie, whose samples aren't all described by its movie atom.
+//
+//////////
+
+static long QTFile_ReadMovieAtom (QTFileRef theFile, QTFileUInt64 *theFileTypeSize, unsigned char **theData, long *theSize)
+{
+	unsigned char		myHeader[kQTFile_ExtendedAtomHeaderSize];
+	unsigned char		*myData = NULL;
+	QTFileUInt64		myFileSize = 0;
+	QTFileUInt64		myOffset = 0;
+	QTFileUInt64		myAtomSize;
+	QTFileUInt64		myMovieOffset = 0;
+	QTFileUInt64		myMovieSize = 0;
+	QTFileAtom			myAtom;
+	long				myAtomOffset = 0;
+	long				myErr = kQTFileErr_NoErr;
+
+	*theFileTypeSize = 0;
+	*theData = NULL;
+	*theSize = 0;
+
+	myErr = QTFile_GetFileSize(theFile, &myFileSize);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	while (myOffset + kQTFile_AtomHeaderSize <= myFileSize) {
+		QTFileOSType		myType;
+
+		myErr = QTFile_ReadData(theFile, myOffset, myHeader, kQTFile_AtomHeaderSize);
+		if (myErr != kQTFileErr_NoErr)
+			return(myErr);
+
+		myAtomSize = QTFile_Get32(myHeader);
+		myType = QTFile_Get32(myHeader + 4);
+
+		if (myAtomSize == 1) {
+			myErr = QTFile_ReadData(theFile, myOffset + kQTFile_AtomHeaderSize, myHeader + kQTFile_AtomHeaderSize, 8);
+			if (myErr != kQTFileErr_NoErr)
+				return(myErr);
+			myAtomSize = QTFile_Get64(myHeader + kQTFile_AtomHeaderSize);
+		} else if (myAtomSize == 0) {
+			myAtomSize = myFileSize - myOffset;
+		}
+
+		if ((myAtomSize < kQTFile_AtomHeaderSize) || (myAtomSize > myFileSize - myOffset))
+			return(kQTFileErr_InvalidMovie);
+
+		if (myType == kQTFile_MovieFragmentAtom)
+			return(kQTFileErr_Unimplemented);
+
+		if ((myType == kQTFile_FileTypeAtom) && (myOffset == 0))
+			*theFileTypeSize = myAtomSize;
+
+		if ((myType == kQTFile_MovieAtom) && (myMovieSize == 0)) {
+			myMovieOffset = myOffset;
+			myMovieSize = myAtomSize;
+		}
+
+		myOffset += myAtomSize;
+	}
+
+	if ((myMovieSize == 0) || (myMovieSize > kMaxLong))
+		return(kQTFileErr_InvalidMovie);
+
+	myData = (unsigned char *)malloc((size_t)myMovieSize);
+	if (myData == NULL)
+		return(kQTFileErr_MemFull);
+
+	myErr = QTFile_ReadData(theFile, myMovieOffset, myData, (long)myMovieSize);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	// a movie with an extended 'moov' header would confuse the atom walker; so would a fragmented movie
+	if (!QTFile_GetAtom(myData, (long)myMovieSize, &myAtomOffset, &myAtom) || (myAtomOffset != (long)myMovieSize)) {
+		myErr = kQTFileErr_InvalidMovie;
+		goto bail;
+	}
+
+	if (QTFile_FindChildAtom(&myAtom, kQTFile_MovieExtendsAtom, &myAtom)) {
+		myErr = kQTFileErr_Unimplemented;
+		goto bail;
+	}
+
+	*theData = myData;
+	*theSize = (long)myMovieSize;
+	myData = NULL;
+
+bail:
+	free(myData);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_GetTrackAtomID
+// Return the track ID in the track header of the specified track atom, or 0 if it has none.
+//
+//////////
+
+static QTFileUInt32 QTFile_GetTrackAtomID (const QTFileAtom *theTrackAtom)
+{
+	QTFileAtom			myAtom;
+	long				myOffset;
+
+	if (!QTFile_FindChildAtom(theTrackAtom, kQTFile_TrackHeaderAtom, &myAtom) || (myAtom.fSize < 1))
+		return(0);
+
+	// version 1 track headers have 64-bit creation and modification times
+	myOffset = (myAtom.fData[0] == 1) ? 20 : 12;
+	if (myAtom.fSize < myOffset + 4)
+		return(0);
+
+	return(QTFile_Get32(myAtom.fData + myOffset));
+}
+
+
+//////////
+//
+// QTFile_PlanCompactTrack
+// Decide which samples of the specified text track its compacted media keeps, and work out its new edit
+// list; see note (8). The track's sample table must already be decoded.
+//
+//////////
+
+static long QTFile_PlanCompactTrack (QTFileMoviePtr theMovie, const QTFileAtom *theTrackAtom, QTFileCompactTrackPtr thePlan)
+{
+	QTFileTrackPtr			myTrack = thePlan->fTrack;
+	const QTFileTimeValue	*myTimes = myTrack->fSampleTimes;
+	unsigned char			*isKept = NULL;
+	QTFileAtom				myList;
+	QTFileTimeValue			myNewTime = 0;			// the duration of the new media so far
+	QTFileTimeValue			myLastStart = 0;		// the new media time of the last sample kept
+	long					mySampleCount = myTrack->fSampleCount;
+	long					myCapacity = mySampleCount;
+	long					myEntryCount = 0;
+	long					myEntrySize = 12;
+	long					myIndex;
+	long					myErr = kQTFileErr_NoErr;
+
+	if (mySampleCount == 0)
+		return(kQTFileErr_NoErr);
+
+	// read the track's edit list, if it has one
+	if (QTFile_FindChildAtom(theTrackAtom, kQTFile_EditAtom, &myList) && QTFile_FindChildAtom(&myList, kQTFile_EditListAtom, &myList)) {
+		if (myList.fSize < 8)
+			return(kQTFileErr_InvalidMovie);
+
+		myEntrySize = (myList.fData[0] == 1) ? 20 : 12;
+		myEntryCount = (long)QTFile_Get32(myList.fData + 4);
+		if ((myEntryCount < 0) || (myEntryCount > (myList.fSize - 8) / myEntrySize))
+			return(kQTFileErr_InvalidMovie);
+	}
+
+	thePlan->fEditCount = (myEntryCount > 0) ? myEntryCount : 1;
+	thePlan->fEdits = (QTFileCompactEditPtr)malloc(thePlan->fEditCount * sizeof(QTFileCompactEdit));
+	thePlan->fSamples = (long *)malloc(myCapacity * sizeof(long));
+	thePlan->fDescIndexes = (long *)malloc(mySampleCount * sizeof(long));
+	isKept = (unsigned char *)calloc(mySampleCount, 1);
+	if ((thePlan->fEdits == NULL) || (thePlan->fSamples == NULL) || (thePlan->fDescIndexes == NULL) || (isKept == NULL)) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	myErr = QTFile_GetDescIndexes(&myTrack->fSampleTable, mySampleCount, thePlan->fDescIndexes);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	// walk the edits in order, appending the samples each one plays to the new media
+	for (myIndex = 0; myIndex < thePlan->fEditCount; myIndex++) {
+		QTFileCompactEditPtr	myEdit = &thePlan->fEdits[myIndex];
+		QTFileTimeValue			myMediaDuration;
+		QTFileTimeValue			myFirstStart;
+		long					myFirst;
+		long					myLast;
+		long					mySample;
+
+		if (myEntryCount > 0) {
+			const unsigned char	*myEntry = myList.fData + 8 + (myIndex * myEntrySize);
+
+			if (myEntrySize == 20) {
+				myEdit->fDuration = (QTFileTimeValue)QTFile_Get64(myEntry);
+				myEdit->fMediaTime = (QTFileTimeValue)QTFile_Get64(myEntry + 8);
+				myEdit->fRate = QTFile_Get32(myEntry + 16);
+			} else {
+				myEdit->fDuration = (QTFileTimeValue)QTFile_Get32(myEntry);
+				myEdit->fMediaTime = (QTFileTimeValue)(int)QTFile_Get32(myEntry + 4);
+				myEdit->fRate = QTFile_Get32(myEntry + 8);
+			}
+		} else {
+			// a track without an edit list plays its whole media, once
+			myEdit->fDuration = myTrack->fDuration;
+			myEdit->fMediaTime = 0;
+			myEdit->fRate = kQTFile_UnityRate;
+		}
+
+		// an empty edit plays no media
+		if (myEdit->fMediaTime < 0)
+			continue;
+
+		if (QTFile_GetSampleBounds(myTrack, myEdit->fMediaTime, &myFirst, NULL, NULL) != kQTFileErr_NoErr) {
+			myErr = kQTFileErr_InvalidMovie;
+			goto bail;
+		}
+
+		myMediaDuration = QTFile_ConvertTimeScale(myEdit->fDuration, theMovie->fTimeScale, myTrack->fTimeScale);
+		if (myEdit->fRate != kQTFile_UnityRate)
+			myMediaDuration = (myMediaDuration * (QTFileTimeValue)myEdit->fRate) / kQTFile_UnityRate;
+
+		myLast = myFirst;
+		if ((myMediaDuration > 0) && (QTFile_GetSampleBounds(myTrack, myEdit->fMediaTime + myMediaDuration - 1, &myLast, NULL, NULL) != kQTFileErr_NoErr))
+			myLast = mySampleCount;
+
+		// an edit that starts in the sample the previous edit ended in shares that sample
+		if ((thePlan->fCount > 0) && (thePlan->fSamples[thePlan->fCount - 1] == myFirst)) {
+			myFirstStart = myLastStart;
+			mySample = myFirst + 1;
+		} else {
+			myFirstStart = myNewTime;
+			mySample = myFirst;
+		}
+
+		myEdit->fMediaTime = myFirstStart + (myEdit->fMediaTime - myTimes[myFirst - 1]);
+
+		for (; mySample <= myLast; mySample++) {
+			if (thePlan->fCount == myCapacity) {
+				long		*mySamples;
+
+				mySamples = (long *)realloc(thePlan->fSamples, (myCapacity * 2) * sizeof(long));
+				if (mySamples == NULL) {
+					myErr = kQTFileErr_MemFull;
+					goto bail;
+				}
+
+				thePlan->fSamples = mySamples;
+				myCapacity *= 2;
+			}
+
+			thePlan->fSamples[thePlan->fCount++] = mySample;
+			thePlan->fDataSize += myTrack->fSampleSizes[mySample - 1];
+			isKept[mySample - 1] = 1;
+
+			myLastStart = myNewTime;
+			myNewTime += myTimes[mySample] - myTimes[mySample - 1];
+		}
+	}
+
+	thePlan->fMediaDuration = myNewTime;
+
+	// a track without an edit list doesn't get one
+	if (myEntryCount == 0) {
+		free(thePlan->fEdits);
+		thePlan->fEdits = NULL;
+		thePlan->fEditCount = 0;
+	}
+
+	for (myIndex = 0; myIndex < mySampleCount; myIndex++) {
+		if (!isKept[myIndex]) {
+			thePlan->fDeadSize += myTrack->fSampleSizes[myIndex];
+			thePlan->fDeadCount++;
+		}
+	}
+
+bail:
+	free(isKept);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_GetDescIndexes
+// Fill theIndexes with the sample description index of each of the first theSampleCount samples described by
+// the specified sample table.
+//
+//////////
+
+static long QTFile_GetDescIndexes (const QTFileAtom *theSampleTable, long theSampleCount, long *theIndexes)
+{
+	QTFileAtom			myChunkMap;
+	QTFileAtom			myOffsets;
+	long				myEntryCount;
+	long				myChunkCount;
+	long				mySample = 0;
+	long				myIndex;
+
+	if (!QTFile_FindChildAtom(theSampleTable, kQTFile_SampleToChunkAtom, &myChunkMap) || (myChunkMap.fSize < 8))
+		return(kQTFileErr_InvalidSampleTable);
+
+	if ((!QTFile_FindChildAtom(theSampleTable, kQTFile_ChunkOffsetAtom, &myOffsets) && !QTFile_FindChildAtom(theSampleTable, kQTFile_ChunkOffset64Atom, &myOffsets)) || (myOffsets.fSize < 8))
+		return(kQTFileErr_InvalidSampleTable);
+
+	myEntryCount = (long)QTFile_Get32(myChunkMap.fData + 4);
+	myChunkCount = (long)QTFile_Get32(myOffsets.fData + 4);
+	if ((myEntryCount < 0) || (myEntryCount > (myChunkMap.fSize - 8) / 12) || (myChunkCount < 0))
+		return(kQTFileErr_InvalidSampleTable);
+
+	// each entry describes the chunks from its first chunk up to the first chunk of the next entry
+	for (myIndex = 0; (myIndex < myEntryCount) && (mySample < theSampleCount); myIndex++) {
+		const unsigned char	*myEntry = myChunkMap.fData + 8 + (myIndex * 12);
+		QTFileUInt32		myChunk = QTFile_Get32(myEntry);
+		QTFileUInt32		myLastChunk = (QTFileUInt32)myChunkCount;
+		QTFileUInt32		mySamplesPerChunk = QTFile_Get32(myEntry + 4);
+		long				myDescIndex = (long)QTFile_Get32(myEntry + 8);
+		QTFileUInt32		myCount;
+
+		if ((myIndex + 1 < myEntryCount) && (QTFile_Get32(myEntry + 12) - 1 < myLastChunk))
+			myLastChunk = QTFile_Get32(myEntry + 12) - 1;
+
+		for (; (myChunk <= myLastChunk) && (mySample < theSampleCount); myChunk++)
+			for (myCount = 0; (myCount < mySamplesPerChunk) && (mySample < theSampleCount); myCount++)
+				theIndexes[mySample++] = myDescIndex;
+	}
+
+	return((mySample == theSampleCount) ? kQTFileErr_NoErr : kQTFileErr_InvalidSampleTable);
+}
+
+
+//////////
+//
+// QTFile_AppendCompactAtoms
+// Append the children of the specified atom of a track being compacted to the atom being built in theBuffer,
+// rebuilding the ones that describe the track's media and its edits; theDataOffset is the source offset that
+// stands for the start of the track's kept samples (see QTFile_CompactMovieFile).
+//
+//////////
+
+static void QTFile_AppendCompactAtoms (unsigned char *theBuffer, long *theOffset, const QTFileAtom *theParent, const QTFileCompactTrack *thePlan, QTFileUInt64 theDataOffset, int use64)
+{
+	QTFileAtom			myAtom;
+	long				myAtomStart = 0;
+	long				myOffset = 0;
+	long				myStart;
+
+	while (QTFile_GetAtom(theParent->fData, theParent->fSize, &myOffset, &myAtom)) {
+		switch (myAtom.fType) {
+			case kQTFile_MediaAtom:
+			case kQTFile_MediaInfoAtom:
+				// on the way to the sample table
+				myStart = QTFile_BeginAtom(theBuffer, theOffset, myAtom.fType);
+				QTFile_AppendCompactAtoms(theBuffer, theOffset, &myAtom, thePlan, theDataOffset, use64);
+				QTFile_EndAtom(theBuffer, *theOffset, myStart);
+				break;
+
+			case kQTFile_EditAtom:
+				QTFile_AppendCompactEdits(theBuffer, theOffset, thePlan);
+				break;
+
+			case kQTFile_MediaHeaderAtom:
+				// copy the media header, with the new media duration
+				myStart = *theOffset + (long)(myAtom.fData - (theParent->fData + myAtomStart));
+				QTFile_AppendData(theBuffer, theOffset, theParent->fData + myAtomStart, myOffset - myAtomStart);
+				if ((myAtom.fSize >= 32) && (myAtom.fData[0] == 1))
+					QTFile_Put64(theBuffer + myStart + 24, (QTFileUInt64)thePlan->fMediaDuration);
+				else if (myAtom.fSize >= 20)
+					QTFile_Put32(theBuffer + myStart + 16, (QTFileUInt32)thePlan->fMediaDuration);
+				break;
+
+			case kQTFile_SampleTableAtom:
+				QTFile_AppendCompactSampleTable(theBuffer, theOffset, &myAtom, thePlan, theDataOffset, use64);
+				break;
+
+			default:
+				QTFile_AppendData(theBuffer, theOffset, theParent->fData + myAtomStart, myOffset - myAtomStart);
+				break;
+		}
+
+		myAtomStart = myOffset;
+	}
+}
+
+
+//////////
+//
+// QTFile_AppendCompactEdits
+// Append an edit atom holding the new edit list of a track being compacted, if it has one.
+//
+//////////
+
+static void QTFile_AppendCompactEdits (unsigned char *theBuffer, long *theOffset, const QTFileCompactTrack *thePlan)
+{
+	long				myEdits;
+	long				myList;
+	long				myIndex;
+	int					is64 = 0;
+
+	if (thePlan->fEdits == NULL)
+		return;
+
+	// we write a version 1 edit list only if some value doesn't fit in a version 0 one
+	for (myIndex = 0; myIndex < thePlan->fEditCount; myIndex++)
+		if ((thePlan->fEdits[myIndex].fDuration > (QTFileTimeValue)kMaxUInt32) || (thePlan->fEdits[myIndex].fMediaTime > kMaxLong))
+			is64 = 1;
+
+	myEdits = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_EditAtom);
+	myList = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_EditListAtom);
+
+	QTFile_Append32(theBuffer, theOffset, is64 ? 0x01000000 : 0);
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)thePlan->fEditCount);
+
+	for (myIndex = 0; myIndex < thePlan->fEditCount; myIndex++) {
+		if (is64) {
+			QTFile_Append64(theBuffer, theOffset, (QTFileUInt64)thePlan->fEdits[myIndex].fDuration);
+			QTFile_Append64(theBuffer, theOffset, (QTFileUInt64)thePlan->fEdits[myIndex].fMediaTime);
+		} else {
+			QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)thePlan->fEdits[myIndex].fDuration);
+			QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)thePlan->fEdits[myIndex].fMediaTime);
+		}
+
+		QTFile_Append32(theBuffer, theOffset, thePlan->fEdits[myIndex].fRate);
+	}
+
+	QTFile_EndAtom(theBuffer, *theOffset, myList);
+	QTFile_EndAtom(theBuffer, *theOffset, myEdits);
+}
+
+
+//////////
+//
+// QTFile_AppendCompactSampleTable
+// Append a new sample table atom for a track being compacted, describing only the samples it keeps, stored
+// one after another from theDataOffset. Each chunk holds a run of samples that share a sample description.
+//
+// Only the sample descriptions are copied from the old sample table; any other atoms in it (for instance, a
+// sync sample table) describe the old samples, and are dropped.
+//
+//////////
+
+static void QTFile_AppendCompactSampleTable (unsigned char *theBuffer, long *theOffset, const QTFileAtom *theSampleTable, const QTFileCompactTrack *thePlan, QTFileUInt64 theDataOffset, int use64)
+{
+	QTFileTrackPtr			myTrack = thePlan->fTrack;
+	const QTFileTimeValue	*myTimes = myTrack->fSampleTimes;
+	const long				*mySizes = myTrack->fSampleSizes;
+	QTFileAtom				myAtom;
+	QTFileUInt64			myChunkOffset = theDataOffset;
+	long					myTable;
+	long					myStart;
+	long					myCountOffset;
+	long					myEntryCount = 0;
+	long					myChunkCount = 0;
+	long					myIndex;
+	long					myEnd;
+	int						isUniform = 1;
+
+	myTable = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_SampleTableAtom);
+
+	if (QTFile_FindChildAtom(theSampleTable, kQTFile_SampleDescriptionAtom, &myAtom)) {
+		myStart = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_SampleDescriptionAtom);
+		QTFile_AppendData(theBuffer, theOffset, myAtom.fData, myAtom.fSize);
+		QTFile_EndAtom(theBuffer, *theOffset, myStart);
+	}
+
+	// time-to-sample: runs of samples with the same duration
+	myStart = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_TimeToSampleAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	myCountOffset = *theOffset;
+	QTFile_Append32(theBuffer, theOffset, 0);
+
+	for (myIndex = 0; myIndex < thePlan->fCount; myIndex++) {
+		long			mySample = thePlan->fSamples[myIndex];
+		QTFileUInt32	myDuration = (QTFileUInt32)(myTimes[mySample] - myTimes[mySample - 1]);
+
+		if ((myEntryCount > 0) && (QTFile_Get32(theBuffer + *theOffset - 4) == myDuration)) {
+			QTFile_Put32(theBuffer + *theOffset - 8, QTFile_Get32(theBuffer + *theOffset - 8) + 1);
+		} else {
+			QTFile_Append32(theBuffer, theOffset, 1);
+			QTFile_Append32(theBuffer, theOffset, myDuration);
+			myEntryCount++;
+		}
+	}
+
+	QTFile_Put32(theBuffer + myCountOffset, (QTFileUInt32)myEntryCount);
+	QTFile_EndAtom(theBuffer, *theOffset, myStart);
+
+	// sample-to-chunk: a new entry only where the number of samples per chunk or the description changes
+	myStart = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_SampleToChunkAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	myCountOffset = *theOffset;
+	QTFile_Append32(theBuffer, theOffset, 0);
+	myEntryCount = 0;
+
+	for (myIndex = 0; myIndex < thePlan->fCount; myIndex = myEnd) {
+		long			myDescIndex = thePlan->fDescIndexes[thePlan->fSamples[myIndex] - 1];
+
+		for (myEnd = myIndex + 1; (myEnd < thePlan->fCount) && (thePlan->fDescIndexes[thePlan->fSamples[myEnd] - 1] == myDescIndex); myEnd++)
+			;
+
+		myChunkCount++;
+		if ((myEntryCount == 0) || (QTFile_Get32(theBuffer + *theOffset - 8) != (QTFileUInt32)(myEnd - myIndex)) || (QTFile_Get32(theBuffer + *theOffset - 4) != (QTFileUInt32)myDescIndex)) {
+			QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)myChunkCount);
+			QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)(myEnd - myIndex));
+			QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)myDescIndex);
+			myEntryCount++;
+		}
+	}
+
+	QTFile_Put32(theBuffer + myCountOffset, (QTFileUInt32)myEntryCount);
+	QTFile_EndAtom(theBuffer, *theOffset, myStart);
+
+	// sample sizes: a single size, if all the samples have it
+	for (myIndex = 1; myIndex < thePlan->fCount; myIndex++)
+		if (mySizes[thePlan->fSamples[myIndex] - 1] != mySizes[thePlan->fSamples[0] - 1])
+			isUniform = 0;
+
+	myStart = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_SampleSizeAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+
+	if (isUniform && (thePlan->fCount > 0)) {
+		QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)mySizes[thePlan->fSamples[0] - 1]);
+		QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)thePlan->fCount);
+	} else {
+		QTFile_Append32(theBuffer, theOffset, 0);
+		QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)thePlan->fCount);
+		for (myIndex = 0; myIndex < thePlan->fCount; myIndex++)
+			QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)mySizes[thePlan->fSamples[myIndex] - 1]);
+	}
+
+	QTFile_EndAtom(theBuffer, *theOffset, myStart);
+
+	// chunk offsets
+	myStart = QTFile_BeginAtom(theBuffer, theOffset, use64 ? kQTFile_ChunkOffset64Atom : kQTFile_ChunkOffsetAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)myChunkCount);
+
+	for (myIndex = 0; myIndex < thePlan->fCount; myIndex = myEnd) {
+		long			myDescIndex = thePlan->fDescIndexes[thePlan->fSamples[myIndex] - 1];
+
+		if (use64)
+			QTFile_Append64(theBuffer, theOffset, myChunkOffset);
+		else
+			QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)myChunkOffset);
+
+		for (myEnd = myIndex; (myEnd < thePlan->fCount) && (thePlan->fDescIndexes[thePlan->fSamples[myEnd] - 1] == myDescIndex); myEnd++)
+			myChunkOffset += mySizes[thePlan->fSamples[myEnd] - 1];
+	}
+
+	QTFile_EndAtom(theBuffer, *theOffset, myStart);
+
+	QTFile_EndAtom(theBuffer, *theOffset, myTable);
+}
+
+
+//////////
+//
+// QTFile_DisposeCompactTracks
+// Dispose of the specified track plans.
+//
+//////////
+
+static void QTFile_DisposeCompactTracks (QTFileCompactTrackPtr thePlans, long theCount)
+{
+	long				myIndex;
+
+	if (thePlans == NULL)
+		return;
+
+	for (myIndex = 0; myIndex < theCount; myIndex++) {
+		free(thePlans[myIndex].fSamples);
+		free(thePlans[myIndex].fDescIndexes);
+		free(thePlans[myIndex].fEdits);
+	}
+
+	free(thePlans);
+}
+
+
+//////////
+//
+// QTFile_CompareRegions
+// Compare two data regions by source offset, for qsort.
+//
+//////////
+
+static int QTFile_CompareRegions (const void *theFirst, const void *theSecond)
+{
+	QTFileUInt64		myFirst = ((const QTFileDataRegion *)theFirst)->fSrcOffset;
+	QTFileUInt64		mySecond = ((const QTFileDataRegion *)theSecond)->fSrcOffset;
+
+	return((myFirst < mySecond) ? -1 : ((myFirst > mySecond) ? 1 : 0));
+}
+
+
+//////////
+//
+// QTFile_CompactThreadEntry
+// The entry point of a compaction thread.
+//
+//////////
+
+#if defined(_WIN32)
+static DWORD WINAPI QTFile_CompactThreadEntry (LPVOID theJob)
+#else
+static void *QTFile_CompactThreadEntry (void *theJob)
+#endif
+{
+	QTFileCompactJobPtr		myJob = (QTFileCompactJobPtr)theJob;
+	long					myErr;
+
+	myErr = QTFile_CompactMovieFile(myJob->fPath, myJob->fPadding, &myJob->fStats);
+
+	QTFile_Lock(&myJob->fLock);
+	myJob->fErr = myErr;
+	myJob->fIsDone = 1;
+	QTFile_Unlock(&myJob->fLock);
+
+	return(0);
+}
+
+
+//////////
+//
+// QTFile_InitLock
+// Initialize the specified lock.
+//
+//////////
+
+static void QTFile_InitLock (QTFileLock *theLock)
+{
+#if defined(_WIN32)
+	InitializeCriticalSection(theLock);
+#else
+	pthread_mutex_init(theLock, NULL);
+#endif
+}
+
+
+//////////
+//
+// QTFile_DisposeLock
+// Dispose of the specified lock.
+//
+//////////
+
+static void QTFile_DisposeLock (QTFileLock *theLock)
+{
+#if defined(_WIN32)
+	DeleteCriticalSection(theLock);
+#else
+	pthread_mutex_destroy(theLock);
+#endif
+}
+
+
+//////////
+//
+// QTFile_Lock
+// Acquire the specified lock.
+//
+//////////
+
+static void QTFile_Lock (QTFileLock *theLock)
+{
+#if defined(_WIN32)
+	EnterCriticalSection(theLock);
+#else
+	pthread_mutex_lock(theLock);
+#endif
+}
+
+
+//////////
+//
+// QTFile_Unlock
+// Release the specified lock.
+//
+//////////
+
+static void QTFile_Unlock (QTFileLock *theLock)
+{
+#if defined(_WIN32)
+	LeaveCriticalSection(theLock);
+#else
+	pthread_mutex_unlock(theLock);
+#endif
+}
+
+
+//////////
+//
+// QTFile_FindDataRegions
+// Find the contents of the 'mdat' atoms in the specified file, and the size of its 'ftyp' atom (if it
+// starts with one). On entry, *theRegionCount is the number of elements in theRegions.
+//
+//////////
+
+static long QTFile_FindDataRegions (QTFileRef theFile, QTFileUInt64 *theFileTypeSize, QTFileDataRegionPtr theRegions, long *theRegionCount)
+{
+	unsigned char		myHeader[kQTFile_ExtendedAtomHeaderSize];
+	QTFileUInt64		myFileSize = 0;
+	QTFileUInt64		myOffset = 0;
+	QTFileUInt64		myAtomSize;
+	QTFileOSType		myType;
+	long				myHeaderSize;
+	long				myMaxCount = *theRegionCount;
+	long				myErr = kQTFileErr_NoErr;
+
+	*theFileTypeSize = 0;
+	*theRegionCount = 0;
+
+	myErr = QTFile_GetFileSize(theFile, &myFileSize);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	while (myFileSize - myOffset >= kQTFile_AtomHeaderSize) {
+		myErr = QTFile_ReadData(theFile, myOffset, myHeader, kQTFile_AtomHeaderSize);
+		if (myErr != kQTFileErr_NoErr)
+			return(myErr);
+
+		myAtomSize = QTFile_Get32(myHeader);
+		myType = QTFile_Get32(myHeader + 4);
+		myHeaderSize = kQTFile_AtomHeaderSize;
+
+		if (myAtomSize == 1) {
+			// a 64-bit atom size follows the type
+			if (myFileSize - myOffset < kQTFile_ExtendedAtomHeaderSize)
+				return(kQTFileErr_InvalidMovie);
+
+			myErr = QTFile_ReadData(theFile, myOffset + kQTFile_AtomHeaderSize, myHeader + kQTFile_AtomHeaderSize, 8);
+			if (myErr != kQTFileErr_NoErr)
+				return(myErr);
+
+			myAtomSize = QTFile_Get64(myHeader + kQTFile_AtomHeaderSize);
+			myHeaderSize = kQTFile_ExtendedAtomHeaderSize;
+		} else if (myAtomSize == 0) {
+			// the atom extends to the end of the file
+			myAtomSize = myFileSize - myOffset;
+		}
+
+		if ((myAtomSize < (QTFileUInt64)myHeaderSize) || (myAtomSize > myFileSize - myOffset))
+			return(kQTFileErr_InvalidMovie);
+
+		if ((myType == kQTFile_FileTypeAtom) && (myOffset == 0)) {
+			*theFileTypeSize = myAtomSize;
+		} else if ((myType == kQTFile_MovieDataAtom) && (myAtomSize > (QTFileUInt64)myHeaderSize)) {
+			if (*theRegionCount == myMaxCount)
+				return(kQTFileErr_Unimplemented);
+
+			theRegions[*theRegionCount].fSrcOffset = myOffset + myHeaderSize;
+			theRegions[*theRegionCount].fSize = myAtomSize - myHeaderSize;
+			theRegions[*theRegionCount].fData = NULL;
+			(*theRegionCount)++;
+		}
+
+		myOffset += myAtomSize;
+	}
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_CheckDataReferences
+// Make sure that all the media data of the specified movie atom is in the movie file itself.
+//
+//////////
+
+static long QTFile_CheckDataReferences (const QTFileAtom *theMovieAtom)
+{
+	QTFileAtom			myTrack;
+	QTFileAtom			myAtom;
+	QTFileAtom			myEntry;
+	long				myTrackOffset = 0;
+	long				myOffset;
+
+	while (QTFile_GetAtom(theMovieAtom->fData, theMovieAtom->fSize, &myTrackOffset, &myTrack)) {
+		if (myTrack.fType != kQTFile_TrackAtom)
+			continue;
+
+		// a track without a data reference atom gets its data from the movie file
+		if (!QTFile_FindChildAtom(&myTrack, kQTFile_MediaAtom, &myAtom) || !QTFile_FindChildAtom(&myAtom, kQTFile_MediaInfoAtom, &myAtom) ||
+			!QTFile_FindChildAtom(&myAtom, kQTFile_DataInfoAtom, &myAtom) || !QTFile_FindChildAtom(&myAtom, kQTFile_DataReferenceAtom, &myAtom))
+			continue;
+
+		// skip the version, flags and entry count; each entry is an atom whose flags say where the data is
+		if (myAtom.fSize < 8)
+			return(kQTFileErr_InvalidMovie);
+
+		myOffset = 8;
+		while (QTFile_GetAtom(myAtom.fData, myAtom.fSize, &myOffset, &myEntry))
+			if ((myEntry.fSize < 4) || !(QTFile_Get32(myEntry.fData) & kQTFile_SelfReference))
+				return(kQTFileErr_Unimplemented);
+	}
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_RewriteChunkOffsets
+// Rewrite the chunk offsets in the specified movie atom, which refer to the media data in the source file,
+// so that they refer to the new locations of that data.
+//
+//////////
+
+static long QTFile_RewriteChunkOffsets (unsigned char *theMovieAtom, long theSize, const QTFileDataRegion *theRegions, long theRegionCount, long *theChunkCount)
+{
+	QTFileAtom			myMovie;
+	QTFileAtom			myTrack;
+	QTFileAtom			myAtom;
+	long				myOffset = 0;
+	long				myTrackOffset = 0;
+	long				myErr = kQTFileErr_NoErr;
+
+	*theChunkCount = 0;
+
+	if (!QTFile_GetAtom(theMovieAtom, theSize, &myOffset, &myMovie))
+		return(kQTFileErr_InvalidMovie);
+
+	while (QTFile_GetAtom(myMovie.fData, myMovie.fSize, &myTrackOffset, &myTrack)) {
+		unsigned char	*myEntry = NULL;
+		QTFileUInt64	myNewOffset;
+		long			myEntryCount;
+		long			myEntrySize = 4;
+		long			myIndex;
+
+		if (myTrack.fType != kQTFile_TrackAtom)
+			continue;
+
+		if (!QTFile_FindChildAtom(&myTrack, kQTFile_MediaAtom, &myAtom) || !QTFile_FindChildAtom(&myAtom, kQTFile_MediaInfoAtom, &myAtom) ||
+			!QTFile_FindChildAtom(&myAtom, kQTFile_SampleTableAtom, &myAtom))
+			continue;
+
+		if (!QTFile_FindChildAtom(&myAtom, kQTFile_ChunkOffsetAtom, &myAtom)) {
+			if (!QTFile_FindChildAtom(&myAtom, kQTFile_ChunkOffset64Atom, &myAtom))
+				continue;
+			myEntrySize = 8;
+		}
+
+		if (myAtom.fSize < 8)
+			return(kQTFileErr_InvalidSampleTable);
+
+		myEntryCount = (long)QTFile_Get32(myAtom.fData + 4);
+		if ((myEntryCount < 0) || (myEntryCount > (myAtom.fSize - 8) / myEntrySize))
+			return(kQTFileErr_InvalidSampleTable);
+
+		// the atom data lies within theMovieAtom, which we're allowed to change
+		myEntry = theMovieAtom + (myAtom.fData - theMovieAtom) + 8;
+		for (myIndex = 0; myIndex < myEntryCount; myIndex++, myEntry += myEntrySize) {
+			myErr = QTFile_MapChunkOffset(theRegions, theRegionCount, (myEntrySize == 8) ? QTFile_Get64(myEntry) : QTFile_Get32(myEntry), &myNewOffset);
+			if (myErr != kQTFileErr_NoErr)
+				return(myErr);
+
+			if (myEntrySize == 8) {
+				QTFile_Put64(myEntry, myNewOffset);
+			} else {
+				// we promote 'stco' atoms to 'co64' atoms whenever the new file is too big for them
+				if (myNewOffset > kMaxUInt32)
+					return(kQTFileErr_InvalidSampleTable);
+				QTFile_Put32(myEntry, (QTFileUInt32)myNewOffset);
+			}
+		}
+
+		*theChunkCount += myEntryCount;
+	}
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_PromoteChunkOffsets
+// Copy the atoms in the specified data to theNewData, replacing each 'stco' atom in a sample table by a 'co64'
+// atom with the same entries, and fixing up the sizes of the atoms that contain it; return the size of the copy.
+//
+// If theNewData is NULL, we just return the size that the copy would have.
+//
+//////////
+
+static long QTFile_PromoteChunkOffsets (const unsigned char *theData, long theSize, unsigned char *theNewData)
+{
+	QTFileAtom			myAtom;
+	long				myOffset = 0;
+	long				myAtomStart = 0;
+	long				myNewSize = 0;
+	long				myEntryCount;
+	long				myIndex;
+
+	while (QTFile_GetAtom(theData, theSize, &myOffset, &myAtom)) {
+		if ((myAtom.fType == kQTFile_MovieAtom) || (myAtom.fType == kQTFile_TrackAtom) || (myAtom.fType == kQTFile_MediaAtom) ||
+			(myAtom.fType == kQTFile_MediaInfoAtom) || (myAtom.fType == kQTFile_SampleTableAtom)) {
+			long		mySize;
+
+			// a container atom: copy its children, and then give it the new size
+			mySize = kQTFile_AtomHeaderSize + QTFile_PromoteChunkOffsets(myAtom.fData, myAtom.fSize, (theNewData != NULL) ? theNewData + myNewSize + kQTFile_AtomHeaderSize : NULL);
+			if (theNewData != NULL) {
+				QTFile_Put32(theNewData + myNewSize, (QTFileUInt32)mySize);
+				QTFile_Put32(theNewData + myNewSize + 4, myAtom.fType);
+			}
+
+			myNewSize += mySize;
+		} else if ((myAtom.fType == kQTFile_ChunkOffsetAtom) && (myAtom.fSize >= 8) &&
+					((myEntryCount = (long)QTFile_Get32(myAtom.fData + 4)) >= 0) && (myEntryCount <= (myAtom.fSize - 8) / 4)) {
+			// a 'stco' atom: the header, version, flags and entry count, and then 8 bytes per entry
+			if (theNewData != NULL) {
+				unsigned char	*myEntry = theNewData + myNewSize + kQTFile_AtomHeaderSize + 8;
+
+				QTFile_Put32(theNewData + myNewSize, (QTFileUInt32)(kQTFile_AtomHeaderSize + 8 + (myEntryCount * 8)));
+				QTFile_Put32(theNewData + myNewSize + 4, kQTFile_ChunkOffset64Atom);
+				memcpy(theNewData + myNewSize + kQTFile_AtomHeaderSize, myAtom.fData, 8);
+
+				for (myIndex = 0; myIndex < myEntryCount; myIndex++, myEntry += 8)
+					QTFile_Put64(myEntry, QTFile_Get32(myAtom.fData + 8 + (myIndex * 4)));
+			}
+
+			myNewSize += kQTFile_AtomHeaderSize + 8 + (myEntryCount * 8);
+		} else {
+			// any other atom is copied as it is
+			if (theNewData != NULL)
+				memcpy(theNewData + myNewSize, theData + myAtomStart, myOffset - myAtomStart);
+
+			myNewSize += myOffset - myAtomStart;
+		}
+
+		myAtomStart = myOffset;
+	}
+
+	return(myNewSize);
+}
+
+
+//////////
+//
+// QTFile_MapChunkOffset
+// Return, through theNewOffset, the offset in the new file of the media data at theOffset in the source file.
+//
+//////////
+
+static long QTFile_MapChunkOffset (const QTFileDataRegion *theRegions, long theRegionCount, QTFileUInt64 theOffset, QTFileUInt64 *theNewOffset)
+{
+	long				myLow = 0;
+	long				myHigh = theRegionCount - 1;
+	long				myMiddle;
+
+	// the regions are in file order, so find the last one that starts at or before the offset
+	if ((theRegionCount == 0) || (theOffset < theRegions[0].fSrcOffset))
+		return(kQTFileErr_InvalidSampleTable);
+
+	while (myLow < myHigh) {
+		myMiddle = myLow + ((myHigh - myLow + 1) / 2);
+		if (theRegions[myMiddle].fSrcOffset <= theOffset)
+			myLow = myMiddle;
+		else
+			myHigh = myMiddle - 1;
+	}
+
+	// an empty chunk may sit right at the end of a region
+	if (theOffset - theRegions[myLow].fSrcOffset > theRegions[myLow].fSize)
+		return(kQTFileErr_InvalidSampleTable);
+
+	*theNewOffset = theRegions[myLow].fDstOffset + (theOffset - theRegions[myLow].fSrcOffset);
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_OpenFile
+// Open the file having the specified path, for reading; or create it (replacing any existing file), for writing.
+//
+//////////
+
+static QTFileRef QTFile_OpenFile (const char *thePath, int forWriting)
+{
+#if defined(_WIN32)
+	if (forWriting)
+		return(CreateFileA(thePath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+	else
+		return(CreateFileA(thePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+#else
+	if (forWriting)
+		return(open(thePath, O_WRONLY | O_CREAT | O_TRUNC, 0666));
+	else
+		return(open(thePath, O_RDONLY));
+#endif
+}
+
+
+//////////
+//
+// QTFile_CloseFile
+// Close the specified file.
+//
+//////////
+
+static void QTFile_CloseFile (QTFileRef theFile)
+{
+#if defined(_WIN32)
+	CloseHandle(theFile);
+#else
+	close(theFile);
+#endif
+}
+
+
+//////////
+//
+// QTFile_GetFileSize
+// Return the size of the specified file.
+//
+//////////
+
+static long QTFile_GetFileSize (QTFileRef theFile, QTFileUInt64 *theSize)
+{
+#if defined(_WIN32)
+	DWORD				mySizeHigh = 0;
+	DWORD				mySize;
+
+	mySize = GetFileSize(theFile, &mySizeHigh);
+	if ((mySize == INVALID_FILE_SIZE) && (GetLastError() != NO_ERROR))
+		return(kQTFileErr_IO);
+
+	*theSize = ((QTFileUInt64)mySizeHigh << 32) | mySize;
+#else
+	struct stat			myStat;
+
+	if (fstat(theFile, &myStat) != 0)
+		return(kQTFileErr_IO);
+
+	*theSize = (QTFileUInt64)myStat.st_size;
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_ReadData
+// Read theSize bytes at the specified offset in the specified file.
+//
+//////////
+
+static long QTFile_ReadData (QTFileRef theFile, QTFileUInt64 theOffset, void *theData, long theSize)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER		myOffset;
+	DWORD				myCount = 0;
+
+	myOffset.QuadPart = (LONGLONG)theOffset;
+	if (!SetFilePointerEx(theFile, myOffset, NULL, FILE_BEGIN))
+		return(kQTFileErr_IO);
+
+	if (!ReadFile(theFile, theData, (DWORD)theSize, &myCount, NULL) || (myCount != (DWORD)theSize))
+		return(kQTFileErr_IO);
+#else
+	if (pread(theFile, theData, (size_t)theSize, (off_t)theOffset) != (ssize_t)theSize)
+		return(kQTFileErr_IO);
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_WriteData
+// Write theSize bytes at the current position in the specified file.
+//
+//////////
+
+static long QTFile_WriteData (QTFileRef theFile, const void *theData, long theSize)
+{
+#if defined(_WIN32)
+	DWORD				myCount = 0;
+
+	if (!WriteFile(theFile, theData, (DWORD)theSize, &myCount, NULL) || (myCount != (DWORD)theSize))
+		return(kQTFileErr_IO);
+#else
+	const char			*myData = (const char *)theData;
+	ssize_t				myCount;
+
+	while (theSize > 0) {
+		myCount = write(theFile, myData, (size_t)theSize);
+		if (myCount < 0) {
+			if (errno == EINTR)
+				continue;
+			return(kQTFileErr_IO);
+		}
+
+		myData += myCount;
+		theSize -= (long)myCount;
+	}
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_CopyData
+// Copy theSize bytes at the specified offset in the source file to the current position in the
+// destination file, using theBuffer (of kQTFile_CopyBufferSize bytes) if need be.
+//
+//////////
+
+static long QTFile_CopyData (QTFileRef theSrcFile, QTFileUInt64 theOffset, QTFileUInt64 theSize, QTFileRef theDstFile, unsigned char *theBuffer)
+{
+	long				myCount;
+	long				myErr = kQTFileErr_NoErr;
+
+#if defined(__linux__)
+	// let the kernel copy the data, without bringing it into user space
+	{
+		loff_t			mySrcOffset = (loff_t)theOffset;
+		ssize_t			myCopied;
+
+		while (theSize > 0) {
+			myCopied = copy_file_range(theSrcFile, &mySrcOffset, theDstFile, NULL, (size_t)((theSize < 0x40000000) ? theSize : 0x40000000), 0);
+			if (myCopied <= 0)
+				break;
+
+			theSize -= (QTFileUInt64)myCopied;
+		}
+
+		// if the kernel couldn't do it (for instance, across file systems), do the rest ourselves
+		theOffset = (QTFileUInt64)mySrcOffset;
+	}
+#endif
+
+	while (theSize > 0) {
+		myCount = (theSize < kQTFile_CopyBufferSize) ? (long)theSize : kQTFile_CopyBufferSize;
+
+		myErr = QTFile_ReadData(theSrcFile, theOffset, theBuffer, myCount);
+		if (myErr == kQTFileErr_NoErr)
+			myErr = QTFile_WriteData(theDstFile, theBuffer, myCount);
+		if (myErr != kQTFileErr_NoErr)
+			break;
+
+		theOffset += myCount;
+		theSize -= myCount;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFile_SyncFile
+// Make sure that everything written to the specified file is on disk.
+//
+//////////
+
+static long QTFile_SyncFile (QTFileRef theFile)
+{
+#if defined(_WIN32)
+	return(FlushFileBuffers(theFile) ? kQTFileErr_NoErr : kQTFileErr_IO);
+#else
+	return((fsync(theFile) == 0) ? kQTFileErr_NoErr : kQTFileErr_IO);
+#endif
+}
+
+
+//////////
+//
+// QTFile_ReplaceFile
+// Replace the file at thePath with the file at theNewPath, in a single step: anyone opening thePath sees
+// either the old file or the new one, never a mixture or nothing.
+//
+//////////
+
+static long QTFile_ReplaceFile (const char *theNewPath, const char *thePath)
+{
+#if defined(_WIN32)
+	if (!MoveFileExA(theNewPath, thePath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		return(kQTFileErr_IO);
+#else
+	if (rename(theNewPath, thePath) != 0)
+		return(kQTFileErr_IO);
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTFile_DeleteFile
+// Delete the file at thePath, if there is one.
+//
+//////////
+
+static void QTFile_DeleteFile (const char *thePath)
+{
+#if defined(_WIN32)
+	DeleteFileA(thePath);
+#else
+	unlink(thePath);
+#endif
+}
+
+
+//////////
+//
+// QTFile_BuildInitSegment
+// Build, in theBuffer, the 'ftyp' and 'moov' atoms of the fragmented movie written by the specified fragment
+// writer; return their total size (at most kInitSegmentSize).
+//
+//////////
+
+static long QTFile_BuildInitSegment (QTFileFragmentWriterPtr theWriter, unsigned char *theBuffer, short theWidth, short theHeight)
+{
+	long				myOffset = 0;
+	long				myMovie;
+	long				myTrack;
+	long				myMedia;
+	long				myInfo;
+	long				myTable;
+	long				myDesc;
+	long				myAtom;
+
+	// the file type atom
+	myAtom = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_FileTypeAtom);
+	QTFile_Append32(theBuffer, &myOffset, QTFILE_FOURCC('i','s','o','6'));
+	QTFile_Append32(theBuffer, &myOffset, 0);
+	QTFile_Append32(theBuffer, &myOffset, QTFILE_FOURCC('i','s','o','6'));
+	QTFile_Append32(theBuffer, &myOffset, QTFILE_FOURCC('i','s','o','m'));
+	QTFile_Append32(theBuffer, &myOffset, QTFILE_FOURCC('m','p','4','1'));
+	QTFile_EndAtom(theBuffer, myOffset, myAtom);
+
+	myMovie = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_MovieAtom);
+
+	// the movie header; the duration is unknown (0), since the movie is made of fragments
+	myAtom = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_MovieHeaderAtom);
+	QTFile_AppendZeros(theBuffer, &myOffset, 12);					// version, flags, creation and modification times
+	QTFile_Append32(theBuffer, &myOffset, (QTFileUInt32)theWriter->fTimeScale);
+	QTFile_Append32(theBuffer, &myOffset, 0);
+	QTFile_Append32(theBuffer, &myOffset, 0x00010000);				// rate
+	QTFile_Append16(theBuffer, &myOffset, 0x0100);					// volume
+	QTFile_AppendZeros(theBuffer, &myOffset, 10);
+	QTFile_AppendMatrix(theBuffer, &myOffset);
+	QTFile_AppendZeros(theBuffer, &myOffset, 24);
+	QTFile_Append32(theBuffer, &myOffset, theWriter->fTrackID + 1);	// next track ID
+	QTFile_EndAtom(theBuffer, myOffset, myAtom);
+
+	myTrack = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_TrackAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_TrackHeaderAtom);
+	QTFile_Append32(theBuffer, &myOffset, kTrackInMovieAndEnabled);
+	QTFile_AppendZeros(theBuffer, &myOffset, 8);
+	QTFile_Append32(theBuffer, &myOffset, theWriter->fTrackID);
+	QTFile_AppendZeros(theBuffer, &myOffset, 4 + 4 + 8 + 2 + 2 + 2 + 2);	// duration, layer, group, volume
+	QTFile_AppendMatrix(theBuffer, &myOffset);
+	QTFile_Append32(theBuffer, &myOffset, (QTFileUInt32)theWidth << 16);
+	QTFile_Append32(theBuffer, &myOffset, (QTFileUInt32)theHeight << 16);
+	QTFile_EndAtom(theBuffer, myOffset, myAtom);
+
+	myMedia = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_MediaAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_MediaHeaderAtom);
+	QTFile_AppendZeros(theBuffer, &myOffset, 12);
+	QTFile_Append32(theBuffer, &myOffset, (QTFileUInt32)theWriter->fTimeScale);
+	QTFile_Append32(theBuffer, &myOffset, 0);
+	QTFile_Append16(theBuffer, &myOffset, kUndeterminedLanguage);
+	QTFile_Append16(theBuffer, &myOffset, 0);
+	QTFile_EndAtom(theBuffer, myOffset, myAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_HandlerAtom);
+	QTFile_AppendZeros(theBuffer, &myOffset, 8);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_TextMediaType);
+	QTFile_AppendZeros(theBuffer, &myOffset, 12);
+	memcpy(theBuffer + myOffset, "Text", 5);
+	myOffset += 5;
+	QTFile_EndAtom(theBuffer, myOffset, myAtom);
+
+	myInfo = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_MediaInfoAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_NullMediaHeaderAtom);
+	QTFile_Append32(theBuffer, &myOffset, 0);
+	QTFile_EndAtom(theBuffer, myOffset, myAtom);
+
+	// the media data is in the movie file itself
+	myAtom = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_DataInfoAtom);
+	QTFile_Append32(theBuffer, &myOffset, 28);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_DataReferenceAtom);
+	QTFile_Append32(theBuffer, &myOffset, 0);
+	QTFile_Append32(theBuffer, &myOffset, 1);
+	QTFile_Append32(theBuffer, &myOffset, 12);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_DataEntryURLAtom);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_SelfReference);
+	QTFile_EndAtom(theBuffer, myOffset, myAtom);
+
+	myTable = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_SampleTableAtom);
+
+	// the one sample description: centered text at the bottom of the text box, in a single font
+	myDesc = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_SampleDescriptionAtom);
+	QTFile_Append32(theBuffer, &myOffset, 0);
+	QTFile_Append32(theBuffer, &myOffset, 1);
+
+	QTFile_AppendTextDescription(theBuffer, &myOffset, theWidth, theHeight);
+	QTFile_EndAtom(theBuffer, myOffset, myDesc);
+
+	// the sample tables are empty; the samples are described by the fragments
+	QTFile_Append32(theBuffer, &myOffset, 16);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_TimeToSampleAtom);
+	QTFile_AppendZeros(theBuffer, &myOffset, 8);
+
+	QTFile_Append32(theBuffer, &myOffset, 16);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_SampleToChunkAtom);
+	QTFile_AppendZeros(theBuffer, &myOffset, 8);
+
+	QTFile_Append32(theBuffer, &myOffset, 20);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_SampleSizeAtom);
+	QTFile_AppendZeros(theBuffer, &myOffset, 12);
+
+	QTFile_Append32(theBuffer, &myOffset, 16);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_ChunkOffsetAtom);
+	QTFile_AppendZeros(theBuffer, &myOffset, 8);
+
+	QTFile_EndAtom(theBuffer, myOffset, myTable);
+	QTFile_EndAtom(theBuffer, myOffset, myInfo);
+	QTFile_EndAtom(theBuffer, myOffset, myMedia);
+	QTFile_EndAtom(theBuffer, myOffset, myTrack);
+
+	// the movie extends atom says that fragments follow, and gives the defaults for the track's samples
+	myAtom = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_MovieExtendsAtom);
+	QTFile_Append32(theBuffer, &myOffset, 32);
+	QTFile_Append32(theBuffer, &myOffset, kQTFile_TrackExtendsAtom);
+	QTFile_Append32(theBuffer, &myOffset, 0);
+	QTFile_Append32(theBuffer, &myOffset, theWriter->fTrackID);
+	QTFile_Append32(theBuffer, &myOffset, 1);						// sample description index
+	QTFile_AppendZeros(theBuffer, &myOffset, 12);					// duration, size and flags
+	QTFile_EndAtom(theBuffer, myOffset, myAtom);
+
+	QTFile_EndAtom(theBuffer, myOffset, myMovie);
+
+	return(myOffset);
+}
+
+
+//////////
+//
+// QTFile_PutFragment
+// Hand the specified data to the write procedure of the specified fragment writer, unless an earlier call
+// failed.
+//
+//////////
+
+static void QTFile_PutFragment (QTFileFragmentWriterPtr theWriter, const unsigned char *theData, long theSize)
+{
+	if ((theWriter->fError != kQTFileErr_NoErr) || (theSize == 0))
+		return;
+
+	theWriter->fError = (*theWriter->fWriteProc)(theWriter->fRefCon, theData, theSize);
+	if (theWriter->fError == kQTFileErr_NoErr)
+		theWriter->fBytesWritten += theSize;
+}
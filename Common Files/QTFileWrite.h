@@ -0,0 +1,147 @@
+//////////
+//
+//	File:		QTFileWrite.h
+//
+//	Contains:	Portable writing of QuickTime movie files, without QuickTime.
+//				All utilities start with the prefix "QTFile_".
+//
+//	Written by:	QuickTime Team
+//
+//////////
+
+#pragma once
+
+#ifndef __QTFileWrite__
+#define __QTFileWrite__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#ifndef __QTFile__
+#include "QTFile.h"
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kQTFile_CopyBufferSize			(1024L * 1024L)	// size of the buffer used to copy media data
+#define kQTFile_MaxDataRegions			1024			// most 'mdat' atoms we copy from one file
+
+#define kQTFile_MaxTextLength			0xFFFF			// longest text in a text media sample
+#define kQTFile_DefaultFragmentSeconds	2				// length of a movie fragment, if the caller doesn't specify one
+#define kQTFile_MinFragmentSamples		64				// number of samples a fragment writer has room for initially
+#define kQTFile_MinFragmentDataSize		(4L * 1024L)	// number of bytes of sample data a fragment writer has room for initially
+
+#define kQTFile_CompactSuffix			".compact"		// appended to the name of a movie file to name the file it's compacted into
+#define kQTFile_MaxCompactTextSize		(256L * 1024L * 1024L)	// the most text sample data QTFile_CompactMovieFile keeps in memory
+#define kQTFile_DefaultCompactPadding	0L				// most free space left after the movie atom of a compacted movie file
+
+// atom types used in fragmented movie files
+#define kQTFile_MovieExtendsAtom		QTFILE_FOURCC('m','v','e','x')
+#define kQTFile_TrackExtendsAtom		QTFILE_FOURCC('t','r','e','x')
+#define kQTFile_MovieFragmentAtom		QTFILE_FOURCC('m','o','o','f')
+#define kQTFile_MovieFragmentHeaderAtom	QTFILE_FOURCC('m','f','h','d')
+#define kQTFile_TrackFragmentAtom		QTFILE_FOURCC('t','r','a','f')
+#define kQTFile_TrackFragmentHeaderAtom	QTFILE_FOURCC('t','f','h','d')
+#define kQTFile_TrackFragmentTimeAtom	QTFILE_FOURCC('t','f','d','t')
+#define kQTFile_TrackRunAtom			QTFILE_FOURCC('t','r','u','n')
+#define kQTFile_NullMediaHeaderAtom		QTFILE_FOURCC('n','m','h','d')
+#define kQTFile_DataEntryURLAtom		QTFILE_FOURCC('u','r','l',' ')
+#define kQTFile_FontTableAtom			QTFILE_FOURCC('f','t','a','b')
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// statistics returned by QTFile_WriteFastStartMovie
+typedef struct QTFileFlattenStats {
+	QTFileUInt64					fBytesCopied;	// the number of bytes of media data copied
+	long							fRegionCount;	// the number of 'mdat' atoms they were copied from
+	long							fChunkCount;	// the number of chunk offsets rewritten
+} QTFileFlattenStats, *QTFileFlattenStatsPtr;
+
+// statistics returned by QTFile_CompactMovieFile
+typedef struct QTFileCompactStats {
+	QTFileUInt64					fOldSize;		// the size of the movie file before compaction
+	QTFileUInt64					fNewSize;		// its size afterwards
+	QTFileInt64						fBytesReclaimed;// the difference (never negative; a file that wouldn't shrink is left alone)
+	QTFileUInt64					fDeadBytes;		// the number of bytes of text samples dropped
+	long							fTrackCount;	// the number of text tracks compacted
+	long							fSampleCount;	// the number of samples they kept
+	long							fDroppedCount;	// the number of samples they dropped
+} QTFileCompactStats, *QTFileCompactStatsPtr;
+
+// a compaction running in the background; its contents are private to QTFileWrite.c
+typedef struct QTFileCompactJob			QTFileCompactJob, *QTFileCompactJobPtr;
+
+
+// a procedure that writes data to a file (or to a network connection, or wherever the movie is going);
+// it returns 0 if all the data was written or an error code otherwise
+typedef long (*QTFileWriteProcPtr) (void *theRefCon, const unsigned char *theData, long theSize);
+
+// a fragmented movie writer for a single text track; the samples of the current fragment are collected in
+// memory and handed to the write procedure as a 'moof' and an 'mdat' atom once the fragment is long enough,
+// so the memory used by a writer depends only on the length of a fragment, never on the length of the movie
+typedef struct QTFileFragmentWriter {
+	QTFileWriteProcPtr				fWriteProc;		// the procedure that writes out the movie
+	void							*fRefCon;		// a reference constant for the write procedure
+	long							fError;			// the first error returned by the write procedure
+	QTFileUInt32					fTrackID;		// the ID of the text track
+	long							fTimeScale;		// the time scale of the text media
+	long							fFragmentDuration;	// the duration of a fragment, in the media time scale
+	QTFileUInt32					fSequenceNumber;	// the sequence number of the last fragment written
+	QTFileUInt64					fFragmentTime;	// the media time at which the current fragment starts
+	long							fDuration;		// the duration of the current fragment
+	long							fSampleCount;	// the number of samples in the current fragment
+	long							fMaxSamples;	// the number of samples fEntries has room for
+	unsigned char					*fEntries;		// the track run entries (duration and size) of those samples
+	long							fDataSize;		// the number of bytes of sample data in the current fragment
+	long							fMaxDataSize;	// the number of bytes fData has room for
+	unsigned char					*fData;			// the sample data of the current fragment
+	long							fFragmentCount;	// the number of fragments written so far
+	QTFileUInt64					fBytesWritten;	// the number of bytes handed to the write procedure so far
+} QTFileFragmentWriter, *QTFileFragmentWriterPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+long						QTFile_WriteFastStartMovie (const char *theSrcPath, const unsigned char *theMovieAtom, long theMovieAtomSize, const char *theDstPath, long thePadding, QTFileFlattenStatsPtr theStats);
+
+long						QTFile_CompactMovieFile (const char *thePath, long thePadding, QTFileCompactStatsPtr theStats);
+long						QTFile_StartCompaction (const char *thePath, long thePadding, QTFileCompactJobPtr *theJob);
+int							QTFile_IsCompactionDone (QTFileCompactJobPtr theJob);
+long						QTFile_FinishCompaction (QTFileCompactJobPtr theJob, QTFileCompactStatsPtr theStats);
+
+long						QTFile_PutTextSample (unsigned char *theData, const char *theText, long theLength);
+
+long						QTFile_BeginAtom (unsigned char *theBuffer, long *theOffset, QTFileOSType theType);
+void						QTFile_EndAtom (unsigned char *theBuffer, long theOffset, long theStart);
+void						QTFile_Append16 (unsigned char *theBuffer, long *theOffset, QTFileUInt16 theValue);
+void						QTFile_Append32 (unsigned char *theBuffer, long *theOffset, QTFileUInt32 theValue);
+void						QTFile_Append64 (unsigned char *theBuffer, long *theOffset, QTFileUInt64 theValue);
+void						QTFile_AppendZeros (unsigned char *theBuffer, long *theOffset, long theCount);
+void						QTFile_AppendMatrix (unsigned char *theBuffer, long *theOffset);
+void						QTFile_AppendData (unsigned char *theBuffer, long *theOffset, const void *theData, long theSize);
+void						QTFile_AppendTextDescription (unsigned char *theBuffer, long *theOffset, short theWidth, short theHeight);
+
+long						QTFile_BeginFragmentWriter (QTFileFragmentWriterPtr theWriter, QTFileWriteProcPtr theWriteProc, void *theRefCon, long theTimeScale, long theFragmentDuration, short theWidth, short theHeight);
+long						QTFile_WriteFragmentSample (QTFileFragmentWriterPtr theWriter, const char *theText, long theLength, long theDuration);
+long						QTFile_FlushFragment (QTFileFragmentWriterPtr theWriter);
+long						QTFile_EndFragmentWriter (QTFileFragmentWriterPtr theWriter);
+
+#endif	// __QTFileWrite__
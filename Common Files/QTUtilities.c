@@ -1913,4 +1913,341 @@ MovieController QTUtils_ChangeControllerType (MovieController theMC, OSType theT
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Movie file utilities.
+//
+// Use these functions to update the movie atom in a movie file that keeps its movie in the data fork.
+//
+// UpdateMovieResource can leave the old movie atom in place only if the new one is no bigger; an edit that
+// adds even one sample makes the movie atom grow, so the new one gets appended to the file. We instead look
+// for the movie atom and any 'free' or 'skip' atoms right after it, and if the new movie atom fits in that
+// free space we write it there, covering whatever is left over with a 'free' atom. Otherwise we append the
+// new movie atom to the file, followed by enough padding for the next update to go there. Either way, no media
+// data is read or copied; any media data added since the file was opened has already been written to the end
+// of the file, inside 'mdat' atoms (by QuickTime, or by the text media writer in QTText.c), so the file is
+// still a valid sequence of atoms.
+//
+// We never overwrite the old movie atom, which is the only copy of the movie until the new one is complete. The
+// new movie atom is written (its header last) and flushed to disk first; only then is the old one turned into a
+// 'free' atom, by rewriting its header. If we're interrupted before that, the file still opens with the old
+// movie atom, which comes first.
+//
+// File positions here are 32-bit values, so we give up (and let the caller fall back to UpdateMovieResource)
+// if the movie atom lies beyond the first 2 GB of the file.
+//
+// QTUtils_WriteFastStartMovieFile does the job of FlattenMovieData for a movie whose media data is all in its
+// own movie file: it writes the movie atom first and then copies the media data, in one sequential pass, using
+// the QTFile utilities (see QTFileWrite.c).
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTUtils_FindMovieAtom
+// Find the movie atom in the data fork of the movie file with the specified file reference number; return
+// its offset and size, and the total size of the 'free' and 'skip' atoms that immediately follow it.
+//
+//////////
+
+OSErr QTUtils_FindMovieAtom (short theRefNum, long *theOffset, long *theSize, long *theFreeSize)
+{
+	long				myEOF = 0;
+	long				myOffset = 0;
+	long				myCount;
+	UInt32				myHeader[4];
+	UInt32				mySize;
+	OSType				myType;
+	Boolean				isAfterMovie = false;
+	OSErr				myErr = noErr;
+
+	*theOffset = 0;
+	*theSize = 0;
+	*theFreeSize = 0;
+
+	myErr = GetEOF(theRefNum, &myEOF);
+	if (myErr != noErr)
+		return(myErr);
+
+	// walk the top-level atoms in the file
+	while (myEOF - myOffset >= kAtomHeaderSize) {
+		myErr = SetFPos(theRefNum, fsFromStart, myOffset);
+		if (myErr != noErr)
+			return(myErr);
+
+		myCount = sizeof(myHeader);
+		if (myCount > myEOF - myOffset)
+			myCount = kAtomHeaderSize;
+
+		myErr = FSRead(theRefNum, &myCount, myHeader);
+		if (myErr != noErr)
+			return(myErr);
+
+		mySize = EndianU32_BtoN(myHeader[0]);
+		myType = EndianU32_BtoN(myHeader[1]);
+
+		if (mySize == 0) {
+			// the atom extends to the end of the file
+			mySize = (UInt32)(myEOF - myOffset);
+		} else if (mySize == 1) {
+			// the atom has a 64-bit size; we can't go past it unless the size fits in 31 bits
+			if ((myCount < (long)sizeof(myHeader)) || (myHeader[2] != 0))
+				break;
+			mySize = EndianU32_BtoN(myHeader[3]);
+		}
+
+		if ((mySize < kAtomHeaderSize) || (mySize > (UInt32)(myEOF - myOffset)))
+			break;
+
+		if (isAfterMovie) {
+			if ((myType != FreeAtomType) && (myType != SkipAtomType))
+				break;
+			*theFreeSize += (long)mySize;
+		} else if (myType == MovieAID) {
+			*theOffset = myOffset;
+			*theSize = (long)mySize;
+			isAfterMovie = true;
+		}
+
+		myOffset += (long)mySize;
+	}
+
+	return((*theSize > 0) ? noErr : invalidMovie);
+}
+
+
+//////////
+//
+// QTUtils_WriteFreeAtom
+// Write the header of a 'free' atom of the specified size at the specified offset in the specified file.
+//
+//////////
+
+OSErr QTUtils_WriteFreeAtom (short theRefNum, long theOffset, long theSize)
+{
+	UInt32				myHeader[2];
+	long				myCount = sizeof(myHeader);
+	OSErr				myErr = noErr;
+
+	myHeader[0] = EndianU32_NtoB((UInt32)theSize);
+	myHeader[1] = EndianU32_NtoB(FreeAtomType);
+
+	myErr = SetFPos(theRefNum, fsFromStart, theOffset);
+	if (myErr == noErr)
+		myErr = FSWrite(theRefNum, &myCount, myHeader);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTUtils_FlushFile
+// Make sure that everything written to the file with the specified file reference number is on the disk.
+//
+//////////
+
+OSErr QTUtils_FlushFile (short theRefNum)
+{
+	ParamBlockRec		myParams;
+
+	myParams.ioParam.ioCompletion = NULL;
+	myParams.ioParam.ioRefNum = theRefNum;
+
+	return(PBFlushFileSync(&myParams));
+}
+
+
+//////////
+//
+// QTUtils_UpdateMovieAtomInPlace
+// Write the movie atom of the specified movie into the data fork of the movie file with the specified
+// file reference number, into the free space right after the old movie atom if it fits, or else at the
+// end of the file followed by enough free space for a copy of it plus thePadding bytes; then turn the old
+// movie atom into a 'free' atom.
+//
+//////////
+
+OSErr QTUtils_UpdateMovieAtomInPlace (Movie theMovie, short theRefNum, long thePadding)
+{
+	Handle				myAtom = NULL;
+	long				myAtomSize;
+	long				myOffset;
+	long				mySize;
+	long				myFreeSize;
+	long				myNewOffset;
+	long				myCount;
+	OSErr				myErr = noErr;
+
+	myErr = QTUtils_FindMovieAtom(theRefNum, &myOffset, &mySize, &myFreeSize);
+	if (myErr != noErr)
+		goto bail;
+
+	// get the complete movie atom (header and all)
+	myAtom = NewHandle(0);
+	if (myAtom == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = PutMovieIntoHandle(theMovie, myAtom);
+	if (myErr != noErr)
+		goto bail;
+
+	myAtomSize = GetHandleSize(myAtom);
+	if ((myAtomSize < kAtomHeaderSize) || (EndianU32_BtoN(((UInt32 *)*myAtom)[1]) != MovieAID)) {
+		myErr = invalidMovie;
+		goto bail;
+	}
+
+	// any space we don't fill has to be big enough to hold the header of a 'free' atom
+	if ((myAtomSize == myFreeSize) || (myAtomSize + kAtomHeaderSize <= myFreeSize)) {
+
+		// the new movie atom fits in the free space after the old one
+		myNewOffset = myOffset + mySize;
+		myFreeSize -= myAtomSize;
+	} else {
+
+		// the new movie atom doesn't fit; append it to the file, followed by room for the next update
+		myErr = GetEOF(theRefNum, &myNewOffset);
+		if (myErr != noErr)
+			goto bail;
+
+		if (thePadding < kAtomHeaderSize)
+			thePadding = kAtomHeaderSize;
+
+		myFreeSize = myAtomSize + thePadding;
+		myErr = SetEOF(theRefNum, myNewOffset + myAtomSize + myFreeSize);
+		if (myErr != noErr)
+			goto bail;
+	}
+
+	// cover the space left over after the new movie atom
+	if (myFreeSize > 0) {
+		myErr = QTUtils_WriteFreeAtom(theRefNum, myNewOffset + myAtomSize, myFreeSize);
+		if (myErr != noErr)
+			goto bail;
+	}
+
+	// write the new movie atom, its header last, so that it doesn't look like a movie atom until it's complete
+	HLock(myAtom);
+
+	myErr = SetFPos(theRefNum, fsFromStart, myNewOffset + kAtomHeaderSize);
+	if (myErr == noErr) {
+		myCount = myAtomSize - kAtomHeaderSize;
+		myErr = FSWrite(theRefNum, &myCount, *myAtom + kAtomHeaderSize);
+	}
+
+	if (myErr == noErr)
+		myErr = SetFPos(theRefNum, fsFromStart, myNewOffset);
+
+	if (myErr == noErr) {
+		myCount = kAtomHeaderSize;
+		myErr = FSWrite(theRefNum, &myCount, *myAtom);
+	}
+
+	HUnlock(myAtom);
+
+	if (myErr == noErr)
+		myErr = QTUtils_FlushFile(theRefNum);
+
+	if (myErr != noErr)
+		goto bail;
+
+	// only now that the new movie atom is safely on the disk do we free the old one
+	myErr = QTUtils_WriteFreeAtom(theRefNum, myOffset, mySize);
+	if (myErr == noErr)
+		myErr = QTUtils_FlushFile(theRefNum);
+
+bail:
+	if (myAtom != NULL)
+		DisposeHandle(myAtom);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTUtils_GetNativePathName
+// Return the full native pathname of the file specified by theFSSpec, which must exist on MacOS.
+//
+//////////
+
+OSErr QTUtils_GetNativePathName (const FSSpec *theFSSpec, char *thePath, long theSize)
+{
+#if TARGET_OS_MAC
+	FSRef				myFSRef;
+	OSErr				myErr = noErr;
+
+	myErr = FSpMakeFSRef(theFSSpec, &myFSRef);
+	if (myErr == noErr)
+		myErr = FSRefMakePath(&myFSRef, (UInt8 *)thePath, (UInt32)theSize);
+
+	return(myErr);
+#endif
+#if TARGET_OS_WIN32
+	return(FSSpecToNativePathName(theFSSpec, thePath, theSize, kFullNativePath));
+#endif
+}
+
+
+//////////
+//
+// QTUtils_WriteFastStartMovieFile
+// Write the specified movie, whose media data is in the file specified by theSrcFile, into a new
+// fast-start movie file specified by theDstFile, in a single pass over the media data; the movie atom
+// is followed by thePadding bytes of free space, so that later updates can be done in place.
+//
+// We return an error if the movie can't be written this way (for instance, because some of its media
+// data is in other files); the caller should then use FlattenMovieData instead. theDstFile must not
+// name the file that contains the media data.
+//
+//////////
+
+OSErr QTUtils_WriteFastStartMovieFile (Movie theMovie, const FSSpec *theSrcFile, const FSSpec *theDstFile, long thePadding)
+{
+	Handle				myAtom = NULL;
+	char				mySrcPath[kMaxNativePathSize];
+	char				myDstPath[kMaxNativePathSize];
+	OSErr				myErr = noErr;
+
+	myErr = QTUtils_GetNativePathName(theSrcFile, mySrcPath, sizeof(mySrcPath));
+	if (myErr != noErr)
+		goto bail;
+
+#if TARGET_OS_MAC
+	// on MacOS, the file must exist before we can get its pathname
+	myErr = FSpCreate(theDstFile, sigMoviePlayer, MovieFileType, smSystemScript);
+	if ((myErr != noErr) && (myErr != dupFNErr))
+		goto bail;
+#endif
+
+	myErr = QTUtils_GetNativePathName(theDstFile, myDstPath, sizeof(myDstPath));
+	if (myErr != noErr)
+		goto bail;
+
+	// get the complete movie atom (header and all); its chunk offsets refer to the source file
+	myAtom = NewHandle(0);
+	if (myAtom == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = PutMovieIntoHandle(theMovie, myAtom);
+	if (myErr != noErr)
+		goto bail;
+
+	HLock(myAtom);
+	myErr = (OSErr)QTFile_WriteFastStartMovie(mySrcPath, (unsigned char *)*myAtom, GetHandleSize(myAtom), myDstPath, thePadding, NULL);
+	HUnlock(myAtom);
+
+bail:
+	if (myAtom != NULL)
+		DisposeHandle(myAtom);
+
+	return(myErr);
+}
+
+
 #endif	// ifndef __QTUtilities__
\ No newline at end of file
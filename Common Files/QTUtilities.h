@@ -102,6 +102,10 @@
 #include <Traps.h>
 #endif
 
+#ifndef __QTFileWrite__
+#include "QTFileWrite.h"
+#endif
+
 
 //////////
 //
@@ -147,6 +151,13 @@ enum {
 	kNoLooping						= 2
 };
 
+// constants used for QTUtils_UpdateMovieAtomInPlace
+#define kAtomHeaderSize				8			// the size and type of an atom
+#define kMovieAtomPadding			(16L * 1024L)	// free space left after a movie atom that has been moved to the end of the file
+
+// constants used for QTUtils_WriteFastStartMovieFile
+#define kMaxNativePathSize			1024		// longest full pathname we pass to the QTFile utilities
+
 #define kQTVideoEffectsMinVers		0x0300		// version of QT that first supports QT video effects
 #define kQTFullScreenMinVers		0x0209		// version of QT that first supports full-screen calls
 #define kQTWiredSpritesMinVers		0x0300		// version of QT that first supports wired sprites
@@ -269,5 +280,11 @@ OSErr						QTUtils_GetUsersContentRating (UInt32 *theType, UInt16 *theRating);
 OSType						QTUtils_GetControllerType (Movie theMovie);
 OSErr						QTUtils_SetControllerType (Movie theMovie, OSType theType);
 MovieController				QTUtils_ChangeControllerType (MovieController theMC, OSType theType, long theFlags);
+OSErr						QTUtils_FindMovieAtom (short theRefNum, long *theOffset, long *theSize, long *theFreeSize);
+OSErr						QTUtils_WriteFreeAtom (short theRefNum, long theOffset, long theSize);
+OSErr						QTUtils_FlushFile (short theRefNum);
+OSErr						QTUtils_UpdateMovieAtomInPlace (Movie theMovie, short theRefNum, long thePadding);
+OSErr						QTUtils_GetNativePathName (const FSSpec *theFSSpec, char *thePath, long theSize);
+OSErr						QTUtils_WriteFastStartMovieFile (Movie theMovie, const FSSpec *theSrcFile, const FSSpec *theDstFile, long thePadding);
 
 #endif	// __QTUtilities__
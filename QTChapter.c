@@ -0,0 +1,1479 @@
+//////////
+//
+//	File:		QTChapter.c
+//
+//	Contains:	Converting between QuickTime chapter tracks and Nero chapter lists ('chpl' atoms) in movie files.
+//				All utilities start with the prefix "QTChap_".
+//
+//	Written by:	QuickTime Team
+//
+//	Like QTTextFile.c, this file makes no QuickTime or Toolbox calls; QTChapterTool.c is a command-line tool
+//	that calls it. On Linux, for instance:
+//
+//		cc -O2 -I. -I"Common Files" -o qtchapter QTChapterTool.c QTChapter.c QTTextIndex.c QTTextFile.c QTTextEncoding.c "Common Files/QTFile.c" "Common Files/QTFileWrite.c" -lpthread
+//
+// NOTES:
+//
+// *** (1) ***
+// QuickTime movies keep their chapters in a text track that another track refers to with a 'chap' track
+// reference (see QTText_SetTextTrackAsChapterTrack). Many MPEG-4 players instead read a Nero chapter list, a
+// 'chpl' atom in the movie's user data:
+//
+//		version (1 byte), flags (3 bytes), reserved (4 bytes, only if the version is 1), chapter count (1 byte)
+//		for each chapter: start time (8 bytes, in units of 100 nanoseconds), title length (1 byte), title (UTF-8)
+//
+// So a chapter list holds at most 255 chapters, with titles of at most 255 bytes; we drop any chapters past
+// the 255th and cut longer titles short (at a character boundary).
+//
+// *** (2) ***
+// A conversion changes only the movie atom; the media data stays where it is, so no chunk offsets change. If
+// the new movie atom fits in the free atoms right after the old one, we write it there; otherwise we append it
+// to the end of the file, followed by enough free space for the next update. Only once the new movie atom is
+// written (header last) and flushed to disk do we turn the old one into a free atom, so an interrupted
+// conversion leaves the old movie in place, as QTUtils_UpdateMovieAtomInPlace does. Either way the file is
+// never copied, so converting a large library takes about as long as reading its movie atoms.
+//
+// *** (3) ***
+// Converting a chapter list into a chapter track does add media data, the text samples of the new track; we
+// append them to the end of the file in an 'mdat' atom of their own, before writing the new movie atom. The
+// new track has one sample per chapter, in the movie's time scale, and no edit list; it's disabled (as
+// chapter tracks are), and the first enabled video track (or, failing that, the first enabled track of any
+// other kind) refers to it. The first chapter always starts at time 0.
+//
+// *** (4) ***
+// A movie that already has a chapter track isn't given another one; a chapter list that's already in a movie
+// is replaced. Movies with nothing to convert are left alone.
+//
+// *** (5) ***
+// QTChap_ConvertDirectory finds all the movie files in a directory tree (with QTIndex_FindMovies) and hands
+// them out one at a time to a set of worker threads. Each worker has at most one movie file open.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#if !defined(_WIN32)
+#define _FILE_OFFSET_BITS				64				// for files larger than 2 GB
+#endif
+
+#include "QTChapter.h"
+#include "QTTextIndex.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kMaxUInt32						0xFFFFFFFFUL
+#define kMaxLong						0x7FFFFFFFL
+
+#define kChapterEntryHeaderSize			9				// start time and title length of a chapter in a 'chpl' atom
+#define kChapterTrackSize				1024			// room for a chapter track atom, not counting its per-sample entries
+#define kChapterSampleEntrySize			8				// room for the 'stts' and 'stsz' entries of each sample
+#define kTrackRefSize					20				// room for a 'tref' atom holding one 'chap' reference
+
+#define kMovieHeaderNextTrackID			96				// 'mvhd': the offset of the next track ID, in a version 0 header
+#define kMovieHeaderNextTrackID64		108				// 'mvhd': the offset of the next track ID, in a version 1 header
+#define kTrackInMovie					0x000002		// 'tkhd': the track is used in the movie (but not enabled)
+#define kUndeterminedLanguage			0x55C4			// 'mdhd': the packed ISO 639-2 code "und"
+
+#if defined(_WIN32)
+#define kInvalidFile					INVALID_HANDLE_VALUE
+#else
+#define kInvalidFile					-1
+#endif
+
+
+//////////
+//
+// data types
+//
+//////////
+
+#if defined(_WIN32)
+typedef HANDLE							QTChapFileRef;
+typedef HANDLE							QTChapThread;
+typedef CRITICAL_SECTION				QTChapLock;
+#else
+typedef int								QTChapFileRef;
+typedef pthread_t						QTChapThread;
+typedef pthread_mutex_t					QTChapLock;
+#endif
+
+// a chapter
+typedef struct QTChapEntry {
+	QTFileTimeValue					fStart;			// the starting time of the chapter, in the movie's time scale
+	long							fLength;		// the length of the title
+	char							fTitle[kQTChap_MaxTitleLength + 1];	// the title, as UTF-8
+} QTChapEntry, *QTChapEntryPtr;
+
+// the chapters of a movie
+typedef struct QTChapList {
+	long							fTimeScale;		// the movie's time scale
+	QTFileTimeValue					fDuration;		// the movie's duration
+	long							fCount;			// the number of chapters
+	QTChapEntry						fEntries[kQTChap_MaxChapters];
+} QTChapList, *QTChapListPtr;
+
+// the movie atom of a movie file
+typedef struct QTChapMovieAtom {
+	QTFileUInt64					fFileSize;		// the size of the file
+	QTFileUInt64					fOffset;		// the offset of the movie atom in the file
+	long							fSize;			// the size of the movie atom, header and all
+	long							fFreeSize;		// the size of the free atoms right after it
+	unsigned char					*fData;			// the movie atom, header and all
+	QTFileAtom						fAtom;			// its contents
+} QTChapMovieAtom, *QTChapMovieAtomPtr;
+
+// a directory conversion; fNext and fStats are shared by the workers, and guarded by fLock
+typedef struct QTChapConverter {
+	QTIndexList						fMovies;		// the paths of the movie files to convert
+	long							fDirection;		// the direction of the conversion
+	QTChapLock						fLock;
+	long							fNext;			// the index in fMovies of the next movie to convert
+	QTChapStats						fStats;			// the results so far
+} QTChapConverter, *QTChapConverterPtr;
+
+// a worker thread
+typedef struct QTChapWorker {
+	QTChapConverterPtr				fConverter;		// the conversion this worker belongs to
+	QTChapThread					fThread;		// the thread
+	QTTextCachePtr					fCache;			// the cache for converting sample text to UTF-8
+} QTChapWorker, *QTChapWorkerPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTChap_RunWorker (QTChapWorkerPtr theWorker);
+static long					QTChap_ReadTrackChapters (QTFileMoviePtr theMovie, QTFileTrackPtr theChapterTrack, QTTextCachePtr theCache, QTChapListPtr theList);
+static void					QTChap_ReadListChapters (const QTFileAtom *theMovieAtom, QTChapListPtr theList);
+static QTFileTrackPtr		QTChap_GetReferringTrack (QTFileMoviePtr theMovie);
+static void					QTChap_SetTitle (QTChapEntryPtr theEntry, const char *theTitle, long theLength);
+static QTFileUInt64			QTChap_MovieTimeToListTime (QTFileTimeValue theTime, long theTimeScale);
+static QTFileTimeValue		QTChap_ListTimeToMovieTime (QTFileUInt64 theTime, long theTimeScale);
+static long					QTChap_BuildListMovieAtom (const QTFileAtom *theMovieAtom, const QTChapList *theList, unsigned char *theBuffer);
+static long					QTChap_BuildTrackMovieAtom (const QTFileAtom *theMovieAtom, const QTChapList *theList, QTFileUInt32 theTrackID, QTFileUInt32 theChapterTrackID, const long *theSampleSizes, QTFileUInt64 theDataOffset, unsigned char *theBuffer);
+static void					QTChap_AppendChapterList (unsigned char *theBuffer, long *theOffset, const QTChapList *theList);
+static void					QTChap_AppendTrackRef (unsigned char *theBuffer, long *theOffset, const QTFileAtom *theRefAtom, QTFileUInt32 theChapterTrackID);
+static void					QTChap_AppendChapterTrack (unsigned char *theBuffer, long *theOffset, const QTChapList *theList, QTFileUInt32 theChapterTrackID, const long *theSampleSizes, QTFileUInt64 theDataOffset);
+static QTFileUInt32			QTChap_GetNextTrackID (const QTFileAtom *theMovieAtom);
+static long					QTChap_ReadMovieAtom (QTChapFileRef theFile, QTChapMovieAtomPtr theMovieAtom);
+static long					QTChap_WriteMovieAtom (QTChapFileRef theFile, const QTChapMovieAtom *theOldAtom, QTFileUInt64 theFileSize, const unsigned char *theNewAtom, long theNewSize, int *wasMoved);
+static long					QTChap_WriteFreeAtom (QTChapFileRef theFile, QTFileUInt64 theOffset, long theSize);
+static QTChapFileRef		QTChap_OpenFile (const char *thePath);
+static void					QTChap_CloseFile (QTChapFileRef theFile);
+static long					QTChap_GetFileSize (QTChapFileRef theFile, QTFileUInt64 *theSize);
+static long					QTChap_ReadData (QTChapFileRef theFile, QTFileUInt64 theOffset, void *theData, long theSize);
+static long					QTChap_WriteData (QTChapFileRef theFile, QTFileUInt64 theOffset, const void *theData, long theSize);
+static long					QTChap_FlushFile (QTChapFileRef theFile);
+#if defined(_WIN32)
+static DWORD WINAPI			QTChap_ThreadEntry (LPVOID theWorker);
+#else
+static void *				QTChap_ThreadEntry (void *theWorker);
+#endif
+static int					QTChap_StartThread (QTChapWorkerPtr theWorker);
+static void					QTChap_WaitThread (QTChapThread theThread);
+static void					QTChap_InitLock (QTChapLock *theLock);
+static void					QTChap_DisposeLock (QTChapLock *theLock);
+static void					QTChap_Lock (QTChapLock *theLock);
+static void					QTChap_Unlock (QTChapLock *theLock);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Conversion utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTChap_ConvertMovieFile
+// Convert the chapters of the movie file at thePath in the specified direction; return the number of chapters
+// converted through theChapterCount (0 if there was nothing to convert), and whether the movie atom had to be
+// moved to the end of the file through wasMoved.
+//
+// theCache must have been created with QTTextEnc_NewCache; we flush it before returning.
+//
+//////////
+
+long QTChap_ConvertMovieFile (const char *thePath, long theDirection, QTTextCachePtr theCache, long *theChapterCount, int *wasMoved)
+{
+	QTFileMoviePtr		myMovie = NULL;
+	QTFileTrackPtr		myChapterTrack = NULL;
+	QTFileTrackPtr		myTrack = NULL;
+	QTChapListPtr		myList = NULL;
+	QTChapMovieAtom		myMovieAtom;
+	QTChapFileRef		myFile = kInvalidFile;
+	unsigned char		*myNewAtom = NULL;
+	unsigned char		*mySamples = NULL;
+	long				*mySampleSizes = NULL;
+	QTFileUInt32		myTrackID = 0;
+	QTFileUInt32		myChapterTrackID = 0;
+	QTFileUInt64		myFileSize;
+	long				myNewSize;
+	long				myDataSize = 0;
+	long				myIndex;
+	long				myErr = kQTFileErr_NoErr;
+
+	if ((thePath == NULL) || (theCache == NULL) || (theChapterCount == NULL) || (wasMoved == NULL))
+		return(kQTFileErr_Param);
+
+	if ((theDirection != kQTChap_TrackToList) && (theDirection != kQTChap_ListToTrack))
+		return(kQTFileErr_Param);
+
+	*theChapterCount = 0;
+	*wasMoved = 0;
+	memset(&myMovieAtom, 0, sizeof(myMovieAtom));
+
+	myList = (QTChapListPtr)calloc(1, sizeof(QTChapList));
+	if (myList == NULL)
+		return(kQTFileErr_MemFull);
+
+	// read what we need from the tracks, and close the movie before we open the file for writing
+	myErr = QTFile_OpenMovie(thePath, &myMovie);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	myList->fTimeScale = myMovie->fTimeScale;
+	myList->fDuration = myMovie->fDuration;
+	myChapterTrack = QTTextFile_GetChapterTrackForMovie(myMovie);
+
+	if (theDirection == kQTChap_TrackToList) {
+		if (myChapterTrack == NULL)
+			goto bail;
+
+		myErr = QTChap_ReadTrackChapters(myMovie, myChapterTrack, theCache, myList);
+	} else {
+		if (myChapterTrack != NULL)
+			goto bail;
+
+		myTrack = QTChap_GetReferringTrack(myMovie);
+		if (myTrack == NULL)
+			goto bail;
+
+		myTrackID = myTrack->fTrackID;
+		for (myIndex = 0; myIndex < myMovie->fTrackCount; myIndex++)
+			if (myMovie->fTracks[myIndex].fTrackID >= myChapterTrackID)
+				myChapterTrackID = myMovie->fTracks[myIndex].fTrackID + 1;
+	}
+
+	QTTextEnc_CacheFlushAll(theCache);
+	QTFile_CloseMovie(myMovie);
+	myMovie = NULL;
+
+	if ((myErr != kQTFileErr_NoErr) || ((theDirection == kQTChap_TrackToList) && (myList->fCount == 0)))
+		goto bail;
+
+	// the new chapter track has 32-bit durations in the movie's time scale
+	if ((myList->fTimeScale <= 0) || (myList->fDuration < 0) || ((QTFileUInt64)myList->fDuration > kMaxUInt32)) {
+		myErr = kQTFileErr_Unimplemented;
+		goto bail;
+	}
+
+	myFile = QTChap_OpenFile(thePath);
+	if (myFile == kInvalidFile) {
+		myErr = kQTFileErr_FileNotFound;
+		goto bail;
+	}
+
+	myErr = QTChap_ReadMovieAtom(myFile, &myMovieAtom);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	myFileSize = myMovieAtom.fFileSize;
+
+	if (theDirection == kQTChap_ListToTrack) {
+		QTChap_ReadListChapters(&myMovieAtom.fAtom, myList);
+		if (myList->fCount == 0)
+			goto bail;
+
+		if (QTChap_GetNextTrackID(&myMovieAtom.fAtom) > myChapterTrackID)
+			myChapterTrackID = QTChap_GetNextTrackID(&myMovieAtom.fAtom);
+
+		// build the text samples, as the contents of an 'mdat' atom
+		mySamples = (unsigned char *)malloc(kQTFile_AtomHeaderSize + (myList->fCount * (sizeof(QTFileUInt16) + kQTChap_MaxTitleLength)));
+		mySampleSizes = (long *)malloc(myList->fCount * sizeof(long));
+		if ((mySamples == NULL) || (mySampleSizes == NULL)) {
+			myErr = kQTFileErr_MemFull;
+			goto bail;
+		}
+
+		myDataSize = kQTFile_AtomHeaderSize;
+		for (myIndex = 0; myIndex < myList->fCount; myIndex++) {
+			mySampleSizes[myIndex] = QTFile_PutTextSample(mySamples + myDataSize, myList->fEntries[myIndex].fTitle, myList->fEntries[myIndex].fLength);
+			myDataSize += mySampleSizes[myIndex];
+		}
+
+		QTFile_Put32(mySamples, (QTFileUInt32)myDataSize);
+		QTFile_Put32(mySamples + 4, kQTFile_MovieDataAtom);
+	}
+
+	myNewAtom = (unsigned char *)malloc(myMovieAtom.fSize + kChapterTrackSize + kTrackRefSize + (myList->fCount * (kChapterEntryHeaderSize + kQTChap_MaxTitleLength + kChapterSampleEntrySize)));
+	if (myNewAtom == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	if (theDirection == kQTChap_TrackToList) {
+		myNewSize = QTChap_BuildListMovieAtom(&myMovieAtom.fAtom, myList, myNewAtom);
+	} else {
+		myNewSize = QTChap_BuildTrackMovieAtom(&myMovieAtom.fAtom, myList, myTrackID, myChapterTrackID, mySampleSizes, myFileSize + kQTFile_AtomHeaderSize, myNewAtom);
+		if (myNewSize == 0) {
+			myErr = kQTFileErr_InvalidMovie;
+			goto bail;
+		}
+
+		// the samples go at the end of the file, before the new movie atom is written
+		myErr = QTChap_WriteData(myFile, myFileSize, mySamples, myDataSize);
+		if (myErr != kQTFileErr_NoErr)
+			goto bail;
+
+		myFileSize += myDataSize;
+	}
+
+	myErr = QTChap_WriteMovieAtom(myFile, &myMovieAtom, myFileSize, myNewAtom, myNewSize, wasMoved);
+	if (myErr == kQTFileErr_NoErr)
+		*theChapterCount = myList->fCount;
+
+bail:
+	if (myMovie != NULL) {
+		QTTextEnc_CacheFlushAll(theCache);
+		QTFile_CloseMovie(myMovie);
+	}
+
+	if (myFile != kInvalidFile)
+		QTChap_CloseFile(myFile);
+
+	free(myMovieAtom.fData);
+	free(myNewAtom);
+	free(mySamples);
+	free(mySampleSizes);
+	free(myList);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTChap_ConvertDirectory
+// Convert the chapters of all the movie files in the directory tree at theDirPath in the specified direction,
+// using the specified number of worker threads (or one per processor, if theThreadCount is 0).
+//
+//////////
+
+long QTChap_ConvertDirectory (const char *theDirPath, long theDirection, long theThreadCount, QTChapStatsPtr theStats)
+{
+	QTChapConverter		myConverter;
+	QTChapWorkerPtr		myWorkers = NULL;
+	long				myStartCount = 0;
+	long				myIndex;
+	long				myErr = kQTFileErr_NoErr;
+
+	if ((theDirPath == NULL) || (theStats == NULL))
+		return(kQTFileErr_Param);
+
+	memset(&myConverter, 0, sizeof(myConverter));
+	memset(theStats, 0, sizeof(QTChapStats));
+	myConverter.fDirection = theDirection;
+
+	myErr = QTIndex_FindMovies(theDirPath, &myConverter.fMovies);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	myConverter.fStats.fMovieCount = myConverter.fMovies.fCount;
+
+	if (theThreadCount <= 0)
+		theThreadCount = QTIndex_GetProcessorCount();
+	if (theThreadCount > kQTChap_MaxThreads)
+		theThreadCount = kQTChap_MaxThreads;
+	if (theThreadCount > myConverter.fMovies.fCount)
+		theThreadCount = myConverter.fMovies.fCount;
+	if (theThreadCount < 1)
+		theThreadCount = 1;
+
+	myWorkers = (QTChapWorkerPtr)calloc(theThreadCount, sizeof(QTChapWorker));
+	if (myWorkers == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < theThreadCount; myIndex++) {
+		myWorkers[myIndex].fConverter = &myConverter;
+		myWorkers[myIndex].fCache = QTTextEnc_NewCache(kQTTextEnc_DefaultCacheSize);
+		if (myWorkers[myIndex].fCache == NULL) {
+			myErr = kQTFileErr_MemFull;
+			goto bail;
+		}
+	}
+
+	QTChap_InitLock(&myConverter.fLock);
+
+	// the workers take the movies one at a time, so a few big movies can't hold up the others
+	for (myStartCount = 0; myStartCount < theThreadCount; myStartCount++)
+		if (!QTChap_StartThread(&myWorkers[myStartCount]))
+			break;
+
+	// if we couldn't start any threads, do the work ourselves
+	if (myStartCount == 0)
+		QTChap_RunWorker(&myWorkers[0]);
+
+	for (myIndex = 0; myIndex < myStartCount; myIndex++)
+		QTChap_WaitThread(myWorkers[myIndex].fThread);
+
+	QTChap_DisposeLock(&myConverter.fLock);
+
+	myConverter.fStats.fThreadCount = (myStartCount > 0) ? myStartCount : 1;
+
+bail:
+	if (myWorkers != NULL) {
+		for (myIndex = 0; myIndex < theThreadCount; myIndex++)
+			if (myWorkers[myIndex].fCache != NULL)
+				QTTextEnc_DisposeCache(myWorkers[myIndex].fCache);
+
+		free(myWorkers);
+	}
+
+	QTIndex_DisposeList(&myConverter.fMovies);
+	*theStats = myConverter.fStats;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTChap_RunWorker
+// Convert movies until there are none left.
+//
+//////////
+
+static void QTChap_RunWorker (QTChapWorkerPtr theWorker)
+{
+	QTChapConverterPtr	myConverter = theWorker->fConverter;
+	long				myIndex;
+	long				myChapterCount;
+	int					wasMoved;
+	long				myErr;
+
+	for (;;) {
+		QTChap_Lock(&myConverter->fLock);
+		myIndex = myConverter->fNext++;
+		QTChap_Unlock(&myConverter->fLock);
+
+		if (myIndex >= myConverter->fMovies.fCount)
+			break;
+
+		myErr = QTChap_ConvertMovieFile(myConverter->fMovies.fItems[myIndex], myConverter->fDirection, theWorker->fCache, &myChapterCount, &wasMoved);
+
+		QTChap_Lock(&myConverter->fLock);
+		if (myErr != kQTFileErr_NoErr) {
+			myConverter->fStats.fFailedCount++;
+		} else if (myChapterCount == 0) {
+			myConverter->fStats.fSkippedCount++;
+		} else {
+			myConverter->fStats.fConvertedCount++;
+			myConverter->fStats.fChapterCount += myChapterCount;
+			if (wasMoved)
+				myConverter->fStats.fMovedCount++;
+		}
+		QTChap_Unlock(&myConverter->fLock);
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Chapter utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTChap_ReadTrackChapters
+// Read the chapters of the specified chapter track into theList.
+//
+//////////
+
+static long QTChap_ReadTrackChapters (QTFileMoviePtr theMovie, QTFileTrackPtr theChapterTrack, QTTextCachePtr theCache, QTChapListPtr theList)
+{
+	QTChapEntryPtr		myEntry;
+	const char			*myText = NULL;
+	QTFileTimeValue		myTime;
+	long				mySampleNum;
+	long				myCount;
+	long				myLength;
+	long				myIndex;
+
+	// the chapters are the samples the track plays, in the order it plays them; any sample that its edits leave
+	// out of the movie isn't among them
+	myCount = QTTextFile_GetChapterCount(theChapterTrack);
+	if (myCount > kQTChap_MaxChapters)
+		myCount = kQTChap_MaxChapters;
+
+	theList->fCount = 0;
+	for (myIndex = 1; myIndex <= myCount; myIndex++) {
+		if (QTFile_GetIndTrackSample(theChapterTrack, myIndex, &mySampleNum, &myTime) != kQTFileErr_NoErr)
+			break;
+
+		myText = QTTextFile_GetSampleTextUTF8(theMovie, theChapterTrack, mySampleNum, theCache, &myLength);
+		if (myText == NULL)
+			myLength = 0;
+
+		myEntry = &theList->fEntries[theList->fCount++];
+		myEntry->fStart = myTime;
+		QTChap_SetTitle(myEntry, myText, myLength);
+	}
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTChap_ReadListChapters
+// Read the chapters of the chapter list in the specified movie atom, if it has one, into theList.
+//
+// We keep only chapters that start after the previous one and before the end of the movie; the first chapter
+// is made to start at time 0 (see note (3)).
+//
+//////////
+
+static void QTChap_ReadListChapters (const QTFileAtom *theMovieAtom, QTChapListPtr theList)
+{
+	QTFileAtom			myAtom;
+	const unsigned char	*myData;
+	const unsigned char	*myEnd;
+	QTFileTimeValue		myTime;
+	long				myCount;
+	long				myLength;
+
+	theList->fCount = 0;
+
+	if (!QTFile_FindChildAtom(theMovieAtom, kQTFile_UserDataAtom, &myAtom) || !QTFile_FindChildAtom(&myAtom, kQTChap_ChapterListAtom, &myAtom))
+		return;
+
+	if (myAtom.fSize < 5)
+		return;
+
+	myData = myAtom.fData + 4;
+	myEnd = myAtom.fData + myAtom.fSize;
+	if (myAtom.fData[0] != 0)
+		myData += 4;									// the reserved field
+
+	if (myData >= myEnd)
+		return;
+
+	myCount = *myData++;
+	while ((myCount-- > 0) && (myEnd - myData >= kChapterEntryHeaderSize)) {
+		myTime = QTChap_ListTimeToMovieTime(QTFile_Get64(myData), theList->fTimeScale);
+		myLength = myData[8];
+		myData += kChapterEntryHeaderSize;
+		if (myLength > myEnd - myData)
+			break;
+
+		if (theList->fCount == 0)
+			myTime = 0;
+
+		if (((theList->fCount == 0) || (myTime > theList->fEntries[theList->fCount - 1].fStart)) && ((myTime < theList->fDuration) || (theList->fCount == 0))) {
+			theList->fEntries[theList->fCount].fStart = myTime;
+			QTChap_SetTitle(&theList->fEntries[theList->fCount], (const char *)myData, myLength);
+			theList->fCount++;
+		}
+
+		myData += myLength;
+	}
+}
+
+
+//////////
+//
+// QTChap_GetReferringTrack
+// Return the track of the specified movie that should refer to a new chapter track: the first enabled video
+// track, or else the first enabled track that isn't a text track; return NULL if there's no such track.
+//
+//////////
+
+static QTFileTrackPtr QTChap_GetReferringTrack (QTFileMoviePtr theMovie)
+{
+	QTFileTrackPtr		myTrack = NULL;
+	long				myIndex;
+
+	for (myIndex = 0; myIndex < theMovie->fTrackCount; myIndex++) {
+		myTrack = &theMovie->fTracks[myIndex];
+		if ((myTrack->fFlags & kQTFile_TrackEnabled) && (myTrack->fMediaType == kQTFile_VideoMediaType))
+			return(myTrack);
+	}
+
+	for (myIndex = 0; myIndex < theMovie->fTrackCount; myIndex++) {
+		myTrack = &theMovie->fTracks[myIndex];
+		if ((myTrack->fFlags & kQTFile_TrackEnabled) && !QTFile_IsTextTrack(myTrack))
+			return(myTrack);
+	}
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTChap_SetTitle
+// Set the title of the specified chapter, cutting it short (at a UTF-8 character boundary) if need be.
+//
+//////////
+
+static void QTChap_SetTitle (QTChapEntryPtr theEntry, const char *theTitle, long theLength)
+{
+	if ((theTitle == NULL) || (theLength < 0))
+		theLength = 0;
+
+	if (theLength > kQTChap_MaxTitleLength) {
+		theLength = kQTChap_MaxTitleLength;
+
+		// back up over any continuation bytes of a character we'd otherwise cut in two
+		while ((theLength > 0) && ((theTitle[theLength] & 0xC0) == 0x80))
+			theLength--;
+	}
+
+	memcpy(theEntry->fTitle, theTitle, theLength);
+	theEntry->fTitle[theLength] = '\0';
+	theEntry->fLength = theLength;
+}
+
+
+//////////
+//
+// QTChap_MovieTimeToListTime
+// Convert the specified movie time into chapter list time (units of 100 nanoseconds).
+//
+//////////
+
+static QTFileUInt64 QTChap_MovieTimeToListTime (QTFileTimeValue theTime, long theTimeScale)
+{
+	if ((theTime <= 0) || (theTimeScale <= 0))
+		return(0);
+
+	// split the time, so that long movies with fine time scales don't overflow
+	return(((QTFileUInt64)(theTime / theTimeScale) * kQTChap_TimeScale) + ((QTFileUInt64)(theTime % theTimeScale) * kQTChap_TimeScale / theTimeScale));
+}
+
+
+//////////
+//
+// QTChap_ListTimeToMovieTime
+// Convert the specified chapter list time (units of 100 nanoseconds) into movie time, rounded to the nearest
+// unit; QTChap_MovieTimeToListTime rounds down, so a movie time survives the round trip.
+//
+//////////
+
+static QTFileTimeValue QTChap_ListTimeToMovieTime (QTFileUInt64 theTime, long theTimeScale)
+{
+	return((QTFileTimeValue)(((theTime / kQTChap_TimeScale) * theTimeScale) + (((theTime % kQTChap_TimeScale) * theTimeScale + (kQTChap_TimeScale / 2)) / kQTChap_TimeScale)));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Movie atom utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTChap_BuildListMovieAtom
+// Build, in theBuffer, a copy of the specified movie atom whose user data holds a chapter list with the
+// chapters in theList (replacing any chapter list it already holds); return the size of the new movie atom.
+//
+//////////
+
+static long QTChap_BuildListMovieAtom (const QTFileAtom *theMovieAtom, const QTChapList *theList, unsigned char *theBuffer)
+{
+	QTFileAtom			myAtom;
+	QTFileAtom			myChild;
+	long				myOffset = 0;
+	long				myStart;
+	long				myChildStart;
+	long				myAtomOffset = 0;
+	long				myChildOffset;
+	long				myMovie;
+	long				myUserData;
+	int					hasUserData = 0;
+
+	myMovie = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_MovieAtom);
+
+	for (myStart = myAtomOffset; QTFile_GetAtom(theMovieAtom->fData, theMovieAtom->fSize, &myAtomOffset, &myAtom); myStart = myAtomOffset) {
+		if ((myAtom.fType != kQTFile_UserDataAtom) || hasUserData) {
+			QTFile_AppendData(theBuffer, &myOffset, theMovieAtom->fData + myStart, myAtomOffset - myStart);
+			continue;
+		}
+
+		// copy the user data, all but any chapter list, and add the new chapter list
+		myUserData = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_UserDataAtom);
+
+		myChildOffset = 0;
+		for (myChildStart = myChildOffset; QTFile_GetAtom(myAtom.fData, myAtom.fSize, &myChildOffset, &myChild); myChildStart = myChildOffset)
+			if (myChild.fType != kQTChap_ChapterListAtom)
+				QTFile_AppendData(theBuffer, &myOffset, myAtom.fData + myChildStart, myChildOffset - myChildStart);
+
+		QTChap_AppendChapterList(theBuffer, &myOffset, theList);
+		QTFile_EndAtom(theBuffer, myOffset, myUserData);
+		hasUserData = 1;
+	}
+
+	if (!hasUserData) {
+		myUserData = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_UserDataAtom);
+		QTChap_AppendChapterList(theBuffer, &myOffset, theList);
+		QTFile_EndAtom(theBuffer, myOffset, myUserData);
+	}
+
+	QTFile_EndAtom(theBuffer, myOffset, myMovie);
+
+	return(myOffset);
+}
+
+
+//////////
+//
+// QTChap_BuildTrackMovieAtom
+// Build, in theBuffer, a copy of the specified movie atom with a new chapter track holding the chapters in
+// theList, to which the track with the ID theTrackID refers; return the size of the new movie atom, or 0 if
+// there's no such track.
+//
+// The samples of the new track are at theDataOffset in the file, and have the sizes in theSampleSizes.
+//
+//////////
+
+static long QTChap_BuildTrackMovieAtom (const QTFileAtom *theMovieAtom, const QTChapList *theList, QTFileUInt32 theTrackID, QTFileUInt32 theChapterTrackID, const long *theSampleSizes, QTFileUInt64 theDataOffset, unsigned char *theBuffer)
+{
+	QTFileAtom			myAtom;
+	QTFileAtom			myChild;
+	QTFileAtom			myRefAtom;
+	long				myOffset = 0;
+	long				myStart;
+	long				myChildStart;
+	long				myAtomOffset = 0;
+	long				myChildOffset;
+	long				myMovie;
+	long				myTrack;
+	long				myNextTrackIDOffset;
+	int					foundTrack = 0;
+
+	myMovie = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_MovieAtom);
+
+	for (myStart = myAtomOffset; QTFile_GetAtom(theMovieAtom->fData, theMovieAtom->fSize, &myAtomOffset, &myAtom); myStart = myAtomOffset) {
+		// the movie header gets the next track ID past the new track
+		if ((myAtom.fType == kQTFile_MovieHeaderAtom) && (myAtom.fSize >= 4)) {
+			myNextTrackIDOffset = myOffset + (myAtomOffset - myStart) - myAtom.fSize + ((myAtom.fData[0] == 1) ? kMovieHeaderNextTrackID64 : kMovieHeaderNextTrackID);
+			QTFile_AppendData(theBuffer, &myOffset, theMovieAtom->fData + myStart, myAtomOffset - myStart);
+			if (myNextTrackIDOffset + 4 <= myOffset)
+				QTFile_Put32(theBuffer + myNextTrackIDOffset, theChapterTrackID + 1);
+			continue;
+		}
+
+		if ((myAtom.fType != kQTFile_TrackAtom) || !QTFile_FindChildAtom(&myAtom, kQTFile_TrackHeaderAtom, &myChild) ||
+					(myChild.fSize < 16) || (QTFile_Get32(myChild.fData + ((myChild.fData[0] == 1) ? 20 : 12)) != theTrackID)) {
+			QTFile_AppendData(theBuffer, &myOffset, theMovieAtom->fData + myStart, myAtomOffset - myStart);
+			continue;
+		}
+
+		// copy the referring track, adding a chapter reference to its track references
+		myTrack = QTFile_BeginAtom(theBuffer, &myOffset, kQTFile_TrackAtom);
+
+		myChildOffset = 0;
+		for (myChildStart = myChildOffset; QTFile_GetAtom(myAtom.fData, myAtom.fSize, &myChildOffset, &myChild); myChildStart = myChildOffset) {
+			if (myChild.fType == kQTFile_TrackReferenceAtom) {
+				QTChap_AppendTrackRef(theBuffer, &myOffset, &myChild, theChapterTrackID);
+				continue;
+			}
+
+			QTFile_AppendData(theBuffer, &myOffset, myAtom.fData + myChildStart, myChildOffset - myChildStart);
+
+			if ((myChild.fType == kQTFile_TrackHeaderAtom) && !QTFile_FindChildAtom(&myAtom, kQTFile_TrackReferenceAtom, &myRefAtom))
+				QTChap_AppendTrackRef(theBuffer, &myOffset, NULL, theChapterTrackID);
+		}
+
+		QTFile_EndAtom(theBuffer, myOffset, myTrack);
+		foundTrack = 1;
+	}
+
+	if (!foundTrack)
+		return(0);
+
+	QTChap_AppendChapterTrack(theBuffer, &myOffset, theList, theChapterTrackID, theSampleSizes, theDataOffset);
+	QTFile_EndAtom(theBuffer, myOffset, myMovie);
+
+	return(myOffset);
+}
+
+
+//////////
+//
+// QTChap_AppendChapterList
+// Append a chapter list atom holding the chapters in theList at *theOffset in theBuffer.
+//
+//////////
+
+static void QTChap_AppendChapterList (unsigned char *theBuffer, long *theOffset, const QTChapList *theList)
+{
+	const QTChapEntry	*myEntry;
+	long				myAtom;
+	long				myIndex;
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTChap_ChapterListAtom);
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)kQTChap_ChapterListVersion << 24);
+	QTFile_Append32(theBuffer, theOffset, 0);						// reserved
+	theBuffer[(*theOffset)++] = (unsigned char)theList->fCount;
+
+	for (myIndex = 0; myIndex < theList->fCount; myIndex++) {
+		myEntry = &theList->fEntries[myIndex];
+		QTFile_Append64(theBuffer, theOffset, QTChap_MovieTimeToListTime(myEntry->fStart, theList->fTimeScale));
+		theBuffer[(*theOffset)++] = (unsigned char)myEntry->fLength;
+		QTFile_AppendData(theBuffer, theOffset, myEntry->fTitle, myEntry->fLength);
+	}
+
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+}
+
+
+//////////
+//
+// QTChap_AppendTrackRef
+// Append, at *theOffset in theBuffer, a copy of the specified track reference atom (if any) whose chapter
+// reference refers to the track with the ID theChapterTrackID.
+//
+//////////
+
+static void QTChap_AppendTrackRef (unsigned char *theBuffer, long *theOffset, const QTFileAtom *theRefAtom, QTFileUInt32 theChapterTrackID)
+{
+	QTFileAtom			myChild;
+	long				myRefs;
+	long				myAtom;
+	long				myChildStart;
+	long				myChildOffset = 0;
+
+	myRefs = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_TrackReferenceAtom);
+
+	// any old chapter reference refers to a track that isn't there, or we wouldn't be adding one
+	if (theRefAtom != NULL)
+		for (myChildStart = myChildOffset; QTFile_GetAtom(theRefAtom->fData, theRefAtom->fSize, &myChildOffset, &myChild); myChildStart = myChildOffset)
+			if (myChild.fType != kQTFile_ChapterListReference)
+				QTFile_AppendData(theBuffer, theOffset, theRefAtom->fData + myChildStart, myChildOffset - myChildStart);
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_ChapterListReference);
+	QTFile_Append32(theBuffer, theOffset, theChapterTrackID);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	QTFile_EndAtom(theBuffer, *theOffset, myRefs);
+}
+
+
+//////////
+//
+// QTChap_AppendChapterTrack
+// Append, at *theOffset in theBuffer, a track atom for a chapter track with the ID theChapterTrackID holding
+// the chapters in theList, one sample per chapter; the samples are in a single chunk at theDataOffset in the
+// file, and have the sizes in theSampleSizes.
+//
+//////////
+
+static void QTChap_AppendChapterTrack (unsigned char *theBuffer, long *theOffset, const QTChapList *theList, QTFileUInt32 theChapterTrackID, const long *theSampleSizes, QTFileUInt64 theDataOffset)
+{
+	QTFileTimeValue		myEnd;
+	long				myTrack;
+	long				myMedia;
+	long				myInfo;
+	long				myTable;
+	long				myAtom;
+	long				myIndex;
+
+	myTrack = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_TrackAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_TrackHeaderAtom);
+	QTFile_Append32(theBuffer, theOffset, kTrackInMovie);
+	QTFile_AppendZeros(theBuffer, theOffset, 8);					// creation and modification times
+	QTFile_Append32(theBuffer, theOffset, theChapterTrackID);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)theList->fDuration);
+	QTFile_AppendZeros(theBuffer, theOffset, 8 + 2 + 2 + 2 + 2);	// layer, group, volume
+	QTFile_AppendMatrix(theBuffer, theOffset);
+	QTFile_AppendZeros(theBuffer, theOffset, 8);					// width and height
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	myMedia = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_MediaAtom);
+
+	// the media has the movie's time scale, so the track needs no edit list
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_MediaHeaderAtom);
+	QTFile_AppendZeros(theBuffer, theOffset, 12);
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)theList->fTimeScale);
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)theList->fDuration);
+	QTFile_Append16(theBuffer, theOffset, kUndeterminedLanguage);
+	QTFile_Append16(theBuffer, theOffset, 0);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_HandlerAtom);
+	QTFile_AppendZeros(theBuffer, theOffset, 8);
+	QTFile_Append32(theBuffer, theOffset, kQTFile_TextMediaType);
+	QTFile_AppendZeros(theBuffer, theOffset, 12);
+	QTFile_AppendData(theBuffer, theOffset, "Chapters", 9);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	myInfo = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_MediaInfoAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_NullMediaHeaderAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	// the media data is in the movie file itself
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_DataInfoAtom);
+	QTFile_Append32(theBuffer, theOffset, 28);
+	QTFile_Append32(theBuffer, theOffset, kQTFile_DataReferenceAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_Append32(theBuffer, theOffset, 1);
+	QTFile_Append32(theBuffer, theOffset, 12);
+	QTFile_Append32(theBuffer, theOffset, kQTFile_DataEntryURLAtom);
+	QTFile_Append32(theBuffer, theOffset, kQTFile_SelfReference);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	myTable = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_SampleTableAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_SampleDescriptionAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_Append32(theBuffer, theOffset, 1);
+	QTFile_AppendTextDescription(theBuffer, theOffset, 0, 0);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	// each chapter lasts until the next one starts; the last one lasts until the end of the movie
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_TimeToSampleAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)theList->fCount);
+	for (myIndex = 0; myIndex < theList->fCount; myIndex++) {
+		myEnd = (myIndex + 1 < theList->fCount) ? theList->fEntries[myIndex + 1].fStart : theList->fDuration;
+		QTFile_Append32(theBuffer, theOffset, 1);
+		QTFile_Append32(theBuffer, theOffset, (myEnd > theList->fEntries[myIndex].fStart) ? (QTFileUInt32)(myEnd - theList->fEntries[myIndex].fStart) : 1);
+	}
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_SampleToChunkAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_Append32(theBuffer, theOffset, 1);
+	QTFile_Append32(theBuffer, theOffset, 1);						// first chunk
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)theList->fCount);	// samples per chunk
+	QTFile_Append32(theBuffer, theOffset, 1);						// sample description index
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, kQTFile_SampleSizeAtom);
+	QTFile_AppendZeros(theBuffer, theOffset, 8);					// version, flags and common sample size
+	QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)theList->fCount);
+	for (myIndex = 0; myIndex < theList->fCount; myIndex++)
+		QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)theSampleSizes[myIndex]);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	// the one chunk needs a 64-bit offset if the file is already bigger than 4 GB
+	myAtom = QTFile_BeginAtom(theBuffer, theOffset, (theDataOffset > kMaxUInt32) ? kQTFile_ChunkOffset64Atom : kQTFile_ChunkOffsetAtom);
+	QTFile_Append32(theBuffer, theOffset, 0);
+	QTFile_Append32(theBuffer, theOffset, 1);
+	if (theDataOffset > kMaxUInt32)
+		QTFile_Append64(theBuffer, theOffset, theDataOffset);
+	else
+		QTFile_Append32(theBuffer, theOffset, (QTFileUInt32)theDataOffset);
+	QTFile_EndAtom(theBuffer, *theOffset, myAtom);
+
+	QTFile_EndAtom(theBuffer, *theOffset, myTable);
+	QTFile_EndAtom(theBuffer, *theOffset, myInfo);
+	QTFile_EndAtom(theBuffer, *theOffset, myMedia);
+	QTFile_EndAtom(theBuffer, *theOffset, myTrack);
+}
+
+
+//////////
+//
+// QTChap_GetNextTrackID
+// Return the next track ID recorded in the movie header of the specified movie atom, or 0 if there's none.
+//
+//////////
+
+static QTFileUInt32 QTChap_GetNextTrackID (const QTFileAtom *theMovieAtom)
+{
+	QTFileAtom			myAtom;
+	long				myOffset;
+
+	if (!QTFile_FindChildAtom(theMovieAtom, kQTFile_MovieHeaderAtom, &myAtom) || (myAtom.fSize < 4))
+		return(0);
+
+	myOffset = (myAtom.fData[0] == 1) ? kMovieHeaderNextTrackID64 : kMovieHeaderNextTrackID;
+	if (myOffset + 4 > myAtom.fSize)
+		return(0);
+
+	return(QTFile_Get32(myAtom.fData + myOffset));
+}
+
+
+//////////
+//
+// QTChap_ReadMovieAtom
+// Find the movie atom of the specified file, and the free atoms right after it, and read the movie atom into
+// memory.
+//
+//////////
+
+static long QTChap_ReadMovieAtom (QTChapFileRef theFile, QTChapMovieAtomPtr theMovieAtom)
+{
+	unsigned char		myHeader[kQTFile_ExtendedAtomHeaderSize];
+	QTFileUInt64		myOffset = 0;
+	QTFileUInt64		myAtomSize;
+	QTFileOSType		myType;
+	long				myHeaderSize;
+	long				myErr = kQTFileErr_NoErr;
+
+	memset(theMovieAtom, 0, sizeof(QTChapMovieAtom));
+
+	myErr = QTChap_GetFileSize(theFile, &theMovieAtom->fFileSize);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	// look only at the headers of the top-level atoms, as QTFile_OpenMovie does
+	while (theMovieAtom->fFileSize - myOffset >= kQTFile_AtomHeaderSize) {
+		myHeaderSize = kQTFile_AtomHeaderSize;
+		if (theMovieAtom->fFileSize - myOffset >= kQTFile_ExtendedAtomHeaderSize)
+			myHeaderSize = kQTFile_ExtendedAtomHeaderSize;
+
+		myErr = QTChap_ReadData(theFile, myOffset, myHeader, myHeaderSize);
+		if (myErr != kQTFileErr_NoErr)
+			return(myErr);
+
+		myAtomSize = QTFile_Get32(myHeader);
+		myType = QTFile_Get32(myHeader + 4);
+		if ((myAtomSize == 1) && (myHeaderSize == kQTFile_ExtendedAtomHeaderSize))
+			myAtomSize = QTFile_Get64(myHeader + 8);
+		else if (myAtomSize == 0)
+			myAtomSize = theMovieAtom->fFileSize - myOffset;
+
+		if ((myAtomSize < kQTFile_AtomHeaderSize) || (myAtomSize > theMovieAtom->fFileSize - myOffset))
+			break;
+
+		if (theMovieAtom->fData != NULL) {
+			// count the free atoms right after the movie atom; a movie atom we rewrite in place can grow into them
+			if ((myType != kQTFile_FreeAtom) || (myAtomSize > (QTFileUInt64)(kMaxLong - theMovieAtom->fSize - theMovieAtom->fFreeSize)))
+				break;
+
+			theMovieAtom->fFreeSize += (long)myAtomSize;
+		} else if (myType == kQTFile_MovieAtom) {
+			if (myAtomSize > (QTFileUInt64)kMaxLong)
+				return(kQTFileErr_InvalidMovie);
+
+			theMovieAtom->fOffset = myOffset;
+			theMovieAtom->fSize = (long)myAtomSize;
+			theMovieAtom->fData = (unsigned char *)malloc(theMovieAtom->fSize);
+			if (theMovieAtom->fData == NULL)
+				return(kQTFileErr_MemFull);
+
+			myErr = QTChap_ReadData(theFile, myOffset, theMovieAtom->fData, theMovieAtom->fSize);
+			if (myErr != kQTFileErr_NoErr)
+				return(myErr);
+
+			myHeaderSize = (QTFile_Get32(theMovieAtom->fData) == 1) ? kQTFile_ExtendedAtomHeaderSize : kQTFile_AtomHeaderSize;
+			theMovieAtom->fAtom.fType = kQTFile_MovieAtom;
+			theMovieAtom->fAtom.fData = theMovieAtom->fData + myHeaderSize;
+			theMovieAtom->fAtom.fSize = theMovieAtom->fSize - myHeaderSize;
+		}
+
+		myOffset += myAtomSize;
+	}
+
+	return((theMovieAtom->fData != NULL) ? kQTFileErr_NoErr : kQTFileErr_InvalidMovie);
+}
+
+
+//////////
+//
+// QTChap_WriteMovieAtom
+// Replace the old movie atom of the specified file, whose end is now at theFileSize, with the new one: in the
+// free space right after the old one if it fits, or else at the end of the file followed by enough free space
+// for a copy of it; the old movie atom is freed only once the new one is on the disk.
+//
+//////////
+
+static long QTChap_WriteMovieAtom (QTChapFileRef theFile, const QTChapMovieAtom *theOldAtom, QTFileUInt64 theFileSize, const unsigned char *theNewAtom, long theNewSize, int *wasMoved)
+{
+	QTFileUInt64		myOffset;
+	long				myFreeSize = theOldAtom->fFreeSize;
+	long				myErr = kQTFileErr_NoErr;
+
+	// any space we don't fill has to be big enough to hold the header of a 'free' atom
+	if ((theNewSize == myFreeSize) || (theNewSize + kQTFile_AtomHeaderSize <= myFreeSize)) {
+		myOffset = theOldAtom->fOffset + theOldAtom->fSize;
+		myFreeSize -= theNewSize;
+	} else {
+		myOffset = theFileSize;
+		myFreeSize = theNewSize + kQTChap_MovieAtomPadding;
+		*wasMoved = 1;
+	}
+
+	// cover the space left over after the new movie atom
+	if (myFreeSize > 0)
+		myErr = QTChap_WriteFreeAtom(theFile, myOffset + theNewSize, myFreeSize);
+
+	// write the new movie atom, its header last, so that it doesn't look like a movie atom until it's complete
+	if (myErr == kQTFileErr_NoErr)
+		myErr = QTChap_WriteData(theFile, myOffset + kQTFile_AtomHeaderSize, theNewAtom + kQTFile_AtomHeaderSize, theNewSize - kQTFile_AtomHeaderSize);
+
+	if (myErr == kQTFileErr_NoErr)
+		myErr = QTChap_WriteData(theFile, myOffset, theNewAtom, kQTFile_AtomHeaderSize);
+
+	if (myErr == kQTFileErr_NoErr)
+		myErr = QTChap_FlushFile(theFile);
+
+	// only now that the new movie atom is safely on the disk do we free the old one
+	if (myErr == kQTFileErr_NoErr)
+		myErr = QTChap_WriteFreeAtom(theFile, theOldAtom->fOffset, theOldAtom->fSize);
+
+	if (myErr == kQTFileErr_NoErr)
+		myErr = QTChap_FlushFile(theFile);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTChap_WriteFreeAtom
+// Write a free atom of the specified size (header and all) at the specified offset in the specified file; only
+// the header is written, so whatever is already there becomes the contents of the atom.
+//
+// Past the end of the file, the contents read as zeros.
+//
+//////////
+
+static long QTChap_WriteFreeAtom (QTChapFileRef theFile, QTFileUInt64 theOffset, long theSize)
+{
+	unsigned char		myHeader[kQTFile_AtomHeaderSize];
+	unsigned char		*myData = NULL;
+	QTFileUInt64		myFileSize;
+	long				myErr = kQTFileErr_NoErr;
+
+	QTFile_Put32(myHeader, (QTFileUInt32)theSize);
+	QTFile_Put32(myHeader + 4, kQTFile_FreeAtom);
+
+	myErr = QTChap_GetFileSize(theFile, &myFileSize);
+	if (myErr != kQTFileErr_NoErr)
+		return(myErr);
+
+	if (theOffset + theSize <= myFileSize)
+		return(QTChap_WriteData(theFile, theOffset, myHeader, sizeof(myHeader)));
+
+	// the atom extends the file; write it whole
+	myData = (unsigned char *)calloc(1, theSize);
+	if (myData == NULL)
+		return(kQTFileErr_MemFull);
+
+	memcpy(myData, myHeader, sizeof(myHeader));
+	myErr = QTChap_WriteData(theFile, theOffset, myData, theSize);
+	free(myData);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTChap_OpenFile
+// Open the existing file having the specified path, for reading and writing.
+//
+//////////
+
+static QTChapFileRef QTChap_OpenFile (const char *thePath)
+{
+#if defined(_WIN32)
+	return(CreateFileA(thePath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL));
+#else
+	return(open(thePath, O_RDWR));
+#endif
+}
+
+
+//////////
+//
+// QTChap_CloseFile
+// Close the specified file.
+//
+//////////
+
+static void QTChap_CloseFile (QTChapFileRef theFile)
+{
+#if defined(_WIN32)
+	CloseHandle(theFile);
+#else
+	close(theFile);
+#endif
+}
+
+
+//////////
+//
+// QTChap_GetFileSize
+// Return the size of the specified file.
+//
+//////////
+
+static long QTChap_GetFileSize (QTChapFileRef theFile, QTFileUInt64 *theSize)
+{
+#if defined(_WIN32)
+	DWORD				mySizeHigh = 0;
+	DWORD				mySize;
+
+	mySize = GetFileSize(theFile, &mySizeHigh);
+	if ((mySize == INVALID_FILE_SIZE) && (GetLastError() != NO_ERROR))
+		return(kQTFileErr_IO);
+
+	*theSize = ((QTFileUInt64)mySizeHigh << 32) | mySize;
+#else
+	struct stat			myStat;
+
+	if (fstat(theFile, &myStat) != 0)
+		return(kQTFileErr_IO);
+
+	*theSize = (QTFileUInt64)myStat.st_size;
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTChap_ReadData
+// Read theSize bytes at the specified offset in the specified file.
+//
+//////////
+
+static long QTChap_ReadData (QTChapFileRef theFile, QTFileUInt64 theOffset, void *theData, long theSize)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER		myOffset;
+	DWORD				myCount = 0;
+
+	myOffset.QuadPart = (LONGLONG)theOffset;
+	if (!SetFilePointerEx(theFile, myOffset, NULL, FILE_BEGIN))
+		return(kQTFileErr_IO);
+
+	if (!ReadFile(theFile, theData, (DWORD)theSize, &myCount, NULL) || (myCount != (DWORD)theSize))
+		return(kQTFileErr_IO);
+#else
+	if (pread(theFile, theData, (size_t)theSize, (off_t)theOffset) != (ssize_t)theSize)
+		return(kQTFileErr_IO);
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTChap_WriteData
+// Write theSize bytes at the specified offset in the specified file.
+//
+//////////
+
+static long QTChap_WriteData (QTChapFileRef theFile, QTFileUInt64 theOffset, const void *theData, long theSize)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER		myOffset;
+	DWORD				myCount = 0;
+
+	myOffset.QuadPart = (LONGLONG)theOffset;
+	if (!SetFilePointerEx(theFile, myOffset, NULL, FILE_BEGIN))
+		return(kQTFileErr_IO);
+
+	if (!WriteFile(theFile, theData, (DWORD)theSize, &myCount, NULL) || (myCount != (DWORD)theSize))
+		return(kQTFileErr_IO);
+#else
+	const char			*myData = (const char *)theData;
+	ssize_t				myCount;
+
+	while (theSize > 0) {
+		myCount = pwrite(theFile, myData, (size_t)theSize, (off_t)theOffset);
+		if (myCount < 0) {
+			if (errno == EINTR)
+				continue;
+			return(kQTFileErr_IO);
+		}
+
+		myData += myCount;
+		theOffset += (QTFileUInt64)myCount;
+		theSize -= (long)myCount;
+	}
+#endif
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTChap_FlushFile
+// Make sure that everything written to the specified file is on the disk.
+//
+//////////
+
+static long QTChap_FlushFile (QTChapFileRef theFile)
+{
+#if defined(_WIN32)
+	return(FlushFileBuffers(theFile) ? kQTFileErr_NoErr : kQTFileErr_IO);
+#else
+	return((fsync(theFile) == 0) ? kQTFileErr_NoErr : kQTFileErr_IO);
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Thread utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTChap_ThreadEntry
+// The entry point of a worker thread.
+//
+//////////
+
+#if defined(_WIN32)
+static DWORD WINAPI QTChap_ThreadEntry (LPVOID theWorker)
+#else
+static void *QTChap_ThreadEntry (void *theWorker)
+#endif
+{
+	QTChap_RunWorker((QTChapWorkerPtr)theWorker);
+	return(0);
+}
+
+
+//////////
+//
+// QTChap_StartThread
+// Start the thread of the specified worker; return 0 if we can't.
+//
+//////////
+
+static int QTChap_StartThread (QTChapWorkerPtr theWorker)
+{
+#if defined(_WIN32)
+	theWorker->fThread = CreateThread(NULL, 0, QTChap_ThreadEntry, theWorker, 0, NULL);
+	return(theWorker->fThread != NULL);
+#else
+	return(pthread_create(&theWorker->fThread, NULL, QTChap_ThreadEntry, theWorker) == 0);
+#endif
+}
+
+
+//////////
+//
+// QTChap_WaitThread
+// Wait for the specified thread to finish.
+//
+//////////
+
+static void QTChap_WaitThread (QTChapThread theThread)
+{
+#if defined(_WIN32)
+	WaitForSingleObject(theThread, INFINITE);
+	CloseHandle(theThread);
+#else
+	pthread_join(theThread, NULL);
+#endif
+}
+
+
+//////////
+//
+// QTChap_InitLock
+// Initialize the specified lock.
+//
+//////////
+
+static void QTChap_InitLock (QTChapLock *theLock)
+{
+#if defined(_WIN32)
+	InitializeCriticalSection(theLock);
+#else
+	pthread_mutex_init(theLock, NULL);
+#endif
+}
+
+
+//////////
+//
+// QTChap_DisposeLock
+// Dispose of the specified lock.
+//
+//////////
+
+static void QTChap_DisposeLock (QTChapLock *theLock)
+{
+#if defined(_WIN32)
+	DeleteCriticalSection(theLock);
+#else
+	pthread_mutex_destroy(theLock);
+#endif
+}
+
+
+//////////
+//
+// QTChap_Lock
+// Acquire the specified lock.
+//
+//////////
+
+static void QTChap_Lock (QTChapLock *theLock)
+{
+#if defined(_WIN32)
+	EnterCriticalSection(theLock);
+#else
+	pthread_mutex_lock(theLock);
+#endif
+}
+
+
+//////////
+//
+// QTChap_Unlock
+// Release the specified lock.
+//
+//////////
+
+static void QTChap_Unlock (QTChapLock *theLock)
+{
+#if defined(_WIN32)
+	LeaveCriticalSection(theLock);
+#else
+	pthread_mutex_unlock(theLock);
+#endif
+}
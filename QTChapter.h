@@ -0,0 +1,81 @@
+//////////
+//
+//	File:		QTChapter.h
+//
+//	Contains:	Converting between QuickTime chapter tracks and Nero chapter lists ('chpl' atoms) in movie files.
+//				All utilities start with the prefix "QTChap_".
+//
+//	Written by:	QuickTime Team
+//
+//////////
+
+#pragma once
+
+#ifndef __QTChapter__
+#define __QTChapter__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#ifndef __QTTextFile__
+#include "QTTextFile.h"
+#endif
+
+#ifndef __QTFileWrite__
+#include "QTFileWrite.h"
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kQTChap_ChapterListAtom			QTFILE_FOURCC('c','h','p','l')	// a Nero chapter list, in the movie's user data
+#define kQTChap_ChapterListVersion		1				// the version of the chapter lists we write
+#define kQTChap_TimeScale				10000000		// chapter list times are in units of 100 nanoseconds
+#define kQTChap_MaxChapters				255				// the most chapters a chapter list can hold
+#define kQTChap_MaxTitleLength			255				// the longest chapter title (in bytes of UTF-8) it can hold
+#define kQTChap_MovieAtomPadding		(16L * 1024L)	// free space (beyond room for a copy of it) left after a movie atom moved to the end of the file
+#define kQTChap_MaxThreads				64				// the most worker threads a directory conversion runs
+
+// the direction of a conversion
+enum {
+	kQTChap_TrackToList				= 1,			// from the movie's chapter track to a chapter list
+	kQTChap_ListToTrack				= 2				// from the movie's chapter list to a new chapter track
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// the results of converting the movie files in a directory tree
+typedef struct QTChapStats {
+	long							fMovieCount;	// the number of movie files found in the directory tree
+	long							fConvertedCount;// the number of them converted
+	long							fSkippedCount;	// the number of them that had nothing to convert
+	long							fFailedCount;	// the number of them that couldn't be converted
+	long							fMovedCount;	// the number of converted movies whose movie atom was moved to the end of the file
+	long							fChapterCount;	// the number of chapters converted
+	long							fThreadCount;	// the number of worker threads
+} QTChapStats, *QTChapStatsPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+long						QTChap_ConvertMovieFile (const char *thePath, long theDirection, QTTextCachePtr theCache, long *theChapterCount, int *wasMoved);
+long						QTChap_ConvertDirectory (const char *theDirPath, long theDirection, long theThreadCount, QTChapStatsPtr theStats);
+
+#endif	// __QTChapter__
@@ -0,0 +1,100 @@
+//////////
+//
+//	File:		QTChapterTool.c
+//
+//	Contains:	A command-line tool that converts the chapters of a library of movie files between QuickTime chapter
+//				tracks and Nero chapter lists.
+//
+//	Written by:	QuickTime Team
+//
+//	Usage:		qtchapter [-j threads] -list|-track directory
+//
+//	With -list, each movie that has a chapter track is given a chapter list ('chpl' atom) with the same chapters;
+//	with -track, each movie that has a chapter list but no chapter track is given a chapter track. The movie
+//	files are changed in place; see QTChapter.c.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTChapter.h"
+
+#include <stdio.h>
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTChapTool_ShowUsage (const char *theToolName);
+
+
+//////////
+//
+// main
+// Parse the command line and convert the movies.
+//
+//////////
+
+int main (int argc, char *argv[])
+{
+	QTChapStats			myStats;
+	long				myThreadCount = 0;
+	long				myDirection = 0;
+	int					myIndex = 1;
+	long				myErr = kQTFileErr_NoErr;
+
+	for (; (myIndex < argc) && (argv[myIndex][0] == '-'); myIndex++) {
+		if ((strcmp(argv[myIndex], "-j") == 0) && (myIndex + 1 < argc)) {
+			myThreadCount = atol(argv[++myIndex]);
+		} else if (strcmp(argv[myIndex], "-list") == 0) {
+			myDirection = kQTChap_TrackToList;
+		} else if (strcmp(argv[myIndex], "-track") == 0) {
+			myDirection = kQTChap_ListToTrack;
+		} else {
+			QTChapTool_ShowUsage(argv[0]);
+			return(1);
+		}
+	}
+
+	if ((argc - myIndex != 1) || (myDirection == 0)) {
+		QTChapTool_ShowUsage(argv[0]);
+		return(1);
+	}
+
+	myErr = QTChap_ConvertDirectory(argv[myIndex], myDirection, myThreadCount, &myStats);
+	if (myErr != kQTFileErr_NoErr) {
+		fprintf(stderr, "%s: couldn't convert %s (error %ld)\n", argv[0], argv[myIndex], myErr);
+		return(1);
+	}
+
+	fprintf(stderr, "%ld of %ld movies converted (%ld skipped, %ld failed, %ld moved), %ld chapters, %ld threads\n",
+				myStats.fConvertedCount,
+				myStats.fMovieCount,
+				myStats.fSkippedCount,
+				myStats.fFailedCount,
+				myStats.fMovedCount,
+				myStats.fChapterCount,
+				myStats.fThreadCount);
+
+	return((myStats.fFailedCount > 0) ? 1 : 0);
+}
+
+
+//////////
+//
+// QTChapTool_ShowUsage
+// Show how to use the tool on the standard error stream.
+//
+//////////
+
+static void QTChapTool_ShowUsage (const char *theToolName)
+{
+	fprintf(stderr, "usage: %s [-j threads] -list|-track directory\n", theToolName);
+}
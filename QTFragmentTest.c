@@ -0,0 +1,221 @@
+//////////
+//
+//	File:		QTFragmentTest.c
+//
+//	Contains:	A test of the fragmented movie writer in QTFileWrite.c.
+//
+//	Written by:	QuickTime Team
+//
+//	Usage:		qtfragmenttest
+//
+//	We write a fragmented movie with a known set of text samples into memory, and then read it back atom by atom,
+//	checking that each fragment's 'tfdt' time is the sum of the durations before it, that its 'trun' durations
+//	and sizes are those of its samples, and that its data offset picks out exactly its samples in the 'mdat'
+//	atom that follows. The test prints what went wrong, and exits with a status of 1, if any check fails.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTFileWrite.h"
+
+#include <stdio.h>
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kTestTimeScale					1000			// time scale of the text media
+#define kTestFragmentDuration			2000			// duration of a fragment
+#define kTestSampleCount				9				// the number of samples written
+#define kTestBufferSize					(16L * 1024L)	// room for the whole movie
+
+
+//////////
+//
+// types
+//
+//////////
+
+// the movie written by the test
+typedef struct QTTestBuffer {
+	unsigned char					fData[kTestBufferSize];
+	long							fSize;
+} QTTestBuffer, *QTTestBufferPtr;
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+static const char *gTestText[kTestSampleCount] = {"one", "two", "", "three", "four", "a longer caption, to vary the sizes", "six", "", "seven"};
+static const long gTestDurations[kTestSampleCount] = {500, 700, 900, 1000, 1200, 300, 2500, 100, 400};
+static long gFailedCount = 0;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static long					QTTest_WriteProc (void *theRefCon, const unsigned char *theData, long theSize);
+static void					QTTest_Check (int isTrue, const char *theWhat, long theFragment);
+
+
+//////////
+//
+// main
+// Write the test movie and check its fragments.
+//
+//////////
+
+int main (void)
+{
+	QTFileFragmentWriter	myWriter;
+	QTTestBuffer			myBuffer;
+	QTFileAtom				myAtom;
+	QTFileAtom				myTrackFragment;
+	QTFileAtom				myChild;
+	unsigned char			mySample[256];
+	QTFileUInt64			myTime = 0;
+	long					myOffset = 0;
+	long					myMovieFragment;
+	long					myFragment = 0;
+	long					mySampleIndex = 0;
+	long					myIndex;
+	long					myErr = kQTFileErr_NoErr;
+
+	myBuffer.fSize = 0;
+
+	myErr = QTFile_BeginFragmentWriter(&myWriter, QTTest_WriteProc, &myBuffer, kTestTimeScale, kTestFragmentDuration, 320, 40);
+	for (myIndex = 0; (myIndex < kTestSampleCount) && (myErr == kQTFileErr_NoErr); myIndex++)
+		myErr = QTFile_WriteFragmentSample(&myWriter, gTestText[myIndex], (long)strlen(gTestText[myIndex]), gTestDurations[myIndex]);
+
+	if (myErr == kQTFileErr_NoErr)
+		myErr = QTFile_EndFragmentWriter(&myWriter);
+
+	if (myErr != kQTFileErr_NoErr) {
+		fprintf(stderr, "couldn't write the movie (error %ld)\n", myErr);
+		return(1);
+	}
+
+	// the movie starts with its 'ftyp' and 'moov' atoms
+	QTTest_Check(QTFile_GetAtom(myBuffer.fData, myBuffer.fSize, &myOffset, &myAtom) && (myAtom.fType == kQTFile_FileTypeAtom), "'ftyp' atom", 0);
+	QTTest_Check(QTFile_GetAtom(myBuffer.fData, myBuffer.fSize, &myOffset, &myAtom) && (myAtom.fType == kQTFile_MovieAtom), "'moov' atom", 0);
+	QTTest_Check(QTFile_FindChildAtom(&myAtom, kQTFile_MovieExtendsAtom, &myChild), "'mvex' atom", 0);
+
+	// then come the fragments, each a 'moof' atom followed by an 'mdat' atom
+	myMovieFragment = myOffset;
+	while (QTFile_GetAtom(myBuffer.fData, myBuffer.fSize, &myOffset, &myAtom)) {
+		const unsigned char		*myRun;
+		const unsigned char		*myData;
+		QTFileAtom				myDataAtom;
+		QTFileUInt64			myStartTime = myTime;
+		long					myCount;
+		long					myDataOffset;
+
+		myFragment++;
+		QTTest_Check(myAtom.fType == kQTFile_MovieFragmentAtom, "'moof' atom", myFragment);
+		if (myAtom.fType != kQTFile_MovieFragmentAtom)
+			break;
+
+		QTTest_Check(QTFile_FindChildAtom(&myAtom, kQTFile_MovieFragmentHeaderAtom, &myChild) && (QTFile_Get32(myChild.fData + 4) == (QTFileUInt32)myFragment), "'mfhd' sequence number", myFragment);
+		QTTest_Check(QTFile_FindChildAtom(&myAtom, kQTFile_TrackFragmentAtom, &myTrackFragment), "'traf' atom", myFragment);
+		QTTest_Check(QTFile_FindChildAtom(&myTrackFragment, kQTFile_TrackFragmentHeaderAtom, &myChild) && (QTFile_Get32(myChild.fData + 4) == 1), "'tfhd' track ID", myFragment);
+
+		// the fragment starts where the samples before it end
+		QTTest_Check(QTFile_FindChildAtom(&myTrackFragment, kQTFile_TrackFragmentTimeAtom, &myChild) && (myChild.fData[0] == 1) && (QTFile_Get64(myChild.fData + 4) == myTime), "'tfdt' time", myFragment);
+
+		if (!QTFile_FindChildAtom(&myTrackFragment, kQTFile_TrackRunAtom, &myChild)) {
+			QTTest_Check(0, "'trun' atom", myFragment);
+			break;
+		}
+
+		myCount = (long)QTFile_Get32(myChild.fData + 4);
+		myDataOffset = (long)QTFile_Get32(myChild.fData + 8);
+		myRun = myChild.fData + 12;
+
+		// the data offset is relative to the 'moof' atom, and must point just past the header of the next atom,
+		// which must be the 'mdat' atom holding the fragment's samples
+		QTTest_Check(myDataOffset == (myOffset - myMovieFragment) + kQTFile_AtomHeaderSize, "'trun' data offset", myFragment);
+		QTTest_Check(QTFile_GetAtom(myBuffer.fData, myBuffer.fSize, &myOffset, &myDataAtom) && (myDataAtom.fType == kQTFile_MovieDataAtom), "'mdat' atom", myFragment);
+		QTTest_Check((myCount > 0) && (mySampleIndex + myCount <= kTestSampleCount), "'trun' sample count", myFragment);
+		if ((myDataAtom.fType != kQTFile_MovieDataAtom) || (myCount <= 0) || (mySampleIndex + myCount > kTestSampleCount))
+			break;
+
+		myData = myBuffer.fData + myMovieFragment + myDataOffset;
+		for (myIndex = 0; myIndex < myCount; myIndex++, mySampleIndex++) {
+			long		mySize = QTFile_PutTextSample(mySample, gTestText[mySampleIndex], (long)strlen(gTestText[mySampleIndex]));
+
+			QTTest_Check(QTFile_Get32(myRun + (myIndex * 8)) == (QTFileUInt32)gTestDurations[mySampleIndex], "'trun' sample duration", myFragment);
+			QTTest_Check(QTFile_Get32(myRun + (myIndex * 8) + 4) == (QTFileUInt32)mySize, "'trun' sample size", myFragment);
+			QTTest_Check((myData + mySize <= myBuffer.fData + myBuffer.fSize) && (memcmp(myData, mySample, mySize) == 0), "sample data", myFragment);
+
+			myData += mySize;
+			myTime += gTestDurations[mySampleIndex];
+		}
+
+		QTTest_Check(myData == myDataAtom.fData + myDataAtom.fSize, "'mdat' size", myFragment);
+
+		// every fragment but the last is at least kTestFragmentDuration long
+		QTTest_Check((myOffset == myBuffer.fSize) || (myTime - myStartTime >= kTestFragmentDuration), "fragment duration", myFragment);
+
+		myMovieFragment = myOffset;
+	}
+
+	QTTest_Check(mySampleIndex == kTestSampleCount, "number of samples", myFragment);
+	QTTest_Check(myFragment == myWriter.fFragmentCount, "number of fragments", myFragment);
+	QTTest_Check(myOffset == myBuffer.fSize, "end of the movie", myFragment);
+
+	fprintf(stderr, "%ld fragments, %ld samples, %ld checks failed\n", myFragment, mySampleIndex, gFailedCount);
+
+	return((gFailedCount > 0) ? 1 : 0);
+}
+
+
+//////////
+//
+// QTTest_WriteProc
+// Append the specified data to the buffer passed in theRefCon.
+//
+//////////
+
+static long QTTest_WriteProc (void *theRefCon, const unsigned char *theData, long theSize)
+{
+	QTTestBufferPtr		myBuffer = (QTTestBufferPtr)theRefCon;
+
+	if (myBuffer->fSize + theSize > kTestBufferSize)
+		return(kQTFileErr_MemFull);
+
+	memcpy(myBuffer->fData + myBuffer->fSize, theData, theSize);
+	myBuffer->fSize += theSize;
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTTest_Check
+// Note a failed check on the standard error stream.
+//
+//////////
+
+static void QTTest_Check (int isTrue, const char *theWhat, long theFragment)
+{
+	if (isTrue)
+		return;
+
+	fprintf(stderr, "fragment %ld: bad %s\n", theFragment, theWhat);
+	gFailedCount++;
+}
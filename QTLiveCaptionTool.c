@@ -0,0 +1,219 @@
+//////////
+//
+//	File:		QTLiveCaptionTool.c
+//
+//	Contains:	A command-line tool that turns caption text arriving on the standard input into a fragmented movie.
+//
+//	Written by:	QuickTime Team
+//
+//	Usage:		qtlivecaption [-f fragment-seconds] [-d caption-milliseconds] movie-file
+//
+//	Each line read from the standard input becomes one caption of the text track of a fragmented movie, which
+//	is written to movie-file (or to the standard output, if movie-file is "-"). A caption lasts until the next
+//	line arrives, or for the specified number of milliseconds; an empty line clears the screen. The file is
+//	flushed after every fragment, so a player reading it falls behind by at most one fragment; see note (5) in
+//	QTFileWrite.c.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTFileWrite.h"
+
+#include <stdio.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kCaptionTimeScale				1000			// time scale of the text media: the durations are in milliseconds
+#define kCaptionWidth					320				// size of the text box
+#define kCaptionHeight					40
+#define kMaxCaptionLength				1024			// longest line we read as a single caption
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static long					QTCaptionTool_WriteProc (void *theRefCon, const unsigned char *theData, long theSize);
+static long					QTCaptionTool_StripLine (char *theLine);
+static unsigned long		QTCaptionTool_GetMilliseconds (void);
+static void					QTCaptionTool_ShowUsage (const char *theToolName);
+
+
+//////////
+//
+// main
+// Parse the command line and write the captions.
+//
+//////////
+
+int main (int argc, char *argv[])
+{
+	QTFileFragmentWriter	myWriter;
+	FILE					*myFile = NULL;
+	char					myCaption[kMaxCaptionLength];
+	char					myLine[kMaxCaptionLength];
+	long					myLength = 0;
+	long					myFragmentSeconds = kQTFile_DefaultFragmentSeconds;
+	long					myCaptionDuration = 0;
+	unsigned long			myCaptionTime = 0;
+	unsigned long			myTime;
+	int						hasCaption = 0;
+	int						myIndex = 1;
+	long					myErr = kQTFileErr_NoErr;
+
+	for (; (myIndex + 1 < argc) && (argv[myIndex][0] == '-') && (argv[myIndex][1] != '\0'); myIndex += 2) {
+		if (strcmp(argv[myIndex], "-f") == 0) {
+			myFragmentSeconds = atol(argv[myIndex + 1]);
+		} else if (strcmp(argv[myIndex], "-d") == 0) {
+			myCaptionDuration = atol(argv[myIndex + 1]);
+		} else {
+			QTCaptionTool_ShowUsage(argv[0]);
+			return(1);
+		}
+	}
+
+	if ((argc - myIndex != 1) || (myFragmentSeconds <= 0) || (myCaptionDuration < 0)) {
+		QTCaptionTool_ShowUsage(argv[0]);
+		return(1);
+	}
+
+	if (strcmp(argv[myIndex], "-") == 0)
+		myFile = stdout;
+	else
+		myFile = fopen(argv[myIndex], "wb");
+
+	if (myFile == NULL) {
+		fprintf(stderr, "%s: couldn't create %s\n", argv[0], argv[myIndex]);
+		return(1);
+	}
+
+	myErr = QTFile_BeginFragmentWriter(&myWriter, QTCaptionTool_WriteProc, myFile, kCaptionTimeScale, myFragmentSeconds * kCaptionTimeScale, kCaptionWidth, kCaptionHeight);
+
+	// a caption is written once we know how long it lasts: when the next line arrives, unless it has a fixed duration
+	while ((myErr == kQTFileErr_NoErr) && (fgets(myLine, sizeof(myLine), stdin) != NULL)) {
+		myTime = QTCaptionTool_GetMilliseconds();
+
+		if (hasCaption)
+			myErr = QTFile_WriteFragmentSample(&myWriter, myCaption, myLength, (long)(myTime - myCaptionTime));
+
+		myLength = QTCaptionTool_StripLine(myLine);
+		memcpy(myCaption, myLine, myLength);
+		myCaptionTime = myTime;
+		hasCaption = 1;
+
+		if ((myErr == kQTFileErr_NoErr) && (myCaptionDuration > 0)) {
+			myErr = QTFile_WriteFragmentSample(&myWriter, myCaption, myLength, myCaptionDuration);
+			hasCaption = 0;
+		}
+	}
+
+	// the last caption lasts until the input ends
+	if ((myErr == kQTFileErr_NoErr) && hasCaption)
+		myErr = QTFile_WriteFragmentSample(&myWriter, myCaption, myLength, (long)(QTCaptionTool_GetMilliseconds() - myCaptionTime));
+
+	if (QTFile_EndFragmentWriter(&myWriter) != kQTFileErr_NoErr)
+		myErr = myWriter.fError;
+
+	if ((myFile != stdout) && (fclose(myFile) != 0) && (myErr == kQTFileErr_NoErr))
+		myErr = kQTFileErr_IO;
+
+	if (myErr != kQTFileErr_NoErr) {
+		fprintf(stderr, "%s: couldn't write %s (error %ld)\n", argv[0], argv[myIndex], myErr);
+		return(1);
+	}
+
+	fprintf(stderr, "%ld fragments, %.0f bytes\n", myWriter.fFragmentCount, (double)(QTFileInt64)myWriter.fBytesWritten);
+
+	return(0);
+}
+
+
+//////////
+//
+// QTCaptionTool_WriteProc
+// Write the specified data to the file passed in theRefCon, and flush the file, so that a player reading it sees
+// each fragment as soon as the fragment writer has handed it over.
+//
+//////////
+
+static long QTCaptionTool_WriteProc (void *theRefCon, const unsigned char *theData, long theSize)
+{
+	FILE				*myFile = (FILE *)theRefCon;
+
+	if (fwrite(theData, 1, theSize, myFile) != (size_t)theSize)
+		return(kQTFileErr_IO);
+
+	if (fflush(myFile) != 0)
+		return(kQTFileErr_IO);
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTCaptionTool_StripLine
+// Remove the line ending from the specified line, and return its length.
+//
+//////////
+
+static long QTCaptionTool_StripLine (char *theLine)
+{
+	long				myLength = (long)strlen(theLine);
+
+	while ((myLength > 0) && ((theLine[myLength - 1] == '\n') || (theLine[myLength - 1] == '\r')))
+		theLine[--myLength] = '\0';
+
+	return(myLength);
+}
+
+
+//////////
+//
+// QTCaptionTool_GetMilliseconds
+// Return the number of milliseconds since some fixed time.
+//
+//////////
+
+static unsigned long QTCaptionTool_GetMilliseconds (void)
+{
+#if defined(_WIN32)
+	return((unsigned long)GetTickCount());
+#else
+	struct timespec		myTime;
+
+	clock_gettime(CLOCK_MONOTONIC, &myTime);
+	return((unsigned long)((myTime.tv_sec * 1000) + (myTime.tv_nsec / 1000000)));
+#endif
+}
+
+
+//////////
+//
+// QTCaptionTool_ShowUsage
+// Show how to use the tool on the standard error stream.
+//
+//////////
+
+static void QTCaptionTool_ShowUsage (const char *theToolName)
+{
+	fprintf(stderr, "usage: %s [-f fragment-seconds] [-d caption-milliseconds] movie-file\n", theToolName);
+}
@@ -0,0 +1,1165 @@
+//////////
+//
+//	File:		QTSubtitle.c
+//
+//	Contains:	Reading and writing subtitle files (SRT, WebVTT and TTML).
+//				All utilities start with the prefix "QTSub_".
+//
+//	Written by:	QuickTime Team
+//
+//	This file contains no QuickTime or Toolbox calls; the caller supplies the procedures that read and write
+//	the data, so the same code can work with a File Manager file, a POSIX file descriptor, or memory.
+//
+// NOTES:
+//
+// *** (1) ***
+// All text is UTF-8 (see QTTextEncoding.c) and all times are in milliseconds.
+//
+// *** (2) ***
+// A cue can't contain an empty line in either format (an empty line ends the cue), so we drop empty lines from
+// the cue text; we also turn the Mac line ending (CR) used in text media samples into LF. WebVTT cue text is
+// markup, so we escape the characters '&', '<' and '>'. Cues with no text at all are skipped.
+//
+// *** (3) ***
+// When reading, we don't try to be a validating parser. SRT and WebVTT are read a line at a time: any line
+// containing "-->" that parses as a timing line starts a cue, and the cue's text runs to the next empty line;
+// everything else (cue numbers and identifiers, the WebVTT header, NOTE and STYLE blocks) is ignored. TTML
+// is read a character at a time: each <p> element is a cue, <br/> is a line break, and all other markup is
+// ignored. Markup in the cue text is removed, and (for WebVTT and TTML) character references are decoded.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSubtitle.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kWebVTTHeader					"WEBVTT\n\n"
+#define kWebVTTSignature				"WEBVTT"
+#define kCueArrow						" --> "
+#define kTimingArrow					"-->"
+#define kEndOfData						-1
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTSub_Put (QTSubWriterPtr theWriter, const char *theData, long theSize);
+static void					QTSub_Flush (QTSubWriterPtr theWriter);
+static long					QTSub_FormatNumber (long theNumber, char *theDst);
+static int					QTSub_GetChar (QTSubReaderPtr theReader);
+static int					QTSub_PeekChar (QTSubReaderPtr theReader);
+static long					QTSub_ReadLine (QTSubReaderPtr theReader);
+static long					QTSub_ReadLineCue (QTSubReaderPtr theReader, QTSubCuePtr theCue);
+static long					QTSub_ReadTTMLCue (QTSubReaderPtr theReader, QTSubCuePtr theCue);
+static long					QTSub_ReadTag (QTSubReaderPtr theReader);
+static int					QTSub_IsTag (const char *theTag, const char *theName, int isEndTag);
+static int					QTSub_GetAttribute (const char *theTag, const char *theName, char *theValue, long theValueSize);
+static int					QTSub_ParseTiming (const char *theLine, long *theStartMS, long *theEndMS);
+static int					QTSub_ParseClockTime (const char **theText, long *theMS);
+static int					QTSub_ParseTTMLTime (QTSubReaderPtr theReader, const char *theText, long *theMS);
+static void					QTSub_AppendText (QTSubReaderPtr theReader, const char *theText, long theLength, int isMarkup);
+static void					QTSub_AppendBytes (QTSubReaderPtr theReader, const char *theText, long theLength);
+static void					QTSub_TrimText (QTSubReaderPtr theReader);
+static long					QTSub_DecodeEntity (const char *theText, long theLength, char *theDst);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Subtitle writing.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSub_BeginWriter
+// Prepare the specified subtitle writer to write a file in the specified format.
+//
+//////////
+
+long QTSub_BeginWriter (QTSubWriterPtr theWriter, long theFormat, QTSubWriteProcPtr theWriteProc, void *theRefCon)
+{
+	if ((theWriter == NULL) || (theWriteProc == NULL))
+		return(-1);
+
+	if ((theFormat != kQTSub_FormatSRT) && (theFormat != kQTSub_FormatWebVTT))
+		return(-1);
+
+	theWriter->fFormat = theFormat;
+	theWriter->fWriteProc = theWriteProc;
+	theWriter->fRefCon = theRefCon;
+	theWriter->fError = 0;
+	theWriter->fCueCount = 0;
+	theWriter->fBytesWritten = 0;
+	theWriter->fCount = 0;
+
+	if (theFormat == kQTSub_FormatWebVTT)
+		QTSub_Put(theWriter, kWebVTTHeader, sizeof(kWebVTTHeader) - 1);
+
+	return(theWriter->fError);
+}
+
+
+//////////
+//
+// QTSub_WriteCue
+// Write a cue with the specified start and end times and the specified (UTF-8) text.
+//
+//////////
+
+long QTSub_WriteCue (QTSubWriterPtr theWriter, long theStartMS, long theEndMS, const char *theText, long theLength)
+{
+	char			myLine[64];
+	long			mySize = 0;
+	long			myStart = 0;
+	long			myIndex = 0;
+	long			myRun = 0;
+	int				hasText = 0;
+	int				isLineStart = 1;
+
+	if (theWriter == NULL)
+		return(-1);
+
+	if (theWriter->fError != 0)
+		return(theWriter->fError);
+
+	// skip the cue if it has nothing but line endings and spaces in it
+	for (myIndex = 0; myIndex < theLength; myIndex++)
+		if ((theText[myIndex] != '\r') && (theText[myIndex] != '\n') && (theText[myIndex] != ' ')) {
+			hasText = 1;
+			break;
+		}
+
+	if (!hasText)
+		return(0);
+
+	if (theEndMS < theStartMS)
+		theEndMS = theStartMS;
+
+	theWriter->fCueCount++;
+
+	// write the cue number (SRT only; it's optional in WebVTT) and the timing line
+	if (theWriter->fFormat == kQTSub_FormatSRT) {
+		mySize = QTSub_FormatNumber(theWriter->fCueCount, myLine);
+		myLine[mySize++] = '\n';
+	}
+
+	mySize += QTSub_FormatTimeStamp(theWriter->fFormat, theStartMS, myLine + mySize);
+	memcpy(myLine + mySize, kCueArrow, sizeof(kCueArrow) - 1);
+	mySize += sizeof(kCueArrow) - 1;
+	mySize += QTSub_FormatTimeStamp(theWriter->fFormat, theEndMS, myLine + mySize);
+	myLine[mySize++] = '\n';
+	QTSub_Put(theWriter, myLine, mySize);
+
+	// write the text, a run of ordinary characters at a time
+	myStart = 0;
+	for (myIndex = 0; myIndex <= theLength; myIndex++) {
+		char		myChar = (myIndex < theLength) ? theText[myIndex] : '\n';
+		const char	*myEscape = NULL;
+
+		if ((myChar != '\r') && (myChar != '\n')) {
+			if (theWriter->fFormat == kQTSub_FormatWebVTT) {
+				if (myChar == '&')
+					myEscape = "&amp;";
+				else if (myChar == '<')
+					myEscape = "&lt;";
+				else if (myChar == '>')
+					myEscape = "&gt;";
+			}
+
+			if (myEscape == NULL) {
+				isLineStart = 0;
+				continue;
+			}
+		}
+
+		// flush the run of ordinary characters before this one
+		myRun = myIndex - myStart;
+		if (myRun > 0)
+			QTSub_Put(theWriter, theText + myStart, myRun);
+		myStart = myIndex + 1;
+
+		if (myEscape != NULL) {
+			QTSub_Put(theWriter, myEscape, (long)strlen(myEscape));
+			isLineStart = 0;
+		} else if (!isLineStart) {
+			// end a non-empty line; empty lines are dropped
+			QTSub_Put(theWriter, "\n", 1);
+			isLineStart = 1;
+		}
+	}
+
+	// an empty line ends the cue
+	QTSub_Put(theWriter, "\n", 1);
+
+	return(theWriter->fError);
+}
+
+
+//////////
+//
+// QTSub_EndWriter
+// Write out anything remaining in the buffer of the specified subtitle writer.
+//
+//////////
+
+long QTSub_EndWriter (QTSubWriterPtr theWriter)
+{
+	if (theWriter == NULL)
+		return(-1);
+
+	QTSub_Flush(theWriter);
+	return(theWriter->fError);
+}
+
+
+//////////
+//
+// QTSub_FormatTimeStamp
+// Format the specified time as a time stamp of the specified format; return the length of the time stamp.
+//
+// The time stamp is "HH:MM:SS,mmm" for SRT and "HH:MM:SS.mmm" for WebVTT. The destination buffer must have
+// room for at least kQTSub_TimeStampSize characters (more, if the time is 100 hours or longer); the time stamp
+// is NOT null-terminated.
+//
+//////////
+
+long QTSub_FormatTimeStamp (long theFormat, long theMS, char *theDst)
+{
+	long			myHours;
+	long			myLength;
+
+	if (theMS < 0)
+		theMS = 0;
+
+	myHours = theMS / 3600000L;
+	if (myHours < 10) {
+		theDst[0] = '0';
+		myLength = 1 + QTSub_FormatNumber(myHours, theDst + 1);
+	} else {
+		myLength = QTSub_FormatNumber(myHours, theDst);
+	}
+
+	theDst += myLength;
+	theDst[0] = ':';
+	theDst[1] = (char)('0' + ((theMS / 600000L) % 6));
+	theDst[2] = (char)('0' + ((theMS / 60000L) % 10));
+	theDst[3] = ':';
+	theDst[4] = (char)('0' + ((theMS / 10000L) % 6));
+	theDst[5] = (char)('0' + ((theMS / 1000L) % 10));
+	theDst[6] = (theFormat == kQTSub_FormatSRT) ? ',' : '.';
+	theDst[7] = (char)('0' + ((theMS / 100L) % 10));
+	theDst[8] = (char)('0' + ((theMS / 10L) % 10));
+	theDst[9] = (char)('0' + (theMS % 10));
+
+	return(myLength + 10);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Subtitle reading.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSub_BeginReader
+// Prepare the specified subtitle reader to read a file; determine the format of the file.
+//
+//////////
+
+long QTSub_BeginReader (QTSubReaderPtr theReader, QTSubReadProcPtr theReadProc, void *theRefCon)
+{
+	long			myIndex;
+
+	if ((theReader == NULL) || (theReadProc == NULL))
+		return(-1);
+
+	theReader->fReadProc = theReadProc;
+	theReader->fRefCon = theRefCon;
+	theReader->fError = 0;
+	theReader->fAtEOF = 0;
+	theReader->fFrameRate = kQTSub_DefaultFrameRate;
+	theReader->fTickRate = 0;
+	theReader->fCueCount = 0;
+	theReader->fPos = 0;
+	theReader->fCount = 0;
+	theReader->fTextLength = 0;
+
+	// fill the buffer, so that we can look at the start of the file
+	QTSub_PeekChar(theReader);
+	if (theReader->fError != 0)
+		return(theReader->fError);
+
+	// skip a UTF-8 byte order mark
+	if ((theReader->fCount >= 3) && ((unsigned char)theReader->fBuffer[0] == 0xEF) && ((unsigned char)theReader->fBuffer[1] == 0xBB) && ((unsigned char)theReader->fBuffer[2] == 0xBF))
+		theReader->fPos = 3;
+
+	// an XML document is TTML; a file that starts with the WebVTT signature is WebVTT; anything else is SRT
+	myIndex = theReader->fPos;
+	while ((myIndex < theReader->fCount) && ((theReader->fBuffer[myIndex] == ' ') || (theReader->fBuffer[myIndex] == '\t') || (theReader->fBuffer[myIndex] == '\r') || (theReader->fBuffer[myIndex] == '\n')))
+		myIndex++;
+
+	if ((myIndex < theReader->fCount) && (theReader->fBuffer[myIndex] == '<'))
+		theReader->fFormat = kQTSub_FormatTTML;
+	else if ((theReader->fCount - myIndex >= (long)sizeof(kWebVTTSignature) - 1) && (memcmp(theReader->fBuffer + myIndex, kWebVTTSignature, sizeof(kWebVTTSignature) - 1) == 0))
+		theReader->fFormat = kQTSub_FormatWebVTT;
+	else
+		theReader->fFormat = kQTSub_FormatSRT;
+
+	return(0);
+}
+
+
+//////////
+//
+// QTSub_ReadCue
+// Read the next cue from the specified subtitle reader.
+//
+// Return 1 if we got a cue, 0 if there are no more cues, or a negative error code.
+//
+//////////
+
+long QTSub_ReadCue (QTSubReaderPtr theReader, QTSubCuePtr theCue)
+{
+	long			myResult = 0;
+
+	if ((theReader == NULL) || (theCue == NULL))
+		return(-1);
+
+	theReader->fTextLength = 0;
+
+	if (theReader->fFormat == kQTSub_FormatTTML)
+		myResult = QTSub_ReadTTMLCue(theReader, theCue);
+	else
+		myResult = QTSub_ReadLineCue(theReader, theCue);
+
+	if (theReader->fError != 0)
+		return(theReader->fError);
+
+	if (myResult > 0) {
+		if (theCue->fEndMS < theCue->fStartMS)
+			theCue->fEndMS = theCue->fStartMS;
+
+		theCue->fText = theReader->fText;
+		theCue->fLength = theReader->fTextLength;
+		theReader->fCueCount++;
+	}
+
+	return(myResult);
+}
+
+
+//////////
+//
+// QTSub_ReadLineCue
+// Read the next cue from an SRT or WebVTT file.
+//
+//////////
+
+static long QTSub_ReadLineCue (QTSubReaderPtr theReader, QTSubCuePtr theCue)
+{
+	long			myLength;
+
+	// look for a timing line
+	for (;;) {
+		myLength = QTSub_ReadLine(theReader);
+		if (myLength == kEndOfData)
+			return(0);
+
+		if ((strstr(theReader->fLine, kTimingArrow) != NULL) && QTSub_ParseTiming(theReader->fLine, &theCue->fStartMS, &theCue->fEndMS))
+			break;
+	}
+
+	// the cue text runs to the next empty line (or the end of the file)
+	for (;;) {
+		myLength = QTSub_ReadLine(theReader);
+		if ((myLength == kEndOfData) || (myLength == 0))
+			break;
+
+		if (theReader->fTextLength > 0)
+			QTSub_AppendBytes(theReader, "\r", 1);
+
+		QTSub_AppendText(theReader, theReader->fLine, myLength, theReader->fFormat == kQTSub_FormatWebVTT);
+	}
+
+	return(1);
+}
+
+
+//////////
+//
+// QTSub_ReadTTMLCue
+// Read the next cue (that is, the next <p> element) from a TTML file.
+//
+//////////
+
+static long QTSub_ReadTTMLCue (QTSubReaderPtr theReader, QTSubCuePtr theCue)
+{
+	char			myValue[64];
+	long			myLength;
+	long			myDuration;
+	int				myChar;
+	int				hasEnd;
+	int				isSpace = 0;
+
+	// look for the start tag of a <p> element that has a begin time
+	for (;;) {
+		do {
+			myChar = QTSub_GetChar(theReader);
+		} while ((myChar != kEndOfData) && (myChar != '<'));
+
+		if (myChar == kEndOfData)
+			return(0);
+
+		QTSub_ReadTag(theReader);
+
+		// the <tt> element may specify the frame and tick rates for the time expressions
+		if (QTSub_IsTag(theReader->fLine, "tt", 0)) {
+			if (QTSub_GetAttribute(theReader->fLine, "frameRate", myValue, sizeof(myValue)) && (atol(myValue) > 0))
+				theReader->fFrameRate = atol(myValue);
+			if (QTSub_GetAttribute(theReader->fLine, "tickRate", myValue, sizeof(myValue)) && (atol(myValue) > 0))
+				theReader->fTickRate = atol(myValue);
+			continue;
+		}
+
+		if (!QTSub_IsTag(theReader->fLine, "p", 0))
+			continue;
+
+		if (!QTSub_GetAttribute(theReader->fLine, "begin", myValue, sizeof(myValue)) || !QTSub_ParseTTMLTime(theReader, myValue, &theCue->fStartMS))
+			continue;
+
+		hasEnd = QTSub_GetAttribute(theReader->fLine, "end", myValue, sizeof(myValue)) && QTSub_ParseTTMLTime(theReader, myValue, &theCue->fEndMS);
+		if (!hasEnd) {
+			if (QTSub_GetAttribute(theReader->fLine, "dur", myValue, sizeof(myValue)) && QTSub_ParseTTMLTime(theReader, myValue, &myDuration))
+				theCue->fEndMS = theCue->fStartMS + myDuration;
+			else
+				theCue->fEndMS = theCue->fStartMS;
+		}
+
+		// an empty element (<p .../>) has no text
+		myLength = (long)strlen(theReader->fLine);
+		if ((myLength > 0) && (theReader->fLine[myLength - 1] == '/'))
+			return(1);
+
+		break;
+	}
+
+	// read the content of the element, a run of text at a time
+	for (;;) {
+		myLength = 0;
+		myChar = QTSub_GetChar(theReader);
+		while ((myChar != kEndOfData) && (myChar != '<')) {
+			// XML line endings in the content are just white space, and runs of white space collapse into
+			// a single space (which we drop at the start of a line)
+			if ((myChar == '\r') || (myChar == '\n') || (myChar == '\t'))
+				myChar = ' ';
+
+			if (myChar == ' ') {
+				if (myLength > 0)
+					isSpace = (theReader->fLine[myLength - 1] == ' ');
+				else
+					isSpace = (theReader->fTextLength == 0) || (theReader->fText[theReader->fTextLength - 1] == ' ') || (theReader->fText[theReader->fTextLength - 1] == '\r');
+			}
+
+			if ((myLength < kQTSub_MaxLineSize) && !((myChar == ' ') && isSpace))
+				theReader->fLine[myLength++] = (char)myChar;
+
+			myChar = QTSub_GetChar(theReader);
+		}
+
+		theReader->fLine[myLength] = '\0';
+		QTSub_AppendText(theReader, theReader->fLine, myLength, 1);
+
+		if (myChar == kEndOfData)
+			break;
+
+		QTSub_ReadTag(theReader);
+		if (QTSub_IsTag(theReader->fLine, "br", 0)) {
+			QTSub_TrimText(theReader);
+			QTSub_AppendBytes(theReader, "\r", 1);
+		} else if (QTSub_IsTag(theReader->fLine, "p", 1)) {
+			break;
+		}
+	}
+
+	QTSub_TrimText(theReader);
+	return(1);
+}
+
+
+//////////
+//
+// QTSub_GetChar
+// Return the next byte from the specified subtitle reader, or kEndOfData.
+//
+//////////
+
+static int QTSub_GetChar (QTSubReaderPtr theReader)
+{
+	int				myChar;
+
+	myChar = QTSub_PeekChar(theReader);
+	if (myChar != kEndOfData)
+		theReader->fPos++;
+
+	return(myChar);
+}
+
+
+//////////
+//
+// QTSub_PeekChar
+// Return the next byte from the specified subtitle reader, or kEndOfData, without consuming it.
+//
+//////////
+
+static int QTSub_PeekChar (QTSubReaderPtr theReader)
+{
+	long			myCount;
+
+	if (theReader->fPos >= theReader->fCount) {
+		if (theReader->fAtEOF || (theReader->fError != 0))
+			return(kEndOfData);
+
+		theReader->fPos = 0;
+		theReader->fCount = 0;
+
+		myCount = (*theReader->fReadProc)(theReader->fRefCon, theReader->fBuffer, kQTSub_ReadBufferSize);
+		if (myCount < 0)
+			theReader->fError = myCount;
+
+		if (myCount <= 0) {
+			theReader->fAtEOF = 1;
+			return(kEndOfData);
+		}
+
+		theReader->fCount = myCount;
+	}
+
+	return((unsigned char)theReader->fBuffer[theReader->fPos]);
+}
+
+
+//////////
+//
+// QTSub_ReadLine
+// Read the next line from the specified subtitle reader into its line buffer; return the length of the line
+// (not counting the line ending, which we discard), or kEndOfData.
+//
+// A line can end with CR, LF or CR LF. Trailing white space is discarded, so a line of blanks is empty.
+//
+//////////
+
+static long QTSub_ReadLine (QTSubReaderPtr theReader)
+{
+	long			myLength = 0;
+	int				myChar;
+
+	myChar = QTSub_GetChar(theReader);
+	if (myChar == kEndOfData)
+		return(kEndOfData);
+
+	while ((myChar != kEndOfData) && (myChar != '\r') && (myChar != '\n')) {
+		if (myLength < kQTSub_MaxLineSize)
+			theReader->fLine[myLength++] = (char)myChar;
+
+		myChar = QTSub_GetChar(theReader);
+	}
+
+	if ((myChar == '\r') && (QTSub_PeekChar(theReader) == '\n'))
+		QTSub_GetChar(theReader);
+
+	while ((myLength > 0) && ((theReader->fLine[myLength - 1] == ' ') || (theReader->fLine[myLength - 1] == '\t')))
+		myLength--;
+
+	theReader->fLine[myLength] = '\0';
+	return(myLength);
+}
+
+
+//////////
+//
+// QTSub_ReadTag
+// Read an XML tag (whose opening '<' has already been read) into the line buffer of the specified subtitle
+// reader, without the angle brackets; return the length of the tag. Comments are skipped entirely.
+//
+//////////
+
+static long QTSub_ReadTag (QTSubReaderPtr theReader)
+{
+	long			myLength = 0;
+	int				myChar;
+
+	myChar = QTSub_GetChar(theReader);
+	while ((myChar != kEndOfData) && (myChar != '>')) {
+		if (myLength < kQTSub_MaxLineSize)
+			theReader->fLine[myLength++] = (char)myChar;
+
+		// a comment ends with "-->", not with the first '>'
+		if ((myLength == 3) && (memcmp(theReader->fLine, "!--", 3) == 0)) {
+			int		myDashes = 0;
+
+			myChar = QTSub_GetChar(theReader);
+			while ((myChar != kEndOfData) && !((myChar == '>') && (myDashes >= 2))) {
+				myDashes = (myChar == '-') ? myDashes + 1 : 0;
+				myChar = QTSub_GetChar(theReader);
+			}
+
+			myLength = 0;
+			break;
+		}
+
+		myChar = QTSub_GetChar(theReader);
+	}
+
+	theReader->fLine[myLength] = '\0';
+	return(myLength);
+}
+
+
+//////////
+//
+// QTSub_IsTag
+// Is the specified tag a start tag (or, if isEndTag is true, an end tag) for the element having the specified
+// name? Any namespace prefix on the element name is ignored.
+//
+//////////
+
+static int QTSub_IsTag (const char *theTag, const char *theName, int isEndTag)
+{
+	const char		*myName = theTag;
+	const char		*myEnd = NULL;
+	const char		*myColon = NULL;
+	long			myLength = (long)strlen(theName);
+
+	if (isEndTag) {
+		if (*myName != '/')
+			return(0);
+		myName++;
+	} else if ((*myName == '/') || (*myName == '!') || (*myName == '?')) {
+		return(0);
+	}
+
+	// find the end of the element name and the last colon in it
+	for (myEnd = myName; (*myEnd != '\0') && (*myEnd != ' ') && (*myEnd != '\t') && (*myEnd != '\r') && (*myEnd != '\n') && (*myEnd != '/'); myEnd++)
+		if (*myEnd == ':')
+			myColon = myEnd;
+
+	if (myColon != NULL)
+		myName = myColon + 1;
+
+	return(((myEnd - myName) == myLength) && (memcmp(myName, theName, myLength) == 0));
+}
+
+
+//////////
+//
+// QTSub_GetAttribute
+// Copy the value of the specified attribute of the specified tag into theValue; return 1 if the tag has
+// that attribute, 0 otherwise. Any namespace prefix on the attribute name is ignored.
+//
+//////////
+
+static int QTSub_GetAttribute (const char *theTag, const char *theName, char *theValue, long theValueSize)
+{
+	const char		*myText = theTag;
+	const char		*myName = NULL;
+	const char		*myEnd = NULL;
+	long			myLength = (long)strlen(theName);
+	long			myIndex;
+	char			myQuote;
+
+	// skip the element name
+	while ((*myText != '\0') && (*myText != ' ') && (*myText != '\t') && (*myText != '\r') && (*myText != '\n'))
+		myText++;
+
+	for (;;) {
+		while ((*myText == ' ') || (*myText == '\t') || (*myText == '\r') || (*myText == '\n'))
+			myText++;
+
+		if ((*myText == '\0') || (*myText == '/'))
+			return(0);
+
+		// get the attribute name, without any namespace prefix
+		myName = myText;
+		while ((*myText != '\0') && (*myText != '=') && (*myText != ' ') && (*myText != '\t') && (*myText != '\r') && (*myText != '\n')) {
+			if (*myText == ':')
+				myName = myText + 1;
+			myText++;
+		}
+		myEnd = myText;
+
+		while ((*myText == ' ') || (*myText == '\t') || (*myText == '\r') || (*myText == '\n'))
+			myText++;
+
+		if (*myText != '=')
+			continue;
+		myText++;
+
+		while ((*myText == ' ') || (*myText == '\t') || (*myText == '\r') || (*myText == '\n'))
+			myText++;
+
+		if ((*myText != '"') && (*myText != '\''))
+			return(0);
+
+		myQuote = *myText++;
+
+		if (((myEnd - myName) == myLength) && (memcmp(myName, theName, myLength) == 0)) {
+			for (myIndex = 0; (myText[myIndex] != '\0') && (myText[myIndex] != myQuote) && (myIndex < theValueSize - 1); myIndex++)
+				theValue[myIndex] = myText[myIndex];
+			theValue[myIndex] = '\0';
+			return(1);
+		}
+
+		// skip the value of some other attribute
+		while ((*myText != '\0') && (*myText != myQuote))
+			myText++;
+
+		if (*myText == '\0')
+			return(0);
+
+		myText++;
+	}
+}
+
+
+//////////
+//
+// QTSub_ParseTiming
+// Parse an SRT or WebVTT timing line ("00:00:01,000 --> 00:00:02,500", possibly followed by cue settings).
+//
+//////////
+
+static int QTSub_ParseTiming (const char *theLine, long *theStartMS, long *theEndMS)
+{
+	const char		*myText = theLine;
+
+	while ((*myText == ' ') || (*myText == '\t'))
+		myText++;
+
+	if (!QTSub_ParseClockTime(&myText, theStartMS))
+		return(0);
+
+	while ((*myText == ' ') || (*myText == '\t'))
+		myText++;
+
+	if (strncmp(myText, kTimingArrow, sizeof(kTimingArrow) - 1) != 0)
+		return(0);
+
+	myText += sizeof(kTimingArrow) - 1;
+	while ((*myText == ' ') || (*myText == '\t'))
+		myText++;
+
+	return(QTSub_ParseClockTime(&myText, theEndMS));
+}
+
+
+//////////
+//
+// QTSub_ParseClockTime
+// Parse a time of the form [HH:]MM:SS[.,]mmm, advancing the text pointer past it.
+//
+//////////
+
+static int QTSub_ParseClockTime (const char **theText, long *theMS)
+{
+	const char		*myText = *theText;
+	long			myFields[3];
+	long			myCount = 0;
+	long			myMS = 0;
+	long			myScale = 100;
+
+	for (;;) {
+		long		myValue = 0;
+
+		if ((*myText < '0') || (*myText > '9'))
+			return(0);
+
+		while ((*myText >= '0') && (*myText <= '9'))
+			myValue = (myValue * 10) + (*myText++ - '0');
+
+		myFields[myCount++] = myValue;
+
+		if ((*myText != ':') || (myCount == 3))
+			break;
+
+		myText++;
+	}
+
+	if (myCount < 2)
+		return(0);
+
+	// get the milliseconds; we ignore any digits past the third
+	if ((*myText == '.') || (*myText == ',')) {
+		myText++;
+		while ((*myText >= '0') && (*myText <= '9')) {
+			myMS += (*myText++ - '0') * myScale;
+			myScale /= 10;
+		}
+	}
+
+	if (myCount == 2)
+		*theMS = (((myFields[0] * 60L) + myFields[1]) * 1000L) + myMS;
+	else
+		*theMS = (((((myFields[0] * 60L) + myFields[1]) * 60L) + myFields[2]) * 1000L) + myMS;
+
+	*theText = myText;
+	return(1);
+}
+
+
+//////////
+//
+// QTSub_ParseTTMLTime
+// Parse a TTML time expression: either a clock time (HH:MM:SS.fraction or HH:MM:SS:frames) or an offset time
+// (a number followed by one of the metrics h, m, s, ms, f or t).
+//
+//////////
+
+static int QTSub_ParseTTMLTime (QTSubReaderPtr theReader, const char *theText, long *theMS)
+{
+	const char		*myText = theText;
+	double			myValue = 0.0;
+	double			myScale = 0.1;
+	double			myFields[3];
+	long			myCount = 0;
+	long			myTickRate;
+
+	while (*myText == ' ')
+		myText++;
+
+	if ((*myText < '0') || (*myText > '9'))
+		return(0);
+
+	// get the first number
+	while ((*myText >= '0') && (*myText <= '9'))
+		myValue = (myValue * 10.0) + (*myText++ - '0');
+
+	if (*myText == ':') {
+		// a clock time
+		myFields[myCount++] = myValue;
+		while ((*myText == ':') && (myCount < 3)) {
+			myValue = 0.0;
+			myText++;
+			while ((*myText >= '0') && (*myText <= '9'))
+				myValue = (myValue * 10.0) + (*myText++ - '0');
+			myFields[myCount++] = myValue;
+		}
+
+		if (myCount < 3)
+			return(0);
+
+		myValue = (((myFields[0] * 60.0) + myFields[1]) * 60.0) + myFields[2];
+
+		if (*myText == '.') {
+			myText++;
+			while ((*myText >= '0') && (*myText <= '9')) {
+				myValue += (*myText++ - '0') * myScale;
+				myScale /= 10.0;
+			}
+		} else if (*myText == ':') {
+			// frames
+			double	myFrames = 0.0;
+
+			myText++;
+			while ((*myText >= '0') && (*myText <= '9'))
+				myFrames = (myFrames * 10.0) + (*myText++ - '0');
+			myValue += myFrames / theReader->fFrameRate;
+		}
+
+		*theMS = (long)((myValue * 1000.0) + 0.5);
+		return(1);
+	}
+
+	// an offset time
+	if (*myText == '.') {
+		myText++;
+		while ((*myText >= '0') && (*myText <= '9')) {
+			myValue += (*myText++ - '0') * myScale;
+			myScale /= 10.0;
+		}
+	}
+
+	if (strncmp(myText, "ms", 2) == 0) {
+		myValue /= 1000.0;
+	} else if (*myText == 'h') {
+		myValue *= 3600.0;
+	} else if (*myText == 'm') {
+		myValue *= 60.0;
+	} else if (*myText == 's') {
+		;
+	} else if (*myText == 'f') {
+		myValue /= theReader->fFrameRate;
+	} else if (*myText == 't') {
+		// without an explicit tick rate, the tick rate is the frame rate
+		myTickRate = (theReader->fTickRate > 0) ? theReader->fTickRate : theReader->fFrameRate;
+		myValue /= myTickRate;
+	} else {
+		return(0);
+	}
+
+	*theMS = (long)((myValue * 1000.0) + 0.5);
+	return(1);
+}
+
+
+//////////
+//
+// QTSub_AppendText
+// Append the specified text to the cue text of the specified subtitle reader, removing any markup; if isMarkup
+// is true, the text is WebVTT or TTML, so we also decode character references.
+//
+//////////
+
+static void QTSub_AppendText (QTSubReaderPtr theReader, const char *theText, long theLength, int isMarkup)
+{
+	char			myChars[8];
+	long			myStart = 0;
+	long			myIndex = 0;
+	long			myEnd;
+
+	while (myIndex < theLength) {
+		char		myChar = theText[myIndex];
+
+		// a '{' is special only if it starts an SSA override ({\an8})
+		if ((myChar != '<') && !((myChar == '{') && (myIndex + 1 < theLength) && (theText[myIndex + 1] == '\\')) && !(isMarkup && (myChar == '&'))) {
+			myIndex++;
+			continue;
+		}
+
+		// append the run of ordinary characters before this one
+		QTSub_AppendBytes(theReader, theText + myStart, myIndex - myStart);
+
+		if (myChar == '&') {
+			// a character reference; if we can't decode it, we just keep the ampersand
+			for (myEnd = myIndex + 1; (myEnd < theLength) && (myEnd - myIndex < 12) && (theText[myEnd] != ';'); myEnd++)
+				;
+
+			if ((myEnd < theLength) && (theText[myEnd] == ';')) {
+				long	mySize = QTSub_DecodeEntity(theText + myIndex + 1, myEnd - myIndex - 1, myChars);
+
+				if (mySize > 0) {
+					QTSub_AppendBytes(theReader, myChars, mySize);
+					myIndex = myEnd + 1;
+					myStart = myIndex;
+					continue;
+				}
+			}
+
+			QTSub_AppendBytes(theReader, "&", 1);
+			myIndex++;
+			myStart = myIndex;
+			continue;
+		}
+
+		// a tag (<i>, <c.yellow>, <00:00:01.000>) or an SSA override; skip it if it's closed, keep it otherwise
+		for (myEnd = myIndex + 1; (myEnd < theLength) && (theText[myEnd] != ((myChar == '<') ? '>' : '}')); myEnd++)
+			;
+
+		if (myEnd < theLength) {
+			myIndex = myEnd + 1;
+			myStart = myIndex;
+		} else {
+			myStart = myIndex;
+			myIndex++;
+		}
+	}
+
+	QTSub_AppendBytes(theReader, theText + myStart, theLength - myStart);
+}
+
+
+//////////
+//
+// QTSub_AppendBytes
+// Append the specified bytes to the cue text of the specified subtitle reader, truncating the text if necessary.
+//
+//////////
+
+static void QTSub_AppendBytes (QTSubReaderPtr theReader, const char *theText, long theLength)
+{
+	if (theLength > kQTSub_MaxCueSize - theReader->fTextLength)
+		theLength = kQTSub_MaxCueSize - theReader->fTextLength;
+
+	if (theLength > 0) {
+		memcpy(theReader->fText + theReader->fTextLength, theText, theLength);
+		theReader->fTextLength += theLength;
+	}
+}
+
+
+//////////
+//
+// QTSub_TrimText
+// Remove any spaces from the end of the cue text of the specified subtitle reader.
+//
+//////////
+
+static void QTSub_TrimText (QTSubReaderPtr theReader)
+{
+	while ((theReader->fTextLength > 0) && (theReader->fText[theReader->fTextLength - 1] == ' '))
+		theReader->fTextLength--;
+}
+
+
+//////////
+//
+// QTSub_DecodeEntity
+// Decode the specified character reference (the text between the '&' and the ';') into UTF-8; return the
+// number of bytes of UTF-8, or 0 if we don't know the reference.
+//
+//////////
+
+static long QTSub_DecodeEntity (const char *theText, long theLength, char *theDst)
+{
+	unsigned long	myChar = 0;
+	long			myIndex;
+
+	if ((theLength == 3) && (memcmp(theText, "amp", 3) == 0))
+		myChar = '&';
+	else if ((theLength == 2) && (memcmp(theText, "lt", 2) == 0))
+		myChar = '<';
+	else if ((theLength == 2) && (memcmp(theText, "gt", 2) == 0))
+		myChar = '>';
+	else if ((theLength == 4) && (memcmp(theText, "quot", 4) == 0))
+		myChar = '"';
+	else if ((theLength == 4) && (memcmp(theText, "apos", 4) == 0))
+		myChar = '\'';
+	else if ((theLength == 4) && (memcmp(theText, "nbsp", 4) == 0))
+		myChar = 0xA0;
+	else if ((theLength == 3) && (memcmp(theText, "lrm", 3) == 0))
+		myChar = 0x200E;
+	else if ((theLength == 3) && (memcmp(theText, "rlm", 3) == 0))
+		myChar = 0x200F;
+	else if ((theLength >= 2) && (theText[0] == '#')) {
+		if ((theText[1] == 'x') || (theText[1] == 'X')) {
+			for (myIndex = 2; myIndex < theLength; myIndex++) {
+				char	myDigit = theText[myIndex];
+
+				if ((myDigit >= '0') && (myDigit <= '9'))
+					myChar = (myChar << 4) + (myDigit - '0');
+				else if ((myDigit >= 'a') && (myDigit <= 'f'))
+					myChar = (myChar << 4) + (myDigit - 'a' + 10);
+				else if ((myDigit >= 'A') && (myDigit <= 'F'))
+					myChar = (myChar << 4) + (myDigit - 'A' + 10);
+				else
+					return(0);
+			}
+		} else {
+			for (myIndex = 1; myIndex < theLength; myIndex++) {
+				if ((theText[myIndex] < '0') || (theText[myIndex] > '9'))
+					return(0);
+				myChar = (myChar * 10) + (theText[myIndex] - '0');
+			}
+		}
+	}
+
+	if ((myChar == 0) || (myChar > 0x10FFFF))
+		return(0);
+
+	if (myChar < 0x80) {
+		theDst[0] = (char)myChar;
+		return(1);
+	} else if (myChar < 0x800) {
+		theDst[0] = (char)(0xC0 | (myChar >> 6));
+		theDst[1] = (char)(0x80 | (myChar & 0x3F));
+		return(2);
+	} else if (myChar < 0x10000) {
+		theDst[0] = (char)(0xE0 | (myChar >> 12));
+		theDst[1] = (char)(0x80 | ((myChar >> 6) & 0x3F));
+		theDst[2] = (char)(0x80 | (myChar & 0x3F));
+		return(3);
+	} else {
+		theDst[0] = (char)(0xF0 | (myChar >> 18));
+		theDst[1] = (char)(0x80 | ((myChar >> 12) & 0x3F));
+		theDst[2] = (char)(0x80 | ((myChar >> 6) & 0x3F));
+		theDst[3] = (char)(0x80 | (myChar & 0x3F));
+		return(4);
+	}
+}
+
+
+//////////
+//
+// QTSub_Put
+// Add the specified data to the buffer of the specified subtitle writer, writing out the buffer as it fills.
+//
+//////////
+
+static void QTSub_Put (QTSubWriterPtr theWriter, const char *theData, long theSize)
+{
+	long			myChunk;
+
+	while ((theSize > 0) && (theWriter->fError == 0)) {
+		myChunk = kQTSub_WriteBufferSize - theWriter->fCount;
+		if (myChunk > theSize)
+			myChunk = theSize;
+
+		memcpy(theWriter->fBuffer + theWriter->fCount, theData, myChunk);
+		theWriter->fCount += myChunk;
+		theData += myChunk;
+		theSize -= myChunk;
+
+		if (theWriter->fCount == kQTSub_WriteBufferSize)
+			QTSub_Flush(theWriter);
+	}
+}
+
+
+//////////
+//
+// QTSub_Flush
+// Write out the buffer of the specified subtitle writer.
+//
+//////////
+
+static void QTSub_Flush (QTSubWriterPtr theWriter)
+{
+	if ((theWriter->fCount > 0) && (theWriter->fError == 0)) {
+		theWriter->fError = (*theWriter->fWriteProc)(theWriter->fRefCon, theWriter->fBuffer, theWriter->fCount);
+		if (theWriter->fError == 0)
+			theWriter->fBytesWritten += theWriter->fCount;
+	}
+
+	theWriter->fCount = 0;
+}
+
+
+//////////
+//
+// QTSub_FormatNumber
+// Format the specified non-negative number in decimal; return the number of digits.
+//
+//////////
+
+static long QTSub_FormatNumber (long theNumber, char *theDst)
+{
+	char			myDigits[16];
+	long			myCount = 0;
+	long			myIndex;
+
+	do {
+		myDigits[myCount++] = (char)('0' + (theNumber % 10));
+		theNumber /= 10;
+	} while (theNumber > 0);
+
+	for (myIndex = 0; myIndex < myCount; myIndex++)
+		theDst[myIndex] = myDigits[myCount - myIndex - 1];
+
+	return(myCount);
+}
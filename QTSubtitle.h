@@ -0,0 +1,125 @@
+//////////
+//
+//	File:		QTSubtitle.h
+//
+//	Contains:	Reading and writing subtitle files (SRT, WebVTT and TTML).
+//				All utilities start with the prefix "QTSub_".
+//
+//	Written by:	QuickTime Team
+//
+//////////
+
+#pragma once
+
+#ifndef __QTSubtitle__
+#define __QTSubtitle__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+// the subtitle file formats we know about
+enum {
+	kQTSub_FormatSRT				= 1,			// SubRip (.srt)
+	kQTSub_FormatWebVTT				= 2,			// Web Video Text Tracks (.vtt)
+	kQTSub_FormatTTML				= 3				// Timed Text Markup Language (.ttml, .xml, .dfxp); reading only
+};
+
+#define kQTSub_WriteBufferSize			(32L * 1024L)	// size of the write buffer of a subtitle writer
+#define kQTSub_TimeStampSize			12				// length of an "HH:MM:SS,mmm" time stamp
+#define kQTSub_ReadBufferSize			(64L * 1024L)	// size of the read buffer of a subtitle reader
+#define kQTSub_MaxLineSize				1024			// longer lines (or TTML tags) are truncated
+#define kQTSub_MaxCueSize				4096			// longer cue text is truncated
+#define kQTSub_DefaultFrameRate			30				// TTML frame rate, if the document doesn't specify one
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a procedure that writes data to a file (or to wherever the subtitles are going);
+// it returns 0 if all the data was written or an error code otherwise
+typedef long (*QTSubWriteProcPtr) (void *theRefCon, const char *theData, long theSize);
+
+// a subtitle writer; the cues are formatted into the buffer, which is handed to the write procedure whenever
+// it fills up, so the memory used by an export doesn't depend on the number or size of the cues
+typedef struct QTSubWriter {
+	long							fFormat;		// the format of the subtitle file
+	QTSubWriteProcPtr				fWriteProc;		// the procedure that writes out the buffer
+	void							*fRefCon;		// a reference constant for the write procedure
+	long							fError;			// the first error returned by the write procedure
+	long							fCueCount;		// the number of cues written so far
+	long							fBytesWritten;	// the number of bytes handed to the write procedure so far
+	long							fCount;			// the number of bytes in the buffer
+	char							fBuffer[kQTSub_WriteBufferSize];
+} QTSubWriter, *QTSubWriterPtr;
+
+
+// a procedure that reads data from a file (or from wherever the subtitles are coming from);
+// it returns the number of bytes read, 0 at the end of the data, or a negative error code
+typedef long (*QTSubReadProcPtr) (void *theRefCon, char *theData, long theSize);
+
+// a cue returned by a subtitle reader; the text is UTF-8, with lines separated by carriage returns (as in a
+// text media sample), and it belongs to the reader (it's valid only until the next call to QTSub_ReadCue)
+typedef struct QTSubCue {
+	long							fStartMS;		// the start time of the cue
+	long							fEndMS;			// the end time of the cue
+	const char						*fText;			// the text of the cue; NOT null-terminated
+	long							fLength;		// the length of the text
+} QTSubCue, *QTSubCuePtr;
+
+// a subtitle reader; the file is read a buffer at a time, so the memory used by an import doesn't depend
+// on the number or size of the cues
+typedef struct QTSubReader {
+	long							fFormat;		// the format of the subtitle file
+	QTSubReadProcPtr				fReadProc;		// the procedure that fills the buffer
+	void							*fRefCon;		// a reference constant for the read procedure
+	long							fError;			// the first error returned by the read procedure
+	int								fAtEOF;			// have we read all the data?
+	long							fFrameRate;		// TTML frames per second
+	long							fTickRate;		// TTML ticks per second
+	long							fCueCount;		// the number of cues read so far
+	long							fPos;			// the offset of the next unread byte in the buffer
+	long							fCount;			// the number of bytes in the buffer
+	long							fTextLength;	// the number of bytes in the cue text buffer
+	char							fBuffer[kQTSub_ReadBufferSize];
+	char							fLine[kQTSub_MaxLineSize + 1];
+	char							fText[kQTSub_MaxCueSize];
+} QTSubReader, *QTSubReaderPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+long						QTSub_BeginWriter (QTSubWriterPtr theWriter, long theFormat, QTSubWriteProcPtr theWriteProc, void *theRefCon);
+long						QTSub_WriteCue (QTSubWriterPtr theWriter, long theStartMS, long theEndMS, const char *theText, long theLength);
+long						QTSub_EndWriter (QTSubWriterPtr theWriter);
+long						QTSub_FormatTimeStamp (long theFormat, long theMS, char *theDst);
+
+long						QTSub_BeginReader (QTSubReaderPtr theReader, QTSubReadProcPtr theReadProc, void *theRefCon);
+long						QTSub_ReadCue (QTSubReaderPtr theReader, QTSubCuePtr theCue);
+
+#endif	// __QTSubtitle__
@@ -11,6 +11,25 @@
 //
 //	Change History (most recent first):
 //
+//	   <21>	 	10/20/00	rtm		added QTText_ReplaceAllText and the Replace All menu item, which replace
+//									every occurrence of the search text in one transaction
+//	   <20>	 	10/13/00	rtm		added text edit transactions (QTText_BeginTransaction and friends), which
+//									add all their new samples in one media editing session and swap them into
+//									the track at once; QTText_EditText now uses one
+//	   <19>	 	10/06/00	rtm		added the chapter table (QTText_BuildChapterTable and friends), which keeps
+//									the start time and title of every chapter, and patch it on edits instead of
+//									rebuilding it; the chapter utilities now look chapters up in it
+//	   <18>	 	09/22/00	rtm		added the sample index, the edit indexes and the reference indexes, so that
+//									finding a sample's bounds, mapping track time to media time and finding
+//									the tracks that refer to a track no longer walk the whole movie
+//	   <17>	 	09/08/00	rtm		added the text media writer (QTText_NewTextWriter and friends), which adds
+//									text samples in large chunks (see the USE_TEXTWRITER compiler flag); the
+//									AddMediaSample path now uses one sample description for all samples
+//	   <16>	 	08/25/00	rtm		added QTText_ExportSubtitles and QTText_ImportSubtitles, which write SRT and
+//									WebVTT files and read SRT, WebVTT and TTML files (see QTSubtitle.c)
+//	   <15>	 	08/11/00	rtm		added a cache of sample text converted to UTF-8 (see QTTextEncoding.c),
+//									used for exporting, listing chapters and (see the USE_UTF8SEARCH compiler
+//									flag) searching
 //	   <14>	 	07/20/00	rtm		replaced all calls to QTText_UpdateMovieAndController by MCMovieChanged;
 //									reworked QTText_RemoveIndTextTrack to call MCMovieChanged right after
 //									calling QTUtils_DeleteAllReferencesToTrack; this prevents crashes when
@@ -58,12 +77,19 @@
 // only a specified track, while MovieSearchText can search all text tracks in a specified movie. Moreover,
 // MovieSearchText will automatically go to and highlight the found text; these operations must be done manually
 // if you're using TextMediaFindNextText. This sample code illustrates BOTH of these functions; you determine
-// which is used by setting the USE_MOVIESEARCHTEXT compiler flag in QTText.h.
+// which is used by setting the USE_MOVIESEARCHTEXT compiler flag in QTText.h. Both compare the search text with
+// the bytes of each sample, so neither finds text in a sample that isn't in the system script; if you set the
+// USE_UTF8SEARCH compiler flag, we instead search the samples' text as converted to UTF-8 (see Text encoding
+// utilities, below).
 //
 //////////
 
 #include "QTText.h"
 
+#if LOG_SUBTITLE_STATS
+#include <stdio.h>
+#endif
+
 
 //////////
 //
@@ -76,8 +102,15 @@ Boolean						gSearchWrap = true;					// do we wrap around when searching?
 Boolean						gSearchWithCase = false;			// is the search case sensitive?
 Str255						gSearchText;						// the text we're searching for
 Str255						gSampleText;						// the text of the current text media sample
+Str255						gReplaceText;						// the text that replaces the search text (see QTText_ReplaceText)
 long						gOffset;							// offset of current found text within sample
 TextMediaUPP				gTextProcUPP = NULL;				// UPP to text handling procedure
+QTTextCachePtr				gTextCache = NULL;					// cache of text media samples converted to UTF-8
+Handle						gChapterSample = NULL;				// the chapter sample last read by QTText_GetIndChapterSample
+QTTextEditIndex				gEditIndexes[kEditIndexCacheSize];	// the decoded edit lists of recently used tracks
+short						gNextEditIndex = 0;					// the entry of gEditIndexes to reuse next
+QTTextRefIndex				gRefIndexes[kRefIndexCacheSize];	// the track references of recently used movies
+short						gNextRefIndex = 0;					// the entry of gRefIndexes to reuse next
 
 extern ModalFilterUPP		gModalFilterUPP;
 
@@ -133,8 +166,15 @@ void QTText_DumpWindowData (WindowObject theWindowObject)
 	ApplicationDataHdl		myAppData = NULL;
 		
 	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
-	if (myAppData != NULL)
+	if (myAppData != NULL) {
+		QTText_DisposeSampleIndex(myAppData);
+		QTText_DisposeChapterTable(myAppData);
 		DisposeHandle((Handle)myAppData);
+	}
+
+	// the movie is disposed of right after this; forget the text, edit indexes and reference index we keep
+	// for it, since a new movie or media could be allocated at the same address
+	QTText_FlushMovieText((**theWindowObject).fMovie);
 }
 
 
@@ -165,6 +205,10 @@ void QTText_SyncWindowData (WindowObject theWindowObject)
 				TextMediaSetTextProc(myHandler, gTextProcUPP, (long)theWindowObject);
 		}
 	
+		// if the text track has changed, the sample index describes some other track
+		if ((**myAppData).fTextTrack != myTrack)
+			QTText_DisposeSampleIndex(myAppData);
+
 		// remember the text track and media handler
 		(**myAppData).fMovieHasText = (myTrack != NULL);
 		(**myAppData).fTextIsChapter = QTText_TrackTypeHasAChapterTrack((**theWindowObject).fMovie, VideoMediaType);
@@ -172,6 +216,53 @@ void QTText_SyncWindowData (WindowObject theWindowObject)
 		(**myAppData).fTextTrack = myTrack;
 		(**myAppData).fTextHandler = myHandler;
 	}
+
+	QTText_FlushMovieChanged(theWindowObject);
+}
+
+
+//////////
+//
+// QTText_NoteMovieChanged
+// Note that the movie in the specified window object has changed, so that the movie controller can be told
+// about it (and rebuild its chapter pop-up) the next time we're idle.
+//
+// Telling the controller once for a run of edits is much cheaper than telling it after each of them.
+//
+//////////
+
+void QTText_NoteMovieChanged (WindowObject theWindowObject)
+{
+	ApplicationDataHdl		myAppData = NULL;
+
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
+	if (myAppData != NULL)
+		(**myAppData).fMovieChanged = true;
+	else if ((**theWindowObject).fController != NULL)
+		MCMovieChanged((**theWindowObject).fController, (**theWindowObject).fMovie);
+}
+
+
+//////////
+//
+// QTText_FlushMovieChanged
+// Tell the movie controller of the specified window object that its movie has changed, if it has changed since
+// the controller was last told.
+//
+//////////
+
+void QTText_FlushMovieChanged (WindowObject theWindowObject)
+{
+	ApplicationDataHdl		myAppData = NULL;
+
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
+	if ((myAppData == NULL) || !(**myAppData).fMovieChanged)
+		return;
+
+	(**myAppData).fMovieChanged = false;
+
+	if ((**theWindowObject).fController != NULL)
+		MCMovieChanged((**theWindowObject).fController, (**theWindowObject).fMovie);
 }
   
 
@@ -258,7 +349,42 @@ void QTText_FindText (WindowObject theWindowObject, Str255 theText)
 
 	myTimeValue = GetMovieTime(myMovie, NULL);
 
-#if USE_MOVIESEARCHTEXT
+#if USE_UTF8SEARCH
+	//////////
+	//
+	// METHOD THREE: Search the UTF-8 text of the samples, as kept in the text cache. MovieSearchText and
+	// TextMediaFindNextText compare the bytes of each sample with the search text, so they can't find anything
+	// in a sample that isn't in the system script (a UTF-16 or Shift-JIS sample, say); this way we can. The
+	// offsets are offsets in the UTF-8 text, so we don't highlight the found text.
+	//
+	//////////
+
+	{
+		char		myFind[(kQTTextEnc_MaxUTF8PerByte * 255) + 1];
+		long		myFindLength;
+		TimeValue	myFoundTime;
+		TimeRecord	myNewTime;
+
+		myFindLength = QTTextEnc_ConvertToUTF8(QTTextEnc_GetEncodingForScript((short)GetScriptManagerVariable(smSysScript)), &theText[1], theText[0], myFind, sizeof(myFind));
+
+		myErr = QTText_FindSampleTextUTF8(myAppData, myFind, myFindLength, myTimeValue, gOffset, &myFoundTime, &gOffset);
+		if (myErr == noErr) {
+			// go to the sample that contains the found text
+			myNewTime.value.hi = 0;
+			myNewTime.value.lo = myFoundTime;
+			myNewTime.scale = GetMovieTimeScale(myMovie);
+			myNewTime.base = NULL;
+			MCDoAction(myMC, mcActionGoToTime, &myNewTime);
+
+			// a forward search goes on after the found text
+			if (gSearchForward)
+				gOffset += myFindLength;
+		} else {
+			// if the desired string wasn't found, beep
+			QTFrame_Beep();
+		}
+	}
+#elif USE_MOVIESEARCHTEXT
 	//////////
 	//
 	// METHOD ONE: Use MovieSearchText, your one-stop, find-the-text-and-do-the-right-thing function.
@@ -306,9 +432,168 @@ void QTText_FindText (WindowObject theWindowObject, Str255 theText)
 	}
 #endif // USE_MOVIESEARCHTEXT
 
+#if !USE_UTF8SEARCH
 	// update the current offset, if we're searching forward
 	if (gSearchForward && (myErr == noErr))
 		gOffset += theText[0];
+#endif
+}
+
+
+//////////
+//
+// QTText_FindSampleTextUTF8
+// Find the specified UTF-8 text in the UTF-8 text of the samples of the text track of the specified application
+// data, starting at the specified offset in the sample displayed at the specified track time; return the start
+// time of the sample that contains the text through theFoundTime, and the offset of the text in the sample's
+// UTF-8 text through theFoundOffset.
+//
+// The search goes forward or backward, and wraps around or not, as gSearchForward and gSearchWrap say; it is
+// case sensitive if gSearchWithCase is set. Searching forward, the text can start at theOffset; searching
+// backward, it must start before it.
+//
+//////////
+
+OSErr QTText_FindSampleTextUTF8 (ApplicationDataHdl theAppData, const char *theFind, long theFindLength, TimeValue theTime, long theOffset, TimeValue *theFoundTime, long *theFoundOffset)
+{
+	Track				myTrack = NULL;
+	Media				myMedia = NULL;
+	TimeValue			*myStarts = NULL;
+	TimeValue			myStart;
+	const char			*myText = NULL;
+	long				myLength;
+	long				mySampleNum;
+	long				myCount;
+	long				myIndex = 0;
+	long				myStep;
+	long				myFirst;
+	long				myLast;
+	long				myFound = kSearchNoMatch;
+	OSErr				myErr = noErr;
+
+	if ((theAppData == NULL) || (theFind == NULL) || (theFindLength <= 0))
+		return(paramErr);
+
+	myTrack = (**theAppData).fTextTrack;
+	if (myTrack == NULL)
+		return(invalidTrack);
+
+	myMedia = GetTrackMedia(myTrack);
+
+	// the sample index gives us the start of every sample in the track, in time order
+	if (!QTText_IsSampleIndexValid(theAppData)) {
+		myErr = QTText_BuildSampleIndex(theAppData);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	myCount = (**theAppData).fSampleIndex.fCount;
+	if (myCount == 0)
+		return(searchTextNotFoundErr);
+
+	// find the sample displayed at the specified time; before the first sample, start at the first
+	myStarts = (TimeValue *)*(**theAppData).fSampleIndex.fStarts;
+	while ((myIndex + 1 < myCount) && (myStarts[myIndex + 1] <= theTime))
+		myIndex++;
+
+	if (theTime < myStarts[0])
+		theOffset = 0;
+
+	// look at each sample in turn, ending (if we wrap around) with the part of the first one we skipped
+	for (myStep = 0; myStep <= myCount; myStep++) {
+		myStart = ((TimeValue *)*(**theAppData).fSampleIndex.fStarts)[myIndex];
+
+		myErr = MediaTimeToSampleNum(myMedia, QTText_TrackTimeToMediaTime(myTrack, myStart), &mySampleNum, NULL, NULL);
+		if (myErr != noErr)
+			return(myErr);
+
+		myText = QTText_GetSampleTextUTF8(myMedia, mySampleNum, &myLength);
+
+		// the range of offsets at which the text may start
+		myFirst = 0;
+		myLast = myLength;
+		if (myStep == 0) {
+			if (gSearchForward)
+				myFirst = theOffset;
+			else
+				myLast = theOffset;
+		} else if (myStep == myCount) {
+			if (gSearchForward)
+				myLast = theOffset;
+			else
+				myFirst = theOffset;
+		}
+
+		if (myText != NULL) {
+			myFound = QTText_SearchBuffer(myText, myLength, theFind, theFindLength, myFirst, myLast, !gSearchForward, gSearchWithCase);
+			if (myFound != kSearchNoMatch)
+				break;
+		}
+
+		// go on to the next sample
+		myIndex += gSearchForward ? 1 : -1;
+		if ((myIndex < 0) || (myIndex >= myCount)) {
+			if (!gSearchWrap)
+				break;
+
+			myIndex = gSearchForward ? 0 : myCount - 1;
+		}
+	}
+
+	if (myFound == kSearchNoMatch)
+		return(searchTextNotFoundErr);
+
+	*theFoundTime = myStart;
+	*theFoundOffset = myFound;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTText_SearchBuffer
+// Return the offset of the first (or, if isBackward is true, the last) occurrence of theFind in the specified
+// text that starts at an offset from theFirst up to but not including theLast, or kSearchNoMatch if there is none.
+//
+// Unless isCaseSensitive is true, an ASCII letter matches the same letter in either case, as in
+// QTText_ReplaceInBuffer.
+//
+//////////
+
+long QTText_SearchBuffer (const char *theText, long theLength, const char *theFind, long theFindLength, long theFirst, long theLast, Boolean isBackward, Boolean isCaseSensitive)
+{
+	const unsigned char		*myText = (const unsigned char *)theText;
+	const unsigned char		*myFind = (const unsigned char *)theFind;
+	long					myOffset;
+	long					myIndex;
+
+	if (theFirst < 0)
+		theFirst = 0;
+
+	// the text can't start so late that it runs off the end
+	if (theLast > theLength - theFindLength + 1)
+		theLast = theLength - theFindLength + 1;
+
+	for (myOffset = isBackward ? theLast - 1 : theFirst; (myOffset >= theFirst) && (myOffset < theLast); myOffset += isBackward ? -1 : 1) {
+		for (myIndex = 0; myIndex < theFindLength; myIndex++) {
+			unsigned char	myChar = myText[myOffset + myIndex];
+
+			if (myChar == myFind[myIndex])
+				continue;
+
+			// the two characters are the same ASCII letter, in different cases
+			if (!isCaseSensitive && ((myChar | 0x20) == (myFind[myIndex] | 0x20)) && ((myChar | 0x20) >= 'a') && ((myChar | 0x20) <= 'z'))
+				continue;
+
+			break;
+		}
+
+		if (myIndex == theFindLength)
+			return(myOffset);
+	}
+
+	return(kSearchNoMatch);
 }
 
 
@@ -323,9 +608,6 @@ void QTText_EditText (WindowObject theWindowObject)
 {
 	ApplicationDataHdl		myAppData = NULL;
 	Movie					myMovie = NULL;
-	Track					myTrack = NULL;
-	Media					myMedia = NULL;
-	MediaHandler			myHandler = NULL;
 	DialogPtr				myDialog = NULL;
 	short					myItem;
 	short					myType;
@@ -339,9 +621,8 @@ void QTText_EditText (WindowObject theWindowObject)
 		goto bail;
 		
 	myMovie = (**theWindowObject).fMovie;
-	myTrack = (**myAppData).fTextTrack;
-	myMedia = GetTrackMedia(myTrack);
-	myHandler = (**myAppData).fTextHandler;
+	if ((**myAppData).fTextTrack == NULL)
+		goto bail;
 
 	// get the dialog that lets the user specify the text for the current sample
 	myDialog = GetNewDialog(kEditDialogID, NULL, (WindowPtr)-1);
@@ -366,92 +647,24 @@ void QTText_EditText (WindowObject theWindowObject)
 	
 	// if the user hit the OK button, save the text and update the text sample 
 	if (myItem == kEditOKIndex) {
-		Fixed			myWidth;
-		Fixed			myHeight;
-		Rect			myBounds;	
-		TimeValue		myMovieTime;
-		TimeValue		mySampleTime;			
-		TimeValue		myDuration;
-		TimeValue		myMediaSampleDuration;
-		TimeValue		myMediaSampleStartTime;
-		TimeValue		myMediaCurrentTime;
-		TimeValue		myInterestingTime;
-		long			myMediaSampleIndex;
+		QTTextTransactionPtr	myTransaction = NULL;
 
 		// get the text in the edittext field
 		GetDialogItemText(myItemHandle, gSampleText);
 		
-		// install that text as the current text media sample
-
-		// first, we need to find the start and duration for this media sample;
-		// get the current movie time and the time in media time of the current sample
-		myMovieTime = GetMovieTime(myMovie, NULL);
-			
-		myMediaCurrentTime = TrackTimeToMediaTime(myMovieTime, myTrack);
-				
-		// get detailed information about the start and duration of the current sample		
-		MediaTimeToSampleNum(	myMedia, 
-								myMediaCurrentTime, 
-								&myMediaSampleIndex, 
-								&myMediaSampleStartTime,
-								&myMediaSampleDuration);
-								
-		// see where this text starts
-		GetTrackNextInterestingTime(myTrack, nextTimeEdgeOK | nextTimeMediaSample, myMovieTime, -fixed1, &myInterestingTime, NULL);		
-
-		// get the duration of the current sample
-		myMovieTime = myInterestingTime;					
-		GetTrackNextInterestingTime(myTrack, nextTimeEdgeOK | nextTimeMediaSample, myMovieTime, fixed1, NULL, &myDuration);
-							
-		myErr = BeginMediaEdits(myMedia);
-		if (myErr != noErr) 
-			goto bail;
-				
-		// delete the existing text			
-		myErr = DeleteTrackSegment(myTrack, myInterestingTime, myDuration);
+		// install that text as the current text media sample; a transaction holding just this one replacement
+		// finds the sample, replaces it, and brings our caches and the movie controller up to date
+		myErr = QTText_BeginTransaction(theWindowObject, &myTransaction);
 		if (myErr != noErr) 
 			goto bail;
-			
-		// get the track bounds
-		GetTrackDimensions(myTrack, &myWidth, &myHeight);
-		myBounds.top = 0;
-		myBounds.left = 0;
-		myBounds.right = Fix2Long(myWidth);
-		myBounds.bottom = Fix2Long(myHeight);	
 
-		// write out the new data to the media
-		myErr = TextMediaAddTextSample(	myHandler, 
-										(Ptr)(&gSampleText[1]), 
-										gSampleText[0],
-										0,
-										0,
-										0,
-										NULL, 
-										NULL, 
-										teCenter,
-										&myBounds, 
-										dfClipToTextBox, 
-										0, 
-										0, 
-										0, 
-										NULL, 
-										myMediaSampleDuration, 
-										&mySampleTime);
-								
-		if (myErr != noErr) 
+		myErr = QTText_QueueSampleText(myTransaction, GetMovieTime(myMovie, NULL), (char *)(&gSampleText[1]), gSampleText[0]);
+		if (myErr != noErr) {
+			QTText_CancelTransaction(myTransaction);
 			goto bail;
-			
-		EndMediaEdits(myMedia);
-		
-		// insert the new media into the track
-		InsertMediaIntoTrack(myTrack, myInterestingTime, mySampleTime, myMediaSampleDuration, fixed1);
+		}
 
-		// stamp the movie as dirty
-		(**theWindowObject).fIsDirty = true;
-		
-		// update the chapter pop-up
-		if ((**theWindowObject).fController != NULL)
-			MCMovieChanged((**theWindowObject).fController, myMovie);
+		QTText_CommitTransaction(myTransaction);
 	}
 	
 bail:
@@ -462,88 +675,301 @@ bail:
 
 //////////
 //
-// QTText_TextProc
-// This function is called whenever a new text sample is about to be displayed.
-// We'll use it to grab the text of the current text sample.
-//
-// NOTE: The theRefCon parameter is a handle to a window object record.
+// QTText_ReplaceText
+// Let the user specify the text that replaces the search text, and then replace every occurrence of the search
+// text in the (first) text track of the specified window object with it.
 //
 //////////
 
-PASCAL_RTN OSErr QTText_TextProc (Handle theText, Movie theMovie, short *theDisplayFlag, long theRefCon)
+void QTText_ReplaceText (WindowObject theWindowObject) 
 {
-#pragma unused(theMovie, theRefCon)
-	char			*myTextPtr = NULL;
-	short			myTextSize;
-	short			myIndex;
-	
-	// on entry to this function, theText is a handle to the text sample data,
-	// which is a big-endian 16-bit length word followed by the text itself
-	myTextSize = EndianU16_BtoN(*(short *)(*theText));
-	myTextPtr = (char *)(*theText + sizeof(short));
+	ApplicationDataHdl		myAppData = NULL;
+	DialogPtr				myDialog = NULL;
+	short					myItem;
+	short					myType;
+	Handle					myItemHandle = NULL;
+	Rect					myRect;
+	Str255					myPrompt;
+	long					myCount = 0;
+	OSErr					myErr = noErr;
+		
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
+	if ((myAppData == NULL) || ((**myAppData).fTextTrack == NULL))
+		goto bail;
 
-	// copy the text into our global variable
-	for (myIndex = 1; myIndex <= myTextSize; myIndex++, myTextPtr++)
-		gSampleText[myIndex] = *myTextPtr;
+	// the edit dialog, with a different prompt, lets the user specify the replacement text
+	myDialog = GetNewDialog(kEditDialogID, NULL, (WindowPtr)-1);
+	if (myDialog == NULL)
+		goto bail;
 
-	gSampleText[0] = myTextSize;
+	SetDialogDefaultItem(myDialog, kEditOKIndex);
+	SetDialogCancelItem(myDialog, kEditCancelIndex);
 	
-	// ask for the default text display
-	*theDisplayFlag = txtProcDefaultDisplay;
+	QTText_CopyCStringToPascal(kReplacePrompt, myPrompt);
+	GetDialogItem(myDialog, kEditLabelIndex, &myType, &myItemHandle, &myRect);
+	SetDialogItemText(myItemHandle, myPrompt);
 
-	return(noErr);
-}
+	GetDialogItem(myDialog, kEditTextEditIndex, &myType, &myItemHandle, &myRect);
+	SetDialogItemText(myItemHandle, gReplaceText);
+	SelectDialogItemText(myDialog, kEditTextEditIndex, 0, 32767);	
+		
+	// now show the dialog
+	MacShowWindow(GetDialogWindow(myDialog));
+	MacSetPort(GetDialogPort(myDialog));
+	
+	do {
+		ModalDialog(gModalFilterUPP, &myItem);
+	} while ((myItem != kEditOKIndex) && (myItem != kEditCancelIndex));
+	
+	if (myItem == kEditOKIndex) {
+		GetDialogItemText(myItemHandle, gReplaceText);
+
+		// if the search text wasn't found (or the samples couldn't be changed), beep
+		myErr = QTText_ReplaceAllText(theWindowObject, gSearchText, gReplaceText, &myCount);
+		if ((myErr != noErr) || (myCount == 0))
+			QTFrame_Beep();
+	}
 
+bail:
+	if (myDialog != NULL)
+		DisposeDialog(myDialog);
+}
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////
-//
-// Text track utilities.
-//
-// Use these functions to manipulate text tracks in a movie.
-//
-///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //////////
 //
-// QTText_AddTextTrack
-// Add a text track containing some text data to a movie; return the new track to the caller.
-//
-// The theStrings parameter is an array of C strings; each element is the text for a certain span of frames
-// of the movie. The theFrames parameter is an array of frame counts; each of these counts determines how many
-// frames the corresponding text element in the theStrings array applies to; the sum of all the values in this
-// array should be equal to the total number of frames in the movie.
-//
-// If the isChapterTrack parameter is true, the text track is set to be a chapter track, attached to the (first)
-// track of type theType.
+// QTText_ExportSubtitles
+// Let the user specify a file, and then write the text in the (first) text track of the specified window object
+// to it as a subtitle file. We write a WebVTT file if the file name ends in ".vtt", and an SRT file otherwise.
+// If the export fails, we delete the file rather than leave a partial one behind.
 //
 //////////
 
-Track QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[], short theNumFrames, OSType theType, Boolean isChapterTrack)
+void QTText_ExportSubtitles (WindowObject theWindowObject)
 {
-	Track				myTypeTrack = NULL;
-	Track				myTextTrack = NULL;
-	Media				myMedia = NULL;
-	MediaHandler		myHandler = NULL;
-	TimeScale			myTimeScale;
-	MatrixRecord		myMatrix;
-	Fixed				myWidth;
-	Fixed				myHeight;
-	OSErr				myErr = noErr;
+	ApplicationDataHdl		myAppData = NULL;
+	FSSpec					myFile;
+	Boolean					myIsSelected = false;
+	Boolean					myIsReplacing = false;
+	Boolean					isCreated = false;
+	long					myCueCount = 0;
+	long					mySamplesPerSec = 0;
+	StringPtr 				myPrompt = QTUtils_ConvertCToPascalString(kExportPrompt);
+	StringPtr 				myFileName = QTUtils_ConvertCToPascalString(kExportFileName);
+	long					myFormat = kQTSub_FormatSRT;
+	short					myRefNum = kInvalidFileRefNum;
+	OSErr					myErr = noErr;
 
-	//////////
-	//
-	// find the target track
-	//
-	//////////
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
+	if ((myAppData == NULL) || ((**myAppData).fTextTrack == NULL))
+		goto bail;
 
-	// get the (first) track of the specified type; this track determines the width of the new text track
-	// and (if isChapterTrack is true) is the target of the new chapter track
-	myTypeTrack = GetMovieIndTrackType(theMovie, 1, theType, movieTrackMediaType);
-	if (myTypeTrack == NULL)
+	QTFrame_PutFile(myPrompt, myFileName, &myFile, &myIsSelected, &myIsReplacing);
+	if (!myIsSelected)
 		goto bail;
-	
-	// get the dimensions of the target track
-	GetTrackDimensions(myTypeTrack, &myWidth, &myHeight);
+
+	if ((myFile.name[0] >= 4) && (myFile.name[myFile.name[0] - 3] == '.') &&
+		((myFile.name[myFile.name[0] - 2] | 0x20) == 'v') &&
+		((myFile.name[myFile.name[0] - 1] | 0x20) == 't') &&
+		((myFile.name[myFile.name[0]] | 0x20) == 't'))
+		myFormat = kQTSub_FormatWebVTT;
+
+	// delete any existing file of that name
+	if (myIsReplacing) {
+		myErr = FSpDelete(&myFile);
+		if (myErr != noErr)
+			goto bail;
+	}
+
+	myErr = FSpCreate(&myFile, sigMoviePlayer, kExportFileType, smSystemScript);
+	if (myErr != noErr)
+		goto bail;
+
+	isCreated = true;
+
+	myErr = FSpOpenDF(&myFile, fsRdWrPerm, &myRefNum);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTText_ExportTextTrack((**myAppData).fTextTrack, myFormat, myRefNum, &myCueCount, &mySamplesPerSec);
+
+#if LOG_SUBTITLE_STATS
+	{
+		char				myString[256];
+
+		sprintf(myString, "subtitle export: %ld cues, %ld samples/s (error %d)\n", myCueCount, mySamplesPerSec, myErr);
+		QTText_LogSubtitleStats(myString);
+	}
+#endif
+
+bail:
+	if (myRefNum != kInvalidFileRefNum)
+		FSClose(myRefNum);
+
+	// if the file couldn't be written, delete what there is of it and beep
+	if (myErr != noErr) {
+		if (isCreated)
+			FSpDelete(&myFile);
+
+		QTFrame_Beep();
+	}
+
+	free(myPrompt);
+	free(myFileName);
+}
+
+
+//////////
+//
+// QTText_ImportSubtitles
+// Let the user select a subtitle file (SRT, WebVTT or TTML), and then add a text track made from it to the movie
+// in the specified window object; return the new track, or NULL if none was added.
+//
+//////////
+
+Track QTText_ImportSubtitles (WindowObject theWindowObject)
+{
+	Movie					myMovie = NULL;
+	Track					myTrack = NULL;
+	FSSpec					myFile;
+	OSType 					myTypeList[] = {kExportFileType};
+	QTTextImportStats		myStats;
+	short					myNumTypes = -1;
+	short					myRefNum = kInvalidFileRefNum;
+	OSErr					myErr = noErr;
+
+#if TARGET_OS_MAC
+	myNumTypes = 0;
+#endif
+
+	if (theWindowObject == NULL)
+		goto bail;
+
+	myMovie = (**theWindowObject).fMovie;
+	if (myMovie == NULL)
+		goto bail;
+
+	// subtitle files have all sorts of file types, so show every file
+	myErr = QTFrame_GetOneFileWithPreview(myNumTypes, (QTFrameTypeListPtr)myTypeList, &myFile, NULL);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = FSpOpenDF(&myFile, fsRdPerm, &myRefNum);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTText_ImportSubtitleFile(myMovie, myRefNum, &myTrack, &myStats);
+
+#if LOG_SUBTITLE_STATS
+	{
+		char				myString[256];
+
+		sprintf(myString, "subtitle import: %ld cues, %ld samples, %lu ticks, %ld bytes peak (error %d)\n",
+					myStats.fCueCount, myStats.fSampleCount, myStats.fTicks, myStats.fPeakBytes, myErr);
+		QTText_LogSubtitleStats(myString);
+	}
+#endif
+
+bail:
+	if (myRefNum != kInvalidFileRefNum)
+		FSClose(myRefNum);
+
+	// if the file couldn't be read, beep
+	if ((myErr != noErr) && (myErr != userCanceledErr))
+		QTFrame_Beep();
+
+	return(myTrack);
+}
+
+
+//////////
+//
+// QTText_TextProc
+// This function is called whenever a new text sample is about to be displayed.
+// We'll use it to grab the text of the current text sample.
+//
+// NOTE: The theRefCon parameter is a handle to a window object record.
+//
+//////////
+
+PASCAL_RTN OSErr QTText_TextProc (Handle theText, Movie theMovie, short *theDisplayFlag, long theRefCon)
+{
+#pragma unused(theMovie, theRefCon)
+	char			*myTextPtr = NULL;
+	short			myTextSize;
+	short			myIndex;
+	
+	// on entry to this function, theText is a handle to the text sample data,
+	// which is a big-endian 16-bit length word followed by the text itself
+	myTextSize = EndianU16_BtoN(*(short *)(*theText));
+	myTextPtr = (char *)(*theText + sizeof(short));
+
+	// copy the text into our global variable
+	for (myIndex = 1; myIndex <= myTextSize; myIndex++, myTextPtr++)
+		gSampleText[myIndex] = *myTextPtr;
+
+	gSampleText[0] = myTextSize;
+	
+	// ask for the default text display
+	*theDisplayFlag = txtProcDefaultDisplay;
+
+	return(noErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Text track utilities.
+//
+// Use these functions to manipulate text tracks in a movie.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTText_AddTextTrack
+// Add a text track containing some text data to a movie; return the new track to the caller.
+//
+// The theStrings parameter is an array of C strings; each element is the text for a certain span of frames
+// of the movie. The theFrames parameter is an array of frame counts; each of these counts determines how many
+// frames the corresponding text element in the theStrings array applies to; the sum of all the values in this
+// array should be equal to the total number of frames in the movie.
+//
+// If the isChapterTrack parameter is true, the text track is set to be a chapter track, attached to the (first)
+// track of type theType.
+//
+//////////
+
+Track QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[], short theNumFrames, OSType theType, Boolean isChapterTrack)
+{
+	Track				myTypeTrack = NULL;
+	Track				myTextTrack = NULL;
+	Media				myMedia = NULL;
+	MediaHandler		myHandler = NULL;
+	TimeScale			myTimeScale;
+	MatrixRecord		myMatrix;
+	Fixed				myWidth;
+	Fixed				myHeight;
+	WindowObject		myWindowObject = NULL;
+	ApplicationDataHdl	myAppData = NULL;
+	QTTextChapterTable	myTable;
+	Boolean				hasTable = false;
+	OSErr				myErr = noErr;
+
+	//////////
+	//
+	// find the target track
+	//
+	//////////
+
+	// get the (first) track of the specified type; this track determines the width of the new text track
+	// and (if isChapterTrack is true) is the target of the new chapter track
+	myTypeTrack = GetMovieIndTrackType(theMovie, 1, theType, movieTrackMediaType);
+	if (myTypeTrack == NULL)
+		goto bail;
+	
+	// get the dimensions of the target track
+	GetTrackDimensions(myTypeTrack, &myWidth, &myHeight);
 	myTimeScale = GetMediaTimeScale(GetTrackMedia(myTypeTrack));
 	
 	//////////
@@ -575,6 +1001,15 @@ Track QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[]
 	
 	SetTrackMatrix(myTextTrack, &myMatrix);	
 	SetTrackEnabled(myTextTrack, true);
+
+	// if the new track is to be a chapter track of the front window's movie, we fill in the window's chapter
+	// table as we add the samples, instead of reading them all back the next time the table is needed
+	myWindowObject = QTFrame_GetWindowObjectFromFrontWindow();
+	if (isChapterTrack && (myWindowObject != NULL) && ((**myWindowObject).fMovie == theMovie))
+		myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(myWindowObject);
+
+	if (myAppData != NULL)
+		hasTable = (QTText_NewChapterTable(&myTable, myTextTrack, theNumFrames) == noErr);
 	
 	//////////
 	//
@@ -587,7 +1022,14 @@ Track QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[]
 		Rect				myBounds;	
 		short				myIndex;
 		TimeValue			myTypeSampleDuration;
+		TimeValue			myMediaTime = 0;
 		TimeRecord			myTimeRec;
+#if USE_TEXTWRITER
+		QTTextWriterPtr				myWriter = NULL;
+#elif USE_ADDMEDIASAMPLE
+		TextDescriptionHandle		mySampleDesc = NULL;
+		Handle						mySample = NULL;
+#endif
 		
 		myBounds.top = 0;
 		myBounds.left = 0;
@@ -597,6 +1039,28 @@ Track QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[]
 		// determine the duration of a sample in the track of the specified type
 		myTypeSampleDuration = QTUtils_GetFrameDuration(myTypeTrack);
 				
+#if USE_TEXTWRITER
+		// collect the samples into large chunks
+		myErr = QTText_NewTextWriter(myMedia, &myBounds, kTextWriterChunkSize, &myWriter);
+		if (myErr != noErr) {
+			EndMediaEdits(myMedia);
+			goto bail;
+		}
+#elif USE_ADDMEDIASAMPLE
+		// all the samples share one sample description, so that the media gets just one entry in its sample
+		// description table; and all the samples are built in one buffer, big enough for the longest sample
+		mySampleDesc = QTText_NewTextDescription(&myBounds);
+		mySample = NewHandle(sizeof(UInt16) + 255);
+		if ((mySampleDesc == NULL) || (mySample == NULL)) {
+			if (mySampleDesc != NULL)
+				DisposeHandle((Handle)mySampleDesc);
+			if (mySample != NULL)
+				DisposeHandle(mySample);
+			EndMediaEdits(myMedia);
+			goto bail;
+		}
+#endif
+
 
 		for (myIndex = 0; myIndex < theNumFrames; myIndex++) {
 			TimeValue		myTextSampleDuration;
@@ -613,44 +1077,24 @@ Track QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[]
 
 			QTText_CopyCStringToPascal(theStrings[myIndex], mySampleText);
 			
-#if USE_ADDMEDIASAMPLE
+#if USE_TEXTWRITER
+			myErr = QTText_WriteTextSample(myWriter, (char *)(&mySampleText[1]), mySampleText[0], myTextSampleDuration);
+#elif USE_ADDMEDIASAMPLE
 			{
-				TextDescriptionHandle		mySampleDesc = NULL;
-				Handle						mySample = NULL;
-				UInt16						myLength;
-				RGBColor					myBGColor = {0xffff, 0xffff, 0xffff};
+				long						mySize;
 
-				mySampleDesc = (TextDescriptionHandle)NewHandleClear(sizeof(TextDescription));
-				if (mySampleDesc == NULL)
-					goto bail;
-					
-				(**mySampleDesc).descSize = sizeof(TextDescription);
-				(**mySampleDesc).dataFormat = TextMediaType;
-				(**mySampleDesc).displayFlags = dfClipToTextBox;
-				(**mySampleDesc).textJustification = teCenter;
-				(**mySampleDesc).defaultTextBox = myBounds;
-				(**mySampleDesc).bgColor = myBGColor;
+				// create the text media sample in the sample buffer: a 16-bit length word followed by the text
+				mySize = QTFile_PutTextSample((unsigned char *)*mySample, (char *)&mySampleText[1], mySampleText[0]);
 				
-				myLength = EndianU16_NtoB(mySampleText[0]);
-
-				// create the text media sample: a 16-bit length word followed by the text
-				myErr = PtrToHand(&myLength, &mySample, sizeof(myLength));
-				if (myErr == noErr) {
-					myErr = PtrAndHand((Ptr)(&mySampleText[1]), mySample, mySampleText[0]);
-					if (myErr == noErr)
-						AddMediaSample(	myMedia,
+				myErr = AddMediaSample(	myMedia,
 										mySample,
 										0,
-										GetHandleSize(mySample),
+										mySize,
 										myTextSampleDuration,
 										(SampleDescriptionHandle)mySampleDesc,
 										1,
 										0,
 										NULL);
-					DisposeHandle(mySample);
-				}
-				
-				DisposeHandle((Handle)mySampleDesc);
 			}
 #else
 			// write out the new data to the media
@@ -672,7 +1116,26 @@ Track QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[]
 											myTextSampleDuration,
 											NULL);
 #endif
+
+			// the table holds media times for now; a sample that couldn't be added leaves a hole in the
+			// media, so then we give up on the table
+			if (hasTable) {
+				if ((myErr != noErr) || (QTText_AddTableChapter(&myTable, myMediaTime, (char *)(&mySampleText[1]), mySampleText[0]) != noErr)) {
+					DisposeHandle(myTable.fChapters);
+					DisposeHandle(myTable.fText);
+					hasTable = false;
+				}
+			}
+
+			myMediaTime += myTextSampleDuration;
 		}
+
+#if USE_TEXTWRITER
+		QTText_DisposeTextWriter(myWriter, NULL);
+#elif USE_ADDMEDIASAMPLE
+		DisposeHandle(mySample);
+		DisposeHandle((Handle)mySampleDesc);
+#endif
 	}
 
 	myErr = EndMediaEdits(myMedia);
@@ -699,9 +1162,29 @@ Track QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[]
 	//////////
 	
 	if (isChapterTrack)
-		AddTrackReference(myTypeTrack, myTextTrack, kTrackReferenceChapterList, NULL);
+		QTText_AddTrackReference(myTypeTrack, myTextTrack, kTrackReferenceChapterList, NULL);
+
+	// now that the media is in the track, turn the media times in the chapter table into track times
+	if (hasTable) {
+		QTTextChapter		*myChapters = NULL;
+		long				myIndex;
+
+		HLock(myTable.fChapters);
+		myChapters = (QTTextChapter *)*myTable.fChapters;
+		for (myIndex = 0; myIndex < myTable.fCount; myIndex++)
+			myChapters[myIndex].fStart = QTText_MediaTimeToTrackTime(myTextTrack, myChapters[myIndex].fStart);
+		HUnlock(myTable.fChapters);
+
+		QTText_InstallChapterTable(myAppData, &myTable);
+		hasTable = false;
+	}
 
 bail:
+	if (hasTable) {
+		DisposeHandle(myTable.fChapters);
+		DisposeHandle(myTable.fText);
+	}
+
 	return(myTextTrack);
 }
 
@@ -717,6 +1200,7 @@ bail:
 
 OSErr QTText_RemoveIndTextTrack (WindowObject theWindowObject, short theIndex)
 {
+	ApplicationDataHdl	myAppData = NULL;
 	MovieController 	myMC = NULL;
 	Movie				myMovie = NULL;
 	Track				myTrack = NULL;
@@ -725,9 +1209,13 @@ OSErr QTText_RemoveIndTextTrack (WindowObject theWindowObject, short theIndex)
 	if (theWindowObject == NULL)
 		return(paramErr);
 			
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
 	myMC = (**theWindowObject).fController;
 	myMovie = (**theWindowObject).fMovie;
 
+	// the chapter table may describe one of the tracks we're about to remove
+	QTText_DisposeChapterTable(myAppData);
+
 	if (theIndex == kAllTextTracks) {
 		// remove ALL text tracks from the movie
 		myTrack = GetMovieIndTrackType(myMovie, 1, TextMediaType, movieTrackMediaType);
@@ -735,7 +1223,9 @@ OSErr QTText_RemoveIndTextTrack (WindowObject theWindowObject, short theIndex)
 			myErr = badTrackIndex;
 				
 		while (myTrack != NULL) {
-			QTUtils_DeleteAllReferencesToTrack(myTrack);
+			QTTextEnc_CacheFlushOwner(gTextCache, GetTrackMedia(myTrack));
+			QTText_InvalidateEditIndex(myTrack);
+			QTText_DeleteAllReferencesToTrack(myTrack);
 			MCMovieChanged(myMC, myMovie);
 			DisposeMovieTrack(myTrack);
 			myTrack = GetMovieIndTrackType(myMovie, 1, TextMediaType, movieTrackMediaType);
@@ -746,7 +1236,9 @@ OSErr QTText_RemoveIndTextTrack (WindowObject theWindowObject, short theIndex)
 		if (myTrack == NULL) {
 			myErr = badTrackIndex;
 		} else {
-			QTUtils_DeleteAllReferencesToTrack(myTrack);
+			QTTextEnc_CacheFlushOwner(gTextCache, GetTrackMedia(myTrack));
+			QTText_InvalidateEditIndex(myTrack);
+			QTText_DeleteAllReferencesToTrack(myTrack);
 			MCMovieChanged(myMC, myMovie);
 			DisposeMovieTrack(myTrack);
 		}
@@ -758,406 +1250,3348 @@ OSErr QTText_RemoveIndTextTrack (WindowObject theWindowObject, short theIndex)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-// Chapter track utilities.
+// Text media writer utilities.
 //
-// Use these functions to manipulate chapter tracks in a movie.
+// Use these functions to add text samples to a text media in large contiguous chunks.
 //
-// A chapter track is a text track that has been associated with some other track (often a video or sound
-// track) in such a way that the movie controller will build, display, and handle a pop-up menu of titles
-// of various parts of the associated track. The pop-up menu appears (space permitting) in the controller
-// bar. The various parts of the associated track are called the track's "chapters". When a user selects a
-// chapter title in the pop-up menu, the movie controller jumps to the start time of the selected chapter.
+// When we add text samples one at a time (with TextMediaAddTextSample or AddMediaSample), each sample can end
+// up in a chunk of its own, which bloats the media's sample-to-chunk and chunk offset tables and scatters
+// the text through the movie file. A text media writer instead collects consecutive samples in a buffer;
+// when the buffer holds a chunk's worth of data, it appends the whole buffer to the media's data file in one
+// go (inside an 'mdat' atom of its own) and then adds all those samples at once with AddMediaSampleReferences64,
+// so they form a single chunk. Consecutive samples that have the same size and duration share a single sample
+// reference record.
 //
-// You create the association between a text track and some other track by creating a reference from that
-// other track to the text track, where the reference is of type kTrackReferenceChapterList. Note that all
-// the chapter titles must be contained in a single text track; you specify the starting time for chapters
-// when you add the text to the text track by calling TextMediaAddTextSample. Note also that you need to
-// create the chapter association only between the text track and one other track, not between the chapter
-// track and all other tracks in the movie. (That "other" track must be enabled, but typically the chapter
-// track is not enabled.)
+// We use the 64-bit data handler and sample reference calls, so a writer can append text to a movie file that's
+// bigger than 4 GB.
 //
-// The pop-up menu will disappear from the controller bar if there isn't enough space to display the menu,
-// the volume slider control, the step buttons, and the other controls. 
+// All the samples added by a writer share one sample description. A writer must be used (and disposed of)
+// between calls to BeginMediaEdits and EndMediaEdits, since the media's data handler is open for writing
+// only during that time.
+//
+// If a chunk can't be written or its samples can't be added, we cut the data file back to its old size and add
+// the samples one at a time instead. QTText_AddTextTrack, QTText_CommitTransaction and QTText_ImportSubtitleFile
+// use a writer only if the USE_TEXTWRITER compiler flag is set.
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //////////
 //
-// QTText_SetTextTrackAsChapterTrack
-// Set the (first) text track in the specified movie to be or not to be a chapter track
-// for the (first) enabled track of the specified type.
+// QTText_NewTextDescription
+// Return a new text sample description for centered text clipped to the specified text box.
 //
-// The isChapterTrack parameter determines the final state of the text track.
+// We fill in the description just as TextMediaAddTextSample does when it's passed a font number and size of 0
+// and no colors: black text in the default size of the system font, on a white background. The name of the
+// font follows the description, so that the text looks the same on a machine that numbers its fonts differently.
+//
+// The caller is responsible for disposing of the handle returned by this function (by calling DisposeHandle).
 //
 //////////
 
-OSErr QTText_SetTextTrackAsChapterTrack (WindowObject theWindowObject, OSType theType, Boolean isChapterTrack)
+TextDescriptionHandle QTText_NewTextDescription (const Rect *theBounds)
 {
-	ApplicationDataHdl		myAppData = NULL;
-	Movie					myMovie = NULL;
-	MovieController			myMC = NULL;
-	Track					myTypeTrack = NULL;
-	Track					myTextTrack = NULL;
-	OSErr					myErr = paramErr;
-		
-	// get the movie, controller, and related stuff	
-	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
-	if (myAppData == NULL)
-		return(myErr);
-		
-	myMovie = (**theWindowObject).fMovie;
-	myMC = (**theWindowObject).fController;
-	myTextTrack = (**myAppData).fTextTrack;
-	
-	if ((myMovie != NULL) && (myMC != NULL)) {
-		myTypeTrack = GetMovieIndTrackType(myMovie, 1, theType, movieTrackMediaType | movieTrackEnabledOnly);
-		if ((myTypeTrack != NULL) && (myTextTrack != NULL)) {
-		
-			// add or delete a track reference, as determined by the desired final state
-			if (isChapterTrack)
-				myErr = AddTrackReference(myTypeTrack, myTextTrack, kTrackReferenceChapterList, NULL);
-			else
-				myErr = DeleteTrackReference(myTypeTrack, kTrackReferenceChapterList, 1);
-				
-			// tell the movie controller we've changed aspects of the movie
-			MCMovieChanged(myMC, myMovie);
-			
-			// stamp the movie as dirty
-			(**theWindowObject).fIsDirty = true;
-		}
+	TextDescriptionHandle		myDesc = NULL;
+	RGBColor					myBGColor = {0xffff, 0xffff, 0xffff};
+	RGBColor					myTextColor = {0x0000, 0x0000, 0x0000};
+	FontInfo					myMetrics;
+	Str255						myFontName;
+	long						mySize;
+
+	GetFontName(kTextWriterFontID, myFontName);
+
+	// the description ends with the font name (a Pascal string), whose length byte is already counted
+	mySize = sizeof(TextDescription) + myFontName[0];
+
+	myDesc = (TextDescriptionHandle)NewHandleClear(mySize);
+	if (myDesc == NULL)
+		return(NULL);
+
+	(**myDesc).descSize = mySize;
+	(**myDesc).dataFormat = TextMediaType;
+	(**myDesc).dataRefIndex = kTextWriterDataRefIndex;
+	(**myDesc).displayFlags = dfClipToTextBox;
+	(**myDesc).textJustification = teCenter;
+	(**myDesc).bgColor = myBGColor;
+	(**myDesc).defaultTextBox = *theBounds;
+
+	(**myDesc).defaultStyle.scrpStartChar = 0;
+	(**myDesc).defaultStyle.scrpFont = kTextWriterFontID;
+	(**myDesc).defaultStyle.scrpFace = normal;
+	(**myDesc).defaultStyle.scrpSize = kTextWriterFontSize;
+	(**myDesc).defaultStyle.scrpColor = myTextColor;
+
+	// the line height and ascent of the default style
+	if (FetchFontInfo(kTextWriterFontID, kTextWriterFontSize, normal, &myMetrics) == noErr) {
+		(**myDesc).defaultStyle.scrpHeight = myMetrics.ascent + myMetrics.descent + myMetrics.leading;
+		(**myDesc).defaultStyle.scrpAscent = myMetrics.ascent;
 	}
 
-	return(myErr);
+	BlockMove(myFontName, (**myDesc).defaultFontName, myFontName[0] + 1);
+
+	return(myDesc);
 }
 
 
 //////////
 //
-// QTText_TrackTypeHasAChapterTrack
-// Does the (first) enabled track of the specified type in the specified movie have a chapter track?
+// QTText_NewTextWriter
+// Create a new text media writer for the specified media; return it through theWriter.
+//
+// Samples are written in chunks of (about) theChunkSize bytes; pass 0 to use kTextWriterChunkSize.
 //
 //////////
 
-Boolean QTText_TrackTypeHasAChapterTrack (Movie theMovie, OSType theType)
+OSErr QTText_NewTextWriter (Media theMedia, const Rect *theBounds, long theChunkSize, QTTextWriterPtr *theWriter)
 {
-	Track					myTypeTrack = NULL;
-	Track					myTextTrack = NULL;
-		
-	myTypeTrack = GetMovieIndTrackType(theMovie, 1, theType, movieTrackMediaType | movieTrackEnabledOnly);
-	if (myTypeTrack != NULL)
-		myTextTrack = GetTrackReference(myTypeTrack, kTrackReferenceChapterList, 1);
+	QTTextWriterPtr		myWriter = NULL;
+	OSErr				myErr = noErr;
 
-	return(myTextTrack != NULL);
-}
+	if (theWriter == NULL)
+		return(paramErr);
 
+	*theWriter = NULL;
 
-//////////
-//
-// QTText_TrackHasAChapterTrack
-// Does the specified track have a chapter track?
-//
-//////////
+	if ((theMedia == NULL) || (theBounds == NULL))
+		return(paramErr);
 
-Boolean QTText_TrackHasAChapterTrack (Track theTrack)
-{
-	return(GetTrackReference(theTrack, kTrackReferenceChapterList, 1) != NULL);
-}
+	if (theChunkSize <= 0)
+		theChunkSize = kTextWriterChunkSize;
+
+	myWriter = (QTTextWriterPtr)NewPtrClear(sizeof(QTTextWriter));
+	if (myWriter == NULL)
+		return(memFullErr);
+
+	myWriter->fMedia = theMedia;
+	myWriter->fChunkSize = theChunkSize;
+	myWriter->fFirstTime = kBogusStartingTime;
+	myWriter->fDesc = QTText_NewTextDescription(theBounds);
+	myWriter->fChunk = NewHandle(theChunkSize);
+	myWriter->fRefs = NewHandle(kTextWriterMinRefs * sizeof(SampleReference64Record));
+	if ((myWriter->fDesc == NULL) || (myWriter->fChunk == NULL) || (myWriter->fRefs == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myWriter->fBytes = sizeof(QTTextWriter) + GetHandleSize((Handle)myWriter->fDesc) + GetHandleSize(myWriter->fChunk) + GetHandleSize(myWriter->fRefs);
+	myWriter->fPeakBytes = myWriter->fBytes;
+
+	// if we ever have to fall back to adding the samples one at a time, let QuickTime group them into chunks
+	SetMediaPreferredChunkSize(theMedia, theChunkSize);
+
+bail:
+	if (myErr != noErr)
+		QTText_DiscardTextWriter(myWriter);
+	else
+		*theWriter = myWriter;
+
+	return(myErr);
+}
 
 
 //////////
 //
-// QTText_MovieHasAChapterTrack
-// Does the specified movie have a chapter track? In other words, is there are least one enabled track
-// in the specified movie that has a chapter track associated wih it?
+// QTText_WriteTextSample
+// Add a text sample having the specified text and duration to the specified text media writer.
+//
+// The text is in the encoding of the sample description's font (or is Unicode text with a byte order mark).
+// The sample might not be added to the media until the writer is flushed or disposed of.
 //
 //////////
 
-Boolean QTText_MovieHasAChapterTrack (Movie theMovie)
+OSErr QTText_WriteTextSample (QTTextWriterPtr theWriter, const char *theText, long theLength, TimeValue theDuration)
 {
-	long		myCount;
-	long		myTrackCount = GetMovieTrackCount(theMovie);
-	Track		myTrack = NULL;
-	Boolean		myGotChapter = false;
-	
-	for (myCount = 1; myCount <= myTrackCount; myCount++) {
-		myTrack = GetMovieIndTrack(theMovie, myCount);
-		if (GetTrackEnabled(myTrack))
-			myGotChapter = QTText_TrackHasAChapterTrack(myTrack);
-			if (myGotChapter)
-				break;
+	SampleReference64Ptr	myRef = NULL;
+	long				mySize;
+	long				myRefsSize;
+	OSErr				myErr = noErr;
+
+	if ((theWriter == NULL) || (theLength < 0) || (theLength > kQTFile_MaxTextLength))
+		return(paramErr);
+
+	// a text media sample is a 16-bit length word followed by the text
+	mySize = sizeof(UInt16) + theLength;
+
+	// if this sample won't fit into the current chunk, write out the current chunk
+	if ((theWriter->fChunkBytes > 0) && (theWriter->fChunkBytes + mySize > theWriter->fChunkSize)) {
+		myErr = QTText_FlushTextWriter(theWriter);
+		if (myErr != noErr)
+			return(myErr);
 	}
-	
-	return(myGotChapter);
+
+	// make sure there's room for the sample in the buffer (a single sample can be bigger than a chunk)
+	if (theWriter->fChunkBytes + mySize > GetHandleSize(theWriter->fChunk)) {
+		myErr = QTText_ResizeTextWriterHandle(theWriter, theWriter->fChunk, theWriter->fChunkBytes + mySize);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	QTFile_PutTextSample((unsigned char *)*theWriter->fChunk + theWriter->fChunkBytes, theText, theLength);
+
+	// add the sample to the last sample reference record, if it's just like the samples already there
+	if (theWriter->fRefCount > 0) {
+		myRef = (SampleReference64Ptr)*theWriter->fRefs + (theWriter->fRefCount - 1);
+		if ((myRef->dataSize == mySize) && (myRef->durationPerSample == theDuration) && (myRef->dataOffset.lo + (myRef->dataSize * myRef->numberOfSamples) == theWriter->fChunkBytes)) {
+			myRef->numberOfSamples++;
+			goto done;
+		}
+	}
+
+	// otherwise, start a new sample reference record
+	myRefsSize = GetHandleSize(theWriter->fRefs);
+	if ((theWriter->fRefCount + 1) * (long)sizeof(SampleReference64Record) > myRefsSize) {
+		myErr = QTText_ResizeTextWriterHandle(theWriter, theWriter->fRefs, 2 * myRefsSize);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	// until the chunk is written, the data offset is the offset of the sample in fChunk
+	myRef = (SampleReference64Ptr)*theWriter->fRefs + theWriter->fRefCount;
+	myRef->dataOffset.hi = 0;
+	myRef->dataOffset.lo = theWriter->fChunkBytes;
+	myRef->dataSize = mySize;
+	myRef->durationPerSample = theDuration;
+	myRef->numberOfSamples = 1;
+	myRef->sampleFlags = 0;
+	theWriter->fRefCount++;
+
+done:
+	theWriter->fChunkBytes += mySize;
+	theWriter->fSampleCount++;
+	return(noErr);
 }
 
 
 //////////
 //
-// QTText_GetChapterTrackForTrack
-// Return the first chapter track (if any) associated with the specified track.
+// QTText_FlushTextWriter
+// Add all the samples in the buffer of the specified text media writer to its media, as a single chunk.
 //
 //////////
 
-Track QTText_GetChapterTrackForTrack (Track theTrack)
+OSErr QTText_FlushTextWriter (QTTextWriterPtr theWriter)
 {
-	return(GetTrackReference(theTrack, kTrackReferenceChapterList, 1));
+	DataHandler				myDataHandler = NULL;
+	SampleReference64Ptr	myRefs = NULL;
+	TimeValue				myTime = kBogusStartingTime;
+	wide					myFileSize = {0, 0};
+	wide					myOffset = {0, 0};
+	wide					myHeaderSize = {0, 0};
+	UInt32					myHeader[2];
+	long					myIndex;
+	long					mySample;
+	OSErr					myErr = noErr;
+
+	if (theWriter == NULL)
+		return(paramErr);
+
+	if (theWriter->fRefCount == 0)
+		return(noErr);
+
+	HLock(theWriter->fChunk);
+	HLock(theWriter->fRefs);
+	myRefs = (SampleReference64Ptr)*theWriter->fRefs;
+
+	// append the buffer to the end of the media's data file, wrapped in a media data atom so that the file
+	// remains a valid sequence of top-level atoms, and then point the new samples at the atom's data
+	myDataHandler = GetMediaDataHandler(theWriter->fMedia, kTextWriterDataRefIndex);
+	if (myDataHandler != NULL)
+		myErr = DataHGetFileSize64(myDataHandler, &myFileSize);
+
+	if ((myDataHandler != NULL) && (myErr == noErr)) {
+		myOffset = myFileSize;
+		myHeader[0] = EndianU32_NtoB((UInt32)(kAtomHeaderSize + theWriter->fChunkBytes));
+		myHeader[1] = EndianU32_NtoB(kTextWriterDataAtomType);
+		myErr = DataHWrite64(myDataHandler, (Ptr)myHeader, &myOffset, kAtomHeaderSize, NULL, 0);
+
+		if (myErr == noErr) {
+			myHeaderSize.hi = 0;
+			myHeaderSize.lo = kAtomHeaderSize;
+			WideAdd(&myOffset, &myHeaderSize);
+			myErr = DataHWrite64(myDataHandler, *theWriter->fChunk, &myOffset, theWriter->fChunkBytes, NULL, 0);
+		}
+
+		if (myErr == noErr) {
+			for (myIndex = 0; myIndex < theWriter->fRefCount; myIndex++)
+				WideAdd(&myRefs[myIndex].dataOffset, &myOffset);
+
+			myErr = AddMediaSampleReferences64(theWriter->fMedia, (SampleDescriptionHandle)theWriter->fDesc, theWriter->fRefCount, myRefs, &myTime);
+
+			// put the offsets back the way they were, in case we need to fall back on AddMediaSample
+			for (myIndex = 0; myIndex < theWriter->fRefCount; myIndex++)
+				WideSubtract(&myRefs[myIndex].dataOffset, &myOffset);
+		}
+
+		// if anything went wrong, cut the file back to where it ended: a partly written atom would corrupt it,
+		// and a completely written one that no sample refers to would hold a second copy of the text once we've
+		// added the samples one at a time; if we can't cut the file back, we can't safely add anything after it
+		if (myErr != noErr) {
+			if (DataHSetFileSize64(myDataHandler, &myFileSize) != noErr)
+				goto bail;
+		}
+	}
+
+	// if the data handler isn't able to write the chunk for us, add the samples one at a time
+	if ((myDataHandler == NULL) || (myErr != noErr)) {
+		myErr = noErr;
+		myTime = kBogusStartingTime;
+
+		for (myIndex = 0; (myIndex < theWriter->fRefCount) && (myErr == noErr); myIndex++) {
+			for (mySample = 0; (mySample < myRefs[myIndex].numberOfSamples) && (myErr == noErr); mySample++) {
+				TimeValue	mySampleTime;
+
+				myErr = AddMediaSample(	theWriter->fMedia,
+										theWriter->fChunk,
+										myRefs[myIndex].dataOffset.lo + (mySample * myRefs[myIndex].dataSize),
+										myRefs[myIndex].dataSize,
+										myRefs[myIndex].durationPerSample,
+										(SampleDescriptionHandle)theWriter->fDesc,
+										1,
+										myRefs[myIndex].sampleFlags,
+										&mySampleTime);
+
+				if (myTime == kBogusStartingTime)
+					myTime = mySampleTime;
+			}
+		}
+	}
+
+bail:
+	HUnlock(theWriter->fRefs);
+	HUnlock(theWriter->fChunk);
+
+	if (myErr == noErr) {
+		if (theWriter->fFirstTime == kBogusStartingTime)
+			theWriter->fFirstTime = myTime;
+
+		theWriter->fChunkCount++;
+		theWriter->fChunkBytes = 0;
+		theWriter->fRefCount = 0;
+	}
+
+	return(myErr);
 }
 
 
 //////////
 //
-// QTText_GetChapterTrackForMovie
-// Return the first chapter track (if any) in the specified movie.
-//
-// A movie can have more than one chapter track; if so, QuickTime uses the chapter track associated
-// with the first enabled track that it finds. Accordingly, this function returns the first chapter
-// track that we find as we iterate thru the movie's tracks.
+// QTText_DisposeTextWriter
+// Flush the specified text media writer and dispose of it; return, through theFirstTime, the media time of the
+// first sample added by the writer (or kBogusStartingTime, if it didn't add any).
 //
 //////////
 
-Track QTText_GetChapterTrackForMovie (Movie theMovie)
+OSErr QTText_DisposeTextWriter (QTTextWriterPtr theWriter, TimeValue *theFirstTime)
 {
-	long		myCount;
-	long		myTrackCount = GetMovieTrackCount(theMovie);
-	Track		myTrack = NULL;
-	Track		myChapTrack = NULL;
-	
-	for (myCount = 1; myCount <= myTrackCount; myCount++) {
-		myTrack = GetMovieIndTrack(theMovie, myCount);
-		if (GetTrackEnabled(myTrack))
-			myChapTrack = QTText_GetChapterTrackForTrack(myTrack);
-			if (myChapTrack != NULL)
-				break;
-	}
-	
-	return(myChapTrack);
+	OSErr				myErr = noErr;
+
+	if (theFirstTime != NULL)
+		*theFirstTime = kBogusStartingTime;
+
+	if (theWriter == NULL)
+		return(paramErr);
+
+	if ((theWriter->fDesc != NULL) && (theWriter->fChunk != NULL) && (theWriter->fRefs != NULL))
+		myErr = QTText_FlushTextWriter(theWriter);
+
+	if (theFirstTime != NULL)
+		*theFirstTime = theWriter->fFirstTime;
+
+	QTText_DiscardTextWriter(theWriter);
+	return(myErr);
 }
 
 
 //////////
 //
-// QTText_IsChapterTrack
-// Is the specified track a chapter track?
+// QTText_DiscardTextWriter
+// Dispose of the specified text media writer without adding the samples still in its buffer to its media; use
+// this instead of QTText_DisposeTextWriter when the samples written so far aren't wanted after all.
 //
 //////////
 
-Boolean QTText_IsChapterTrack (Track theTrack)
+void QTText_DiscardTextWriter (QTTextWriterPtr theWriter)
 {
-	Movie				myMovie = NULL;
-	Track				myTrack = NULL;
-	long				myTrackCount = 0L;
-	long				myTrRefCount = 0L;
-	long				myTrackIndex;
-	long				myTrRefIndex;
+	if (theWriter == NULL)
+		return;
 
-	myMovie = GetTrackMovie(theTrack);
-	if (myMovie == NULL)
-		return(false);
+	if (theWriter->fDesc != NULL)
+		DisposeHandle((Handle)theWriter->fDesc);
 
-	// a chapter track is a text track that is referred to by some other track in the movie,
-	// so we need to iterate thru all those tracks to see if any of them refers to the specified track
-	myTrackCount = GetMovieTrackCount(myMovie);
-	for (myTrackIndex = 1; myTrackIndex <= myTrackCount; myTrackIndex++) {
-		myTrack = GetMovieIndTrack(myMovie, myTrackIndex);
-		if ((myTrack != NULL) && (myTrack != theTrack)) {
-		
-			// iterate thru all track references of type kTrackReferenceChapterList
-			myTrRefCount = GetTrackReferenceCount(myTrack, kTrackReferenceChapterList);
-			for (myTrRefIndex = 1; myTrRefIndex <= myTrRefCount; myTrRefIndex++) {
-				Track	myRefTrack = NULL;
-
-				myRefTrack = GetTrackReference(myTrack, kTrackReferenceChapterList, myTrRefIndex);
-				if (myRefTrack == theTrack)
-					return(true);
-			}
-		}
-	}
+	if (theWriter->fChunk != NULL)
+		DisposeHandle(theWriter->fChunk);
 
-	return(false);
+	if (theWriter->fRefs != NULL)
+		DisposeHandle(theWriter->fRefs);
+
+	DisposePtr((Ptr)theWriter);
 }
 
 
 //////////
 //
-// QTText_GetFirstChapterTime
-// Return, through the theTime parameter, the starting time of the first chapter of the
-// specified chapter track.
-//
-// If this function encounters an error, it returns a (bogus) starting time of -1. Note that
-// GetTrackNextInterestingTime also returns -1 as a starting time if the search criteria
-// specified in the myFlags parameter are not matched by any interesting time in the movie. 
+// QTText_ResizeTextWriterHandle
+// Resize the specified handle, which belongs to the specified text media writer, and keep track of the most
+// memory the writer has had allocated at once.
 //
 //////////
 
-OSErr QTText_GetFirstChapterTime (Track theChapterTrack, TimeValue *theTime)
+OSErr QTText_ResizeTextWriterHandle (QTTextWriterPtr theWriter, Handle theHandle, long theSize)
 {
-	short	myFlags = nextTimeMediaSample + nextTimeEdgeOK;	// we want the first sample in the movie
-	
-	if (theChapterTrack == NULL) {
-		*theTime = kBogusStartingTime;						// a bogus time
-		return(invalidTrack);
-	}
-	
-	GetTrackNextInterestingTime(theChapterTrack, myFlags, (TimeValue)0, fixed1, theTime, NULL);
-	return(GetMoviesError());
+	long				myOldSize;
+	OSErr				myErr = noErr;
+
+	if ((theWriter == NULL) || (theHandle == NULL))
+		return(paramErr);
+
+	myOldSize = GetHandleSize(theHandle);
+
+	SetHandleSize(theHandle, theSize);
+	myErr = MemError();
+	if (myErr != noErr)
+		return(myErr);
+
+	theWriter->fBytes += theSize - myOldSize;
+	if (theWriter->fBytes > theWriter->fPeakBytes)
+		theWriter->fPeakBytes = theWriter->fBytes;
+
+	return(noErr);
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Sample index utilities.
+//
+// Use these functions to find the bounds of the sample of a text track that is displayed at a given time.
+//
+// Finding the start and duration of the current sample the usual way takes a TrackTimeToMediaTime, a
+// MediaTimeToSampleNum and two GetTrackNextInterestingTime calls, each of which walks the track's edit list
+// and the media's run-length encoded sample tables. Instead, we walk the track once and record the start and
+// duration (in track time) and the media duration of every sample in flat arrays; after that, finding the
+// sample at a given time is a binary search.
+//
+// The index lives in the window's application data. It is rebuilt whenever the text track, its duration or
+// the number of samples in its media changes; edits that leave the sample bounds alone (such as replacing
+// the text of a sample with QTText_EditText) can mark it as still valid with QTText_RevalidateSampleIndex.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 //////////
 //
-// QTText_GetNextChapterTime
-// Return, through the theTime parameter, the starting time of the chapter of the
-// specified chapter track that immediately follows the chapter starting at the time
-// passed in through theTime.
+// QTText_BuildSampleIndex
+// Build the sample index for the text track of the specified application data.
 //
 //////////
 
-OSErr QTText_GetNextChapterTime (Track theChapterTrack, TimeValue *theTime)
+OSErr QTText_BuildSampleIndex (ApplicationDataHdl theAppData)
 {
-	short	myFlags = nextTimeMediaSample;					// we want the next sample in the movie
-	
-	if (theChapterTrack == NULL) {
-		*theTime = kBogusStartingTime;						// a bogus time
+	QTTextSampleIndex		myIndex;
+	Track					myTrack = NULL;
+	Media					myMedia = NULL;
+	TimeValue				myTime;
+	TimeValue				myDuration;
+	TimeValue				myMediaDuration;
+	long					mySampleNum;
+	long					mySize;
+	long					myCapacity;
+	OSErr					myErr = noErr;
+
+	if (theAppData == NULL)
+		return(paramErr);
+
+	QTText_DisposeSampleIndex(theAppData);
+
+	myTrack = (**theAppData).fTextTrack;
+	if (myTrack == NULL)
 		return(invalidTrack);
+
+	myMedia = GetTrackMedia(myTrack);
+
+	// the media sample count is a good first guess at the number of samples in the track
+	myCapacity = GetMediaSampleCount(myMedia);
+	if (myCapacity < 1)
+		myCapacity = 1;
+
+	myIndex.fTrack = myTrack;
+	myIndex.fTrackDuration = GetTrackDuration(myTrack);
+	myIndex.fMediaSampleCount = GetMediaSampleCount(myMedia);
+	myIndex.fCount = 0;
+	myIndex.fStarts = NewHandle(myCapacity * sizeof(TimeValue));
+	myIndex.fDurations = NewHandle(myCapacity * sizeof(TimeValue));
+	myIndex.fMediaDurations = NewHandle(myCapacity * sizeof(TimeValue));
+	if ((myIndex.fStarts == NULL) || (myIndex.fDurations == NULL) || (myIndex.fMediaDurations == NULL)) {
+		myErr = memFullErr;
+		goto bail;
 	}
+
+	GetTrackNextInterestingTime(myTrack, nextTimeMediaSample | nextTimeEdgeOK, (TimeValue)0, fixed1, &myTime, &myDuration);
+	while (myTime >= 0) {
 	
-	GetTrackNextInterestingTime(theChapterTrack, myFlags, *theTime, fixed1, theTime, NULL);
-	return(GetMoviesError());
+		// grow the arrays, if necessary
+		if (myIndex.fCount == myCapacity) {
+			myCapacity *= 2;
+			mySize = myCapacity * sizeof(TimeValue);
+			SetHandleSize(myIndex.fStarts, mySize);
+			if (MemError() == noErr)
+				SetHandleSize(myIndex.fDurations, mySize);
+			if (MemError() == noErr)
+				SetHandleSize(myIndex.fMediaDurations, mySize);
+			myErr = MemError();
+			if (myErr != noErr)
+				goto bail;
+		}
+
+		MediaTimeToSampleNum(myMedia, QTText_TrackTimeToMediaTime(myTrack, myTime), &mySampleNum, NULL, &myMediaDuration);
+
+		((TimeValue *)*myIndex.fStarts)[myIndex.fCount] = myTime;
+		((TimeValue *)*myIndex.fDurations)[myIndex.fCount] = myDuration;
+		((TimeValue *)*myIndex.fMediaDurations)[myIndex.fCount] = myMediaDuration;
+		myIndex.fCount++;
+
+		GetTrackNextInterestingTime(myTrack, nextTimeMediaSample, myTime, fixed1, &myTime, &myDuration);
+	}
+
+	(**theAppData).fSampleIndex = myIndex;
+
+bail:
+	if (myErr != noErr) {
+		if (myIndex.fStarts != NULL)
+			DisposeHandle(myIndex.fStarts);
+
+		if (myIndex.fDurations != NULL)
+			DisposeHandle(myIndex.fDurations);
+
+		if (myIndex.fMediaDurations != NULL)
+			DisposeHandle(myIndex.fMediaDurations);
+	}
+
+	return(myErr);
 }
 
 
 //////////
 //
-// QTText_GetIndChapterTime
-// Return the starting time of the chapter in the specified chapter track that has the specified index.
+// QTText_DisposeSampleIndex
+// Dispose of the sample index of the specified application data.
 //
 //////////
 
-TimeValue QTText_GetIndChapterTime (Track theChapterTrack, long theIndex)
+void QTText_DisposeSampleIndex (ApplicationDataHdl theAppData)
 {
-	long			myCount = 1;
-	TimeValue		myTime = kBogusStartingTime;
+	if (theAppData == NULL)
+		return;
 
-	if ((theChapterTrack == NULL) || (theIndex < 1))
-		return(myTime);
+	if ((**theAppData).fSampleIndex.fStarts != NULL)
+		DisposeHandle((**theAppData).fSampleIndex.fStarts);
 
-	QTText_GetFirstChapterTime(theChapterTrack, &myTime);
-	if (theIndex == 1)
-		return(myTime);
-		
-	while (myCount < theIndex) {
-		QTText_GetNextChapterTime(theChapterTrack, &myTime);
-		myCount++;
-	}
-	
-	return(myTime);
+	if ((**theAppData).fSampleIndex.fDurations != NULL)
+		DisposeHandle((**theAppData).fSampleIndex.fDurations);
+
+	if ((**theAppData).fSampleIndex.fMediaDurations != NULL)
+		DisposeHandle((**theAppData).fSampleIndex.fMediaDurations);
+
+	(**theAppData).fSampleIndex.fTrack = NULL;
+	(**theAppData).fSampleIndex.fCount = 0;
+	(**theAppData).fSampleIndex.fStarts = NULL;
+	(**theAppData).fSampleIndex.fDurations = NULL;
+	(**theAppData).fSampleIndex.fMediaDurations = NULL;
 }
 
 
 //////////
 //
-// QTText_GetIndChapterText
-// Return the text of the chapter in the specified chapter track that has the specified index.
-//
-// The caller is responsible for disposing of the pointer returned by this function (by calling free).
+// QTText_IsSampleIndexValid
+// Is the sample index of the specified application data up to date?
 //
 //////////
 
-char *QTText_GetIndChapterText (Track theChapterTrack, long theIndex)
+Boolean QTText_IsSampleIndexValid (ApplicationDataHdl theAppData)
 {
-	long			myCount = 1;
-	long			mySize;			// size of entire handle returned, which may include appended style atoms
-	short			myTextSize;
-	TimeValue		myTime;
-	Handle			myHandle = NewHandleClear(0);
-	char			*myText = NULL;
+	Track				myTrack = NULL;
 
-	if ((theChapterTrack == NULL) || (theIndex < 1))
-		return(myText);
+	if (theAppData == NULL)
+		return(false);
 
-	if (myHandle == NULL)
-		return(myText);
+	myTrack = (**theAppData).fTextTrack;
+	if ((myTrack == NULL) || ((**theAppData).fSampleIndex.fStarts == NULL) || ((**theAppData).fSampleIndex.fTrack != myTrack))
+		return(false);
 
-	myTime = QTText_GetIndChapterTime(theChapterTrack, theIndex);
-	if (myTime != kBogusStartingTime) {
-	
-		GetMediaSample(	GetTrackMedia(theChapterTrack),
-						myHandle,
-						0,
-						&mySize,
-						TrackTimeToMediaTime(myTime, theChapterTrack),		// media time scale
-						NULL,
-						NULL,
-						NULL,
-						NULL,
-						0,
-						NULL,
-						NULL);
-					
-		// for text media samples, the returned handle is a 16-bit size field followed by the actual text data
-		myTextSize = *(short *)(*myHandle);
-		myText = malloc(myTextSize + 1);
-		BlockMove(*myHandle + sizeof(short), myText, myTextSize);
-		myText[myTextSize] = '\0';
-		
-		DisposeHandle(myHandle);
-	}
+	return(((**theAppData).fSampleIndex.fTrackDuration == GetTrackDuration(myTrack)) && 
+			((**theAppData).fSampleIndex.fMediaSampleCount == GetMediaSampleCount(GetTrackMedia(myTrack))));
+}
 
-	return(myText);
+
+//////////
+//
+// QTText_RevalidateSampleIndex
+// Mark the sample index of the specified application data as up to date.
+//
+// Call this after an edit that changed the text track's media but not the bounds of its samples.
+//
+//////////
+
+void QTText_RevalidateSampleIndex (ApplicationDataHdl theAppData)
+{
+	Track				myTrack = NULL;
+
+	if ((theAppData == NULL) || ((**theAppData).fSampleIndex.fStarts == NULL))
+		return;
+
+	myTrack = (**theAppData).fSampleIndex.fTrack;
+	(**theAppData).fSampleIndex.fTrackDuration = GetTrackDuration(myTrack);
+	(**theAppData).fSampleIndex.fMediaSampleCount = GetMediaSampleCount(GetTrackMedia(myTrack));
 }
 
 
 //////////
 //
-// QTText_GetChapterCount
-// Return the number of chapters in the specified chapter track.
+// QTText_GetSampleBounds
+// Return, through theStart, theDuration and theMediaDuration, the start time and duration (in track time)
+// and the media duration of the sample of the text track that is displayed at the specified track time.
+//
+// If the specified time falls between two samples, we return the earlier one; so, as with a backward
+// GetTrackNextInterestingTime search, the time at the end of the track gives the last sample.
 //
 //////////
 
-long QTText_GetChapterCount (Track theChapterTrack)
+OSErr QTText_GetSampleBounds (ApplicationDataHdl theAppData, TimeValue theTime, TimeValue *theStart, TimeValue *theDuration, TimeValue *theMediaDuration)
 {
-	long			myCount = 0;
-	TimeValue		myTime = kBogusStartingTime;
+	TimeValue			*myStarts = NULL;
+	long				myLow = 0;
+	long				myHigh;
+	long				myMiddle;
+	OSErr				myErr = noErr;
 
-	if (theChapterTrack != NULL) {
-		QTText_GetFirstChapterTime(theChapterTrack, &myTime);
-			
-		while (myTime != kBogusStartingTime) {
-			myCount++;
-			QTText_GetNextChapterTime(theChapterTrack, &myTime);
-		}
+	if (theAppData == NULL)
+		return(paramErr);
+
+	if (!QTText_IsSampleIndexValid(theAppData)) {
+		myErr = QTText_BuildSampleIndex(theAppData);
+		if (myErr != noErr)
+			return(myErr);
 	}
 
-	return(myCount);
+	myStarts = (TimeValue *)*(**theAppData).fSampleIndex.fStarts;
+	myHigh = (**theAppData).fSampleIndex.fCount - 1;
+	if ((myHigh < 0) || (theTime < myStarts[0]))
+		return(paramErr);
+
+	// find the last sample that starts at or before the specified time
+	while (myLow < myHigh) {
+		myMiddle = myLow + ((myHigh - myLow + 1) / 2);
+		if (myStarts[myMiddle] <= theTime)
+			myLow = myMiddle;
+		else
+			myHigh = myMiddle - 1;
+	}
+
+	if (theStart != NULL)
+		*theStart = myStarts[myLow];
+
+	if (theDuration != NULL)
+		*theDuration = ((TimeValue *)*(**theAppData).fSampleIndex.fDurations)[myLow];
+
+	if (theMediaDuration != NULL)
+		*theMediaDuration = ((TimeValue *)*(**theAppData).fSampleIndex.fMediaDurations)[myLow];
+
+	return(myErr);
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-// HREF track utilities.
+// Edit index utilities.
 //
-// Use these functions to manipulate HREF tracks in a movie.
+// Use these functions to convert between the track time and the media time of a text track.
 //
-// An HREF track is a text track that has a special name ("HREFTrack") and some of whose samples specify
-// URLs that are loaded when the user clicks in the movie box when the text sample is active or when the
-// text sample first loads.
+// TrackTimeToMediaTime walks the track's edit list every time it's called, and we call it once per sample
+// when we index a track or export its text, and once per chapter when we fetch chapter titles. The Movie
+// Toolbox doesn't give us the edit list itself, so we walk the track's edits once (with
+// GetTrackNextInterestingTime and GetTrackEditRate) and record the track start, media start and rate of each
+// edit in a table sorted by track time; after that, a conversion in either direction is a binary search
+// followed by a fixed-point multiply and a change of time scale.
+//
+// We keep the edit indexes of the last few tracks we've converted times for. An index is rebuilt whenever the
+// duration or the modification time of its track changes; our own edits that leave the duration alone (such
+// as replacing the text of a sample with QTText_EditText) call QTText_InvalidateEditIndex.
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //////////
 //
-// QTText_SetTextTrackAsHREFTrack
-// Set the specified track to be or not to be an HREF track.
+// QTText_GetEditIndex
+// Return an up-to-date edit index for the specified track, building it if necessary; return NULL if the
+// index can't be built.
 //
 //////////
 
-OSErr QTText_SetTextTrackAsHREFTrack (Track theTrack, Boolean isHREFTrack)
+QTTextEditIndexPtr QTText_GetEditIndex (Track theTrack)
 {
-	OSErr		myErr = noErr;
-	
-	myErr = QTUtils_SetTrackName(theTrack, isHREFTrack ? kHREFTrackName : kNonHREFTrackName);
+	QTTextEditIndexPtr		myIndex = NULL;
+	short					myCount;
 
-	return(myErr);
+	if (theTrack == NULL)
+		return(NULL);
+
+	// look for the track's index; if it isn't there, reuse the entry we built longest ago
+	for (myCount = 0; myCount < kEditIndexCacheSize; myCount++)
+		if (gEditIndexes[myCount].fTrack == theTrack)
+			myIndex = &gEditIndexes[myCount];
+
+	if (myIndex == NULL) {
+		myIndex = &gEditIndexes[gNextEditIndex];
+		gNextEditIndex = (gNextEditIndex + 1) % kEditIndexCacheSize;
+	}
+
+	if (!QTText_IsEditIndexValid(myIndex, theTrack))
+		if (QTText_BuildEditIndex(theTrack, myIndex) != noErr)
+			return(NULL);
+
+	return(myIndex);
+}
+
+
+//////////
+//
+// QTText_BuildEditIndex
+// Build the edit index for the specified track.
+//
+//////////
+
+OSErr QTText_BuildEditIndex (Track theTrack, QTTextEditIndexPtr theIndex)
+{
+	QTTextEditIndex			myIndex;
+	QTTextEditSegment		mySegment;
+	long					*myOrder = NULL;
+	TimeValue				myTime;
+	TimeValue				myDuration;
+	long					myCapacity = kEditIndexMinSegments;
+	long					myPosition;
+	OSErr					myErr = noErr;
+
+	if ((theTrack == NULL) || (theIndex == NULL))
+		return(paramErr);
+
+	QTText_DisposeEditIndex(theIndex);
+
+	myIndex.fTrack = theTrack;
+	myIndex.fTrackDuration = GetTrackDuration(theTrack);
+	myIndex.fModificationTime = GetTrackModificationTime(theTrack);
+	myIndex.fMovieTimeScale = GetMovieTimeScale(GetTrackMovie(theTrack));
+	myIndex.fMediaTimeScale = GetMediaTimeScale(GetTrackMedia(theTrack));
+	myIndex.fCount = 0;
+	myIndex.fMediaCount = 0;
+	myIndex.fSegments = NewHandle(myCapacity * sizeof(QTTextEditSegment));
+	myIndex.fMediaOrder = NewHandle(myCapacity * sizeof(long));
+	if ((myIndex.fSegments == NULL) || (myIndex.fMediaOrder == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	if ((myIndex.fMovieTimeScale <= 0) || (myIndex.fMediaTimeScale <= 0)) {
+		myErr = invalidTrack;
+		goto bail;
+	}
+
+	GetTrackNextInterestingTime(theTrack, nextTimeEdit | nextTimeEdgeOK, (TimeValue)0, fixed1, &myTime, &myDuration);
+	while (myTime >= 0) {
+
+		// grow the arrays, if necessary
+		if (myIndex.fCount == myCapacity) {
+			myCapacity *= 2;
+			SetHandleSize(myIndex.fSegments, myCapacity * sizeof(QTTextEditSegment));
+			if (MemError() == noErr)
+				SetHandleSize(myIndex.fMediaOrder, myCapacity * sizeof(long));
+			myErr = MemError();
+			if (myErr != noErr)
+				goto bail;
+		}
+
+		// TrackTimeToMediaTime returns -1 for an empty edit
+		mySegment.fStart = myTime;
+		mySegment.fDuration = myDuration;
+		mySegment.fMediaStart = TrackTimeToMediaTime(myTime, theTrack);
+		mySegment.fRate = GetTrackEditRate(theTrack, myTime);
+		if (mySegment.fRate <= 0)
+			mySegment.fRate = fixed1;
+		mySegment.fMediaDuration = 0;
+		if (mySegment.fMediaStart >= 0)
+			mySegment.fMediaDuration = QTText_TrackToMediaDuration(&myIndex, &mySegment, myDuration);
+
+		((QTTextEditSegment *)*myIndex.fSegments)[myIndex.fCount] = mySegment;
+
+		// insert the edit into the media order; edits usually play the media in order, so this is rarely more than an append
+		if (mySegment.fMediaStart >= 0) {
+			myOrder = (long *)*myIndex.fMediaOrder;
+			myPosition = myIndex.fMediaCount;
+			while ((myPosition > 0) && (((QTTextEditSegment *)*myIndex.fSegments)[myOrder[myPosition - 1]].fMediaStart > mySegment.fMediaStart)) {
+				myOrder[myPosition] = myOrder[myPosition - 1];
+				myPosition--;
+			}
+
+			myOrder[myPosition] = myIndex.fCount;
+			myIndex.fMediaCount++;
+		}
+
+		myIndex.fCount++;
+
+		GetTrackNextInterestingTime(theTrack, nextTimeEdit, myTime, fixed1, &myTime, &myDuration);
+	}
+
+	*theIndex = myIndex;
+
+bail:
+	if (myErr != noErr) {
+		if (myIndex.fSegments != NULL)
+			DisposeHandle(myIndex.fSegments);
+
+		if (myIndex.fMediaOrder != NULL)
+			DisposeHandle(myIndex.fMediaOrder);
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_DisposeEditIndex
+// Dispose of the specified edit index.
+//
+//////////
+
+void QTText_DisposeEditIndex (QTTextEditIndexPtr theIndex)
+{
+	if (theIndex == NULL)
+		return;
+
+	if (theIndex->fSegments != NULL)
+		DisposeHandle(theIndex->fSegments);
+
+	if (theIndex->fMediaOrder != NULL)
+		DisposeHandle(theIndex->fMediaOrder);
+
+	theIndex->fTrack = NULL;
+	theIndex->fCount = 0;
+	theIndex->fMediaCount = 0;
+	theIndex->fSegments = NULL;
+	theIndex->fMediaOrder = NULL;
+}
+
+
+//////////
+//
+// QTText_IsEditIndexValid
+// Is the specified edit index an up-to-date index of the specified track?
+//
+//////////
+
+Boolean QTText_IsEditIndexValid (QTTextEditIndexPtr theIndex, Track theTrack)
+{
+	if ((theIndex == NULL) || (theTrack == NULL) || (theIndex->fSegments == NULL) || (theIndex->fTrack != theTrack))
+		return(false);
+
+	return((theIndex->fTrackDuration == GetTrackDuration(theTrack)) && 
+			(theIndex->fModificationTime == GetTrackModificationTime(theTrack)));
+}
+
+
+//////////
+//
+// QTText_InvalidateEditIndex
+// Forget the edit index of the specified track, if we have one.
+//
+// Call this after editing a track, or before disposing of it.
+//
+//////////
+
+void QTText_InvalidateEditIndex (Track theTrack)
+{
+	short				myCount;
+
+	if (theTrack == NULL)
+		return;
+
+	for (myCount = 0; myCount < kEditIndexCacheSize; myCount++)
+		if (gEditIndexes[myCount].fTrack == theTrack)
+			QTText_DisposeEditIndex(&gEditIndexes[myCount]);
+}
+
+
+//////////
+//
+// QTText_FlushEditIndexes
+// Forget the edit indexes of all tracks.
+//
+//////////
+
+void QTText_FlushEditIndexes (void)
+{
+	short				myCount;
+
+	for (myCount = 0; myCount < kEditIndexCacheSize; myCount++)
+		QTText_DisposeEditIndex(&gEditIndexes[myCount]);
+}
+
+
+//////////
+//
+// QTText_TrackTimeToMediaTime
+// Return the media time that the specified track plays at the specified track time.
+//
+// Like TrackTimeToMediaTime, we return -1 if the track time falls in an empty edit or outside the track.
+//
+//////////
+
+TimeValue QTText_TrackTimeToMediaTime (Track theTrack, TimeValue theTime)
+{
+	QTTextEditIndexPtr		myIndex = NULL;
+	QTTextEditSegment		*mySegments = NULL;
+	long					myLow = 0;
+	long					myHigh;
+	long					myMiddle;
+
+	myIndex = QTText_GetEditIndex(theTrack);
+	if (myIndex == NULL)
+		return(TrackTimeToMediaTime(theTime, theTrack));
+
+	mySegments = (QTTextEditSegment *)*myIndex->fSegments;
+	myHigh = myIndex->fCount - 1;
+	if ((myHigh < 0) || (theTime < mySegments[0].fStart) || (theTime >= myIndex->fTrackDuration))
+		return(-1);
+
+	// find the last edit that starts at or before the specified time
+	while (myLow < myHigh) {
+		myMiddle = myLow + ((myHigh - myLow + 1) / 2);
+		if (mySegments[myMiddle].fStart <= theTime)
+			myLow = myMiddle;
+		else
+			myHigh = myMiddle - 1;
+	}
+
+	if (mySegments[myLow].fMediaStart < 0)
+		return(-1);
+
+	return(mySegments[myLow].fMediaStart + QTText_TrackToMediaDuration(myIndex, &mySegments[myLow], theTime - mySegments[myLow].fStart));
+}
+
+
+//////////
+//
+// QTText_MediaTimeToTrackTime
+// Return the track time at which the specified track plays the specified media time, or -1 if it never does.
+//
+// If several edits play the same media time, we return the time in the one whose media starts latest.
+//
+//////////
+
+TimeValue QTText_MediaTimeToTrackTime (Track theTrack, TimeValue theTime)
+{
+	QTTextEditIndexPtr		myIndex = NULL;
+	QTTextEditSegment		*mySegments = NULL;
+	QTTextEditSegment		*mySegment = NULL;
+	long					*myOrder = NULL;
+	long					myLow = 0;
+	long					myHigh;
+	long					myMiddle;
+
+	myIndex = QTText_GetEditIndex(theTrack);
+	if (myIndex == NULL)
+		return(-1);
+
+	mySegments = (QTTextEditSegment *)*myIndex->fSegments;
+	myOrder = (long *)*myIndex->fMediaOrder;
+	myHigh = myIndex->fMediaCount - 1;
+	if ((myHigh < 0) || (theTime < mySegments[myOrder[0]].fMediaStart))
+		return(-1);
+
+	// find the last edit whose media starts at or before the specified time
+	while (myLow < myHigh) {
+		myMiddle = myLow + ((myHigh - myLow + 1) / 2);
+		if (mySegments[myOrder[myMiddle]].fMediaStart <= theTime)
+			myLow = myMiddle;
+		else
+			myHigh = myMiddle - 1;
+	}
+
+	// that edit may end before the specified time, if the edits skip over part of the media
+	for (; myLow >= 0; myLow--) {
+		mySegment = &mySegments[myOrder[myLow]];
+		if (theTime < mySegment->fMediaStart + mySegment->fMediaDuration)
+			return(mySegment->fStart + QTText_MediaToTrackDuration(myIndex, mySegment, theTime - mySegment->fMediaStart));
+	}
+
+	return(-1);
+}
+
+
+//////////
+//
+// QTText_TrackToMediaDuration
+// Convert the specified duration within the specified edit from track time to media time.
+//
+//////////
+
+TimeValue QTText_TrackToMediaDuration (QTTextEditIndexPtr theIndex, const QTTextEditSegment *theSegment, TimeValue theDuration)
+{
+	wide				myProduct;
+	long				myRemainder;
+
+	if (theSegment->fRate != fixed1)
+		theDuration = FixMul(theDuration, theSegment->fRate);
+
+	if (theIndex->fMediaTimeScale == theIndex->fMovieTimeScale)
+		return(theDuration);
+
+	WideMultiply(theDuration, theIndex->fMediaTimeScale, &myProduct);
+	return(WideDivide(&myProduct, theIndex->fMovieTimeScale, &myRemainder));
+}
+
+
+//////////
+//
+// QTText_MediaToTrackDuration
+// Convert the specified duration within the specified edit from media time to track time.
+//
+//////////
+
+TimeValue QTText_MediaToTrackDuration (QTTextEditIndexPtr theIndex, const QTTextEditSegment *theSegment, TimeValue theDuration)
+{
+	wide				myProduct;
+	long				myRemainder;
+
+	if (theIndex->fMediaTimeScale != theIndex->fMovieTimeScale) {
+		WideMultiply(theDuration, theIndex->fMovieTimeScale, &myProduct);
+		theDuration = WideDivide(&myProduct, theIndex->fMediaTimeScale, &myRemainder);
+	}
+
+	if (theSegment->fRate != fixed1)
+		theDuration = FixDiv(theDuration, theSegment->fRate);
+
+	return(theDuration);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Track reference index utilities.
+//
+// Use these functions to find the track references that point at a given track.
+//
+// The Movie Toolbox stores track references with the track that holds them, so to find out which tracks refer
+// to a given track (is it a chapter track? which references must go before we dispose of it?) we have to ask
+// every track in the movie about every reference of every type. Instead, we ask once and record every track
+// reference in the movie in a reference index, sorted by the ID of the referenced track; after that, finding
+// the references to a track is a binary search.
+//
+// We keep the reference indexes of the last few movies we've asked about. An index is rebuilt whenever the
+// number of tracks or the modification time of its movie changes; QTText_AddTrackReference and
+// QTText_DeleteTrackReference change the references and keep the index in step, so use them instead of
+// AddTrackReference and DeleteTrackReference.
+//
+// The index also holds a list of every chapter track in the movie, with the track that refers to it and its
+// language, which we make from the chapter references the first time it's asked for. A movie can have a
+// chapter track for each of several languages; the list lets us switch between them without asking every
+// track about its references again.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTText_GetRefIndex
+// Return an up-to-date reference index for the specified movie, building it if necessary; return NULL if the
+// index can't be built.
+//
+//////////
+
+QTTextRefIndexPtr QTText_GetRefIndex (Movie theMovie)
+{
+	QTTextRefIndexPtr		myIndex = NULL;
+	short					myCount;
+
+	if (theMovie == NULL)
+		return(NULL);
+
+	// look for the movie's index; if it isn't there, reuse the entry we built longest ago
+	for (myCount = 0; myCount < kRefIndexCacheSize; myCount++)
+		if (gRefIndexes[myCount].fMovie == theMovie)
+			myIndex = &gRefIndexes[myCount];
+
+	if (myIndex == NULL) {
+		myIndex = &gRefIndexes[gNextRefIndex];
+		gNextRefIndex = (gNextRefIndex + 1) % kRefIndexCacheSize;
+	}
+
+	if (!QTText_IsRefIndexValid(myIndex, theMovie))
+		if (QTText_BuildRefIndex(theMovie, myIndex) != noErr)
+			return(NULL);
+
+	return(myIndex);
+}
+
+
+//////////
+//
+// QTText_BuildRefIndex
+// Build the reference index for the specified movie.
+//
+//////////
+
+OSErr QTText_BuildRefIndex (Movie theMovie, QTTextRefIndexPtr theIndex)
+{
+	QTTextRefIndex			myIndex;
+	QTTextTrackRef			myRef;
+	Track					myTrack = NULL;
+	OSType					myType;
+	long					myTrackIndex;
+	long					myRefCount;
+	OSErr					myErr = noErr;
+
+	if ((theMovie == NULL) || (theIndex == NULL))
+		return(paramErr);
+
+	QTText_DisposeRefIndex(theIndex);
+
+	myIndex.fMovie = theMovie;
+	myIndex.fTrackCount = GetMovieTrackCount(theMovie);
+	myIndex.fModificationTime = GetMovieModificationTime(theMovie);
+	myIndex.fCount = 0;
+	myIndex.fChapterCount = 0;
+	myIndex.fChapters = NULL;
+	myIndex.fRefs = NewHandle(kRefIndexMinRefs * sizeof(QTTextTrackRef));
+	if (myIndex.fRefs == NULL)
+		return(memFullErr);
+
+	// iterate thru all the tracks in the movie, all the track reference types of each track,
+	// and all the track references of each type
+	for (myTrackIndex = 1; myTrackIndex <= myIndex.fTrackCount; myTrackIndex++) {
+		myTrack = GetMovieIndTrack(theMovie, myTrackIndex);
+		if (myTrack == NULL)
+			continue;
+
+		myType = GetNextTrackReferenceType(myTrack, 0L);
+		while (myType != 0L) {
+			myRefCount = GetTrackReferenceCount(myTrack, myType);
+			for (myRef.fIndex = 1; myRef.fIndex <= myRefCount; myRef.fIndex++) {
+				myRef.fRefTrack = GetTrackReference(myTrack, myType, myRef.fIndex);
+				if (myRef.fRefTrack == NULL)
+					continue;
+
+				myRef.fRefTrackID = GetTrackID(myRef.fRefTrack);
+				myRef.fTrack = myTrack;
+				myRef.fTrackIndex = myTrackIndex;
+				myRef.fType = myType;
+
+				myErr = QTText_InsertTrackRef(&myIndex, &myRef);
+				if (myErr != noErr)
+					goto bail;
+			}
+
+			myType = GetNextTrackReferenceType(myTrack, myType);
+		}
+	}
+
+	*theIndex = myIndex;
+
+bail:
+	if (myErr != noErr)
+		DisposeHandle(myIndex.fRefs);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_DisposeRefIndex
+// Dispose of the specified reference index.
+//
+//////////
+
+void QTText_DisposeRefIndex (QTTextRefIndexPtr theIndex)
+{
+	if (theIndex == NULL)
+		return;
+
+	if (theIndex->fRefs != NULL)
+		DisposeHandle(theIndex->fRefs);
+
+	if (theIndex->fChapters != NULL)
+		DisposeHandle(theIndex->fChapters);
+
+	theIndex->fMovie = NULL;
+	theIndex->fCount = 0;
+	theIndex->fRefs = NULL;
+	theIndex->fChapterCount = 0;
+	theIndex->fChapters = NULL;
+}
+
+
+//////////
+//
+// QTText_IsRefIndexValid
+// Is the specified reference index an up-to-date index of the specified movie?
+//
+//////////
+
+Boolean QTText_IsRefIndexValid (QTTextRefIndexPtr theIndex, Movie theMovie)
+{
+	if ((theIndex == NULL) || (theMovie == NULL) || (theIndex->fRefs == NULL) || (theIndex->fMovie != theMovie))
+		return(false);
+
+	return((theIndex->fTrackCount == GetMovieTrackCount(theMovie)) && 
+			(theIndex->fModificationTime == GetMovieModificationTime(theMovie)));
+}
+
+
+//////////
+//
+// QTText_InvalidateRefIndex
+// Forget the reference index of the specified movie, if we have one.
+//
+//////////
+
+void QTText_InvalidateRefIndex (Movie theMovie)
+{
+	short				myCount;
+
+	if (theMovie == NULL)
+		return;
+
+	for (myCount = 0; myCount < kRefIndexCacheSize; myCount++)
+		if (gRefIndexes[myCount].fMovie == theMovie)
+			QTText_DisposeRefIndex(&gRefIndexes[myCount]);
+}
+
+
+//////////
+//
+// QTText_FlushRefIndexes
+// Forget the reference indexes of all movies.
+//
+//////////
+
+void QTText_FlushRefIndexes (void)
+{
+	short				myCount;
+
+	for (myCount = 0; myCount < kRefIndexCacheSize; myCount++)
+		QTText_DisposeRefIndex(&gRefIndexes[myCount]);
+}
+
+
+//////////
+//
+// QTText_FindTrackRefs
+// Return the position in the specified reference index of the first reference to the specified track, and
+// return through theCount the number of references to it; those references follow one another in the index.
+//
+//////////
+
+long QTText_FindTrackRefs (QTTextRefIndexPtr theIndex, Track theRefTrack, long *theCount)
+{
+	QTTextTrackRef		*myRefs = NULL;
+	long				myID;
+	long				myLow = 0;
+	long				myHigh;
+	long				myMiddle;
+	long				myEnd;
+
+	*theCount = 0;
+	if ((theIndex == NULL) || (theIndex->fRefs == NULL) || (theRefTrack == NULL))
+		return(0);
+
+	myRefs = (QTTextTrackRef *)*theIndex->fRefs;
+	myID = GetTrackID(theRefTrack);
+
+	// find the first reference to a track whose ID is at least the specified track's ID
+	myHigh = theIndex->fCount;
+	while (myLow < myHigh) {
+		myMiddle = myLow + ((myHigh - myLow) / 2);
+		if (myRefs[myMiddle].fRefTrackID < myID)
+			myLow = myMiddle + 1;
+		else
+			myHigh = myMiddle;
+	}
+
+	for (myEnd = myLow; (myEnd < theIndex->fCount) && (myRefs[myEnd].fRefTrackID == myID); myEnd++)
+		;
+
+	*theCount = myEnd - myLow;
+	return(myLow);
+}
+
+
+//////////
+//
+// QTText_InsertTrackRef
+// Add the specified track reference to the specified reference index, after any other references to the
+// same track.
+//
+//////////
+
+OSErr QTText_InsertTrackRef (QTTextRefIndexPtr theIndex, const QTTextTrackRef *theRef)
+{
+	QTTextTrackRef		*myRefs = NULL;
+	long				myPosition;
+	OSErr				myErr = noErr;
+
+	if (GetHandleSize(theIndex->fRefs) < (long)((theIndex->fCount + 1) * sizeof(QTTextTrackRef))) {
+		SetHandleSize(theIndex->fRefs, 2 * theIndex->fCount * sizeof(QTTextTrackRef));
+		myErr = MemError();
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	// references are usually found in order of the referenced track, so this is rarely more than an append
+	myRefs = (QTTextTrackRef *)*theIndex->fRefs;
+	myPosition = theIndex->fCount;
+	while ((myPosition > 0) && (myRefs[myPosition - 1].fRefTrackID > theRef->fRefTrackID)) {
+		myRefs[myPosition] = myRefs[myPosition - 1];
+		myPosition--;
+	}
+
+	myRefs[myPosition] = *theRef;
+	theIndex->fCount++;
+
+	// the list of chapter tracks is built from the references, so it's now out of date
+	if (theIndex->fChapters != NULL) {
+		DisposeHandle(theIndex->fChapters);
+		theIndex->fChapters = NULL;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_RemoveTrackRef
+// Remove the specified track reference from the specified reference index, renumbering the references of
+// the same type that follow it, as DeleteTrackReference does.
+//
+//////////
+
+void QTText_RemoveTrackRef (QTTextRefIndexPtr theIndex, Track theTrack, OSType theType, long theRefIndex)
+{
+	QTTextTrackRef		*myRefs = NULL;
+	long				myFrom;
+	long				myTo = 0;
+
+	myRefs = (QTTextTrackRef *)*theIndex->fRefs;
+	for (myFrom = 0; myFrom < theIndex->fCount; myFrom++) {
+		if ((myRefs[myFrom].fTrack == theTrack) && (myRefs[myFrom].fType == theType)) {
+			if (myRefs[myFrom].fIndex == theRefIndex)
+				continue;
+
+			if (myRefs[myFrom].fIndex > theRefIndex)
+				myRefs[myFrom].fIndex--;
+		}
+
+		myRefs[myTo++] = myRefs[myFrom];
+	}
+
+	theIndex->fCount = myTo;
+
+	// the list of chapter tracks is built from the references, so it's now out of date
+	if (theIndex->fChapters != NULL) {
+		DisposeHandle(theIndex->fChapters);
+		theIndex->fChapters = NULL;
+	}
+}
+
+
+//////////
+//
+// QTText_AddTrackReference
+// Add a track reference of the specified type from one track to another, and return its index through
+// theIndex (which can be NULL).
+//
+//////////
+
+OSErr QTText_AddTrackReference (Track theTrack, Track theRefTrack, OSType theType, long *theIndex)
+{
+	QTTextRefIndexPtr	myIndex = NULL;
+	QTTextTrackRef		myRef;
+	Movie				myMovie = NULL;
+	long				myPosition;
+	long				myCount;
+	OSErr				myErr = noErr;
+
+	myMovie = GetTrackMovie(theTrack);
+	if (myMovie == NULL)
+		return(invalidTrack);
+
+	// bring the index up to date before we change the references, so that we need only add the new one to it
+	myIndex = QTText_GetRefIndex(myMovie);
+
+	myRef.fIndex = 0;
+	myErr = AddTrackReference(theTrack, theRefTrack, theType, &myRef.fIndex);
+	if (theIndex != NULL)
+		*theIndex = myRef.fIndex;
+
+	if ((myErr != noErr) || (myIndex == NULL))
+		return(myErr);
+
+	// if the track already had this reference, AddTrackReference returns the index of the existing one
+	myPosition = QTText_FindTrackRefs(myIndex, theRefTrack, &myCount);
+	for (; myCount > 0; myCount--, myPosition++) {
+		QTTextTrackRef	*myOldRef = &((QTTextTrackRef *)*myIndex->fRefs)[myPosition];
+
+		if ((myOldRef->fTrack == theTrack) && (myOldRef->fType == theType) && (myOldRef->fIndex == myRef.fIndex))
+			break;
+	}
+
+	if (myCount == 0) {
+		myRef.fRefTrackID = GetTrackID(theRefTrack);
+		myRef.fRefTrack = theRefTrack;
+		myRef.fTrack = theTrack;
+		myRef.fType = theType;
+		for (myRef.fTrackIndex = 1; myRef.fTrackIndex <= myIndex->fTrackCount; myRef.fTrackIndex++)
+			if (GetMovieIndTrack(myMovie, myRef.fTrackIndex) == theTrack)
+				break;
+
+		if (QTText_InsertTrackRef(myIndex, &myRef) != noErr) {
+			QTText_DisposeRefIndex(myIndex);
+			return(myErr);
+		}
+	}
+
+	myIndex->fModificationTime = GetMovieModificationTime(myMovie);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_DeleteTrackReference
+// Delete the track reference of the specified type and index from the specified track.
+//
+//////////
+
+OSErr QTText_DeleteTrackReference (Track theTrack, OSType theType, long theIndex)
+{
+	QTTextRefIndexPtr	myIndex = NULL;
+	Movie				myMovie = NULL;
+	OSErr				myErr = noErr;
+
+	myMovie = GetTrackMovie(theTrack);
+	if (myMovie == NULL)
+		return(invalidTrack);
+
+	// bring the index up to date before we change the references, so that we need only remove the old one from it
+	myIndex = QTText_GetRefIndex(myMovie);
+
+	myErr = DeleteTrackReference(theTrack, theType, theIndex);
+	if ((myErr != noErr) || (myIndex == NULL))
+		return(myErr);
+
+	QTText_RemoveTrackRef(myIndex, theTrack, theType, theIndex);
+	myIndex->fModificationTime = GetMovieModificationTime(myMovie);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_DeleteAllReferencesToTrack
+// Delete all existing track references to the specified track from the other tracks in its movie.
+//
+//////////
+
+OSErr QTText_DeleteAllReferencesToTrack (Track theTrack)
+{
+	QTTextRefIndexPtr	myIndex = NULL;
+	QTTextTrackRef		myRef;
+	Movie				myMovie = NULL;
+	long				myPosition;
+	long				myCount;
+	OSErr				myErr = noErr;
+
+	myMovie = GetTrackMovie(theTrack);
+	if (myMovie == NULL)
+		return(paramErr);
+
+	myIndex = QTText_GetRefIndex(myMovie);
+	if (myIndex == NULL)
+		return(QTUtils_DeleteAllReferencesToTrack(theTrack));
+
+	// work back from the last reference, so that removing one doesn't move the ones we have yet to visit;
+	// QTText_RemoveTrackRef renumbers the ones that DeleteTrackReference renumbers
+	myPosition = QTText_FindTrackRefs(myIndex, theTrack, &myCount);
+	while (myCount-- > 0) {
+		myRef = ((QTTextTrackRef *)*myIndex->fRefs)[myPosition + myCount];
+		if (myRef.fTrack == theTrack)
+			continue;
+
+		myErr = DeleteTrackReference(myRef.fTrack, myRef.fType, myRef.fIndex);
+		if (myErr == noErr)
+			QTText_RemoveTrackRef(myIndex, myRef.fTrack, myRef.fType, myRef.fIndex);
+	}
+
+	myIndex->fModificationTime = GetMovieModificationTime(myMovie);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_GetChapterTrackIndex
+// Return an up-to-date reference index for the specified movie, with its list of chapter tracks; return NULL
+// if the index or the list can't be built.
+//
+//////////
+
+QTTextRefIndexPtr QTText_GetChapterTrackIndex (Movie theMovie)
+{
+	QTTextRefIndexPtr		myIndex = NULL;
+
+	myIndex = QTText_GetRefIndex(theMovie);
+	if (myIndex == NULL)
+		return(NULL);
+
+	if (myIndex->fChapters == NULL)
+		if (QTText_BuildChapterTrackList(myIndex) != noErr)
+			return(NULL);
+
+	return(myIndex);
+}
+
+
+//////////
+//
+// QTText_BuildChapterTrackList
+// Build the list of chapter tracks of the specified reference index, in the order of the tracks that refer
+// to them (and, for each of those tracks, in the order of its chapter references).
+//
+//////////
+
+OSErr QTText_BuildChapterTrackList (QTTextRefIndexPtr theIndex)
+{
+	QTTextTrackRef				*myRefs = NULL;
+	QTTextChapterTrackRef		*myChapters = NULL;
+	QTTextChapterTrackRef		myChapter;
+	long						myCount;
+	long						myPosition;
+
+	if ((theIndex == NULL) || (theIndex->fRefs == NULL))
+		return(paramErr);
+
+	if (theIndex->fChapters != NULL)
+		DisposeHandle(theIndex->fChapters);
+
+	theIndex->fChapterCount = 0;
+	theIndex->fChapters = NewHandle(theIndex->fCount * sizeof(QTTextChapterTrackRef));
+	if (theIndex->fChapters == NULL)
+		return(memFullErr);
+
+	myRefs = (QTTextTrackRef *)*theIndex->fRefs;
+	myChapters = (QTTextChapterTrackRef *)*theIndex->fChapters;
+	for (myCount = 0; myCount < theIndex->fCount; myCount++) {
+		if (myRefs[myCount].fType != kTrackReferenceChapterList)
+			continue;
+
+		myChapter.fOwnerTrack = myRefs[myCount].fTrack;
+		myChapter.fOwnerIndex = myRefs[myCount].fTrackIndex;
+		myChapter.fRefIndex = myRefs[myCount].fIndex;
+		myChapter.fChapterTrack = myRefs[myCount].fRefTrack;
+		myChapter.fLanguage = GetMediaLanguage(GetTrackMedia(myChapter.fChapterTrack));
+
+		// the references are sorted by the track they refer to, so sort the chapter references into movie order
+		myPosition = theIndex->fChapterCount;
+		while ((myPosition > 0) && 
+				((myChapters[myPosition - 1].fOwnerIndex > myChapter.fOwnerIndex) || 
+				((myChapters[myPosition - 1].fOwnerIndex == myChapter.fOwnerIndex) && (myChapters[myPosition - 1].fRefIndex > myChapter.fRefIndex)))) {
+			myChapters[myPosition] = myChapters[myPosition - 1];
+			myPosition--;
+		}
+
+		myChapters[myPosition] = myChapter;
+		theIndex->fChapterCount++;
+	}
+
+	return(noErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Chapter track utilities.
+//
+// Use these functions to manipulate chapter tracks in a movie.
+//
+// A chapter track is a text track that has been associated with some other track (often a video or sound
+// track) in such a way that the movie controller will build, display, and handle a pop-up menu of titles
+// of various parts of the associated track. The pop-up menu appears (space permitting) in the controller
+// bar. The various parts of the associated track are called the track's "chapters". When a user selects a
+// chapter title in the pop-up menu, the movie controller jumps to the start time of the selected chapter.
+//
+// You create the association between a text track and some other track by creating a reference from that
+// other track to the text track, where the reference is of type kTrackReferenceChapterList. Note that all
+// the chapter titles must be contained in a single text track; you specify the starting time for chapters
+// when you add the text to the text track by calling TextMediaAddTextSample. Note also that you need to
+// create the chapter association only between the text track and one other track, not between the chapter
+// track and all other tracks in the movie. (That "other" track must be enabled, but typically the chapter
+// track is not enabled.)
+//
+// The pop-up menu will disappear from the controller bar if there isn't enough space to display the menu,
+// the volume slider control, the step buttons, and the other controls. 
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTText_SetTextTrackAsChapterTrack
+// Set the (first) text track in the specified movie to be or not to be a chapter track
+// for the (first) enabled track of the specified type.
+//
+// The isChapterTrack parameter determines the final state of the text track.
+//
+//////////
+
+OSErr QTText_SetTextTrackAsChapterTrack (WindowObject theWindowObject, OSType theType, Boolean isChapterTrack)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	Movie					myMovie = NULL;
+	MovieController			myMC = NULL;
+	Track					myTypeTrack = NULL;
+	Track					myTextTrack = NULL;
+	OSErr					myErr = paramErr;
+		
+	// get the movie, controller, and related stuff	
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
+	if (myAppData == NULL)
+		return(myErr);
+		
+	myMovie = (**theWindowObject).fMovie;
+	myMC = (**theWindowObject).fController;
+	myTextTrack = (**myAppData).fTextTrack;
+	
+	if ((myMovie != NULL) && (myMC != NULL)) {
+		myTypeTrack = GetMovieIndTrackType(myMovie, 1, theType, movieTrackMediaType | movieTrackEnabledOnly);
+		if ((myTypeTrack != NULL) && (myTextTrack != NULL)) {
+		
+			// add or delete a track reference, as determined by the desired final state
+			if (isChapterTrack)
+				myErr = QTText_AddTrackReference(myTypeTrack, myTextTrack, kTrackReferenceChapterList, NULL);
+			else
+				myErr = QTText_DeleteTrackReference(myTypeTrack, kTrackReferenceChapterList, 1);
+				
+			// tell the movie controller we've changed aspects of the movie
+			MCMovieChanged(myMC, myMovie);
+			
+			// stamp the movie as dirty
+			(**theWindowObject).fIsDirty = true;
+		}
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_TrackTypeHasAChapterTrack
+// Does the (first) enabled track of the specified type in the specified movie have a chapter track?
+//
+//////////
+
+Boolean QTText_TrackTypeHasAChapterTrack (Movie theMovie, OSType theType)
+{
+	Track					myTypeTrack = NULL;
+	Track					myTextTrack = NULL;
+		
+	myTypeTrack = GetMovieIndTrackType(theMovie, 1, theType, movieTrackMediaType | movieTrackEnabledOnly);
+	if (myTypeTrack != NULL)
+		myTextTrack = GetTrackReference(myTypeTrack, kTrackReferenceChapterList, 1);
+
+	return(myTextTrack != NULL);
+}
+
+
+//////////
+//
+// QTText_TrackHasAChapterTrack
+// Does the specified track have a chapter track?
+//
+//////////
+
+Boolean QTText_TrackHasAChapterTrack (Track theTrack)
+{
+	return(GetTrackReference(theTrack, kTrackReferenceChapterList, 1) != NULL);
+}
+
+
+//////////
+//
+// QTText_MovieHasAChapterTrack
+// Does the specified movie have a chapter track? In other words, is there are least one enabled track
+// in the specified movie that has a chapter track associated wih it?
+//
+//////////
+
+Boolean QTText_MovieHasAChapterTrack (Movie theMovie)
+{
+	return(QTText_GetChapterTrackForMovie(theMovie) != NULL);
+}
+
+
+//////////
+//
+// QTText_GetChapterTrackForTrack
+// Return the first chapter track (if any) associated with the specified track.
+//
+//////////
+
+Track QTText_GetChapterTrackForTrack (Track theTrack)
+{
+	return(GetTrackReference(theTrack, kTrackReferenceChapterList, 1));
+}
+
+
+//////////
+//
+// QTText_GetChapterTrackForMovie
+// Return the first chapter track (if any) in the specified movie.
+//
+// A movie can have more than one chapter track; if so, QuickTime uses the chapter track associated
+// with the first enabled track that it finds. Accordingly, this function returns the first chapter
+// track that we find as we iterate thru the movie's tracks.
+//
+//////////
+
+Track QTText_GetChapterTrackForMovie (Movie theMovie)
+{
+	QTTextRefIndexPtr	myIndex = NULL;
+	QTTextTrackRef		*myRefs = NULL;
+	long				myCount;
+	long				myTrackIndex = 0;
+	Track				myChapTrack = NULL;
+	
+	myIndex = QTText_GetRefIndex(theMovie);
+	if (myIndex == NULL)
+		return(NULL);
+
+	// look at the first chapter reference of each enabled track, and pick the track that comes first in the movie
+	myRefs = (QTTextTrackRef *)*myIndex->fRefs;
+	for (myCount = 0; myCount < myIndex->fCount; myCount++) {
+		if ((myRefs[myCount].fType != kTrackReferenceChapterList) || (myRefs[myCount].fIndex != 1))
+			continue;
+
+		if ((myChapTrack != NULL) && (myRefs[myCount].fTrackIndex > myTrackIndex))
+			continue;
+
+		if (GetTrackEnabled(myRefs[myCount].fTrack)) {
+			myChapTrack = myRefs[myCount].fRefTrack;
+			myTrackIndex = myRefs[myCount].fTrackIndex;
+		}
+	}
+	
+	return(myChapTrack);
+}
+
+
+//////////
+//
+// QTText_IsChapterTrack
+// Is the specified track a chapter track?
+//
+//////////
+
+Boolean QTText_IsChapterTrack (Track theTrack)
+{
+	QTTextRefIndexPtr	myIndex = NULL;
+	QTTextTrackRef		*myRefs = NULL;
+	long				myPosition;
+	long				myCount;
+
+	if (theTrack == NULL)
+		return(false);
+
+	myIndex = QTText_GetRefIndex(GetTrackMovie(theTrack));
+	if (myIndex == NULL)
+		return(false);
+
+	// a chapter track is a text track that is referred to by some other track in the movie,
+	// so we need to see whether any of the references to the specified track is a chapter reference
+	myPosition = QTText_FindTrackRefs(myIndex, theTrack, &myCount);
+	myRefs = (QTTextTrackRef *)*myIndex->fRefs;
+	for (; myCount > 0; myCount--, myPosition++)
+		if ((myRefs[myPosition].fType == kTrackReferenceChapterList) && (myRefs[myPosition].fTrack != theTrack))
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTText_GetChapterTrackCount
+// Return the number of chapter references in the specified movie; each names a track that refers to a
+// chapter track. A movie can have more than one, for instance one chapter track for each of several languages.
+//
+//////////
+
+long QTText_GetChapterTrackCount (Movie theMovie)
+{
+	QTTextRefIndexPtr		myIndex = NULL;
+
+	myIndex = QTText_GetChapterTrackIndex(theMovie);
+	if (myIndex == NULL)
+		return(0);
+
+	return(myIndex->fChapterCount);
+}
+
+
+//////////
+//
+// QTText_GetIndChapterTrack
+// Return, through theOwnerTrack, theChapterTrack and theLanguage (any of which can be NULL), the track that
+// holds the chapter reference having the specified index in the specified movie, the chapter track it refers
+// to, and the language of that chapter track.
+//
+// The chapter references are in the order of the tracks that hold them; so, for a given language, the first
+// enabled owner track gives the chapter track that QuickTime would use.
+//
+//////////
+
+OSErr QTText_GetIndChapterTrack (Movie theMovie, long theIndex, Track *theOwnerTrack, Track *theChapterTrack, short *theLanguage)
+{
+	QTTextRefIndexPtr		myIndex = NULL;
+	QTTextChapterTrackRef	*myChapter = NULL;
+
+	myIndex = QTText_GetChapterTrackIndex(theMovie);
+	if (myIndex == NULL)
+		return(invalidMovie);
+
+	if ((theIndex < 1) || (theIndex > myIndex->fChapterCount))
+		return(badTrackIndex);
+
+	myChapter = &((QTTextChapterTrackRef *)*myIndex->fChapters)[theIndex - 1];
+	if (theOwnerTrack != NULL)
+		*theOwnerTrack = myChapter->fOwnerTrack;
+
+	if (theChapterTrack != NULL)
+		*theChapterTrack = myChapter->fChapterTrack;
+
+	if (theLanguage != NULL)
+		*theLanguage = myChapter->fLanguage;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTText_GetChapterTrackForLanguage
+// Return the chapter track in the specified language that is associated with the first enabled track
+// in the specified movie that has one; return NULL if there's no such chapter track.
+//
+//////////
+
+Track QTText_GetChapterTrackForLanguage (Movie theMovie, short theLanguage)
+{
+	QTTextRefIndexPtr		myIndex = NULL;
+	QTTextChapterTrackRef	*myChapters = NULL;
+	long					myCount;
+
+	myIndex = QTText_GetChapterTrackIndex(theMovie);
+	if (myIndex == NULL)
+		return(NULL);
+
+	myChapters = (QTTextChapterTrackRef *)*myIndex->fChapters;
+	for (myCount = 0; myCount < myIndex->fChapterCount; myCount++)
+		if ((myChapters[myCount].fLanguage == theLanguage) && GetTrackEnabled(myChapters[myCount].fOwnerTrack))
+			return(myChapters[myCount].fChapterTrack);
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTText_GetFirstChapterTime
+// Return, through the theTime parameter, the starting time of the first chapter of the
+// specified chapter track.
+//
+// If this function encounters an error, it returns a (bogus) starting time of -1. Note that
+// GetTrackNextInterestingTime also returns -1 as a starting time if the search criteria
+// specified in the myFlags parameter are not matched by any interesting time in the movie. 
+//
+//////////
+
+OSErr QTText_GetFirstChapterTime (Track theChapterTrack, TimeValue *theTime)
+{
+	short	myFlags = nextTimeMediaSample + nextTimeEdgeOK;	// we want the first sample in the movie
+	
+	if (theChapterTrack == NULL) {
+		*theTime = kBogusStartingTime;						// a bogus time
+		return(invalidTrack);
+	}
+	
+	GetTrackNextInterestingTime(theChapterTrack, myFlags, (TimeValue)0, fixed1, theTime, NULL);
+	return(GetMoviesError());
+}
+
+
+//////////
+//
+// QTText_GetNextChapterTime
+// Return, through the theTime parameter, the starting time of the chapter of the
+// specified chapter track that immediately follows the chapter starting at the time
+// passed in through theTime.
+//
+//////////
+
+OSErr QTText_GetNextChapterTime (Track theChapterTrack, TimeValue *theTime)
+{
+	short	myFlags = nextTimeMediaSample;					// we want the next sample in the movie
+	
+	if (theChapterTrack == NULL) {
+		*theTime = kBogusStartingTime;						// a bogus time
+		return(invalidTrack);
+	}
+	
+	GetTrackNextInterestingTime(theChapterTrack, myFlags, *theTime, fixed1, theTime, NULL);
+	return(GetMoviesError());
+}
+
+
+//////////
+//
+// QTText_GetMovieAppData
+// Return the application data of the window that displays the specified movie, or NULL if the movie isn't
+// in one of our windows.
+//
+//////////
+
+ApplicationDataHdl QTText_GetMovieAppData (Movie theMovie)
+{
+	WindowReference			myWindow = NULL;
+	WindowObject			myWindowObject = NULL;
+
+	if (theMovie == NULL)
+		return(NULL);
+
+	myWindow = QTFrame_GetFrontMovieWindow();
+	while (myWindow != NULL) {
+		myWindowObject = QTFrame_GetWindowObjectFromWindow(myWindow);
+		if ((myWindowObject != NULL) && ((**myWindowObject).fMovie == theMovie))
+			return((ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(myWindowObject));
+
+		myWindow = QTFrame_GetNextMovieWindow(myWindow);
+	}
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTText_GetIndChapterTime
+// Return the starting time of the chapter in the specified chapter track that has the specified index.
+//
+// If the track's movie is in one of our windows, we look the chapter up in the window's chapter table;
+// otherwise we have to walk the track from its first chapter.
+//
+//////////
+
+TimeValue QTText_GetIndChapterTime (Track theChapterTrack, long theIndex)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	long					myCount = 1;
+	TimeValue				myTime = kBogusStartingTime;
+
+	if ((theChapterTrack == NULL) || (theIndex < 1))
+		return(myTime);
+
+	myAppData = QTText_GetMovieAppData(GetTrackMovie(theChapterTrack));
+	if (myAppData != NULL)
+		return(QTText_GetTableChapterTime(myAppData, theChapterTrack, theIndex, NULL));
+
+	QTText_GetFirstChapterTime(theChapterTrack, &myTime);
+	if (theIndex == 1)
+		return(myTime);
+		
+	while (myCount < theIndex) {
+		QTText_GetNextChapterTime(theChapterTrack, &myTime);
+		myCount++;
+	}
+	
+	return(myTime);
+}
+
+
+//////////
+//
+// QTText_GetIndChapterSample
+// Read the sample of the chapter in the specified chapter track that has the specified index into the
+// handle gChapterSample, and return the length of its text, or -1 if there is no such chapter.
+//
+// The text starts sizeof(UInt16) bytes into the handle. We reuse the handle from call to call, so reading
+// one title after another doesn't allocate any memory once the handle is as big as the biggest sample.
+//
+//////////
+
+long QTText_GetIndChapterSample (Track theChapterTrack, long theIndex)
+{
+	long			mySize = 0;		// size of entire handle returned, which may include appended style atoms
+	long			myTextSize;
+	TimeValue		myTime;
+	OSErr			myErr = noErr;
+
+	if ((theChapterTrack == NULL) || (theIndex < 1) || (gChapterSample == NULL))
+		return(-1);
+
+	myTime = QTText_GetIndChapterTime(theChapterTrack, theIndex);
+	if (myTime == kBogusStartingTime)
+		return(-1);
+
+	myErr = GetMediaSample(	GetTrackMedia(theChapterTrack),
+							gChapterSample,
+							0,
+							&mySize,
+							QTText_TrackTimeToMediaTime(theChapterTrack, myTime),	// media time scale
+							NULL,
+							NULL,
+							NULL,
+							NULL,
+							0,
+							NULL,
+							NULL);
+	if (myErr != noErr)
+		return(-1);
+				
+	// for text media samples, the returned handle is a big-endian, unsigned 16-bit size field followed by
+	// the actual text data; don't trust the size field to stay within the handle
+	mySize = GetHandleSize(gChapterSample);
+	if (mySize < (long)sizeof(UInt16))
+		return(-1);
+
+	myTextSize = EndianU16_BtoN(*(UInt16 *)(*gChapterSample));
+	if (myTextSize > mySize - (long)sizeof(UInt16))
+		myTextSize = mySize - (long)sizeof(UInt16);
+
+	return(myTextSize);
+}
+
+
+//////////
+//
+// QTText_GetIndChapterText
+// Return the text of the chapter in the specified chapter track that has the specified index.
+//
+// The caller is responsible for disposing of the pointer returned by this function (by calling free).
+// To avoid that allocation, call QTText_CopyIndChapterText instead.
+//
+// If the track's movie is in one of our windows, the text comes from the window's chapter table; otherwise
+// we have to read the chapter's sample.
+//
+//////////
+
+char *QTText_GetIndChapterText (Track theChapterTrack, long theIndex)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	long					myTextSize;
+	char					*myText = NULL;
+
+	if (theChapterTrack == NULL)
+		return(myText);
+
+	myAppData = QTText_GetMovieAppData(GetTrackMovie(theChapterTrack));
+	if (myAppData != NULL)
+		return(QTText_GetTableChapterText(myAppData, theChapterTrack, theIndex));
+
+	myTextSize = QTText_GetIndChapterSample(theChapterTrack, theIndex);
+	if (myTextSize < 0)
+		return(myText);
+
+	// allocate the copy before we dereference the sample handle, in case the allocation moves memory
+	myText = malloc(myTextSize + 1);
+	if (myText != NULL) {
+		BlockMove(*gChapterSample + sizeof(UInt16), myText, myTextSize);
+		myText[myTextSize] = '\0';
+	}
+
+	return(myText);
+}
+
+
+//////////
+//
+// QTText_CopyIndChapterText
+// Copy the text of the chapter in the specified chapter track that has the specified index into the specified
+// buffer, as a null-terminated string, and return the length of the text; return -1 if there is no such chapter.
+//
+// If the buffer is too small, we copy as much of the text as fits; the return value is the length of all the
+// text, so compare it with theBufferSize to find out whether the text was truncated. As with
+// QTText_GetIndChapterText, the text comes from the window's chapter table if we can.
+//
+//////////
+
+long QTText_CopyIndChapterText (Track theChapterTrack, long theIndex, char *theBuffer, long theBufferSize)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	long					myTextSize;
+
+	if (theChapterTrack == NULL)
+		return(-1);
+
+	myAppData = QTText_GetMovieAppData(GetTrackMovie(theChapterTrack));
+	if (myAppData != NULL)
+		return(QTText_CopyTableChapterText(myAppData, theChapterTrack, theIndex, theBuffer, theBufferSize));
+
+	myTextSize = QTText_GetIndChapterSample(theChapterTrack, theIndex);
+	if ((myTextSize < 0) || (theBuffer == NULL) || (theBufferSize < 1))
+		return(myTextSize);
+
+	BlockMove(*gChapterSample + sizeof(UInt16), theBuffer, (myTextSize < theBufferSize) ? myTextSize : theBufferSize - 1);
+	theBuffer[(myTextSize < theBufferSize) ? myTextSize : theBufferSize - 1] = '\0';
+
+	return(myTextSize);
+}
+
+
+//////////
+//
+// QTText_GetChapterCount
+// Return the number of chapters in the specified chapter track.
+//
+// As with QTText_GetIndChapterTime, we use the window's chapter table if we can.
+//
+//////////
+
+long QTText_GetChapterCount (Track theChapterTrack)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	long					myCount = 0;
+	TimeValue				myTime = kBogusStartingTime;
+
+	if (theChapterTrack == NULL)
+		return(myCount);
+
+	myAppData = QTText_GetMovieAppData(GetTrackMovie(theChapterTrack));
+	if (myAppData != NULL)
+		return(QTText_GetTableChapterCount(myAppData, theChapterTrack));
+
+	QTText_GetFirstChapterTime(theChapterTrack, &myTime);
+	while (myTime != kBogusStartingTime) {
+		myCount++;
+		QTText_GetNextChapterTime(theChapterTrack, &myTime);
+	}
+
+	return(myCount);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Chapter table utilities.
+//
+// Use these functions to get the number, start times and titles of the chapters in a chapter track.
+//
+// Walking the chapter track from its first chapter to find the chapter with a given index means that listing
+// all the chapters takes a number of Movie Toolbox calls that grows with the square of the number of chapters,
+// and counting them takes yet another walk. Instead, we walk the track once and record the start time, duration
+// and title of every chapter in a chapter table; after that, getting the number of chapters, or the start time
+// or title of any one of them, is a lookup, and finding the chapter playing at a given time (for instance, to
+// move to the next or previous chapter) is a binary search. QTText_GetIndChapterTime and QTText_GetChapterCount
+// use the table of the window that displays the chapter track's movie, and walk the track only for a movie
+// that isn't in one of our windows.
+//
+// The table lives in the window's application data. It is rebuilt whenever the chapter track, its duration,
+// its modification time or the number of samples in its media changes. But the edits we make ourselves don't
+// need a rebuild: QTText_EditText, which never moves a chapter, changes just the title of the edited chapter
+// (QTText_SetTableChapterText), and QTText_AddTextTrack fills in the table of a new chapter track as it adds
+// the samples.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTText_BuildChapterTable
+// Build the chapter table of the specified application data for the specified chapter track.
+//
+//////////
+
+OSErr QTText_BuildChapterTable (ApplicationDataHdl theAppData, Track theChapterTrack)
+{
+	QTTextChapterTable		myTable;
+	Media					myMedia = NULL;
+	Handle					mySample = NULL;
+	TimeValue				myTime;
+	long					mySize;
+	long					myLength;
+	OSErr					myErr = noErr;
+
+	if (theAppData == NULL)
+		return(paramErr);
+
+	QTText_DisposeChapterTable(theAppData);
+
+	if (theChapterTrack == NULL)
+		return(invalidTrack);
+
+	myMedia = GetTrackMedia(theChapterTrack);
+
+	// the media sample count is a good first guess at the number of chapters
+	myErr = QTText_NewChapterTable(&myTable, theChapterTrack, GetMediaSampleCount(myMedia));
+	if (myErr != noErr)
+		return(myErr);
+
+	mySample = NewHandle(0);
+	if (mySample == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	GetTrackNextInterestingTime(theChapterTrack, nextTimeMediaSample | nextTimeEdgeOK, (TimeValue)0, fixed1, &myTime, NULL);
+	while (myTime >= 0) {
+		// get the chapter title; for text media samples, the sample is a big-endian, unsigned 16-bit size field
+		// followed by the actual text data, and we don't trust the size field to stay within the sample
+		if (GetMediaSample(myMedia, mySample, 0, &mySize, QTText_TrackTimeToMediaTime(theChapterTrack, myTime), NULL, NULL, NULL, NULL, 0, NULL, NULL) == noErr)
+			mySize = GetHandleSize(mySample);
+		else
+			mySize = 0;
+
+		myLength = 0;
+		if (mySize >= (long)sizeof(UInt16)) {
+			myLength = EndianU16_BtoN(*(UInt16 *)(*mySample));
+			if (myLength > mySize - (long)sizeof(UInt16))
+				myLength = mySize - (long)sizeof(UInt16);
+		}
+
+		// the sample mustn't move while its text is copied into the table
+		HLock(mySample);
+		myErr = QTText_AddTableChapter(&myTable, myTime, *mySample + sizeof(UInt16), myLength);
+		HUnlock(mySample);
+		if (myErr != noErr)
+			goto bail;
+
+		GetTrackNextInterestingTime(theChapterTrack, nextTimeMediaSample, myTime, fixed1, &myTime, NULL);
+	}
+
+	QTText_InstallChapterTable(theAppData, &myTable);
+
+bail:
+	if (mySample != NULL)
+		DisposeHandle(mySample);
+
+	if (myErr != noErr) {
+		DisposeHandle(myTable.fChapters);
+		DisposeHandle(myTable.fText);
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_NewChapterTable
+// Start a new, empty chapter table for the specified chapter track, with room for theCapacity chapters.
+//
+// Add the chapters with QTText_AddTableChapter, and then hand the table to QTText_InstallChapterTable.
+//
+//////////
+
+OSErr QTText_NewChapterTable (QTTextChapterTablePtr theTable, Track theChapterTrack, long theCapacity)
+{
+	if (theCapacity < 1)
+		theCapacity = 1;
+
+	theTable->fTrack = theChapterTrack;
+	theTable->fTrackDuration = 0;
+	theTable->fModificationTime = 0;
+	theTable->fMediaSampleCount = 0;
+	theTable->fCount = 0;
+	theTable->fTextSize = 0;
+	theTable->fChapters = NewHandle(theCapacity * sizeof(QTTextChapter));
+	theTable->fText = NewHandle(theCapacity * kChapterTableTextPerChapter);
+
+	if ((theTable->fChapters == NULL) || (theTable->fText == NULL)) {
+		if (theTable->fChapters != NULL)
+			DisposeHandle(theTable->fChapters);
+
+		if (theTable->fText != NULL)
+			DisposeHandle(theTable->fText);
+
+		theTable->fChapters = NULL;
+		theTable->fText = NULL;
+		return(memFullErr);
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTText_AddTableChapter
+// Add a chapter that starts at the specified time and has the specified title to the end of the specified
+// chapter table; its duration is filled in by QTText_InstallChapterTable.
+//
+//////////
+
+OSErr QTText_AddTableChapter (QTTextChapterTablePtr theTable, TimeValue theStart, const char *theText, long theLength)
+{
+	QTTextChapter		myChapter;
+	long				myCapacity;
+	OSErr				myErr = noErr;
+
+	// grow the array of chapters, if necessary
+	myCapacity = GetHandleSize(theTable->fChapters) / sizeof(QTTextChapter);
+	if (theTable->fCount == myCapacity) {
+		SetHandleSize(theTable->fChapters, 2 * myCapacity * sizeof(QTTextChapter));
+		myErr = MemError();
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	myErr = QTText_ReserveTableText(theTable, theLength + 1);
+	if (myErr != noErr)
+		return(myErr);
+
+	myChapter.fStart = theStart;
+	myChapter.fDuration = 0;
+	myChapter.fTextOffset = theTable->fTextSize;
+	myChapter.fTextLength = theLength;
+
+	if (theLength > 0)
+		BlockMove(theText, *theTable->fText + theTable->fTextSize, theLength);
+	(*theTable->fText)[theTable->fTextSize + theLength] = '\0';
+	theTable->fTextSize += theLength + 1;
+
+	((QTTextChapter *)*theTable->fChapters)[theTable->fCount] = myChapter;
+	theTable->fCount++;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTText_ReserveTableText
+// Make sure that the text of the specified chapter table has room for theSize more bytes.
+//
+// The text keeps its locked state, so the text of an installed table stays locked.
+//
+//////////
+
+OSErr QTText_ReserveTableText (QTTextChapterTablePtr theTable, long theSize)
+{
+	long				myCapacity;
+	SInt8				myState;
+
+	myCapacity = GetHandleSize(theTable->fText);
+	if (theTable->fTextSize + theSize <= myCapacity)
+		return(noErr);
+
+	while (theTable->fTextSize + theSize > myCapacity)
+		myCapacity *= 2;
+
+	myState = HGetState(theTable->fText);
+	HUnlock(theTable->fText);
+	SetHandleSize(theTable->fText, myCapacity);
+	HSetState(theTable->fText, myState);
+
+	return(MemError());
+}
+
+
+//////////
+//
+// QTText_InstallChapterTable
+// Fill in the durations of the chapters in the specified chapter table and make it the chapter table of the
+// specified application data, replacing any table it already has.
+//
+// The start times of the chapters must be track times, in increasing order.
+//
+//////////
+
+void QTText_InstallChapterTable (ApplicationDataHdl theAppData, QTTextChapterTablePtr theTable)
+{
+	QTTextChapter		*myChapters = NULL;
+	TimeValue			myEnd;
+	long				myIndex;
+
+	// each chapter lasts until the next one starts; the last one lasts until the movie ends
+	myChapters = (QTTextChapter *)*theTable->fChapters;
+	myEnd = GetMovieDuration(GetTrackMovie(theTable->fTrack));
+	for (myIndex = theTable->fCount - 1; myIndex >= 0; myIndex--) {
+		myChapters[myIndex].fDuration = myEnd - myChapters[myIndex].fStart;
+		myEnd = myChapters[myIndex].fStart;
+	}
+
+	// lock the text, so that QTText_GetTableChapterTextPtr can hand out pointers into it
+	HLock(theTable->fText);
+
+	QTText_DisposeChapterTable(theAppData);
+	(**theAppData).fChapterTable = *theTable;
+	QTText_RevalidateChapterTable(theAppData);
+}
+
+
+//////////
+//
+// QTText_DisposeChapterTable
+// Dispose of the chapter table of the specified application data.
+//
+//////////
+
+void QTText_DisposeChapterTable (ApplicationDataHdl theAppData)
+{
+	if (theAppData == NULL)
+		return;
+
+	if ((**theAppData).fChapterTable.fChapters != NULL)
+		DisposeHandle((**theAppData).fChapterTable.fChapters);
+
+	if ((**theAppData).fChapterTable.fText != NULL)
+		DisposeHandle((**theAppData).fChapterTable.fText);
+
+	(**theAppData).fChapterTable.fTrack = NULL;
+	(**theAppData).fChapterTable.fCount = 0;
+	(**theAppData).fChapterTable.fTextSize = 0;
+	(**theAppData).fChapterTable.fChapters = NULL;
+	(**theAppData).fChapterTable.fText = NULL;
+}
+
+
+//////////
+//
+// QTText_IsChapterTableValid
+// Is the chapter table of the specified application data an up-to-date table of the specified chapter track?
+//
+//////////
+
+Boolean QTText_IsChapterTableValid (ApplicationDataHdl theAppData, Track theChapterTrack)
+{
+	if ((theAppData == NULL) || (theChapterTrack == NULL))
+		return(false);
+
+	if (((**theAppData).fChapterTable.fChapters == NULL) || ((**theAppData).fChapterTable.fTrack != theChapterTrack))
+		return(false);
+
+	return(((**theAppData).fChapterTable.fTrackDuration == GetTrackDuration(theChapterTrack)) && 
+			((**theAppData).fChapterTable.fModificationTime == GetTrackModificationTime(theChapterTrack)) && 
+			((**theAppData).fChapterTable.fMediaSampleCount == GetMediaSampleCount(GetTrackMedia(theChapterTrack))));
+}
+
+
+//////////
+//
+// QTText_RevalidateChapterTable
+// Mark the chapter table of the specified application data as up to date.
+//
+// Call this after an edit that changed the chapter track's media but not the bounds of its chapters (and
+// after changing the affected titles in the table, with QTText_SetTableChapterText).
+//
+//////////
+
+void QTText_RevalidateChapterTable (ApplicationDataHdl theAppData)
+{
+	Track				myTrack = NULL;
+
+	if ((theAppData == NULL) || ((**theAppData).fChapterTable.fChapters == NULL))
+		return;
+
+	myTrack = (**theAppData).fChapterTable.fTrack;
+	(**theAppData).fChapterTable.fTrackDuration = GetTrackDuration(myTrack);
+	(**theAppData).fChapterTable.fModificationTime = GetTrackModificationTime(myTrack);
+	(**theAppData).fChapterTable.fMediaSampleCount = GetMediaSampleCount(GetTrackMedia(myTrack));
+}
+
+
+//////////
+//
+// QTText_SetTableChapterText
+// Change the title of the chapter of the specified chapter track that is playing at the specified time, in the
+// chapter table of the specified application data, and mark the table as up to date.
+//
+// Call this after an edit that replaced the text of that one chapter; the table must have been up to date
+// before the edit. A title no longer than the old one is written over it, and a longer one is added to the end
+// of the table's text, so that no other title moves; either way, the cost is that of finding the chapter.
+//
+//////////
+
+OSErr QTText_SetTableChapterText (ApplicationDataHdl theAppData, Track theChapterTrack, TimeValue theTime, const char *theText, long theLength)
+{
+	QTTextChapterTable		myTable;
+	QTTextChapter			*myChapter = NULL;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if ((theAppData == NULL) || (theChapterTrack == NULL) || (theLength < 0))
+		return(paramErr);
+
+	if (((**theAppData).fChapterTable.fChapters == NULL) || ((**theAppData).fChapterTable.fTrack != theChapterTrack))
+		return(paramErr);
+
+	myIndex = QTText_FindTableChapter(theAppData, theTime);
+	if (myIndex == 0)
+		return(paramErr);
+
+	// work on a copy of the table, since growing its text can move the application data
+	myTable = (**theAppData).fChapterTable;
+
+	if (theLength > ((QTTextChapter *)*myTable.fChapters)[myIndex - 1].fTextLength) {
+		myErr = QTText_ReserveTableText(&myTable, theLength + 1);
+		if (myErr != noErr)
+			return(myErr);
+
+		((QTTextChapter *)*myTable.fChapters)[myIndex - 1].fTextOffset = myTable.fTextSize;
+		myTable.fTextSize += theLength + 1;
+	}
+
+	myChapter = &((QTTextChapter *)*myTable.fChapters)[myIndex - 1];
+	if (theLength > 0)
+		BlockMove(theText, *myTable.fText + myChapter->fTextOffset, theLength);
+	(*myTable.fText)[myChapter->fTextOffset + theLength] = '\0';
+	myChapter->fTextLength = theLength;
+
+	(**theAppData).fChapterTable = myTable;
+	QTText_RevalidateChapterTable(theAppData);
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTText_UpdateChapterTable
+// Make sure that the chapter table of the specified application data is an up-to-date table of the
+// specified chapter track, rebuilding it if necessary.
+//
+//////////
+
+OSErr QTText_UpdateChapterTable (ApplicationDataHdl theAppData, Track theChapterTrack)
+{
+	if (QTText_IsChapterTableValid(theAppData, theChapterTrack))
+		return(noErr);
+
+	return(QTText_BuildChapterTable(theAppData, theChapterTrack));
+}
+
+
+//////////
+//
+// QTText_GetTableChapterCount
+// Return the number of chapters in the specified chapter track, using the chapter table of the specified
+// application data.
+//
+//////////
+
+long QTText_GetTableChapterCount (ApplicationDataHdl theAppData, Track theChapterTrack)
+{
+	if (QTText_UpdateChapterTable(theAppData, theChapterTrack) != noErr)
+		return(0);
+
+	return((**theAppData).fChapterTable.fCount);
+}
+
+
+//////////
+//
+// QTText_GetTableChapterTime
+// Return the starting time of the chapter in the specified chapter track that has the specified index,
+// using the chapter table of the specified application data; also return, through theDuration (which can
+// be NULL), the time until the next chapter starts.
+//
+//////////
+
+TimeValue QTText_GetTableChapterTime (ApplicationDataHdl theAppData, Track theChapterTrack, long theIndex, TimeValue *theDuration)
+{
+	QTTextChapter		*myChapter = NULL;
+
+	if (theDuration != NULL)
+		*theDuration = 0;
+
+	if (QTText_UpdateChapterTable(theAppData, theChapterTrack) != noErr)
+		return(kBogusStartingTime);
+
+	if ((theIndex < 1) || (theIndex > (**theAppData).fChapterTable.fCount))
+		return(kBogusStartingTime);
+
+	myChapter = &((QTTextChapter *)*(**theAppData).fChapterTable.fChapters)[theIndex - 1];
+	if (theDuration != NULL)
+		*theDuration = myChapter->fDuration;
+
+	return(myChapter->fStart);
+}
+
+
+//////////
+//
+// QTText_GetTableChapterTextPtr
+// Return a pointer to the text of the chapter in the specified chapter track that has the specified index,
+// using the chapter table of the specified application data, and return its length through theLength (which
+// can be NULL); return NULL if there is no such chapter.
+//
+// The text is null-terminated. It belongs to the chapter table, which keeps its text locked; so the pointer
+// stays good until the table is rebuilt or disposed of, or until a title in it is made longer.
+//
+//////////
+
+const char *QTText_GetTableChapterTextPtr (ApplicationDataHdl theAppData, Track theChapterTrack, long theIndex, long *theLength)
+{
+	QTTextChapter		*myChapter = NULL;
+
+	if (theLength != NULL)
+		*theLength = 0;
+
+	if (QTText_UpdateChapterTable(theAppData, theChapterTrack) != noErr)
+		return(NULL);
+
+	if ((theIndex < 1) || (theIndex > (**theAppData).fChapterTable.fCount))
+		return(NULL);
+
+	myChapter = &((QTTextChapter *)*(**theAppData).fChapterTable.fChapters)[theIndex - 1];
+	if (theLength != NULL)
+		*theLength = myChapter->fTextLength;
+
+	return(*(**theAppData).fChapterTable.fText + myChapter->fTextOffset);
+}
+
+
+//////////
+//
+// QTText_GetTableChapterText
+// Return the text of the chapter in the specified chapter track that has the specified index, using the
+// chapter table of the specified application data.
+//
+// The caller is responsible for disposing of the pointer returned by this function (by calling free).
+// To avoid that allocation, call QTText_GetTableChapterTextPtr or QTText_CopyTableChapterText instead.
+//
+//////////
+
+char *QTText_GetTableChapterText (ApplicationDataHdl theAppData, Track theChapterTrack, long theIndex)
+{
+	const char			*myTableText = NULL;
+	long				myLength;
+	char				*myText = NULL;
+
+	myTableText = QTText_GetTableChapterTextPtr(theAppData, theChapterTrack, theIndex, &myLength);
+	if (myTableText == NULL)
+		return(myText);
+
+	myText = malloc(myLength + 1);
+	if (myText != NULL)
+		BlockMove(myTableText, myText, myLength + 1);
+
+	return(myText);
+}
+
+
+//////////
+//
+// QTText_CopyTableChapterText
+// Copy the text of the chapter in the specified chapter track that has the specified index into the specified
+// buffer, as a null-terminated string, using the chapter table of the specified application data; return the
+// length of the text, or -1 if there is no such chapter.
+//
+// As with QTText_CopyIndChapterText, a buffer that's too small gets as much of the text as fits.
+//
+//////////
+
+long QTText_CopyTableChapterText (ApplicationDataHdl theAppData, Track theChapterTrack, long theIndex, char *theBuffer, long theBufferSize)
+{
+	const char			*myTableText = NULL;
+	long				myLength;
+
+	myTableText = QTText_GetTableChapterTextPtr(theAppData, theChapterTrack, theIndex, &myLength);
+	if (myTableText == NULL)
+		return(-1);
+
+	if ((theBuffer != NULL) && (theBufferSize > 0)) {
+		BlockMove(myTableText, theBuffer, (myLength < theBufferSize) ? myLength : theBufferSize - 1);
+		theBuffer[(myLength < theBufferSize) ? myLength : theBufferSize - 1] = '\0';
+	}
+
+	return(myLength);
+}
+
+
+//////////
+//
+// QTText_GetTableChapterIndex
+// Return the index of the chapter of the specified chapter track that is playing at the specified time,
+// using the chapter table of the specified application data; return 0 if the time precedes the first
+// chapter (or the track has no chapters).
+//
+//////////
+
+long QTText_GetTableChapterIndex (ApplicationDataHdl theAppData, Track theChapterTrack, TimeValue theTime)
+{
+	if (QTText_UpdateChapterTable(theAppData, theChapterTrack) != noErr)
+		return(0);
+
+	return(QTText_FindTableChapter(theAppData, theTime));
+}
+
+
+//////////
+//
+// QTText_FindTableChapter
+// Return the index of the chapter in the chapter table of the specified application data that is playing at
+// the specified time, without checking that the table is up to date; return 0 if the time precedes the first
+// chapter (or the table has no chapters).
+//
+//////////
+
+long QTText_FindTableChapter (ApplicationDataHdl theAppData, TimeValue theTime)
+{
+	QTTextChapter		*myChapters = NULL;
+	long				myLow = 0;
+	long				myHigh;
+	long				myMiddle;
+
+	if ((theAppData == NULL) || ((**theAppData).fChapterTable.fChapters == NULL))
+		return(0);
+
+	myChapters = (QTTextChapter *)*(**theAppData).fChapterTable.fChapters;
+	myHigh = (**theAppData).fChapterTable.fCount - 1;
+	if ((myHigh < 0) || (theTime < myChapters[0].fStart))
+		return(0);
+
+	// find the last chapter that starts at or before the specified time
+	while (myLow < myHigh) {
+		myMiddle = myLow + ((myHigh - myLow + 1) / 2);
+		if (myChapters[myMiddle].fStart <= theTime)
+			myLow = myMiddle;
+		else
+			myHigh = myMiddle - 1;
+	}
+
+	return(myLow + 1);
+}
+
+
+//////////
+//
+// QTText_GoToRelativeChapter
+// Move the movie in the specified window object to the start of the chapter that is the specified number of
+// chapters after (or, if theDelta is negative, before) the current chapter.
+//
+// We stop at the first and last chapters. Before the first chapter, the next chapter is the first one.
+//
+//////////
+
+OSErr QTText_GoToRelativeChapter (WindowObject theWindowObject, long theDelta)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	Movie					myMovie = NULL;
+	Track					myTrack = NULL;
+	TimeRecord				myTimeRecord;
+	long					myCount;
+	long					myIndex;
+
+	if (theWindowObject == NULL)
+		return(paramErr);
+
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
+	myMovie = (**theWindowObject).fMovie;
+	if ((myAppData == NULL) || (myMovie == NULL) || ((**theWindowObject).fController == NULL))
+		return(paramErr);
+
+	myTrack = QTText_GetChapterTrackForMovie(myMovie);
+	myCount = QTText_GetTableChapterCount(myAppData, myTrack);
+	if (myCount == 0)
+		return(invalidTrack);
+
+	myIndex = QTText_GetTableChapterIndex(myAppData, myTrack, GetMovieTime(myMovie, NULL)) + theDelta;
+	if (myIndex < 1)
+		myIndex = 1;
+	if (myIndex > myCount)
+		myIndex = myCount;
+
+	myTimeRecord.value.hi = 0;
+	myTimeRecord.value.lo = QTText_GetTableChapterTime(myAppData, myTrack, myIndex, NULL);
+	myTimeRecord.base = 0;
+	myTimeRecord.scale = GetMovieTimeScale(myMovie);
+
+	return((OSErr)MCDoAction((**theWindowObject).fController, mcActionGoToTime, &myTimeRecord));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Text edit transaction utilities.
+//
+// Use these functions to replace the text of many samples of a window's text track at once.
+//
+// Replacing one sample takes a media-edit session (BeginMediaEdits to EndMediaEdits), a DeleteTrackSegment, an
+// InsertMediaIntoTrack and an MCMovieChanged, which makes the movie controller rebuild its chapter pop-up; so
+// a few hundred caption fixes made one at a time pay for all of that a few hundred times. A transaction
+// instead queues the replacements (in time order, with a later replacement of a sample overriding an earlier
+// one) and then, when it's committed, adds all the new samples to the media in one media-edit session, with
+// a text media writer, before swapping them into the track. Each new sample has the same duration as the
+// sample it replaces, so no other sample moves: the sample index stays good, and the chapter table needs only
+// the changed titles. The movie controller is told about the changes once, at the end.
+//
+// QTText_EditText is a transaction holding a single replacement. QTText_ReplaceAllText reads every sample of the
+// track once, in time order (using the sample index, so finding the next sample costs nothing), and queues only
+// the samples whose text changes; a track of 100,000 samples with a few hundred changes costs 100,000 sample
+// reads and a single commit.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTText_BeginTransaction
+// Start a new text edit transaction on the (first) text track of the specified window object; return it
+// through theTransaction.
+//
+// A transaction must be finished with QTText_CommitTransaction or QTText_CancelTransaction, either of which
+// disposes of it.
+//
+//////////
+
+OSErr QTText_BeginTransaction (WindowObject theWindowObject, QTTextTransactionPtr *theTransaction)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	QTTextTransactionPtr	myTransaction = NULL;
+
+	if (theTransaction == NULL)
+		return(paramErr);
+
+	*theTransaction = NULL;
+
+	if (theWindowObject == NULL)
+		return(paramErr);
+
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
+	if ((myAppData == NULL) || ((**myAppData).fTextTrack == NULL))
+		return(invalidTrack);
+
+	myTransaction = (QTTextTransactionPtr)NewPtrClear(sizeof(QTTextTransaction));
+	if (myTransaction == NULL)
+		return(memFullErr);
+
+	myTransaction->fWindowObject = theWindowObject;
+	myTransaction->fTrack = (**myAppData).fTextTrack;
+	myTransaction->fEdits = NewHandle(kTransactionMinEdits * sizeof(QTTextSampleEdit));
+	myTransaction->fText = NewHandle(kTransactionMinEdits * kTransactionTextPerEdit);
+	if ((myTransaction->fEdits == NULL) || (myTransaction->fText == NULL)) {
+		QTText_CancelTransaction(myTransaction);
+		return(memFullErr);
+	}
+
+	*theTransaction = myTransaction;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTText_QueueSampleText
+// Queue, in the specified text edit transaction, the replacement of the text of the sample that is displayed
+// at the specified movie time.
+//
+// The sample keeps its start time and duration. If the transaction already holds a replacement of the same
+// sample, the new text takes its place.
+//
+//////////
+
+OSErr QTText_QueueSampleText (QTTextTransactionPtr theTransaction, TimeValue theTime, const char *theText, long theLength)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	QTTextSampleEdit		myEdit;
+	QTTextSampleEdit		*myEdits = NULL;
+	long					myPosition;
+	long					mySize;
+	OSErr					myErr = noErr;
+
+	if ((theTransaction == NULL) || (theLength < 0) || (theLength > kQTFile_MaxTextLength))
+		return(paramErr);
+
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theTransaction->fWindowObject);
+	if ((myAppData == NULL) || ((**myAppData).fTextTrack != theTransaction->fTrack))
+		return(invalidTrack);
+
+	// find the sample that is displayed at the specified time
+	myErr = QTText_GetSampleBounds(myAppData, theTime, &myEdit.fStart, &myEdit.fDuration, &myEdit.fMediaDuration);
+	if (myErr != noErr)
+		return(myErr);
+
+	// remember where the sample's media is, so that QTText_CommitTransaction can put it back if it has to
+	myEdit.fOldMediaStart = TrackTimeToMediaTime(myEdit.fStart, theTransaction->fTrack);
+
+	// make room for the text and for one more replacement
+	mySize = GetHandleSize(theTransaction->fText);
+	if (theTransaction->fTextSize + theLength > mySize) {
+		while (theTransaction->fTextSize + theLength > mySize)
+			mySize *= 2;
+
+		SetHandleSize(theTransaction->fText, mySize);
+		myErr = MemError();
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	mySize = GetHandleSize(theTransaction->fEdits);
+	if ((theTransaction->fCount + 1) * (long)sizeof(QTTextSampleEdit) > mySize) {
+		SetHandleSize(theTransaction->fEdits, 2 * mySize);
+		myErr = MemError();
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	if (theLength > 0)
+		BlockMove(theText, *theTransaction->fText + theTransaction->fTextSize, theLength);
+
+	myEdit.fMediaStart = kBogusStartingTime;
+	myEdit.fTextOffset = theTransaction->fTextSize;
+	myEdit.fTextLength = theLength;
+	theTransaction->fTextSize += theLength;
+
+	// keep the replacements in time order; they usually come in that order anyway, so look for the new one's
+	// place from the end
+	myEdits = (QTTextSampleEdit *)*theTransaction->fEdits;
+	myPosition = theTransaction->fCount;
+	while ((myPosition > 0) && (myEdits[myPosition - 1].fStart > myEdit.fStart))
+		myPosition--;
+
+	// a later replacement of a sample overrides an earlier one (whose text just goes unused)
+	if ((myPosition > 0) && (myEdits[myPosition - 1].fStart == myEdit.fStart)) {
+		myEdits[myPosition - 1] = myEdit;
+		return(noErr);
+	}
+
+	for (mySize = theTransaction->fCount; mySize > myPosition; mySize--)
+		myEdits[mySize] = myEdits[mySize - 1];
+
+	myEdits[myPosition] = myEdit;
+	theTransaction->fCount++;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTText_CommitTransaction
+// Apply all the replacements queued in the specified text edit transaction, and dispose of the transaction.
+//
+// If a new sample can't be added, the track isn't touched. If a replacement can't be swapped into the track,
+// we swap the old samples back in for the replacements already made, so that the track is left as it was.
+//
+//////////
+
+OSErr QTText_CommitTransaction (QTTextTransactionPtr theTransaction)
+{
+	WindowObject			myWindowObject = NULL;
+	ApplicationDataHdl		myAppData = NULL;
+	Track					myTrack = NULL;
+	Media					myMedia = NULL;
+	QTTextSampleEdit		*myEdits = NULL;
+	Fixed					myWidth;
+	Fixed					myHeight;
+	Rect					myBounds;
+	Boolean					wasSampleIndexValid;
+	Boolean					wasChapterTableValid;
+	Boolean					isDeleted = false;
+	Boolean					isTrackChanged = true;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theTransaction == NULL)
+		return(paramErr);
+
+	if (theTransaction->fCount == 0)
+		goto bail;
+
+	myWindowObject = theTransaction->fWindowObject;
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(myWindowObject);
+	myTrack = theTransaction->fTrack;
+	if ((myAppData == NULL) || ((**myAppData).fTextTrack != myTrack)) {
+		myErr = invalidTrack;
+		goto bail;
+	}
+
+	myMedia = GetTrackMedia(myTrack);
+
+	// the sample index and the chapter table can be patched after the edits only if they're up to date before them
+	wasSampleIndexValid = QTText_IsSampleIndexValid(myAppData);
+	wasChapterTableValid = QTText_IsChapterTableValid(myAppData, myTrack);
+
+	// get the track bounds
+	GetTrackDimensions(myTrack, &myWidth, &myHeight);
+	myBounds.top = 0;
+	myBounds.left = 0;
+	myBounds.right = Fix2Long(myWidth);
+	myBounds.bottom = Fix2Long(myHeight);
+
+	HLock(theTransaction->fEdits);
+	HLock(theTransaction->fText);
+	myEdits = (QTTextSampleEdit *)*theTransaction->fEdits;
+
+	// add all the new samples to the media, in a single media-edit session
+	myErr = BeginMediaEdits(myMedia);
+	if (myErr != noErr)
+		goto bail;
+
+#if USE_TEXTWRITER
+	{
+		QTTextWriterPtr		myWriter = NULL;
+		TimeValue			myMediaTime = kBogusStartingTime;
+
+		myErr = QTText_NewTextWriter(myMedia, &myBounds, kTextWriterChunkSize, &myWriter);
+		if (myErr == noErr) {
+			for (myIndex = 0; (myIndex < theTransaction->fCount) && (myErr == noErr); myIndex++)
+				myErr = QTText_WriteTextSample(myWriter, *theTransaction->fText + myEdits[myIndex].fTextOffset, myEdits[myIndex].fTextLength, myEdits[myIndex].fMediaDuration);
+
+			// if a sample couldn't be written, the track won't be touched, so there's no point adding the others
+			if (myErr == noErr)
+				myErr = QTText_DisposeTextWriter(myWriter, &myMediaTime);
+			else
+				QTText_DiscardTextWriter(myWriter);
+		}
+
+		// the writer adds the samples one after another
+		for (myIndex = 0; (myIndex < theTransaction->fCount) && (myErr == noErr); myIndex++) {
+			myEdits[myIndex].fMediaStart = myMediaTime;
+			myMediaTime += myEdits[myIndex].fMediaDuration;
+		}
+	}
+#else
+	for (myIndex = 0; (myIndex < theTransaction->fCount) && (myErr == noErr); myIndex++)
+		myErr = TextMediaAddTextSample(	GetMediaHandler(myMedia), 
+										*theTransaction->fText + myEdits[myIndex].fTextOffset, 
+										myEdits[myIndex].fTextLength,
+										0,
+										0,
+										0,
+										NULL, 
+										NULL, 
+										teCenter,
+										&myBounds, 
+										dfClipToTextBox, 
+										0, 
+										0, 
+										0, 
+										NULL, 
+										myEdits[myIndex].fMediaDuration, 
+										&myEdits[myIndex].fMediaStart);
+#endif
+
+	EndMediaEdits(myMedia);
+	if (myErr != noErr)
+		goto bail;
+
+	// swap the new samples into the track, in time order
+	for (myIndex = 0; myIndex < theTransaction->fCount; myIndex++) {
+		myErr = DeleteTrackSegment(myTrack, myEdits[myIndex].fStart, myEdits[myIndex].fDuration);
+		if (myErr != noErr)
+			break;
+
+		isDeleted = true;
+		myErr = InsertMediaIntoTrack(myTrack, myEdits[myIndex].fStart, myEdits[myIndex].fMediaStart, myEdits[myIndex].fMediaDuration, fixed1);
+		if (myErr != noErr)
+			break;
+
+		isDeleted = false;
+	}
+
+	// if a swap failed, put the old samples back, starting with the one whose new sample couldn't be inserted;
+	// the new samples stay in the media, unused
+	if (myErr != noErr) {
+		OSErr		myUndoErr = noErr;
+
+		if (isDeleted)
+			myUndoErr = InsertMediaIntoTrack(myTrack, myEdits[myIndex].fStart, myEdits[myIndex].fOldMediaStart, myEdits[myIndex].fMediaDuration, fixed1);
+
+		while ((--myIndex >= 0) && (myUndoErr == noErr)) {
+			myUndoErr = DeleteTrackSegment(myTrack, myEdits[myIndex].fStart, myEdits[myIndex].fDuration);
+			if (myUndoErr == noErr)
+				myUndoErr = InsertMediaIntoTrack(myTrack, myEdits[myIndex].fStart, myEdits[myIndex].fOldMediaStart, myEdits[myIndex].fMediaDuration, fixed1);
+		}
+
+		isTrackChanged = (myUndoErr != noErr);
+	}
+
+	// the track's edits now point at other media (or have at least been split), so its edit index isn't good any more
+	QTText_InvalidateEditIndex(myTrack);
+
+	// if the old samples are all back in place, the track shows what it did before; only its media has grown
+	if (!isTrackChanged) {
+		if (wasSampleIndexValid)
+			QTText_RevalidateSampleIndex(myAppData);
+
+		goto bail;
+	}
+
+	if (myErr == noErr) {
+		// no sample has moved, so the sample index is still good
+		if (wasSampleIndexValid)
+			QTText_RevalidateSampleIndex(myAppData);
+
+		// the chapter table holds the old text, if this is the chapter track; change just the edited titles
+		if ((**myAppData).fChapterTable.fTrack == myTrack) {
+			for (myIndex = 0; (myIndex < theTransaction->fCount) && wasChapterTableValid; myIndex++)
+				if (QTText_SetTableChapterText(myAppData, myTrack, myEdits[myIndex].fStart, *theTransaction->fText + myEdits[myIndex].fTextOffset, myEdits[myIndex].fTextLength) != noErr)
+					wasChapterTableValid = false;
+
+			if (!wasChapterTableValid)
+				QTText_DisposeChapterTable(myAppData);
+		}
+	} else {
+		// we don't know how much of the track was edited
+		QTText_DisposeSampleIndex(myAppData);
+		if ((**myAppData).fChapterTable.fTrack == myTrack)
+			QTText_DisposeChapterTable(myAppData);
+	}
+
+	// stamp the movie as dirty
+	(**myWindowObject).fIsDirty = true;
+
+	// update the chapter pop-up, once for all the replacements
+	QTText_NoteMovieChanged(myWindowObject);
+	QTText_FlushMovieChanged(myWindowObject);
+
+bail:
+	QTText_CancelTransaction(theTransaction);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_CancelTransaction
+// Dispose of the specified text edit transaction, without applying any of its replacements.
+//
+//////////
+
+void QTText_CancelTransaction (QTTextTransactionPtr theTransaction)
+{
+	if (theTransaction == NULL)
+		return;
+
+	if (theTransaction->fEdits != NULL)
+		DisposeHandle(theTransaction->fEdits);
+
+	if (theTransaction->fText != NULL)
+		DisposeHandle(theTransaction->fText);
+
+	DisposePtr((Ptr)theTransaction);
+}
+
+
+//////////
+//
+// QTText_ReplaceAllText
+// Replace every occurrence of theFind in the (first) text track of the specified window object with theReplace,
+// in a single text edit transaction; return the number of samples changed through theCount, which can be NULL.
+//
+// Matching ignores case unless gSearchWithCase is set. Only the ASCII letters A to Z are folded; all other
+// characters must match exactly. The search direction and wrapping don't apply, since every sample is looked
+// at. Each changed sample keeps its start time and duration. If a changed sample would be longer than a text
+// sample can be, nothing is changed.
+//
+//////////
+
+OSErr QTText_ReplaceAllText (WindowObject theWindowObject, Str255 theFind, Str255 theReplace, long *theCount)
+{
+	ApplicationDataHdl		myAppData = NULL;
+	QTTextTransactionPtr	myTransaction = NULL;
+	Track					myTrack = NULL;
+	Media					myMedia = NULL;
+	Handle					mySample = NULL;
+	Ptr						myText = NULL;
+	long					mySampleCount;
+	long					myCount = 0;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theCount != NULL)
+		*theCount = 0;
+
+	if ((theWindowObject == NULL) || (theFind == NULL) || (theReplace == NULL) || (theFind[0] == 0))
+		return(paramErr);
+
+	myAppData = (ApplicationDataHdl)QTFrame_GetAppDataFromWindowObject(theWindowObject);
+	if ((myAppData == NULL) || ((**myAppData).fTextTrack == NULL))
+		return(invalidTrack);
+
+	// the sample index gives us the start of every sample in the track, in time order
+	if (!QTText_IsSampleIndexValid(myAppData)) {
+		myErr = QTText_BuildSampleIndex(myAppData);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	myErr = QTText_BeginTransaction(theWindowObject, &myTransaction);
+	if (myErr != noErr)
+		return(myErr);
+
+	myTrack = (**myAppData).fTextTrack;
+	myMedia = GetTrackMedia(myTrack);
+
+	// one handle for the samples as we read them, and one buffer for the new text
+	mySample = NewHandle(0);
+	myText = NewPtr(kQTFile_MaxTextLength);
+	if ((mySample == NULL) || (myText == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	mySampleCount = (**myAppData).fSampleIndex.fCount;
+	for (myIndex = 0; myIndex < mySampleCount; myIndex++) {
+		TimeValue		myStart = ((TimeValue *)*(**myAppData).fSampleIndex.fStarts)[myIndex];
+		long			mySize = 0;
+		long			myLength;
+
+		myErr = GetMediaSample(myMedia, mySample, 0, &mySize, QTText_TrackTimeToMediaTime(myTrack, myStart), NULL, NULL, NULL, NULL, 0, NULL, NULL);
+		if (myErr != noErr)
+			goto bail;
+
+		// a text sample starts with the length of its text
+		if (mySize < 2)
+			continue;
+
+		myLength = (long)(((unsigned char *)*mySample)[0] << 8) | ((unsigned char *)*mySample)[1];
+		if (myLength > mySize - 2)
+			myLength = mySize - 2;
+
+		myLength = QTText_ReplaceInBuffer(*mySample + 2, myLength, theFind, theReplace, gSearchWithCase, myText, kQTFile_MaxTextLength);
+		if (myLength == kReplaceNoMatch)
+			continue;
+
+		if (myLength == kReplaceTooLong) {
+			myErr = paramErr;
+			goto bail;
+		}
+
+		myErr = QTText_QueueSampleText(myTransaction, myStart, myText, myLength);
+		if (myErr != noErr)
+			goto bail;
+
+		myCount++;
+	}
+
+	// apply all the changes at once; the commit disposes of the transaction
+	if (myCount > 0) {
+		myErr = QTText_CommitTransaction(myTransaction);
+		myTransaction = NULL;
+	}
+
+	if ((myErr == noErr) && (theCount != NULL))
+		*theCount = myCount;
+
+bail:
+	if (myTransaction != NULL)
+		QTText_CancelTransaction(myTransaction);
+
+	if (mySample != NULL)
+		DisposeHandle(mySample);
+
+	if (myText != NULL)
+		DisposePtr(myText);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_ReplaceInBuffer
+// Copy the specified text into theBuffer, replacing every occurrence of theFind with theReplace; return the
+// length of the new text, kReplaceNoMatch if theFind doesn't occur in the text, or kReplaceTooLong if the new
+// text doesn't fit in theBufferSize bytes.
+//
+// Occurrences are found from left to right and don't overlap. Unless isCaseSensitive is true, an ASCII letter
+// matches the same letter in either case.
+//
+//////////
+
+long QTText_ReplaceInBuffer (const char *theText, long theLength, Str255 theFind, Str255 theReplace, Boolean isCaseSensitive, char *theBuffer, long theBufferSize)
+{
+	const unsigned char		*myText = (const unsigned char *)theText;
+	const unsigned char		*myFind = &theFind[1];
+	long					myFindLength = theFind[0];
+	long					myOffset = 0;
+	long					myCopied = 0;			// the number of bytes of theText already copied (or replaced)
+	long					myNewLength = 0;
+	long					myMatchCount = 0;
+	long					myIndex;
+
+	if (myFindLength == 0)
+		return(kReplaceNoMatch);
+
+	while (myOffset + myFindLength <= theLength) {
+		for (myIndex = 0; myIndex < myFindLength; myIndex++) {
+			unsigned char	myChar = myText[myOffset + myIndex];
+
+			if (myChar == myFind[myIndex])
+				continue;
+
+			// the two characters are the same ASCII letter, in different cases
+			if (!isCaseSensitive && ((myChar | 0x20) == (myFind[myIndex] | 0x20)) && ((myChar | 0x20) >= 'a') && ((myChar | 0x20) <= 'z'))
+				continue;
+
+			break;
+		}
+
+		if (myIndex < myFindLength) {
+			myOffset++;
+			continue;
+		}
+
+		// copy the text before the match, and then the replacement
+		if (myNewLength + (myOffset - myCopied) + theReplace[0] > theBufferSize)
+			return(kReplaceTooLong);
+
+		BlockMove(theText + myCopied, theBuffer + myNewLength, myOffset - myCopied);
+		myNewLength += myOffset - myCopied;
+		BlockMove(&theReplace[1], theBuffer + myNewLength, theReplace[0]);
+		myNewLength += theReplace[0];
+
+		myOffset += myFindLength;
+		myCopied = myOffset;
+		myMatchCount++;
+	}
+
+	if (myMatchCount == 0)
+		return(kReplaceNoMatch);
+
+	// copy the text after the last match
+	if (myNewLength + (theLength - myCopied) > theBufferSize)
+		return(kReplaceTooLong);
+
+	BlockMove(theText + myCopied, theBuffer + myNewLength, theLength - myCopied);
+	myNewLength += theLength - myCopied;
+
+	return(myNewLength);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// HREF track utilities.
+//
+// Use these functions to manipulate HREF tracks in a movie.
+//
+// An HREF track is a text track that has a special name ("HREFTrack") and some of whose samples specify
+// URLs that are loaded when the user clicks in the movie box when the text sample is active or when the
+// text sample first loads.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTText_SetTextTrackAsHREFTrack
+// Set the specified track to be or not to be an HREF track.
+//
+//////////
+
+OSErr QTText_SetTextTrackAsHREFTrack (Track theTrack, Boolean isHREFTrack)
+{
+	OSErr		myErr = noErr;
+	
+	myErr = QTUtils_SetTrackName(theTrack, isHREFTrack ? kHREFTrackName : kNonHREFTrackName);
+
+	return(myErr);
 }
 
 
@@ -1166,23 +4600,626 @@ OSErr QTText_SetTextTrackAsHREFTrack (Track theTrack, Boolean isHREFTrack)
 // QTText_IsHREFTrack
 // Is the specified track an HREF track?
 //
-// For the moment, we are content to count a track as an HREF track if its name is "HREFTrack";
-// a more thorough test would be to look through the text samples for some actual URLs. This is
-// left as an exercise for the reader.
+// For the moment, we are content to count a track as an HREF track if its name is "HREFTrack";
+// a more thorough test would be to look through the text samples for some actual URLs. This is
+// left as an exercise for the reader.
+//
+//////////
+
+Boolean QTText_IsHREFTrack (Track theTrack)
+{
+	Boolean		isHREFTrack = false;
+	char 		*myTrackName = NULL;
+	
+	myTrackName = QTUtils_GetTrackName(theTrack);
+	if (myTrackName != NULL)
+		isHREFTrack = (strcmp(myTrackName, kHREFTrackName) == 0);
+	
+	free(myTrackName);
+	return(isHREFTrack);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Text encoding utilities.
+//
+// Use these functions to get the text of a text media sample as UTF-8.
+//
+// The text in a text media sample is stored in the encoding of the script system of the sample description's
+// default font; so a Japanese sample is Shift-JIS, a Roman sample is Mac Roman, and so forth. (A sample can
+// also begin with a Unicode byte order mark, in which case it's UTF-16 or UTF-8.) We convert each sample only
+// once and keep the UTF-8 text in gTextCache, which throws away the least recently used samples when it grows
+// past its byte budget. Anything that wants to look at lots of samples (searching, exporting, listing the
+// chapters) should get the text from here.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTText_GetSampleTextUTF8
+// Return the text of the specified sample in the specified text media, converted to UTF-8; return the
+// length of the text (in bytes) through theLength.
+//
+// The returned text is owned by the cache, and it is NOT null-terminated; it remains valid only until
+// the next call to this function or to QTText_GetIndChapterTextUTF8. Copy it if you need to keep it.
+//
+//////////
+
+const char *QTText_GetSampleTextUTF8 (Media theMedia, long theSampleNum, long *theLength)
+{
+	const char					*myText = NULL;
+	Handle						mySample = NULL;
+	SampleDescriptionHandle		myDesc = NULL;
+	TimeValue					myTime;
+	long						mySize = 0;
+	long						myEncoding = kQTTextEnc_MacRoman;
+	OSErr						myErr = noErr;
+
+	if (theLength != NULL)
+		*theLength = 0;
+
+	if ((theMedia == NULL) || (theSampleNum < 1) || (theLength == NULL))
+		return(NULL);
+
+	// if we've already converted this sample, we're done
+	myText = QTTextEnc_CacheLookup(gTextCache, theMedia, theSampleNum, theLength);
+	if (myText != NULL)
+		return(myText);
+
+	mySample = NewHandle(0);
+	myDesc = (SampleDescriptionHandle)NewHandle(0);
+	if ((mySample == NULL) || (myDesc == NULL))
+		goto bail;
+
+	SampleNumToMediaTime(theMedia, theSampleNum, &myTime, NULL);
+	myErr = GetMediaSample(theMedia, mySample, 0, &mySize, myTime, NULL, NULL, myDesc, NULL, 0, NULL, NULL);
+	if (myErr != noErr)
+		goto bail;
+
+	// the sample description's default font tells us which script (and hence which encoding) the text is in
+	if (GetHandleSize((Handle)myDesc) >= (long)sizeof(TextDescription))
+		myEncoding = QTTextEnc_GetEncodingForScript(FontToScript((**(TextDescriptionHandle)myDesc).defaultStyle.scrpFont));
+
+	HLock(mySample);
+	myText = QTTextEnc_CacheInsert(gTextCache, theMedia, theSampleNum, myEncoding, (unsigned char *)*mySample, GetHandleSize(mySample), theLength);
+	HUnlock(mySample);
+
+bail:
+	if (mySample != NULL)
+		DisposeHandle(mySample);
+
+	if (myDesc != NULL)
+		DisposeHandle((Handle)myDesc);
+
+	return(myText);
+}
+
+
+//////////
+//
+// QTText_GetIndChapterTextUTF8
+// Return the text of the chapter in the specified chapter track that has the specified index, as UTF-8.
+//
+// The chapter table keeps each title as it is in the sample, and converting it needs the sample's description,
+// so we take only the chapter's start time from the table (through QTText_GetIndChapterTime); the converted
+// text is kept in the text cache under the sample number, so asking for it again doesn't read the sample.
+//
+// The caller is responsible for disposing of the pointer returned by this function (by calling free).
 //
 //////////
 
-Boolean QTText_IsHREFTrack (Track theTrack)
+char *QTText_GetIndChapterTextUTF8 (Track theChapterTrack, long theIndex)
 {
-	Boolean		isHREFTrack = false;
-	char 		*myTrackName = NULL;
-	
-	myTrackName = QTUtils_GetTrackName(theTrack);
-	if (myTrackName != NULL)
-		isHREFTrack = (strcmp(myTrackName, kHREFTrackName) == 0);
-	
-	free(myTrackName);
-	return(isHREFTrack);
+	Media			myMedia = NULL;
+	TimeValue		myTime;
+	long			mySampleNum = 0;
+	long			myLength = 0;
+	const char		*myUTF8 = NULL;
+	char			*myText = NULL;
+
+	if ((theChapterTrack == NULL) || (theIndex < 1))
+		return(myText);
+
+	myTime = QTText_GetIndChapterTime(theChapterTrack, theIndex);
+	if (myTime == kBogusStartingTime)
+		return(myText);
+
+	myMedia = GetTrackMedia(theChapterTrack);
+	MediaTimeToSampleNum(myMedia, QTText_TrackTimeToMediaTime(theChapterTrack, myTime), &mySampleNum, NULL, NULL);
+
+	myUTF8 = QTText_GetSampleTextUTF8(myMedia, mySampleNum, &myLength);
+	if (myUTF8 != NULL) {
+		myText = malloc(myLength + 1);
+		if (myText != NULL) {
+			BlockMove(myUTF8, myText, myLength);
+			myText[myLength] = '\0';
+		}
+	}
+
+	return(myText);
+}
+
+
+//////////
+//
+// QTText_FlushMovieText
+// Remove from the cache any converted text belonging to the tracks in the specified movie, and forget the
+// edit indexes of those tracks and the reference index of the movie.
+//
+// Call this before disposing of the movie; the other movies' entries are left alone.
+//
+//////////
+
+void QTText_FlushMovieText (Movie theMovie)
+{
+	Track			myTrack = NULL;
+	long			myIndex;
+
+	if (theMovie == NULL)
+		return;
+
+	// any track can have text converted (a subtitle or MPEG-4 text track, say), not just a text track
+	for (myIndex = 1; myIndex <= GetMovieTrackCount(theMovie); myIndex++) {
+		myTrack = GetMovieIndTrack(theMovie, myIndex);
+		if (myTrack == NULL)
+			continue;
+
+		QTTextEnc_CacheFlushOwner(gTextCache, GetTrackMedia(myTrack));
+		QTText_InvalidateEditIndex(myTrack);
+	}
+
+	QTText_InvalidateRefIndex(theMovie);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Subtitle import and export utilities.
+//
+// Use these functions to write the text in a text track to a subtitle file (SRT or WebVTT), or to create a
+// text track from a subtitle file (SRT, WebVTT or TTML).
+//
+// To export, we walk the track's samples in time order, get the text of each one as UTF-8 from the sample
+// cache, and hand it to a subtitle writer (see QTSubtitle.c), which formats the cues into a fixed-size buffer
+// and writes the buffer to the file whenever it fills. To import, a subtitle reader fills a fixed-size buffer
+// from the file and hands us one cue at a time, which we add to the text media. Either way, the memory used
+// is the same for a file with ten cues as for a file with a hundred thousand.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTText_ExportTextTrack
+// Write the text in the specified text track to the open file having the specified file reference number,
+// as a subtitle file of the specified format (kQTSub_FormatSRT or kQTSub_FormatWebVTT).
+//
+// Each text sample becomes one cue, which lasts as long as the sample. If the track is a chapter track, each
+// chapter lasts until the start of the next chapter (or the end of the movie, for the last chapter). We return
+// the number of cues written and the throughput (in samples per second) through theCueCount and theSamplesPerSec,
+// either of which can be NULL.
+//
+//////////
+
+OSErr QTText_ExportTextTrack (Track theTrack, long theFormat, short theRefNum, long *theCueCount, long *theSamplesPerSec)
+{
+	QTSubWriterPtr		myWriter = NULL;
+	Movie				myMovie = NULL;
+	Media				myMedia = NULL;
+	TimeScale			myTimeScale;
+	TimeValue			myTime;
+	TimeValue			myDuration;
+	TimeValue			myEndTime;
+	TimeValue			myNextTime;
+	long				mySampleNum;
+	long				mySampleCount = 0;
+	long				myLength;
+	const char			*myText = NULL;
+	Boolean				isChapterTrack = false;
+	unsigned long		myTicks;
+	OSErr				myErr = noErr;
+
+	if (theCueCount != NULL)
+		*theCueCount = 0;
+
+	if (theSamplesPerSec != NULL)
+		*theSamplesPerSec = 0;
+
+	if (theTrack == NULL)
+		return(invalidTrack);
+
+	myMovie = GetTrackMovie(theTrack);
+	myMedia = GetTrackMedia(theTrack);
+	if ((myMovie == NULL) || (myMedia == NULL))
+		return(invalidTrack);
+
+	// the writer holds the write buffer, so allocate it in the heap rather than on the stack
+	myWriter = (QTSubWriterPtr)NewPtrClear(sizeof(QTSubWriter));
+	if (myWriter == NULL)
+		return(memFullErr);
+
+	myErr = (OSErr)QTSub_BeginWriter(myWriter, theFormat, QTText_ExportWriteProc, (void *)(long)theRefNum);
+	if (myErr != noErr)
+		goto bail;
+
+	myTimeScale = GetMovieTimeScale(myMovie);
+	isChapterTrack = QTText_IsChapterTrack(theTrack);
+	myTicks = TickCount();
+
+	GetTrackNextInterestingTime(theTrack, nextTimeMediaSample + nextTimeEdgeOK, (TimeValue)0, fixed1, &myTime, &myDuration);
+	while (myTime >= 0) {
+		GetTrackNextInterestingTime(theTrack, nextTimeMediaSample, myTime, fixed1, &myNextTime, NULL);
+
+		if (isChapterTrack)
+			myEndTime = (myNextTime >= 0) ? myNextTime : GetMovieDuration(myMovie);
+		else
+			myEndTime = myTime + myDuration;
+
+		MediaTimeToSampleNum(myMedia, QTText_TrackTimeToMediaTime(theTrack, myTime), &mySampleNum, NULL, NULL);
+		myText = QTText_GetSampleTextUTF8(myMedia, mySampleNum, &myLength);
+		if (myText != NULL) {
+			myErr = (OSErr)QTSub_WriteCue(myWriter, QTText_TimeToMilliseconds(myTime, myTimeScale), QTText_TimeToMilliseconds(myEndTime, myTimeScale), myText, myLength);
+			if (myErr != noErr)
+				goto bail;
+		}
+
+		mySampleCount++;
+
+		// get the duration of the next sample
+		if (myNextTime >= 0)
+			GetTrackNextInterestingTime(theTrack, nextTimeMediaSample + nextTimeEdgeOK, myNextTime, fixed1, &myNextTime, &myDuration);
+
+		myTime = myNextTime;
+	}
+
+	myErr = (OSErr)QTSub_EndWriter(myWriter);
+
+	myTicks = TickCount() - myTicks;
+	if (theSamplesPerSec != NULL)
+		*theSamplesPerSec = (long)(((double)mySampleCount * 60.0) / (double)((myTicks > 0) ? myTicks : 1));
+
+	if (theCueCount != NULL)
+		*theCueCount = myWriter->fCueCount;
+
+bail:
+	DisposePtr((Ptr)myWriter);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_ExportWriteProc
+// Write the specified data to the file whose file reference number is passed in theRefCon.
+//
+//////////
+
+long QTText_ExportWriteProc (void *theRefCon, const char *theData, long theSize)
+{
+	long			mySize = theSize;
+	OSErr			myErr = noErr;
+
+	myErr = FSWrite((short)(long)theRefCon, &mySize, theData);
+	if ((myErr == noErr) && (mySize != theSize))
+		myErr = ioErr;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_ImportSubtitleFile
+// Create a new text track in the specified movie from the subtitle file having the specified file reference
+// number; return the new track through theTrack.
+//
+// The format of the file (SRT, WebVTT or TTML) is determined from its contents. Each cue becomes one text
+// sample; the gaps between cues are filled with empty samples, and cues that overlap the previous cue are
+// started when the previous cue ends. All the samples are added in a single media editing session (in large
+// chunks, if the USE_TEXTWRITER compiler flag is set), and the media is inserted into the track just once, at
+// the end. We return the number of cues and samples, the time taken (in ticks) and the peak amount of memory we
+// allocated through theStats, which can be NULL.
+//
+//////////
+
+OSErr QTText_ImportSubtitleFile (Movie theMovie, short theRefNum, Track *theTrack, QTTextImportStatsPtr theStats)
+{
+	QTSubReaderPtr				myReader = NULL;
+	QTSubCue					myCue;
+	Track						myTrack = NULL;
+	Media						myMedia = NULL;
+#if USE_TEXTWRITER
+	QTTextWriterPtr				myWriter = NULL;
+#endif
+	Ptr							mySample = NULL;
+	Rect						myBounds;
+	Rect						myTextBox = {0, 0, 0, 0};
+	MatrixRecord				myMatrix;
+	TimeValue					myMediaTime = 0;
+	long						myLength;
+	long						myResult;
+	long						mySampleCount = 0;
+	long						myPeakBytes = 0;
+	unsigned long				myTicks;
+	Boolean						isEditing = false;
+	OSErr						myErr = noErr;
+
+	if (theTrack != NULL)
+		*theTrack = NULL;
+
+	if (theStats != NULL) {
+		theStats->fCueCount = 0;
+		theStats->fSampleCount = 0;
+		theStats->fTicks = 0;
+		theStats->fPeakBytes = 0;
+	}
+
+	if ((theMovie == NULL) || (theTrack == NULL))
+		return(paramErr);
+
+	myTicks = TickCount();
+
+	//////////
+	//
+	// allocate the reader and a buffer big enough for the text of any cue
+	//
+	//////////
+
+	// the reader holds the read buffer, so allocate it in the heap rather than on the stack
+	myReader = (QTSubReaderPtr)NewPtrClear(sizeof(QTSubReader));
+	mySample = NewPtr((2 * kQTSub_MaxCueSize) + 2);
+	if ((myReader == NULL) || (mySample == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = (OSErr)QTSub_BeginReader(myReader, QTText_ImportReadProc, (void *)(long)theRefNum);
+	if (myErr != noErr)
+		goto bail;
+
+	//////////
+	//
+	// create the text track and media; the track runs along the bottom of the movie box
+	//
+	//////////
+
+	GetMovieBox(theMovie, &myBounds);
+	if (myBounds.right <= myBounds.left)
+		myBounds.right = myBounds.left + kSubtitleTrackWidth;
+
+	myTrack = NewMovieTrack(theMovie, FixRatio(myBounds.right - myBounds.left, 1), FixRatio(kTextTrackHeight, 1), kNoVolume);
+	if (myTrack == NULL) {
+		myErr = GetMoviesError();
+		goto bail;
+	}
+
+	// we use a time scale of 1000, so that the cue times (in milliseconds) are media times
+	myMedia = NewTrackMedia(myTrack, TextMediaType, kSubtitleTimeScale, NULL, 0);
+	if (myMedia == NULL) {
+		myErr = GetMoviesError();
+		goto bail;
+	}
+
+	GetTrackMatrix(myTrack, &myMatrix);
+	TranslateMatrix(&myMatrix, FixRatio(myBounds.left, 1), FixRatio(myBounds.bottom, 1));
+	SetTrackMatrix(myTrack, &myMatrix);
+	SetTrackEnabled(myTrack, true);
+
+	//////////
+	//
+	// add the cues to the media, a chunk at a time
+	//
+	//////////
+
+	myErr = BeginMediaEdits(myMedia);
+	if (myErr != noErr)
+		goto bail;
+
+	isEditing = true;
+
+	myTextBox.right = myBounds.right - myBounds.left;
+	myTextBox.bottom = kTextTrackHeight;
+#if USE_TEXTWRITER
+	myErr = QTText_NewTextWriter(myMedia, &myTextBox, kTextWriterChunkSize, &myWriter);
+	if (myErr != noErr)
+		goto bail;
+#endif
+
+	for (;;) {
+		myResult = QTSub_ReadCue(myReader, &myCue);
+		if (myResult <= 0) {
+			myErr = (OSErr)myResult;
+			break;
+		}
+
+		// skip cues that end before the previous cue does
+		if (myCue.fEndMS <= myMediaTime)
+			continue;
+
+		// fill any gap before this cue with an empty sample
+		if (myCue.fStartMS > myMediaTime) {
+#if USE_TEXTWRITER
+			myErr = QTText_WriteTextSample(myWriter, NULL, 0, myCue.fStartMS - myMediaTime);
+#else
+			myErr = QTText_AddSubtitleSample(myMedia, &myTextBox, NULL, 0, myCue.fStartMS - myMediaTime);
+#endif
+			if (myErr != noErr)
+				break;
+
+			mySampleCount++;
+			myMediaTime = myCue.fStartMS;
+		}
+
+		myLength = QTTextEnc_ConvertFromUTF8(myCue.fText, myCue.fLength, (unsigned char *)mySample, (2 * kQTSub_MaxCueSize) + 2);
+#if USE_TEXTWRITER
+		myErr = QTText_WriteTextSample(myWriter, mySample, myLength, myCue.fEndMS - myMediaTime);
+#else
+		myErr = QTText_AddSubtitleSample(myMedia, &myTextBox, mySample, myLength, myCue.fEndMS - myMediaTime);
+#endif
+		if (myErr != noErr)
+			break;
+
+		mySampleCount++;
+		myMediaTime = myCue.fEndMS;
+	}
+
+	// the reader and the sample buffer are allocated for the whole import
+	myPeakBytes = GetPtrSize((Ptr)myReader) + GetPtrSize(mySample);
+
+#if USE_TEXTWRITER
+	// the writer's buffers grow as it goes, so it keeps track of its own high-water mark; if anything went wrong,
+	// we throw away the samples it still holds rather than add them to a media we're about to dispose of
+	myPeakBytes += myWriter->fPeakBytes;
+
+	if (myErr == noErr)
+		myErr = QTText_DisposeTextWriter(myWriter, NULL);
+	else
+		QTText_DiscardTextWriter(myWriter);
+
+	myWriter = NULL;
+#endif
+
+	isEditing = false;
+	if (myErr == noErr)
+		myErr = EndMediaEdits(myMedia);
+	else
+		EndMediaEdits(myMedia);
+
+	if (myErr != noErr)
+		goto bail;
+
+	// insert all the new media into the track at once
+	myErr = InsertMediaIntoTrack(myTrack, 0, 0, GetMediaDuration(myMedia), fixed1);
+
+bail:
+#if USE_TEXTWRITER
+	if (myWriter != NULL)
+		QTText_DiscardTextWriter(myWriter);
+#endif
+
+	if (isEditing)
+		EndMediaEdits(myMedia);
+
+	if (theStats != NULL) {
+		theStats->fCueCount = (myReader != NULL) ? myReader->fCueCount : 0;
+		theStats->fSampleCount = mySampleCount;
+		theStats->fTicks = TickCount() - myTicks;
+		theStats->fPeakBytes = myPeakBytes;
+	}
+
+	if ((myErr != noErr) && (myTrack != NULL)) {
+		DisposeMovieTrack(myTrack);
+		myTrack = NULL;
+	}
+
+	*theTrack = myTrack;
+
+	if (myReader != NULL)
+		DisposePtr((Ptr)myReader);
+
+	if (mySample != NULL)
+		DisposePtr(mySample);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTText_AddSubtitleSample
+// Add a text sample having the specified text and duration to the specified media, which must be in a media
+// editing session; the text is drawn centered in the specified text box. The text can be NULL, for an empty
+// sample.
+//
+//////////
+
+OSErr QTText_AddSubtitleSample (Media theMedia, Rect *theTextBox, Ptr theText, long theLength, TimeValue theDuration)
+{
+	char			myEmptyText = 0;
+
+	if (theText == NULL) {
+		theText = &myEmptyText;
+		theLength = 0;
+	}
+
+	return(TextMediaAddTextSample(	GetMediaHandler(theMedia),
+									theText,
+									theLength,
+									0,
+									0,
+									0,
+									NULL,
+									NULL,
+									teCenter,
+									theTextBox,
+									dfClipToTextBox,
+									0,
+									0,
+									0,
+									NULL,
+									theDuration,
+									NULL));
+}
+
+
+//////////
+//
+// QTText_LogSubtitleStats
+// Write the specified statistics to the debugger (on Windows) or the console (on Macintosh).
+//
+// The menu commands that import and export subtitles do this in a debug build (that is, when the
+// LOG_SUBTITLE_STATS compiler flag is set), so that we can see how fast they are without a tool of our own.
+//
+//////////
+
+void QTText_LogSubtitleStats (char *theStats)
+{
+#if LOG_SUBTITLE_STATS
+#if TARGET_OS_WIN32
+	OutputDebugString(theStats);
+#else
+	fputs(theStats, stderr);
+#endif
+#else
+#pragma unused(theStats)
+#endif
+}
+
+
+//////////
+//
+// QTText_ImportReadProc
+// Read data from the file whose file reference number is passed in theRefCon.
+//
+//////////
+
+long QTText_ImportReadProc (void *theRefCon, char *theData, long theSize)
+{
+	long			mySize = theSize;
+	OSErr			myErr = noErr;
+
+	myErr = FSRead((short)(long)theRefCon, &mySize, theData);
+	if ((myErr != noErr) && (myErr != eofErr))
+		return(myErr);
+
+	return(mySize);
+}
+
+
+//////////
+//
+// QTText_TimeToMilliseconds
+// Convert the specified time (in the specified time scale) into milliseconds.
+//
+//////////
+
+long QTText_TimeToMilliseconds (TimeValue theTime, TimeScale theTimeScale)
+{
+	if ((theTime <= 0) || (theTimeScale <= 0))
+		return(0L);
+
+	// use floating-point so that we don't overflow a long with large times
+	return((long)(((double)theTime * 1000.0) / (double)theTimeScale + 0.5));
 }
 
 
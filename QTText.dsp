@@ -99,6 +99,18 @@ SOURCE=".\Common Files\ComFramework.c"
 # End Source File
 # Begin Source File
 
+SOURCE=".\Common Files\QTFile.c"
+# End Source File
+# Begin Source File
+
+SOURCE=".\Common Files\QTFileWrite.c"
+# End Source File
+# Begin Source File
+
+SOURCE=.\QTSubtitle.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\QTText.c
 # End Source File
 # Begin Source File
@@ -144,6 +156,14 @@ SOURCE=".\Application Files\QTText.rc"
 # End Source File
 # Begin Source File
 
+SOURCE=.\QTTextEncoding.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\QTTextFile.c
+# End Source File
+# Begin Source File
+
 SOURCE=".\Common Files\QTUtilities.c"
 # End Source File
 # Begin Source File
@@ -160,10 +180,30 @@ SOURCE=".\Application Files\ComApplication.h"
 # End Source File
 # Begin Source File
 
+SOURCE=".\Common Files\QTFile.h"
+# End Source File
+# Begin Source File
+
+SOURCE=".\Common Files\QTFileWrite.h"
+# End Source File
+# Begin Source File
+
+SOURCE=.\QTSubtitle.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\QTText.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\QTTextEncoding.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\QTTextFile.h
+# End Source File
+# Begin Source File
+
 SOURCE=".\Common Files\QTUtilities.h"
 # End Source File
 # Begin Source File
@@ -25,6 +25,10 @@
 #include <FixMath.h>
 #endif
 
+#ifndef __FONTS__
+#include <Fonts.h>
+#endif
+
 #ifndef __MOVIES__
 #include <Movies.h>
 #endif
@@ -38,6 +42,8 @@
 #endif
 
 #include "ComApplication.h"
+#include "QTSubtitle.h"
+#include "QTTextEncoding.h"
 
 #if TARGET_OS_MAC
 #include "MacFramework.h"
@@ -55,7 +61,16 @@
 //////////
 
 #define USE_MOVIESEARCHTEXT		1		// do we use MovieSearchText or TextMediaFindNextText to find text?
+#define USE_UTF8SEARCH			1		// do we search the UTF-8 text of the samples (overrides USE_MOVIESEARCHTEXT)?
 #define USE_ADDMEDIASAMPLE		0		// do we use AddMediaSample or TextMediaAddTextSample to add a text track?
+#define USE_TEXTWRITER			0		// do we add text samples in large chunks (overrides USE_ADDMEDIASAMPLE)?
+
+// do we log the statistics of subtitle imports and exports? (yes, in a debug build)
+#if defined(_DEBUG) || (defined(DEBUG) && DEBUG)
+#define LOG_SUBTITLE_STATS		1
+#else
+#define LOG_SUBTITLE_STATS		0
+#endif
 
 
 //////////
@@ -69,12 +84,144 @@
 
 #define kSearchText				"QuickTime"
 #define kSampleText				""
+#define kReplaceText			""
+#define kReplacePrompt			"Replace the search text with:"
+#define kExportPrompt			"Export subtitles as:"
+#define kExportFileName			"untitled.srt"
+#define kExportFileType			FOUR_CHAR_CODE('TEXT')
 
 #define kBogusStartingTime		-1			// an invalid starting time
 
 #define kHREFTrackName			"HREFTrack"
 #define kNonHREFTrackName		"Text Track"
 
+#define kTextWriterChunkSize	(64L * 1024L)	// default size of the chunks written by a text media writer
+#define kTextWriterMinRefs		64			// initial number of sample reference records in a text media writer
+#define kTextWriterDataRefIndex	1			// the data reference that a text media writer writes to
+#define kTextWriterDataAtomType	FOUR_CHAR_CODE('mdat')	// the atom that holds each chunk written by a text media writer
+#define kTextWriterFontID		systemFont	// the default font of the text added by a text media writer
+#define kTextWriterFontSize		12			// the default size of that text (what TextMediaAddTextSample uses for a size of 0)
+
+#define kSubtitleTimeScale		1000		// time scale of a text track imported from a subtitle file
+#define kSubtitleTrackWidth		320			// width of an imported text track, if the movie has no width
+
+#define kEditIndexCacheSize		4			// number of tracks whose edit lists we keep decoded
+#define kEditIndexMinSegments	4			// initial number of segments in an edit index
+#define kChapterTableTextPerChapter	32		// initial number of bytes of title text per chapter in a chapter table
+#define kTransactionMinEdits	16			// initial number of sample replacements in a text edit transaction
+#define kTransactionTextPerEdit	64			// initial number of bytes of text per replacement in a text edit transaction
+#define kReplaceNoMatch			-1			// QTText_ReplaceInBuffer: the search text doesn't occur in the text
+#define kReplaceTooLong			-2			// QTText_ReplaceInBuffer: the new text doesn't fit in the buffer
+#define kSearchNoMatch			-1			// QTText_SearchBuffer: the search text doesn't occur in the text
+#define kRefIndexCacheSize		4			// number of movies whose track references we keep indexed
+#define kRefIndexMinRefs		8			// initial number of track references in a reference index
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a text media writer, which adds text samples to a media in large chunks
+typedef struct QTTextWriter {
+	Media						fMedia;				// the media we're adding samples to
+	TextDescriptionHandle		fDesc;				// the sample description shared by all the samples
+	Handle						fChunk;				// the data of the samples not yet added to the media
+	long						fChunkSize;			// we add the samples once they amount to this many bytes
+	long						fChunkBytes;		// the number of bytes in fChunk
+	Handle						fRefs;				// the sample reference records for the data in fChunk
+	long						fRefCount;			// the number of records in fRefs
+	long						fSampleCount;		// the number of samples written so far
+	long						fChunkCount;		// the number of chunks written so far
+	TimeValue					fFirstTime;			// the media time of the first sample added
+	long						fBytes;				// the number of bytes the writer has allocated
+	long						fPeakBytes;			// the largest number of bytes the writer has had allocated at once
+} QTTextWriter, *QTTextWriterPtr;
+
+// one sample replacement queued in a text edit transaction
+typedef struct QTTextSampleEdit {
+	TimeValue					fStart;				// the track time at which the replaced sample starts
+	TimeValue					fDuration;			// the duration of the sample, in track time
+	TimeValue					fMediaDuration;		// the duration of the sample, in media time
+	TimeValue					fMediaStart;		// the media time of the new sample, once it has been added
+	TimeValue					fOldMediaStart;		// the media time of the replaced sample (to undo the replacement)
+	long						fTextOffset;		// the offset of the new text in the transaction's text
+	long						fTextLength;		// the length of the new text
+} QTTextSampleEdit, *QTTextSampleEditPtr;
+
+// a set of sample replacements in the text track of a window, applied all at once (see QTText_CommitTransaction)
+typedef struct QTTextTransaction {
+	WindowObject				fWindowObject;		// the window whose text track is edited
+	Track						fTrack;				// the text track
+	long						fCount;				// the number of queued replacements
+	Handle						fEdits;				// the replacements, in time order (QTTextSampleEdit[])
+	Handle						fText;				// the new text of the samples (char[])
+	long						fTextSize;			// the number of bytes of fText in use
+} QTTextTransaction, *QTTextTransactionPtr;
+
+// one edit of a track: a stretch of track time and the stretch of media it plays
+typedef struct QTTextEditSegment {
+	TimeValue					fStart;				// the track time at which the edit starts
+	TimeValue					fDuration;			// the duration of the edit, in track time
+	TimeValue					fMediaStart;		// the media time played at fStart, or -1 for an empty edit
+	TimeValue					fMediaDuration;		// the duration of the edit, in media time
+	Fixed						fRate;				// the rate at which the media is played
+} QTTextEditSegment, *QTTextEditSegmentPtr;
+
+// the edit list of a track, decoded once into a table sorted by track time (see QTText_TrackTimeToMediaTime);
+// the track duration and modification time tell us whether the track has been edited since it was decoded
+typedef struct QTTextEditIndex {
+	Track						fTrack;				// the indexed track
+	TimeValue					fTrackDuration;		// the duration of the track when it was indexed
+	unsigned long				fModificationTime;	// the modification time of the track when it was indexed
+	TimeScale					fMovieTimeScale;	// the time scale of the track's movie
+	TimeScale					fMediaTimeScale;	// the time scale of the track's media
+	long						fCount;				// the number of edits
+	long						fMediaCount;		// the number of edits that aren't empty
+	Handle						fSegments;			// the edits, in track order (QTTextEditSegment[])
+	Handle						fMediaOrder;		// the indices of the non-empty edits, in media order (long[])
+} QTTextEditIndex, *QTTextEditIndexPtr;
+
+// a track reference, seen from the track it refers to
+typedef struct QTTextTrackRef {
+	long						fRefTrackID;		// the ID of the referenced track
+	Track						fRefTrack;			// the referenced track
+	Track						fTrack;				// the track that holds the reference
+	long						fTrackIndex;		// the index of that track in the movie
+	OSType						fType;				// the type of the reference
+	long						fIndex;				// the index of the reference among that track's references of that type
+} QTTextTrackRef, *QTTextTrackRefPtr;
+
+// a chapter track, with the track that refers to it and its language (see QTText_GetIndChapterTrack)
+typedef struct QTTextChapterTrackRef {
+	Track						fOwnerTrack;		// the track that refers to the chapter track
+	long						fOwnerIndex;		// the index of that track in the movie
+	long						fRefIndex;			// the index of the reference among that track's chapter references
+	Track						fChapterTrack;		// the chapter track
+	short						fLanguage;			// the language of the chapter track's media
+} QTTextChapterTrackRef, *QTTextChapterTrackRefPtr;
+
+// all the track references in a movie, sorted by the ID of the referenced track (see QTText_FindTrackRefs);
+// the track count and modification time of the movie tell us whether it has been edited behind our back
+typedef struct QTTextRefIndex {
+	Movie						fMovie;				// the indexed movie
+	long						fTrackCount;		// the number of tracks in the movie when it was indexed
+	unsigned long				fModificationTime;	// the modification time of the movie when it was indexed
+	long						fCount;				// the number of track references
+	Handle						fRefs;				// the track references (QTTextTrackRef[])
+	long						fChapterCount;		// the number of chapter references
+	Handle						fChapters;			// the chapter references, in movie order (QTTextChapterTrackRef[]), or NULL
+} QTTextRefIndex, *QTTextRefIndexPtr;
+
+// statistics returned by QTText_ImportSubtitleFile
+typedef struct QTTextImportStats {
+	long						fCueCount;			// the number of cues read from the file
+	long						fSampleCount;		// the number of text samples added (including empty ones)
+	unsigned long				fTicks;				// the time taken by the import
+	long						fPeakBytes;			// the peak amount of memory allocated by the import
+} QTTextImportStats, *QTTextImportStatsPtr;
+
 
 //////////
 //
@@ -85,13 +232,69 @@
 ApplicationDataHdl			QTText_InitWindowData (WindowObject theWindowObject);
 void						QTText_DumpWindowData (WindowObject theWindowObject);
 void						QTText_SyncWindowData (WindowObject theWindowObject);
+void						QTText_NoteMovieChanged (WindowObject theWindowObject);
+void						QTText_FlushMovieChanged (WindowObject theWindowObject);
 void						QTText_SetSearchText (void);
 void						QTText_FindText (WindowObject theWindowObject, Str255 theText);
 void						QTText_EditText (WindowObject theWindowObject);
+void						QTText_ReplaceText (WindowObject theWindowObject);
+void						QTText_ExportSubtitles (WindowObject theWindowObject);
+Track						QTText_ImportSubtitles (WindowObject theWindowObject);
 PASCAL_RTN OSErr			QTText_TextProc (Handle theText, Movie theMovie, short *theDisplayFlag, long theRefCon);
 Track						QTText_AddTextTrack (Movie theMovie, char *theStrings[], short theFrames[], short theNumFrames, OSType theType, Boolean isChapterTrack);
 OSErr						QTText_RemoveIndTextTrack (WindowObject theWindowObject, short theIndex);
 
+TextDescriptionHandle		QTText_NewTextDescription (const Rect *theBounds);
+OSErr						QTText_NewTextWriter (Media theMedia, const Rect *theBounds, long theChunkSize, QTTextWriterPtr *theWriter);
+OSErr						QTText_WriteTextSample (QTTextWriterPtr theWriter, const char *theText, long theLength, TimeValue theDuration);
+OSErr						QTText_FlushTextWriter (QTTextWriterPtr theWriter);
+OSErr						QTText_DisposeTextWriter (QTTextWriterPtr theWriter, TimeValue *theFirstTime);
+void						QTText_DiscardTextWriter (QTTextWriterPtr theWriter);
+OSErr						QTText_ResizeTextWriterHandle (QTTextWriterPtr theWriter, Handle theHandle, long theSize);
+OSErr						QTText_BeginTransaction (WindowObject theWindowObject, QTTextTransactionPtr *theTransaction);
+OSErr						QTText_QueueSampleText (QTTextTransactionPtr theTransaction, TimeValue theTime, const char *theText, long theLength);
+OSErr						QTText_CommitTransaction (QTTextTransactionPtr theTransaction);
+void						QTText_CancelTransaction (QTTextTransactionPtr theTransaction);
+OSErr						QTText_FindSampleTextUTF8 (ApplicationDataHdl theAppData, const char *theFind, long theFindLength, TimeValue theTime, long theOffset, TimeValue *theFoundTime, long *theFoundOffset);
+long						QTText_SearchBuffer (const char *theText, long theLength, const char *theFind, long theFindLength, long theFirst, long theLast, Boolean isBackward, Boolean isCaseSensitive);
+OSErr						QTText_ReplaceAllText (WindowObject theWindowObject, Str255 theFind, Str255 theReplace, long *theCount);
+long						QTText_ReplaceInBuffer (const char *theText, long theLength, Str255 theFind, Str255 theReplace, Boolean isCaseSensitive, char *theBuffer, long theBufferSize);
+
+OSErr						QTText_BuildSampleIndex (ApplicationDataHdl theAppData);
+void						QTText_DisposeSampleIndex (ApplicationDataHdl theAppData);
+Boolean						QTText_IsSampleIndexValid (ApplicationDataHdl theAppData);
+void						QTText_RevalidateSampleIndex (ApplicationDataHdl theAppData);
+OSErr						QTText_GetSampleBounds (ApplicationDataHdl theAppData, TimeValue theTime, TimeValue *theStart, TimeValue *theDuration, TimeValue *theMediaDuration);
+
+QTTextEditIndexPtr			QTText_GetEditIndex (Track theTrack);
+OSErr						QTText_BuildEditIndex (Track theTrack, QTTextEditIndexPtr theIndex);
+void						QTText_DisposeEditIndex (QTTextEditIndexPtr theIndex);
+Boolean						QTText_IsEditIndexValid (QTTextEditIndexPtr theIndex, Track theTrack);
+void						QTText_InvalidateEditIndex (Track theTrack);
+void						QTText_FlushEditIndexes (void);
+TimeValue					QTText_TrackTimeToMediaTime (Track theTrack, TimeValue theTime);
+TimeValue					QTText_MediaTimeToTrackTime (Track theTrack, TimeValue theTime);
+TimeValue					QTText_TrackToMediaDuration (QTTextEditIndexPtr theIndex, const QTTextEditSegment *theSegment, TimeValue theDuration);
+TimeValue					QTText_MediaToTrackDuration (QTTextEditIndexPtr theIndex, const QTTextEditSegment *theSegment, TimeValue theDuration);
+
+QTTextRefIndexPtr			QTText_GetRefIndex (Movie theMovie);
+OSErr						QTText_BuildRefIndex (Movie theMovie, QTTextRefIndexPtr theIndex);
+void						QTText_DisposeRefIndex (QTTextRefIndexPtr theIndex);
+Boolean						QTText_IsRefIndexValid (QTTextRefIndexPtr theIndex, Movie theMovie);
+void						QTText_InvalidateRefIndex (Movie theMovie);
+void						QTText_FlushRefIndexes (void);
+long						QTText_FindTrackRefs (QTTextRefIndexPtr theIndex, Track theRefTrack, long *theCount);
+OSErr						QTText_InsertTrackRef (QTTextRefIndexPtr theIndex, const QTTextTrackRef *theRef);
+void						QTText_RemoveTrackRef (QTTextRefIndexPtr theIndex, Track theTrack, OSType theType, long theRefIndex);
+OSErr						QTText_AddTrackReference (Track theTrack, Track theRefTrack, OSType theType, long *theIndex);
+OSErr						QTText_DeleteTrackReference (Track theTrack, OSType theType, long theIndex);
+OSErr						QTText_DeleteAllReferencesToTrack (Track theTrack);
+QTTextRefIndexPtr			QTText_GetChapterTrackIndex (Movie theMovie);
+OSErr						QTText_BuildChapterTrackList (QTTextRefIndexPtr theIndex);
+long						QTText_GetChapterTrackCount (Movie theMovie);
+OSErr						QTText_GetIndChapterTrack (Movie theMovie, long theIndex, Track *theOwnerTrack, Track *theChapterTrack, short *theLanguage);
+Track						QTText_GetChapterTrackForLanguage (Movie theMovie, short theLanguage);
+
 OSErr						QTText_SetTextTrackAsChapterTrack (WindowObject theWindowObject, OSType theType, Boolean isChapterTrack);
 Boolean						QTText_TrackTypeHasAChapterTrack (Movie theMovie, OSType theType);
 Boolean						QTText_TrackHasAChapterTrack (Track theTrack);
@@ -101,11 +304,45 @@ Track						QTText_GetChapterTrackForMovie (Movie theMovie);
 Boolean						QTText_IsChapterTrack (Track theTrack);
 OSErr						QTText_GetFirstChapterTime (Track theChapterTrack, TimeValue *theTime);
 OSErr						QTText_GetNextChapterTime (Track theChapterTrack, TimeValue *theTime);
+ApplicationDataHdl			QTText_GetMovieAppData (Movie theMovie);
 TimeValue					QTText_GetIndChapterTime (Track theChapterTrack, long theIndex);
+long						QTText_GetIndChapterSample (Track theChapterTrack, long theIndex);
 char *						QTText_GetIndChapterText (Track theChapterTrack, long theIndex);
+long						QTText_CopyIndChapterText (Track theChapterTrack, long theIndex, char *theBuffer, long theBufferSize);
 long						QTText_GetChapterCount (Track theChapterTrack);
 
+OSErr						QTText_BuildChapterTable (ApplicationDataHdl theAppData, Track theChapterTrack);
+OSErr						QTText_NewChapterTable (QTTextChapterTablePtr theTable, Track theChapterTrack, long theCapacity);
+OSErr						QTText_AddTableChapter (QTTextChapterTablePtr theTable, TimeValue theStart, const char *theText, long theLength);
+OSErr						QTText_ReserveTableText (QTTextChapterTablePtr theTable, long theSize);
+void						QTText_InstallChapterTable (ApplicationDataHdl theAppData, QTTextChapterTablePtr theTable);
+void						QTText_DisposeChapterTable (ApplicationDataHdl theAppData);
+Boolean						QTText_IsChapterTableValid (ApplicationDataHdl theAppData, Track theChapterTrack);
+void						QTText_RevalidateChapterTable (ApplicationDataHdl theAppData);
+OSErr						QTText_SetTableChapterText (ApplicationDataHdl theAppData, Track theChapterTrack, TimeValue theTime, const char *theText, long theLength);
+OSErr						QTText_UpdateChapterTable (ApplicationDataHdl theAppData, Track theChapterTrack);
+long						QTText_GetTableChapterCount (ApplicationDataHdl theAppData, Track theChapterTrack);
+TimeValue					QTText_GetTableChapterTime (ApplicationDataHdl theAppData, Track theChapterTrack, long theIndex, TimeValue *theDuration);
+const char *				QTText_GetTableChapterTextPtr (ApplicationDataHdl theAppData, Track theChapterTrack, long theIndex, long *theLength);
+char *						QTText_GetTableChapterText (ApplicationDataHdl theAppData, Track theChapterTrack, long theIndex);
+long						QTText_CopyTableChapterText (ApplicationDataHdl theAppData, Track theChapterTrack, long theIndex, char *theBuffer, long theBufferSize);
+long						QTText_GetTableChapterIndex (ApplicationDataHdl theAppData, Track theChapterTrack, TimeValue theTime);
+long						QTText_FindTableChapter (ApplicationDataHdl theAppData, TimeValue theTime);
+OSErr						QTText_GoToRelativeChapter (WindowObject theWindowObject, long theDelta);
+
 OSErr						QTText_SetTextTrackAsHREFTrack (Track theTrack, Boolean isHREFTrack);
 Boolean						QTText_IsHREFTrack (Track theTrack);
 
+const char *				QTText_GetSampleTextUTF8 (Media theMedia, long theSampleNum, long *theLength);
+char *						QTText_GetIndChapterTextUTF8 (Track theChapterTrack, long theIndex);
+void						QTText_FlushMovieText (Movie theMovie);
+
+OSErr						QTText_ExportTextTrack (Track theTrack, long theFormat, short theRefNum, long *theCueCount, long *theSamplesPerSec);
+long						QTText_ExportWriteProc (void *theRefCon, const char *theData, long theSize);
+OSErr						QTText_ImportSubtitleFile (Movie theMovie, short theRefNum, Track *theTrack, QTTextImportStatsPtr theStats);
+OSErr						QTText_AddSubtitleSample (Media theMedia, Rect *theTextBox, Ptr theText, long theLength, TimeValue theDuration);
+void						QTText_LogSubtitleStats (char *theStats);
+long						QTText_ImportReadProc (void *theRefCon, char *theData, long theSize);
+long						QTText_TimeToMilliseconds (TimeValue theTime, TimeScale theTimeScale);
+
 void						QTText_CopyCStringToPascal (const char *theSrc, Str255 theDst);
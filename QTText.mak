@@ -51,8 +51,13 @@ ALL : "$(OutDir)\resource.frk\$(TargetName)" "$(OUTDIR)\QTText.exe"
 CLEAN :
 	-@erase "$(INTDIR)\ComApplication.obj"
 	-@erase "$(INTDIR)\ComFramework.obj"
+	-@erase "$(INTDIR)\QTFile.obj"
+	-@erase "$(INTDIR)\QTFileWrite.obj"
+	-@erase "$(INTDIR)\QTSubtitle.obj"
 	-@erase "$(INTDIR)\QTText.obj"
 	-@erase "$(INTDIR)\QTText.res"
+	-@erase "$(INTDIR)\QTTextEncoding.obj"
+	-@erase "$(INTDIR)\QTTextFile.obj"
 	-@erase "$(INTDIR)\QTUtilities.obj"
 	-@erase "$(INTDIR)\vc50.idb"
 	-@erase "$(INTDIR)\WinFramework.obj"
@@ -84,8 +89,13 @@ LINK32_FLAGS=..\..\QTDevWin\Libraries\qtmlclient.lib kernel32.lib user32.lib\
 LINK32_OBJS= \
 	"$(INTDIR)\ComApplication.obj" \
 	"$(INTDIR)\ComFramework.obj" \
+	"$(INTDIR)\QTFile.obj" \
+	"$(INTDIR)\QTFileWrite.obj" \
+	"$(INTDIR)\QTSubtitle.obj" \
 	"$(INTDIR)\QTText.obj" \
 	"$(INTDIR)\QTText.res" \
+	"$(INTDIR)\QTTextEncoding.obj" \
+	"$(INTDIR)\QTTextFile.obj" \
 	"$(INTDIR)\QTUtilities.obj" \
 	"$(INTDIR)\WinFramework.obj"
 
@@ -116,8 +126,13 @@ ALL : "$(OutDir)\resource.frk\$(TargetName)" "$(OUTDIR)\QTText.exe"
 CLEAN :
 	-@erase "$(INTDIR)\ComApplication.obj"
 	-@erase "$(INTDIR)\ComFramework.obj"
+	-@erase "$(INTDIR)\QTFile.obj"
+	-@erase "$(INTDIR)\QTFileWrite.obj"
+	-@erase "$(INTDIR)\QTSubtitle.obj"
 	-@erase "$(INTDIR)\QTText.obj"
 	-@erase "$(INTDIR)\QTText.res"
+	-@erase "$(INTDIR)\QTTextEncoding.obj"
+	-@erase "$(INTDIR)\QTTextFile.obj"
 	-@erase "$(INTDIR)\QTUtilities.obj"
 	-@erase "$(INTDIR)\vc50.idb"
 	-@erase "$(INTDIR)\vc50.pdb"
@@ -151,8 +166,13 @@ LINK32_FLAGS=..\..\QTDevWin\Libraries\qtmlclient.lib kernel32.lib user32.lib\
 LINK32_OBJS= \
 	"$(INTDIR)\ComApplication.obj" \
 	"$(INTDIR)\ComFramework.obj" \
+	"$(INTDIR)\QTFile.obj" \
+	"$(INTDIR)\QTFileWrite.obj" \
+	"$(INTDIR)\QTSubtitle.obj" \
 	"$(INTDIR)\QTText.obj" \
 	"$(INTDIR)\QTText.res" \
+	"$(INTDIR)\QTTextEncoding.obj" \
+	"$(INTDIR)\QTTextFile.obj" \
 	"$(INTDIR)\QTUtilities.obj" \
 	"$(INTDIR)\WinFramework.obj"
 
@@ -273,6 +293,10 @@ DEP_CPP_COMAP=\
 	".\Common Files\WinFramework.h"\
 	".\common files\winprefix.h"\
 	".\QTText.h"\
+	".\QTTextEncoding.h"\
+	".\QTSubtitle.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\ComApplication.obj" : $(SOURCE) $(DEP_CPP_COMAP) "$(INTDIR)"
@@ -355,6 +379,10 @@ DEP_CPP_COMAP=\
 	".\Common Files\WinFramework.h"\
 	".\common files\winprefix.h"\
 	".\QTText.h"\
+	".\QTTextEncoding.h"\
+	".\QTSubtitle.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\ComApplication.obj" : $(SOURCE) $(DEP_CPP_COMAP) "$(INTDIR)"
@@ -437,6 +465,8 @@ DEP_CPP_COMFR=\
 	".\common files\comframework.h"\
 	".\Common Files\QTUtilities.h"\
 	".\common files\winprefix.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\ComFramework.obj" : $(SOURCE) $(DEP_CPP_COMFR) "$(INTDIR)"
@@ -515,12 +545,88 @@ DEP_CPP_COMFR=\
 	".\common files\comframework.h"\
 	".\Common Files\QTUtilities.h"\
 	".\common files\winprefix.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\ComFramework.obj" : $(SOURCE) $(DEP_CPP_COMFR) "$(INTDIR)"
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+!ENDIF 
+
+SOURCE=".\Common Files\QTFile.c"
+
+!IF  "$(CFG)" == "QTText - Win32 Release"
+
+DEP_CPP_QTFIL=\
+	".\Common Files\QTFile.h"\
+	
+
+"$(INTDIR)\QTFile.obj" : $(SOURCE) $(DEP_CPP_QTFIL) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+!ELSEIF  "$(CFG)" == "QTText - Win32 Debug"
+
+DEP_CPP_QTFIL=\
+	".\Common Files\QTFile.h"\
+	
+
+"$(INTDIR)\QTFile.obj" : $(SOURCE) $(DEP_CPP_QTFIL) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+!ENDIF 
+
+SOURCE=".\Common Files\QTFileWrite.c"
+
+!IF  "$(CFG)" == "QTText - Win32 Release"
+
+DEP_CPP_QTFILE=\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
+	
+
+"$(INTDIR)\QTFileWrite.obj" : $(SOURCE) $(DEP_CPP_QTFILE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+!ELSEIF  "$(CFG)" == "QTText - Win32 Debug"
+
+DEP_CPP_QTFILE=\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
+	
+
+"$(INTDIR)\QTFileWrite.obj" : $(SOURCE) $(DEP_CPP_QTFILE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+!ENDIF 
+
+SOURCE=.\QTSubtitle.c
+
+!IF  "$(CFG)" == "QTText - Win32 Release"
+
+DEP_CPP_QTSUB=\
+	".\QTSubtitle.h"\
+	
+
+"$(INTDIR)\QTSubtitle.obj" : $(SOURCE) $(DEP_CPP_QTSUB) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+!ELSEIF  "$(CFG)" == "QTText - Win32 Debug"
+
+DEP_CPP_QTSUB=\
+	".\QTSubtitle.h"\
+	
+
+"$(INTDIR)\QTSubtitle.obj" : $(SOURCE) $(DEP_CPP_QTSUB) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 !ENDIF 
 
 SOURCE=.\QTText.c
@@ -601,6 +707,10 @@ DEP_CPP_QTTEX=\
 	".\Common Files\WinFramework.h"\
 	".\common files\winprefix.h"\
 	".\QTText.h"\
+	".\QTTextEncoding.h"\
+	".\QTSubtitle.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\QTText.obj" : $(SOURCE) $(DEP_CPP_QTTEX) "$(INTDIR)"
@@ -682,6 +792,10 @@ DEP_CPP_QTTEX=\
 	".\Common Files\WinFramework.h"\
 	".\common files\winprefix.h"\
 	".\QTText.h"\
+	".\QTTextEncoding.h"\
+	".\QTSubtitle.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\QTText.obj" : $(SOURCE) $(DEP_CPP_QTTEX) "$(INTDIR)"
@@ -738,6 +852,58 @@ DEP_RSC_QTTEXT=\
  ".\Application Files" /d "_DEBUG" $(SOURCE)
 
 
+!ENDIF 
+
+SOURCE=.\QTTextEncoding.c
+
+!IF  "$(CFG)" == "QTText - Win32 Release"
+
+DEP_CPP_QTTEXE=\
+	".\QTTextEncoding.h"\
+	
+
+"$(INTDIR)\QTTextEncoding.obj" : $(SOURCE) $(DEP_CPP_QTTEXE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+!ELSEIF  "$(CFG)" == "QTText - Win32 Debug"
+
+DEP_CPP_QTTEXE=\
+	".\QTTextEncoding.h"\
+	
+
+"$(INTDIR)\QTTextEncoding.obj" : $(SOURCE) $(DEP_CPP_QTTEXE) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+!ENDIF 
+
+SOURCE=.\QTTextFile.c
+
+!IF  "$(CFG)" == "QTText - Win32 Release"
+
+DEP_CPP_QTTEXTF=\
+	".\Common Files\QTFile.h"\
+	".\QTTextEncoding.h"\
+	".\QTTextFile.h"\
+	
+
+"$(INTDIR)\QTTextFile.obj" : $(SOURCE) $(DEP_CPP_QTTEXTF) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+!ELSEIF  "$(CFG)" == "QTText - Win32 Debug"
+
+DEP_CPP_QTTEXTF=\
+	".\Common Files\QTFile.h"\
+	".\QTTextEncoding.h"\
+	".\QTTextFile.h"\
+	
+
+"$(INTDIR)\QTTextFile.obj" : $(SOURCE) $(DEP_CPP_QTTEXTF) "$(INTDIR)"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 !ENDIF 
 
 SOURCE=".\Common Files\QTUtilities.c"
@@ -801,6 +967,8 @@ DEP_CPP_QTUTI=\
 	"..\..\qtdevwin\cincludes\utcutils.h"\
 	"..\..\qtdevwin\cincludes\video.h"\
 	".\Common Files\QTUtilities.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\QTUtilities.obj" : $(SOURCE) $(DEP_CPP_QTUTI) "$(INTDIR)"
@@ -866,6 +1034,8 @@ DEP_CPP_QTUTI=\
 	"..\..\qtdevwin\cincludes\utcutils.h"\
 	"..\..\qtdevwin\cincludes\video.h"\
 	".\Common Files\QTUtilities.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\QTUtilities.obj" : $(SOURCE) $(DEP_CPP_QTUTI) "$(INTDIR)"
@@ -950,6 +1120,8 @@ DEP_CPP_WINFR=\
 	".\Common Files\QTUtilities.h"\
 	".\Common Files\WinFramework.h"\
 	".\common files\winprefix.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\WinFramework.obj" : $(SOURCE) $(DEP_CPP_WINFR) "$(INTDIR)"
@@ -1030,6 +1202,8 @@ DEP_CPP_WINFR=\
 	".\Common Files\QTUtilities.h"\
 	".\Common Files\WinFramework.h"\
 	".\common files\winprefix.h"\
+	".\Common Files\QTFile.h"\
+	".\Common Files\QTFileWrite.h"\
 	
 
 "$(INTDIR)\WinFramework.obj" : $(SOURCE) $(DEP_CPP_WINFR) "$(INTDIR)"
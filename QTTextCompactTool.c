@@ -0,0 +1,169 @@
+//////////
+//
+//	File:		QTTextCompactTool.c
+//
+//	Contains:	A command-line tool that compacts the text media of movie files.
+//
+//	Written by:	QuickTime Team
+//
+//	Usage:		qttextcompact [-j jobs] [-p padding] movie-file ...
+//
+//	Each movie file is rewritten so that its text media hold only the samples their tracks play; the old text of
+//	edited samples is dropped. Up to the specified number of files are compacted at once, each on a thread of its
+//	own; see QTFileWrite.c. The padding is the most free space left after each new movie atom; a file that
+//	wouldn't get any smaller is left as it is.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTFileWrite.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kDefaultJobCount				4				// the number of files compacted at once, if the user doesn't say
+#define kMaxJobCount					64				// the most files compacted at once
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static long					QTCompactTool_FinishFile (const char *theToolName, const char *thePath, long thePadding, QTFileCompactJobPtr theJob, QTFileInt64 *theTotal);
+static void					QTCompactTool_ShowUsage (const char *theToolName);
+
+
+//////////
+//
+// main
+// Parse the command line and compact the movie files.
+//
+//////////
+
+int main (int argc, char *argv[])
+{
+	QTFileCompactJobPtr	myJobs[kMaxJobCount];
+	QTFileInt64			myTotal = 0;
+	long				myJobCount = kDefaultJobCount;
+	long				myPadding = kQTFile_DefaultCompactPadding;
+	long				myFailedCount = 0;
+	int					myFirst;
+	int					myNext;
+	int					myIndex = 1;
+
+	for (; (myIndex + 1 < argc) && (argv[myIndex][0] == '-'); myIndex += 2) {
+		if (strcmp(argv[myIndex], "-j") == 0) {
+			myJobCount = atol(argv[myIndex + 1]);
+		} else if (strcmp(argv[myIndex], "-p") == 0) {
+			myPadding = atol(argv[myIndex + 1]);
+		} else {
+			QTCompactTool_ShowUsage(argv[0]);
+			return(1);
+		}
+	}
+
+	if ((myIndex == argc) || (myPadding < 0)) {
+		QTCompactTool_ShowUsage(argv[0]);
+		return(1);
+	}
+
+	if (myJobCount < 1)
+		myJobCount = 1;
+	if (myJobCount > kMaxJobCount)
+		myJobCount = kMaxJobCount;
+
+	// keep up to myJobCount compactions going, finishing them in the order they were started
+	myFirst = myIndex;
+	for (myNext = myIndex; myNext < argc; myNext++) {
+		if (myNext - myFirst == myJobCount) {
+			if (QTCompactTool_FinishFile(argv[0], argv[myFirst], myPadding, myJobs[(myFirst - myIndex) % myJobCount], &myTotal) != kQTFileErr_NoErr)
+				myFailedCount++;
+			myFirst++;
+		}
+
+		if (QTFile_StartCompaction(argv[myNext], myPadding, &myJobs[(myNext - myIndex) % myJobCount]) != kQTFileErr_NoErr) {
+			// we couldn't start a thread; the file is compacted on this one when its turn comes
+			myJobs[(myNext - myIndex) % myJobCount] = NULL;
+		}
+	}
+
+	for (; myFirst < argc; myFirst++)
+		if (QTCompactTool_FinishFile(argv[0], argv[myFirst], myPadding, myJobs[(myFirst - myIndex) % myJobCount], &myTotal) != kQTFileErr_NoErr)
+			myFailedCount++;
+
+	fprintf(stderr, "%d movie files, %.0f bytes reclaimed (%ld failed)\n", argc - myIndex, (double)myTotal, myFailedCount);
+
+	return((myFailedCount > 0) ? 1 : 0);
+}
+
+
+//////////
+//
+// QTCompactTool_FinishFile
+// Wait for the compaction of the specified file to finish (or, if theJob is NULL, compact it now), report
+// the result on the standard error stream, and add the bytes reclaimed to theTotal.
+//
+//////////
+
+static long QTCompactTool_FinishFile (const char *theToolName, const char *thePath, long thePadding, QTFileCompactJobPtr theJob, QTFileInt64 *theTotal)
+{
+	QTFileCompactStats	myStats;
+	long				myErr = kQTFileErr_NoErr;
+
+	if (theJob != NULL)
+		myErr = QTFile_FinishCompaction(theJob, &myStats);
+	else
+		myErr = QTFile_CompactMovieFile(thePath, thePadding, &myStats);
+
+	if (myErr != kQTFileErr_NoErr) {
+		fprintf(stderr, "%s: couldn't compact %s (error %ld)\n", theToolName, thePath, myErr);
+		return(myErr);
+	}
+
+	if (myStats.fTrackCount == 0) {
+		fprintf(stderr, "%s: nothing to reclaim\n", thePath);
+		return(myErr);
+	}
+
+	fprintf(stderr, "%s: %.0f bytes of old text dropped (%ld samples; %ld kept, in %ld text tracks); %.0f bytes reclaimed (%.0f -> %.0f)\n",
+				thePath,
+				(double)(QTFileInt64)myStats.fDeadBytes,
+				myStats.fDroppedCount,
+				myStats.fSampleCount,
+				myStats.fTrackCount,
+				(double)myStats.fBytesReclaimed,
+				(double)(QTFileInt64)myStats.fOldSize,
+				(double)(QTFileInt64)myStats.fNewSize);
+
+	*theTotal += myStats.fBytesReclaimed;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTCompactTool_ShowUsage
+// Show how to use the tool on the standard error stream.
+//
+//////////
+
+static void QTCompactTool_ShowUsage (const char *theToolName)
+{
+	fprintf(stderr, "usage: %s [-j jobs] [-p padding] movie-file ...\n", theToolName);
+}
@@ -0,0 +1,982 @@
+//////////
+//
+//	File:		QTTextEncoding.c
+//
+//	Contains:	Conversion of text media sample data into UTF-8, with a cache of converted samples.
+//				All utilities start with the prefix "QTTextEnc_".
+//
+//	Written by:	QuickTime Team
+//
+//	This file contains no QuickTime or Toolbox calls, so that it can be used both by the QTText application
+//	and by tools that read movie files without QuickTime.
+//
+// NOTES:
+//
+// *** (1) ***
+// The text in a text media sample is stored in the encoding of the script system of the sample's font, which
+// is given by the defaultStyle field of the text sample description. (A sample can also begin with a Unicode
+// byte order mark, in which case the text is UTF-16 or UTF-8, whatever the font.) The caller determines the
+// script and passes us the corresponding encoding; see QTTextEnc_GetEncodingForScript.
+//
+// *** (2) ***
+// Mac Roman, the encoding of almost all the text samples we see, is converted with a 128-entry table; runs of
+// 7-bit ASCII characters (the common case) are detected a word at a time and copied with memcpy. The multi-byte
+// encodings are handed to the platform's converter (MultiByteToWideChar on Windows, iconv elsewhere).
+//
+// *** (3) ***
+// The cache is NOT thread-safe; a program that converts samples on several threads should give each thread
+// its own cache.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTTextEncoding.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif QTTEXTENC_USE_ICONV
+#include <iconv.h>
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kCacheMinBuckets				256				// initial number of hash buckets in a sample cache
+#define kCacheEntryOverhead				((long)sizeof(QTTextCacheEntry))
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a converted sample in the cache; the UTF-8 text immediately follows this record in memory
+typedef struct QTTextCacheEntry {
+	struct QTTextCacheEntry		*fHashNext;			// next entry in the same hash bucket
+	struct QTTextCacheEntry		*fOlder;			// next less recently used entry
+	struct QTTextCacheEntry		*fNewer;			// next more recently used entry
+	const void					*fOwner;			// the owner of the sample (typically a Media)
+	long						fSampleNum;			// the sample number within the owner
+	long						fLength;			// the length of the UTF-8 text (not counting the terminating NUL)
+} QTTextCacheEntry;
+
+struct QTTextCache {
+	QTTextCacheEntry			**fBuckets;			// hash buckets
+	long						fBucketCount;		// number of hash buckets; always a power of 2
+	long						fEntryCount;		// number of entries in the cache
+	long						fBytes;				// number of bytes used by the entries in the cache
+	long						fMaxBytes;			// the byte budget for the cache
+	QTTextCacheEntry			*fNewest;			// the most recently used entry
+	QTTextCacheEntry			*fOldest;			// the least recently used entry
+};
+
+// the UTF-8 encoding of a Mac Roman character in the range 0x80-0xFF: a length byte followed by up to 3 bytes
+typedef unsigned char			QTTextUTF8Sequence[4];
+
+// the platform converter names for the multi-byte encodings
+typedef struct QTTextCodePage {
+	long						fEncoding;			// one of our kQTTextEnc_ constants
+	unsigned int				fWinCodePage;		// the Windows code page
+	const char					*fIconvName;		// the iconv encoding name
+} QTTextCodePage;
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+static const QTTextUTF8Sequence	gMacRomanToUTF8[128] = {
+	{2, 0xC3, 0x84, 0x00}, {2, 0xC3, 0x85, 0x00}, {2, 0xC3, 0x87, 0x00}, {2, 0xC3, 0x89, 0x00},		// 0x80
+	{2, 0xC3, 0x91, 0x00}, {2, 0xC3, 0x96, 0x00}, {2, 0xC3, 0x9C, 0x00}, {2, 0xC3, 0xA1, 0x00},		// 0x84
+	{2, 0xC3, 0xA0, 0x00}, {2, 0xC3, 0xA2, 0x00}, {2, 0xC3, 0xA4, 0x00}, {2, 0xC3, 0xA3, 0x00},		// 0x88
+	{2, 0xC3, 0xA5, 0x00}, {2, 0xC3, 0xA7, 0x00}, {2, 0xC3, 0xA9, 0x00}, {2, 0xC3, 0xA8, 0x00},		// 0x8C
+	{2, 0xC3, 0xAA, 0x00}, {2, 0xC3, 0xAB, 0x00}, {2, 0xC3, 0xAD, 0x00}, {2, 0xC3, 0xAC, 0x00},		// 0x90
+	{2, 0xC3, 0xAE, 0x00}, {2, 0xC3, 0xAF, 0x00}, {2, 0xC3, 0xB1, 0x00}, {2, 0xC3, 0xB3, 0x00},		// 0x94
+	{2, 0xC3, 0xB2, 0x00}, {2, 0xC3, 0xB4, 0x00}, {2, 0xC3, 0xB6, 0x00}, {2, 0xC3, 0xB5, 0x00},		// 0x98
+	{2, 0xC3, 0xBA, 0x00}, {2, 0xC3, 0xB9, 0x00}, {2, 0xC3, 0xBB, 0x00}, {2, 0xC3, 0xBC, 0x00},		// 0x9C
+	{3, 0xE2, 0x80, 0xA0}, {2, 0xC2, 0xB0, 0x00}, {2, 0xC2, 0xA2, 0x00}, {2, 0xC2, 0xA3, 0x00},		// 0xA0
+	{2, 0xC2, 0xA7, 0x00}, {3, 0xE2, 0x80, 0xA2}, {2, 0xC2, 0xB6, 0x00}, {2, 0xC3, 0x9F, 0x00},		// 0xA4
+	{2, 0xC2, 0xAE, 0x00}, {2, 0xC2, 0xA9, 0x00}, {3, 0xE2, 0x84, 0xA2}, {2, 0xC2, 0xB4, 0x00},		// 0xA8
+	{2, 0xC2, 0xA8, 0x00}, {3, 0xE2, 0x89, 0xA0}, {2, 0xC3, 0x86, 0x00}, {2, 0xC3, 0x98, 0x00},		// 0xAC
+	{3, 0xE2, 0x88, 0x9E}, {2, 0xC2, 0xB1, 0x00}, {3, 0xE2, 0x89, 0xA4}, {3, 0xE2, 0x89, 0xA5},		// 0xB0
+	{2, 0xC2, 0xA5, 0x00}, {2, 0xC2, 0xB5, 0x00}, {3, 0xE2, 0x88, 0x82}, {3, 0xE2, 0x88, 0x91},		// 0xB4
+	{3, 0xE2, 0x88, 0x8F}, {2, 0xCF, 0x80, 0x00}, {3, 0xE2, 0x88, 0xAB}, {2, 0xC2, 0xAA, 0x00},		// 0xB8
+	{2, 0xC2, 0xBA, 0x00}, {2, 0xCE, 0xA9, 0x00}, {2, 0xC3, 0xA6, 0x00}, {2, 0xC3, 0xB8, 0x00},		// 0xBC
+	{2, 0xC2, 0xBF, 0x00}, {2, 0xC2, 0xA1, 0x00}, {2, 0xC2, 0xAC, 0x00}, {3, 0xE2, 0x88, 0x9A},		// 0xC0
+	{2, 0xC6, 0x92, 0x00}, {3, 0xE2, 0x89, 0x88}, {3, 0xE2, 0x88, 0x86}, {2, 0xC2, 0xAB, 0x00},		// 0xC4
+	{2, 0xC2, 0xBB, 0x00}, {3, 0xE2, 0x80, 0xA6}, {2, 0xC2, 0xA0, 0x00}, {2, 0xC3, 0x80, 0x00},		// 0xC8
+	{2, 0xC3, 0x83, 0x00}, {2, 0xC3, 0x95, 0x00}, {2, 0xC5, 0x92, 0x00}, {2, 0xC5, 0x93, 0x00},		// 0xCC
+	{3, 0xE2, 0x80, 0x93}, {3, 0xE2, 0x80, 0x94}, {3, 0xE2, 0x80, 0x9C}, {3, 0xE2, 0x80, 0x9D},		// 0xD0
+	{3, 0xE2, 0x80, 0x98}, {3, 0xE2, 0x80, 0x99}, {2, 0xC3, 0xB7, 0x00}, {3, 0xE2, 0x97, 0x8A},		// 0xD4
+	{2, 0xC3, 0xBF, 0x00}, {2, 0xC5, 0xB8, 0x00}, {3, 0xE2, 0x81, 0x84}, {3, 0xE2, 0x82, 0xAC},		// 0xD8
+	{3, 0xE2, 0x80, 0xB9}, {3, 0xE2, 0x80, 0xBA}, {3, 0xEF, 0xAC, 0x81}, {3, 0xEF, 0xAC, 0x82},		// 0xDC
+	{3, 0xE2, 0x80, 0xA1}, {2, 0xC2, 0xB7, 0x00}, {3, 0xE2, 0x80, 0x9A}, {3, 0xE2, 0x80, 0x9E},		// 0xE0
+	{3, 0xE2, 0x80, 0xB0}, {2, 0xC3, 0x82, 0x00}, {2, 0xC3, 0x8A, 0x00}, {2, 0xC3, 0x81, 0x00},		// 0xE4
+	{2, 0xC3, 0x8B, 0x00}, {2, 0xC3, 0x88, 0x00}, {2, 0xC3, 0x8D, 0x00}, {2, 0xC3, 0x8E, 0x00},		// 0xE8
+	{2, 0xC3, 0x8F, 0x00}, {2, 0xC3, 0x8C, 0x00}, {2, 0xC3, 0x93, 0x00}, {2, 0xC3, 0x94, 0x00},		// 0xEC
+	{3, 0xEF, 0xA3, 0xBF}, {2, 0xC3, 0x92, 0x00}, {2, 0xC3, 0x9A, 0x00}, {2, 0xC3, 0x9B, 0x00},		// 0xF0
+	{2, 0xC3, 0x99, 0x00}, {2, 0xC4, 0xB1, 0x00}, {2, 0xCB, 0x86, 0x00}, {2, 0xCB, 0x9C, 0x00},		// 0xF4
+	{2, 0xC2, 0xAF, 0x00}, {2, 0xCB, 0x98, 0x00}, {2, 0xCB, 0x99, 0x00}, {2, 0xCB, 0x9A, 0x00},		// 0xF8
+	{2, 0xC2, 0xB8, 0x00}, {2, 0xCB, 0x9D, 0x00}, {2, 0xCB, 0x9B, 0x00}, {2, 0xCB, 0x87, 0x00},		// 0xFC
+};
+
+static const QTTextCodePage		gCodePages[] = {
+	{kQTTextEnc_ShiftJIS,		932,	"SHIFT_JIS"},
+	{kQTTextEnc_Big5,			950,	"BIG5"},
+	{kQTTextEnc_EUCKR,			949,	"EUC-KR"},
+	{kQTTextEnc_GB2312,			936,	"GB2312"}
+};
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static long					QTTextEnc_ConvertMacRoman (const unsigned char *theSrc, long theSrcSize, char *theDst, long theDstSize);
+static long					QTTextEnc_ConvertUTF16 (const unsigned char *theSrc, long theSrcSize, int isBigEndian, char *theDst, long theDstSize);
+static long					QTTextEnc_ConvertMultiByte (long theEncoding, const unsigned char *theSrc, long theSrcSize, char *theDst, long theDstSize);
+static long					QTTextEnc_PutUTF8 (unsigned long theChar, char *theDst, long theDstSize);
+static unsigned long		QTTextEnc_HashKey (const void *theOwner, long theSampleNum);
+static void					QTTextEnc_CacheUnlink (QTTextCachePtr theCache, QTTextCacheEntry *theEntry);
+static void					QTTextEnc_CacheRemove (QTTextCachePtr theCache, QTTextCacheEntry *theEntry);
+static void					QTTextEnc_CacheGrow (QTTextCachePtr theCache);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Conversion utilities.
+//
+// Use these functions to find the text in a text media sample and to convert it into UTF-8.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTextEnc_GetEncodingForScript
+// Return the encoding of text in the specified script system.
+//
+// Scripts we don't know anything about are treated as Mac Roman, which at least gets the ASCII right.
+//
+//////////
+
+long QTTextEnc_GetEncodingForScript (short theScript)
+{
+	switch (theScript) {
+		case kQTTextEnc_smJapanese:		return(kQTTextEnc_ShiftJIS);
+		case kQTTextEnc_smTradChinese:	return(kQTTextEnc_Big5);
+		case kQTTextEnc_smKorean:		return(kQTTextEnc_EUCKR);
+		case kQTTextEnc_smSimpChinese:	return(kQTTextEnc_GB2312);
+		default:						return(kQTTextEnc_MacRoman);
+	}
+}
+
+
+//////////
+//
+// QTTextEnc_GetSampleText
+// Return, through theText, a pointer to the text in the specified text media sample; return the text length.
+//
+// A text media sample is a big-endian 16-bit length word followed by the text itself (and possibly by some
+// style atoms, which we ignore). We never return a length that runs past the end of the sample data.
+//
+//////////
+
+long QTTextEnc_GetSampleText (const unsigned char *theSample, long theSampleSize, const unsigned char **theText)
+{
+	long			myTextSize = 0;
+
+	*theText = theSample;
+	if ((theSample == NULL) || (theSampleSize < 2))
+		return(0);
+
+	myTextSize = ((long)theSample[0] << 8) | (long)theSample[1];
+	if (myTextSize > theSampleSize - 2)
+		myTextSize = theSampleSize - 2;
+
+	*theText = theSample + 2;
+	return(myTextSize);
+}
+
+
+//////////
+//
+// QTTextEnc_GetSampleEncoding
+// Return the encoding of the specified sample text, given the encoding of the sample's script.
+//
+// If the text begins with a Unicode byte order mark, the mark decides the encoding; in that case, we also
+// advance theText past the mark and shorten theTextSize accordingly.
+//
+//////////
+
+long QTTextEnc_GetSampleEncoding (long theEncoding, const unsigned char **theText, long *theTextSize)
+{
+	const unsigned char		*myText = *theText;
+	long					myEncoding = theEncoding;
+	long					myMarkSize = 0;
+
+	if ((*theTextSize >= 2) && (myText[0] == 0xFE) && (myText[1] == 0xFF)) {
+		myEncoding = kQTTextEnc_UTF16BE;
+		myMarkSize = 2;
+	} else if ((*theTextSize >= 2) && (myText[0] == 0xFF) && (myText[1] == 0xFE)) {
+		myEncoding = kQTTextEnc_UTF16LE;
+		myMarkSize = 2;
+	} else if ((*theTextSize >= 3) && (myText[0] == 0xEF) && (myText[1] == 0xBB) && (myText[2] == 0xBF)) {
+		myEncoding = kQTTextEnc_UTF8;
+		myMarkSize = 3;
+	}
+
+	*theText += myMarkSize;
+	*theTextSize -= myMarkSize;
+
+	return(myEncoding);
+}
+
+
+//////////
+//
+// QTTextEnc_ConvertToUTF8
+// Convert the specified text into UTF-8; return the number of bytes written to theDst.
+//
+// The destination is always NUL-terminated, so theDstSize must be at least 1. A destination that is
+// (kQTTextEnc_MaxUTF8PerByte * theSrcSize) + 1 bytes long is always big enough; if it isn't big enough,
+// the output is truncated at a character boundary.
+//
+//////////
+
+long QTTextEnc_ConvertToUTF8 (long theEncoding, const unsigned char *theSrc, long theSrcSize, char *theDst, long theDstSize)
+{
+	long			myLength = 0;
+
+	if ((theDst == NULL) || (theDstSize < 1))
+		return(0);
+
+	if ((theSrc == NULL) || (theSrcSize <= 0)) {
+		theDst[0] = '\0';
+		return(0);
+	}
+
+	switch (theEncoding) {
+		case kQTTextEnc_UTF8:
+			// if the text doesn't fit, cut it before the lead byte of the character that would be split
+			myLength = theSrcSize;
+			if (myLength > theDstSize - 1) {
+				myLength = theDstSize - 1;
+				while ((myLength > 0) && ((theSrc[myLength] & 0xC0) == 0x80))
+					myLength--;
+			}
+			memcpy(theDst, theSrc, myLength);
+			break;
+
+		case kQTTextEnc_UTF16BE:
+		case kQTTextEnc_UTF16LE:
+			myLength = QTTextEnc_ConvertUTF16(theSrc, theSrcSize, theEncoding == kQTTextEnc_UTF16BE, theDst, theDstSize);
+			break;
+
+		case kQTTextEnc_ShiftJIS:
+		case kQTTextEnc_Big5:
+		case kQTTextEnc_EUCKR:
+		case kQTTextEnc_GB2312:
+			// if the platform can't convert this encoding, salvage the ASCII characters
+			myLength = QTTextEnc_ConvertMultiByte(theEncoding, theSrc, theSrcSize, theDst, theDstSize);
+			if (myLength < 0)
+				myLength = QTTextEnc_ConvertMacRoman(theSrc, theSrcSize, theDst, theDstSize);
+			break;
+
+		case kQTTextEnc_MacRoman:
+		default:
+			myLength = QTTextEnc_ConvertMacRoman(theSrc, theSrcSize, theDst, theDstSize);
+			break;
+	}
+
+	theDst[myLength] = '\0';
+	return(myLength);
+}
+
+
+//////////
+//
+// QTTextEnc_ConvertMacRoman
+// Convert Mac Roman text into UTF-8.
+//
+// This is the hot path: we look for runs of ASCII characters a word at a time, copy each run in one piece,
+// and then look up the non-ASCII characters in a table.
+//
+//////////
+
+static long QTTextEnc_ConvertMacRoman (const unsigned char *theSrc, long theSrcSize, char *theDst, long theDstSize)
+{
+	long			mySrcIndex = 0;
+	long			myDstIndex = 0;
+	long			myRoom = theDstSize - 1;			// leave room for the terminating NUL
+
+	while (mySrcIndex < theSrcSize) {
+		long		myRunStart = mySrcIndex;
+		long		myRunLength;
+
+		// skip over a run of ASCII characters, four at a time while we can
+		while (mySrcIndex + 4 <= theSrcSize) {
+			unsigned int	myWord;
+
+			memcpy(&myWord, theSrc + mySrcIndex, 4);
+			if ((myWord & 0x80808080U) != 0)
+				break;
+			mySrcIndex += 4;
+		}
+
+		while ((mySrcIndex < theSrcSize) && (theSrc[mySrcIndex] < 0x80))
+			mySrcIndex++;
+
+		// copy the run
+		myRunLength = mySrcIndex - myRunStart;
+		if (myRunLength > myRoom - myDstIndex)
+			myRunLength = myRoom - myDstIndex;
+		memcpy(theDst + myDstIndex, theSrc + myRunStart, myRunLength);
+		myDstIndex += myRunLength;
+
+		// convert the non-ASCII characters that follow the run
+		while ((mySrcIndex < theSrcSize) && (theSrc[mySrcIndex] >= 0x80)) {
+			const unsigned char	*mySequence = gMacRomanToUTF8[theSrc[mySrcIndex] - 0x80];
+
+			if (mySequence[0] > myRoom - myDstIndex)
+				return(myDstIndex);
+
+			memcpy(theDst + myDstIndex, mySequence + 1, mySequence[0]);
+			myDstIndex += mySequence[0];
+			mySrcIndex++;
+		}
+
+		if (myDstIndex >= myRoom)
+			break;
+	}
+
+	return(myDstIndex);
+}
+
+
+//////////
+//
+// QTTextEnc_ConvertUTF16
+// Convert UTF-16 text (of either byte order) into UTF-8.
+//
+//////////
+
+static long QTTextEnc_ConvertUTF16 (const unsigned char *theSrc, long theSrcSize, int isBigEndian, char *theDst, long theDstSize)
+{
+	long			mySrcIndex = 0;
+	long			myDstIndex = 0;
+	long			myRoom = theDstSize - 1;
+
+	while (mySrcIndex + 2 <= theSrcSize) {
+		unsigned long	myChar;
+		long			myLength;
+
+		myChar = isBigEndian ? ((theSrc[mySrcIndex] << 8) | theSrc[mySrcIndex + 1]) : ((theSrc[mySrcIndex + 1] << 8) | theSrc[mySrcIndex]);
+		mySrcIndex += 2;
+
+		// combine a surrogate pair into a single character
+		if ((myChar >= 0xD800) && (myChar <= 0xDBFF) && (mySrcIndex + 2 <= theSrcSize)) {
+			unsigned long	myLow;
+
+			myLow = isBigEndian ? ((theSrc[mySrcIndex] << 8) | theSrc[mySrcIndex + 1]) : ((theSrc[mySrcIndex + 1] << 8) | theSrc[mySrcIndex]);
+			if ((myLow >= 0xDC00) && (myLow <= 0xDFFF)) {
+				myChar = 0x10000 + ((myChar - 0xD800) << 10) + (myLow - 0xDC00);
+				mySrcIndex += 2;
+			}
+		}
+
+		// unpaired surrogates can't be represented in UTF-8
+		if ((myChar >= 0xD800) && (myChar <= 0xDFFF))
+			myChar = kQTTextEnc_ReplacementChar;
+
+		myLength = QTTextEnc_PutUTF8(myChar, theDst + myDstIndex, myRoom - myDstIndex);
+		if (myLength == 0)
+			break;
+		myDstIndex += myLength;
+	}
+
+	return(myDstIndex);
+}
+
+
+//////////
+//
+// QTTextEnc_ConvertMultiByte
+// Convert text in one of the multi-byte script encodings into UTF-8, using the platform's converter.
+//
+// Return -1 if the platform has no converter for the encoding.
+//
+//////////
+
+static long QTTextEnc_ConvertMultiByte (long theEncoding, const unsigned char *theSrc, long theSrcSize, char *theDst, long theDstSize)
+{
+	const QTTextCodePage	*myCodePage = NULL;
+	long					myIndex;
+
+	for (myIndex = 0; myIndex < (long)(sizeof(gCodePages) / sizeof(gCodePages[0])); myIndex++)
+		if (gCodePages[myIndex].fEncoding == theEncoding)
+			myCodePage = &gCodePages[myIndex];
+
+	if (myCodePage == NULL)
+		return(-1);
+
+#if defined(_WIN32)
+	{
+		WCHAR			*myWide = NULL;
+		int				myWideLength;
+		long			myDstIndex = 0;
+
+		// every multi-byte character maps to at most one UTF-16 code unit in these code pages
+		myWide = (WCHAR *)malloc(theSrcSize * sizeof(WCHAR));
+		if (myWide == NULL)
+			return(-1);
+
+		myWideLength = MultiByteToWideChar(myCodePage->fWinCodePage, 0, (LPCSTR)theSrc, (int)theSrcSize, myWide, (int)theSrcSize);
+		if (myWideLength <= 0) {
+			free(myWide);
+			return(-1);
+		}
+
+		// UTF-16 in native (little-endian) byte order
+		myDstIndex = QTTextEnc_ConvertUTF16((const unsigned char *)myWide, myWideLength * 2L, 0, theDst, theDstSize);
+		free(myWide);
+		return(myDstIndex);
+	}
+#elif QTTEXTENC_USE_ICONV
+	{
+		iconv_t			myConverter;
+		char			*myIn = (char *)theSrc;
+		size_t			myInLeft = (size_t)theSrcSize;
+		char			*myOut = theDst;
+		size_t			myOutLeft = (size_t)(theDstSize - 1);
+
+		myConverter = iconv_open("UTF-8", myCodePage->fIconvName);
+		if (myConverter == (iconv_t)-1)
+			return(-1);
+
+		// on an invalid sequence, emit a replacement character and resynchronize on the next byte
+		while ((myInLeft > 0) && (iconv(myConverter, &myIn, &myInLeft, &myOut, &myOutLeft) == (size_t)-1)) {
+			if ((myOutLeft == 0) || (myInLeft == 0))
+				break;
+			*myOut++ = kQTTextEnc_ReplacementChar;
+			myOutLeft--;
+			myIn++;
+			myInLeft--;
+		}
+
+		iconv_close(myConverter);
+		return((long)(myOut - theDst));
+	}
+#else
+	return(-1);
+#endif
+}
+
+
+//////////
+//
+// QTTextEnc_PutUTF8
+// Write the UTF-8 encoding of the specified Unicode character; return the number of bytes written.
+//
+// Return 0 if there isn't room for the entire encoding.
+//
+//////////
+
+static long QTTextEnc_PutUTF8 (unsigned long theChar, char *theDst, long theDstSize)
+{
+	unsigned char	*myDst = (unsigned char *)theDst;
+
+	if (theChar < 0x80) {
+		if (theDstSize < 1)
+			return(0);
+		myDst[0] = (unsigned char)theChar;
+		return(1);
+	}
+
+	if (theChar < 0x800) {
+		if (theDstSize < 2)
+			return(0);
+		myDst[0] = (unsigned char)(0xC0 | (theChar >> 6));
+		myDst[1] = (unsigned char)(0x80 | (theChar & 0x3F));
+		return(2);
+	}
+
+	if (theChar < 0x10000) {
+		if (theDstSize < 3)
+			return(0);
+		myDst[0] = (unsigned char)(0xE0 | (theChar >> 12));
+		myDst[1] = (unsigned char)(0x80 | ((theChar >> 6) & 0x3F));
+		myDst[2] = (unsigned char)(0x80 | (theChar & 0x3F));
+		return(3);
+	}
+
+	if (theDstSize < 4)
+		return(0);
+	myDst[0] = (unsigned char)(0xF0 | (theChar >> 18));
+	myDst[1] = (unsigned char)(0x80 | ((theChar >> 12) & 0x3F));
+	myDst[2] = (unsigned char)(0x80 | ((theChar >> 6) & 0x3F));
+	myDst[3] = (unsigned char)(0x80 | (theChar & 0x3F));
+	return(4);
+}
+
+
+//////////
+//
+// QTTextEnc_ConvertFromUTF8
+// Convert the specified UTF-8 text into the text of a text media sample; return the number of bytes written.
+//
+// Text that is all 7-bit ASCII is copied as is, since it reads the same in any script. Anything else becomes
+// UTF-16 (big-endian, with a byte order mark), which QuickTime displays whatever the sample's font. So a buffer
+// (2 * theSrcSize) + 2 bytes long is always big enough; if it isn't big enough, the output is truncated.
+// Invalid UTF-8 sequences become kQTTextEnc_ReplacementChar.
+//
+//////////
+
+long QTTextEnc_ConvertFromUTF8 (const char *theSrc, long theSrcSize, unsigned char *theDst, long theDstSize)
+{
+	const unsigned char		*mySrc = (const unsigned char *)theSrc;
+	long					mySrcIndex = 0;
+	long					myDstIndex = 0;
+
+	if ((theSrc == NULL) || (theSrcSize <= 0) || (theDst == NULL) || (theDstSize <= 0))
+		return(0);
+
+	// see whether the text is all ASCII, four characters at a time while we can
+	while (mySrcIndex + 4 <= theSrcSize) {
+		unsigned int	myWord;
+
+		memcpy(&myWord, mySrc + mySrcIndex, 4);
+		if ((myWord & 0x80808080U) != 0)
+			break;
+		mySrcIndex += 4;
+	}
+
+	while ((mySrcIndex < theSrcSize) && (mySrc[mySrcIndex] < 0x80))
+		mySrcIndex++;
+
+	// every byte of ASCII text is a whole character, so it can be cut anywhere
+	if (mySrcIndex == theSrcSize) {
+		myDstIndex = (theSrcSize < theDstSize) ? theSrcSize : theDstSize;
+		memcpy(theDst, theSrc, myDstIndex);
+		return(myDstIndex);
+	}
+
+	// convert to UTF-16, starting with the byte order mark
+	if (theDstSize < 2)
+		return(0);
+
+	theDst[myDstIndex++] = 0xFE;
+	theDst[myDstIndex++] = 0xFF;
+
+	mySrcIndex = 0;
+	while (mySrcIndex < theSrcSize) {
+		unsigned long	myChar = mySrc[mySrcIndex];
+		long			myCount = 0;
+		long			myIndex;
+
+		if (myChar < 0x80)
+			myCount = 0;
+		else if ((myChar & 0xE0) == 0xC0) {
+			myChar &= 0x1F;
+			myCount = 1;
+		} else if ((myChar & 0xF0) == 0xE0) {
+			myChar &= 0x0F;
+			myCount = 2;
+		} else if ((myChar & 0xF8) == 0xF0) {
+			myChar &= 0x07;
+			myCount = 3;
+		} else {
+			myChar = kQTTextEnc_ReplacementChar;
+		}
+
+		mySrcIndex++;
+		for (myIndex = 0; myIndex < myCount; myIndex++) {
+			if ((mySrcIndex >= theSrcSize) || ((mySrc[mySrcIndex] & 0xC0) != 0x80)) {
+				myChar = kQTTextEnc_ReplacementChar;
+				break;
+			}
+			myChar = (myChar << 6) | (mySrc[mySrcIndex++] & 0x3F);
+		}
+
+		if ((myChar > 0x10FFFF) || ((myChar >= 0xD800) && (myChar <= 0xDFFF)))
+			myChar = kQTTextEnc_ReplacementChar;
+
+		if (myChar >= 0x10000) {
+			// a surrogate pair
+			if (myDstIndex + 4 > theDstSize)
+				break;
+
+			myChar -= 0x10000;
+			theDst[myDstIndex++] = (unsigned char)(0xD8 | ((myChar >> 18) & 0x03));
+			theDst[myDstIndex++] = (unsigned char)((myChar >> 10) & 0xFF);
+			theDst[myDstIndex++] = (unsigned char)(0xDC | ((myChar >> 8) & 0x03));
+			theDst[myDstIndex++] = (unsigned char)(myChar & 0xFF);
+		} else {
+			if (myDstIndex + 2 > theDstSize)
+				break;
+
+			theDst[myDstIndex++] = (unsigned char)(myChar >> 8);
+			theDst[myDstIndex++] = (unsigned char)(myChar & 0xFF);
+		}
+	}
+
+	return(myDstIndex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Sample cache utilities.
+//
+// Use these functions to convert each text sample only once. A cache holds the UTF-8 text of recently used
+// samples, keyed by the sample's owner and sample number. Media sample data never changes once it has been
+// added (edits add new samples), so a cached sample needs to be flushed only when its owner goes away.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTextEnc_NewCache
+// Create a new sample cache that uses at most (approximately) the specified number of bytes.
+//
+// The caller is responsible for disposing of the cache returned by this function (by calling QTTextEnc_DisposeCache).
+//
+//////////
+
+QTTextCachePtr QTTextEnc_NewCache (long theMaxBytes)
+{
+	QTTextCachePtr			myCache = NULL;
+
+	myCache = (QTTextCachePtr)calloc(1, sizeof(QTTextCache));
+	if (myCache == NULL)
+		return(NULL);
+
+	myCache->fBuckets = (QTTextCacheEntry **)calloc(kCacheMinBuckets, sizeof(QTTextCacheEntry *));
+	if (myCache->fBuckets == NULL) {
+		free(myCache);
+		return(NULL);
+	}
+
+	myCache->fBucketCount = kCacheMinBuckets;
+	myCache->fMaxBytes = (theMaxBytes > 0) ? theMaxBytes : kQTTextEnc_DefaultCacheSize;
+
+	return(myCache);
+}
+
+
+//////////
+//
+// QTTextEnc_DisposeCache
+// Dispose of the specified sample cache and all the text in it.
+//
+//////////
+
+void QTTextEnc_DisposeCache (QTTextCachePtr theCache)
+{
+	if (theCache == NULL)
+		return;
+
+	while (theCache->fOldest != NULL)
+		QTTextEnc_CacheRemove(theCache, theCache->fOldest);
+
+	free(theCache->fBuckets);
+	free(theCache);
+}
+
+
+//////////
+//
+// QTTextEnc_CacheLookup
+// Return the UTF-8 text of the specified sample, or NULL if it isn't in the cache.
+//
+// The returned text belongs to the cache; it remains valid until the next call to QTTextEnc_CacheInsert
+// or QTTextEnc_CacheFlushOwner.
+//
+//////////
+
+const char *QTTextEnc_CacheLookup (QTTextCachePtr theCache, const void *theOwner, long theSampleNum, long *theLength)
+{
+	QTTextCacheEntry		*myEntry = NULL;
+
+	if (theCache == NULL)
+		return(NULL);
+
+	myEntry = theCache->fBuckets[QTTextEnc_HashKey(theOwner, theSampleNum) & (theCache->fBucketCount - 1)];
+	while (myEntry != NULL) {
+		if ((myEntry->fOwner == theOwner) && (myEntry->fSampleNum == theSampleNum))
+			break;
+		myEntry = myEntry->fHashNext;
+	}
+
+	if (myEntry == NULL)
+		return(NULL);
+
+	// move the entry to the head of the LRU list
+	if (theCache->fNewest != myEntry) {
+		QTTextEnc_CacheUnlink(theCache, myEntry);
+		myEntry->fOlder = theCache->fNewest;
+		myEntry->fNewer = NULL;
+		theCache->fNewest->fNewer = myEntry;
+		theCache->fNewest = myEntry;
+	}
+
+	if (theLength != NULL)
+		*theLength = myEntry->fLength;
+
+	return((const char *)(myEntry + 1));
+}
+
+
+//////////
+//
+// QTTextEnc_CacheInsert
+// Convert the specified text media sample into UTF-8, add it to the cache, and return the UTF-8 text.
+//
+// The theEncoding parameter is the encoding of the sample's script; theSample points to the complete
+// sample data (length word and all). If the sample is already in the cache, we just return it.
+//
+//////////
+
+const char *QTTextEnc_CacheInsert (QTTextCachePtr theCache, const void *theOwner, long theSampleNum, long theEncoding, const unsigned char *theSample, long theSampleSize, long *theLength)
+{
+	QTTextCacheEntry		*myEntry = NULL;
+	const unsigned char		*myText = NULL;
+	long					myTextSize;
+	long					myEncoding;
+	long					myMaxLength;
+	unsigned long			myBucket;
+	const char				*myUTF8 = NULL;
+
+	if (theCache == NULL)
+		return(NULL);
+
+	myUTF8 = QTTextEnc_CacheLookup(theCache, theOwner, theSampleNum, theLength);
+	if (myUTF8 != NULL)
+		return(myUTF8);
+
+	myTextSize = QTTextEnc_GetSampleText(theSample, theSampleSize, &myText);
+	myEncoding = QTTextEnc_GetSampleEncoding(theEncoding, &myText, &myTextSize);
+
+	// convert into a worst-case sized entry, then give back the unused space
+	myMaxLength = (myTextSize * kQTTextEnc_MaxUTF8PerByte) + 1;
+	myEntry = (QTTextCacheEntry *)malloc(sizeof(QTTextCacheEntry) + myMaxLength);
+	if (myEntry == NULL)
+		return(NULL);
+
+	myEntry->fLength = QTTextEnc_ConvertToUTF8(myEncoding, myText, myTextSize, (char *)(myEntry + 1), myMaxLength);
+	if (myEntry->fLength + 1 < myMaxLength) {
+		QTTextCacheEntry	*mySmaller;
+
+		mySmaller = (QTTextCacheEntry *)realloc(myEntry, sizeof(QTTextCacheEntry) + myEntry->fLength + 1);
+		if (mySmaller != NULL)
+			myEntry = mySmaller;
+	}
+
+	myEntry->fOwner = theOwner;
+	myEntry->fSampleNum = theSampleNum;
+
+	// make room for the new entry, discarding the least recently used entries first
+	theCache->fBytes += kCacheEntryOverhead + myEntry->fLength + 1;
+	while ((theCache->fBytes > theCache->fMaxBytes) && (theCache->fOldest != NULL))
+		QTTextEnc_CacheRemove(theCache, theCache->fOldest);
+
+	if (theCache->fEntryCount >= theCache->fBucketCount * 2)
+		QTTextEnc_CacheGrow(theCache);
+
+	// link the entry into its hash bucket and at the head of the LRU list
+	myBucket = QTTextEnc_HashKey(theOwner, theSampleNum) & (theCache->fBucketCount - 1);
+	myEntry->fHashNext = theCache->fBuckets[myBucket];
+	theCache->fBuckets[myBucket] = myEntry;
+
+	myEntry->fOlder = theCache->fNewest;
+	myEntry->fNewer = NULL;
+	if (theCache->fNewest != NULL)
+		theCache->fNewest->fNewer = myEntry;
+	theCache->fNewest = myEntry;
+	if (theCache->fOldest == NULL)
+		theCache->fOldest = myEntry;
+
+	theCache->fEntryCount++;
+
+	if (theLength != NULL)
+		*theLength = myEntry->fLength;
+
+	return((const char *)(myEntry + 1));
+}
+
+
+//////////
+//
+// QTTextEnc_CacheFlushOwner
+// Remove all the samples of the specified owner from the cache.
+//
+// Call this function before disposing of the owner (for instance, before disposing of a text track),
+// since a new owner may later be allocated at the same address.
+//
+//////////
+
+void QTTextEnc_CacheFlushOwner (QTTextCachePtr theCache, const void *theOwner)
+{
+	QTTextCacheEntry		*myEntry = NULL;
+	QTTextCacheEntry		*myNewer = NULL;
+
+	if (theCache == NULL)
+		return;
+
+	myEntry = theCache->fOldest;
+	while (myEntry != NULL) {
+		myNewer = myEntry->fNewer;
+		if (myEntry->fOwner == theOwner)
+			QTTextEnc_CacheRemove(theCache, myEntry);
+		myEntry = myNewer;
+	}
+}
+
+
+//////////
+//
+// QTTextEnc_CacheFlushAll
+// Remove all the samples from the cache.
+//
+//////////
+
+void QTTextEnc_CacheFlushAll (QTTextCachePtr theCache)
+{
+	if (theCache == NULL)
+		return;
+
+	while (theCache->fOldest != NULL)
+		QTTextEnc_CacheRemove(theCache, theCache->fOldest);
+}
+
+
+//////////
+//
+// QTTextEnc_CacheGetSize
+// Return the number of bytes currently used by the specified cache.
+//
+//////////
+
+long QTTextEnc_CacheGetSize (QTTextCachePtr theCache)
+{
+	return((theCache != NULL) ? theCache->fBytes : 0L);
+}
+
+
+//////////
+//
+// QTTextEnc_HashKey
+// Return a hash value for the specified owner and sample number.
+//
+//////////
+
+static unsigned long QTTextEnc_HashKey (const void *theOwner, long theSampleNum)
+{
+	unsigned long	myHash = (unsigned long)(size_t)theOwner;
+
+	myHash ^= myHash >> 9;
+	myHash = (myHash * 31) + (unsigned long)theSampleNum;
+	myHash ^= myHash >> 13;
+	myHash *= 0x9E3779B1UL;
+
+	return(myHash ^ (myHash >> 16));
+}
+
+
+//////////
+//
+// QTTextEnc_CacheUnlink
+// Remove the specified entry from the LRU list (but not from its hash bucket).
+//
+//////////
+
+static void QTTextEnc_CacheUnlink (QTTextCachePtr theCache, QTTextCacheEntry *theEntry)
+{
+	if (theEntry->fNewer != NULL)
+		theEntry->fNewer->fOlder = theEntry->fOlder;
+	else
+		theCache->fNewest = theEntry->fOlder;
+
+	if (theEntry->fOlder != NULL)
+		theEntry->fOlder->fNewer = theEntry->fNewer;
+	else
+		theCache->fOldest = theEntry->fNewer;
+}
+
+
+//////////
+//
+// QTTextEnc_CacheRemove
+// Remove the specified entry from the cache and dispose of it.
+//
+//////////
+
+static void QTTextEnc_CacheRemove (QTTextCachePtr theCache, QTTextCacheEntry *theEntry)
+{
+	QTTextCacheEntry		**myLink = NULL;
+
+	myLink = &theCache->fBuckets[QTTextEnc_HashKey(theEntry->fOwner, theEntry->fSampleNum) & (theCache->fBucketCount - 1)];
+	while ((*myLink != NULL) && (*myLink != theEntry))
+		myLink = &(*myLink)->fHashNext;
+
+	if (*myLink == theEntry)
+		*myLink = theEntry->fHashNext;
+
+	QTTextEnc_CacheUnlink(theCache, theEntry);
+
+	theCache->fBytes -= kCacheEntryOverhead + theEntry->fLength + 1;
+	theCache->fEntryCount--;
+	free(theEntry);
+}
+
+
+//////////
+//
+// QTTextEnc_CacheGrow
+// Double the number of hash buckets in the specified cache.
+//
+// If we can't get the memory, we just keep the longer hash chains.
+//
+//////////
+
+static void QTTextEnc_CacheGrow (QTTextCachePtr theCache)
+{
+	QTTextCacheEntry		**myBuckets = NULL;
+	QTTextCacheEntry		*myEntry = NULL;
+	long					myCount = theCache->fBucketCount * 2;
+	long					myIndex;
+
+	myBuckets = (QTTextCacheEntry **)calloc(myCount, sizeof(QTTextCacheEntry *));
+	if (myBuckets == NULL)
+		return;
+
+	for (myIndex = 0; myIndex < theCache->fBucketCount; myIndex++) {
+		myEntry = theCache->fBuckets[myIndex];
+		while (myEntry != NULL) {
+			QTTextCacheEntry	*myNext = myEntry->fHashNext;
+			unsigned long		myBucket;
+
+			myBucket = QTTextEnc_HashKey(myEntry->fOwner, myEntry->fSampleNum) & (myCount - 1);
+			myEntry->fHashNext = myBuckets[myBucket];
+			myBuckets[myBucket] = myEntry;
+			myEntry = myNext;
+		}
+	}
+
+	free(theCache->fBuckets);
+	theCache->fBuckets = myBuckets;
+	theCache->fBucketCount = myCount;
+}
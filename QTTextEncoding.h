@@ -0,0 +1,113 @@
+//////////
+//
+//	File:		QTTextEncoding.h
+//
+//	Contains:	Conversion of text media sample data into UTF-8, with a cache of converted samples.
+//				All utilities start with the prefix "QTTextEnc_".
+//
+//	Written by:	QuickTime Team
+//
+//////////
+
+#pragma once
+
+#ifndef __QTTextEncoding__
+#define __QTTextEncoding__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+
+//////////
+//
+// compiler flags
+//
+//////////
+
+// do we use iconv to convert the multi-byte script encodings (Shift-JIS and friends)?
+// on Windows we use MultiByteToWideChar instead; everywhere else iconv is part of the C library
+#ifndef QTTEXTENC_USE_ICONV
+#if defined(_WIN32)
+#define QTTEXTENC_USE_ICONV			0
+#else
+#define QTTEXTENC_USE_ICONV			1
+#endif
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+// the source encodings we know how to convert into UTF-8
+enum {
+	kQTTextEnc_MacRoman				= 0,			// single-byte; converted with a lookup table
+	kQTTextEnc_ShiftJIS				= 1,			// smJapanese
+	kQTTextEnc_Big5					= 2,			// smTradChinese
+	kQTTextEnc_EUCKR				= 3,			// smKorean
+	kQTTextEnc_GB2312				= 4,			// smSimpChinese
+	kQTTextEnc_UTF16BE				= 5,			// sample data begins with the byte order mark 0xFEFF
+	kQTTextEnc_UTF16LE				= 6,			// sample data begins with the byte order mark 0xFFFE
+	kQTTextEnc_UTF8					= 7				// sample data begins with the byte order mark 0xEFBBBF
+};
+
+// QuickTime script codes (from Script.h) that select an encoding
+enum {
+	kQTTextEnc_smRoman				= 0,
+	kQTTextEnc_smJapanese			= 1,
+	kQTTextEnc_smTradChinese		= 2,
+	kQTTextEnc_smKorean				= 3,
+	kQTTextEnc_smSimpChinese		= 25
+};
+
+#define kQTTextEnc_MaxUTF8PerByte		3			// worst-case growth when converting one source byte to UTF-8
+#define kQTTextEnc_DefaultCacheSize		(1024L * 1024L)	// default byte budget for a sample cache
+#define kQTTextEnc_ReplacementChar		'?'			// emitted for bytes that cannot be converted
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a cache of converted text samples, keyed by an owner (typically a Media) and a sample number;
+// the least recently used samples are discarded when the cache exceeds its byte budget
+typedef struct QTTextCache			QTTextCache, *QTTextCachePtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+long						QTTextEnc_GetEncodingForScript (short theScript);
+long						QTTextEnc_GetSampleText (const unsigned char *theSample, long theSampleSize, const unsigned char **theText);
+long						QTTextEnc_GetSampleEncoding (long theEncoding, const unsigned char **theText, long *theTextSize);
+long						QTTextEnc_ConvertToUTF8 (long theEncoding, const unsigned char *theSrc, long theSrcSize, char *theDst, long theDstSize);
+long						QTTextEnc_ConvertFromUTF8 (const char *theSrc, long theSrcSize, unsigned char *theDst, long theDstSize);
+
+QTTextCachePtr				QTTextEnc_NewCache (long theMaxBytes);
+void						QTTextEnc_DisposeCache (QTTextCachePtr theCache);
+const char *				QTTextEnc_CacheLookup (QTTextCachePtr theCache, const void *theOwner, long theSampleNum, long *theLength);
+const char *				QTTextEnc_CacheInsert (QTTextCachePtr theCache, const void *theOwner, long theSampleNum, long theEncoding, const unsigned char *theSample, long theSampleSize, long *theLength);
+void						QTTextEnc_CacheFlushOwner (QTTextCachePtr theCache, const void *theOwner);
+void						QTTextEnc_CacheFlushAll (QTTextCachePtr theCache);
+long						QTTextEnc_CacheGetSize (QTTextCachePtr theCache);
+
+#endif	// __QTTextEncoding__
@@ -0,0 +1,323 @@
+//////////
+//
+//	File:		QTTextFile.c
+//
+//	Contains:	Text track, chapter track and HREF track utilities for movie files read without QuickTime.
+//				All utilities start with the prefix "QTTextFile_".
+//
+//	Written by:	QuickTime Team
+//
+//	These are the chapter, HREF and search utilities of QTText.c, rewritten to work on a movie file opened with
+//	QTFile_OpenMovie instead of on a QuickTime movie. They make no QuickTime or Toolbox calls, so a tool that
+//	lists chapters or searches text tracks can run on any platform; for instance, on Linux:
+//
+//		cc -I. -I"Common Files" mytool.c QTTextFile.c QTTextEncoding.c "Common Files/QTFile.c"
+//
+// NOTES:
+//
+// *** (1) ***
+// As in QTText.c, a chapter track is a text track that is the target of a 'chap' track reference of some other
+// track; each sample in the chapter track is a chapter, starting at the sample's time.
+//
+// *** (2) ***
+// Sample text is returned as UTF-8, converted through a cache supplied by the caller (see QTTextEncoding.c);
+// the cache entries are keyed on the QTFileTrack, so flush them (QTTextEnc_CacheFlushAll) before closing the
+// movie if the cache outlives it.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTTextFile.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kFirstScriptFont				16384			// fonts below this number are in the Roman script
+#define kFontsPerScript					512				// each non-Roman script has this many font numbers
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Chapter track utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTextFile_IsChapterTrack
+// Is the specified track a chapter track?
+//
+//////////
+
+int QTTextFile_IsChapterTrack (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack)
+{
+	QTFileTrackPtr		myTrack = NULL;
+	long				myTrackCount = 0;
+	long				myTrRefCount = 0;
+	long				myTrackIndex;
+	long				myTrRefIndex;
+
+	if ((theMovie == NULL) || !QTFile_IsTextTrack(theTrack))
+		return(0);
+
+	// a chapter track is a text track that is referred to by some other track in the movie,
+	// so we need to iterate thru all those tracks to see if any of them refers to the specified track
+	myTrackCount = QTFile_GetTrackCount(theMovie);
+	for (myTrackIndex = 1; myTrackIndex <= myTrackCount; myTrackIndex++) {
+		myTrack = QTFile_GetIndTrack(theMovie, myTrackIndex);
+		if ((myTrack != NULL) && (myTrack != theTrack)) {
+			myTrRefCount = QTFile_GetTrackReferenceCount(myTrack, kQTFile_ChapterListReference);
+			for (myTrRefIndex = 1; myTrRefIndex <= myTrRefCount; myTrRefIndex++)
+				if (QTFile_GetTrackReference(theMovie, myTrack, kQTFile_ChapterListReference, myTrRefIndex) == theTrack)
+					return(1);
+		}
+	}
+
+	return(0);
+}
+
+
+//////////
+//
+// QTTextFile_GetChapterTrackForTrack
+// Return the chapter track for the specified track, or NULL if it has none.
+//
+//////////
+
+QTFileTrackPtr QTTextFile_GetChapterTrackForTrack (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack)
+{
+	return(QTFile_GetTrackReference(theMovie, theTrack, kQTFile_ChapterListReference, 1));
+}
+
+
+//////////
+//
+// QTTextFile_GetChapterTrackForMovie
+// Return the first chapter track in the specified movie, or NULL if it has none.
+//
+//////////
+
+QTFileTrackPtr QTTextFile_GetChapterTrackForMovie (QTFileMoviePtr theMovie)
+{
+	QTFileTrackPtr		myChapTrack = NULL;
+	long				myTrackCount = 0;
+	long				myIndex;
+
+	myTrackCount = QTFile_GetTrackCount(theMovie);
+	for (myIndex = 1; myIndex <= myTrackCount; myIndex++) {
+		myChapTrack = QTTextFile_GetChapterTrackForTrack(theMovie, QTFile_GetIndTrack(theMovie, myIndex));
+		if (myChapTrack != NULL)
+			return(myChapTrack);
+	}
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTTextFile_GetChapterCount
+// Return the number of chapters in the specified chapter track.
+//
+// The chapters are the samples that the track plays, in the order it plays them; a sample that the track's edits
+// leave out (for instance, the old text of an edited chapter) isn't a chapter.
+//
+//////////
+
+long QTTextFile_GetChapterCount (QTFileTrackPtr theChapterTrack)
+{
+	return(QTFile_GetTrackSampleCount(theChapterTrack));
+}
+
+
+//////////
+//
+// QTTextFile_GetIndChapterTime
+// Return the starting time, in movie time, of the chapter in the specified chapter track that has the specified
+// index; return kQTTextFile_BogusTime if there is no such chapter.
+//
+//////////
+
+QTFileTimeValue QTTextFile_GetIndChapterTime (QTFileMoviePtr theMovie, QTFileTrackPtr theChapterTrack, long theIndex)
+{
+	QTFileTimeValue		myTime;
+
+	// track time and movie time are the same thing
+	if ((theMovie == NULL) || (QTFile_GetIndTrackSample(theChapterTrack, theIndex, NULL, &myTime) != kQTFileErr_NoErr))
+		return(kQTTextFile_BogusTime);
+
+	return(myTime);
+}
+
+
+//////////
+//
+// QTTextFile_GetIndChapterText
+// Return the text of the chapter in the specified chapter track that has the specified index, as UTF-8.
+//
+// The caller is responsible for disposing of the pointer returned by this function (by calling free).
+//
+//////////
+
+char *QTTextFile_GetIndChapterText (QTFileMoviePtr theMovie, QTFileTrackPtr theChapterTrack, long theIndex, QTTextCachePtr theCache)
+{
+	const char			*myUTF8 = NULL;
+	char				*myText = NULL;
+	long				mySampleNum;
+	long				myLength = 0;
+
+	if (QTFile_GetIndTrackSample(theChapterTrack, theIndex, &mySampleNum, NULL) != kQTFileErr_NoErr)
+		return(NULL);
+
+	myUTF8 = QTTextFile_GetSampleTextUTF8(theMovie, theChapterTrack, mySampleNum, theCache, &myLength);
+	if (myUTF8 != NULL) {
+		myText = malloc(myLength + 1);
+		if (myText != NULL) {
+			memcpy(myText, myUTF8, myLength);
+			myText[myLength] = '\0';
+		}
+	}
+
+	return(myText);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// HREF track utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTextFile_IsHREFTrack
+// Is the specified track an HREF track?
+//
+//////////
+
+int QTTextFile_IsHREFTrack (QTFileTrackPtr theTrack)
+{
+	if (!QTFile_IsTextTrack(theTrack))
+		return(0);
+
+	return(strcmp(theTrack->fName, kQTTextFile_HREFTrackName) == 0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Text sample utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTextFile_GetTrackEncoding
+// Return the encoding of the text in the samples of the specified text track.
+//
+// For QuickTime text, this is the encoding of the script system of the default font in the sample description
+// (we map font numbers to scripts the way FontToScript does); 3GPP timed text is always UTF-8.
+//
+//////////
+
+long QTTextFile_GetTrackEncoding (QTFileTrackPtr theTrack)
+{
+	short				myScript = kQTTextEnc_smRoman;
+
+	if (theTrack == NULL)
+		return(kQTTextEnc_MacRoman);
+
+	if (theTrack->fDataFormat == kQTFile_TX3GDataFormat)
+		return(kQTTextEnc_UTF8);
+
+	if (theTrack->fFontNumber >= kFirstScriptFont)
+		myScript = (short)(((theTrack->fFontNumber - kFirstScriptFont) / kFontsPerScript) + 1);
+
+	return(QTTextEnc_GetEncodingForScript(myScript));
+}
+
+
+//////////
+//
+// QTTextFile_GetSampleTextUTF8
+// Return the text of the specified sample of the specified text track, as UTF-8; return the length of the text
+// through theLength.
+//
+// The cache must have been created with QTTextEnc_NewCache. The text belongs to the cache; it remains valid until the cache evicts it, which can happen on
+// the next call to this function. Copy it if you need to keep it.
+//
+//////////
+
+const char *QTTextFile_GetSampleTextUTF8 (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, long theSampleNum, QTTextCachePtr theCache, long *theLength)
+{
+	const char			*myText = NULL;
+	const unsigned char	*mySample = NULL;
+	long				mySize = 0;
+
+	if (theLength == NULL)
+		return(NULL);
+
+	*theLength = 0;
+
+	if ((theMovie == NULL) || !QTFile_IsTextTrack(theTrack))
+		return(NULL);
+
+	// if we've already converted this sample, we're done
+	myText = QTTextEnc_CacheLookup(theCache, theTrack, theSampleNum, theLength);
+	if (myText != NULL)
+		return(myText);
+
+	if (QTFile_GetSampleData(theMovie, theTrack, theSampleNum, &mySample, &mySize) != kQTFileErr_NoErr)
+		return(NULL);
+
+	return(QTTextEnc_CacheInsert(theCache, theTrack, theSampleNum, QTTextFile_GetTrackEncoding(theTrack), mySample, mySize, theLength));
+}
+
+
+//////////
+//
+// QTTextFile_FindText
+// Search the samples of the specified text track, starting at the specified sample number, for the specified
+// UTF-8 text; return the number of the first sample that contains the text, or 0 if none does.
+//
+// As with QTText_FindText, the search is case-sensitive.
+//
+//////////
+
+long QTTextFile_FindText (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, long theSampleNum, const char *theText, QTTextCachePtr theCache)
+{
+	const char			*mySample = NULL;
+	long				mySampleCount;
+	long				myTextLength;
+	long				myLength;
+	long				myIndex;
+	long				myOffset;
+
+	if ((theText == NULL) || (theSampleNum < 1))
+		return(0);
+
+	myTextLength = (long)strlen(theText);
+	mySampleCount = QTFile_GetSampleCount(theTrack);
+
+	for (myIndex = theSampleNum; myIndex <= mySampleCount; myIndex++) {
+		mySample = QTTextFile_GetSampleTextUTF8(theMovie, theTrack, myIndex, theCache, &myLength);
+		if (mySample == NULL)
+			continue;
+
+		// the sample text is not null-terminated, so we can't use strstr
+		for (myOffset = 0; myOffset + myTextLength <= myLength; myOffset++)
+			if (memcmp(mySample + myOffset, theText, myTextLength) == 0)
+				return(myIndex);
+	}
+
+	return(0);
+}
@@ -0,0 +1,61 @@
+//////////
+//
+//	File:		QTTextFile.h
+//
+//	Contains:	Text track, chapter track and HREF track utilities for movie files read without QuickTime.
+//				All utilities start with the prefix "QTTextFile_".
+//
+//	Written by:	QuickTime Team
+//
+//////////
+
+#pragma once
+
+#ifndef __QTTextFile__
+#define __QTTextFile__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#ifndef __QTFile__
+#include "QTFile.h"
+#endif
+
+#ifndef __QTTextEncoding__
+#include "QTTextEncoding.h"
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kQTTextFile_HREFTrackName		"HREFTrack"		// the name of an HREF track (as kHREFTrackName in QTText.h)
+#define kQTTextFile_BogusTime			-1				// returned if there's no such chapter (as kBogusStartingTime)
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+int							QTTextFile_IsChapterTrack (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack);
+QTFileTrackPtr				QTTextFile_GetChapterTrackForTrack (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack);
+QTFileTrackPtr				QTTextFile_GetChapterTrackForMovie (QTFileMoviePtr theMovie);
+long						QTTextFile_GetChapterCount (QTFileTrackPtr theChapterTrack);
+QTFileTimeValue				QTTextFile_GetIndChapterTime (QTFileMoviePtr theMovie, QTFileTrackPtr theChapterTrack, long theIndex);
+char *						QTTextFile_GetIndChapterText (QTFileMoviePtr theMovie, QTFileTrackPtr theChapterTrack, long theIndex, QTTextCachePtr theCache);
+int							QTTextFile_IsHREFTrack (QTFileTrackPtr theTrack);
+
+long						QTTextFile_GetTrackEncoding (QTFileTrackPtr theTrack);
+const char *				QTTextFile_GetSampleTextUTF8 (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, long theSampleNum, QTTextCachePtr theCache, long *theLength);
+long						QTTextFile_FindText (QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, long theSampleNum, const char *theText, QTTextCachePtr theCache);
+
+#endif	// __QTTextFile__
@@ -0,0 +1,1362 @@
+//////////
+//
+//	File:		QTTextIndex.c
+//
+//	Contains:	Building an index of the text, chapter and HREF tracks of all the movie files in a directory tree.
+//				All utilities start with the prefix "QTIndex_".
+//
+//	Written by:	QuickTime Team
+//
+//	This file builds on QTTextFile.c and, like it, makes no QuickTime or Toolbox calls; QTTextIndexTool.c is
+//	a command-line tool that calls it. On Linux, for instance:
+//
+//		cc -O2 -I. -I"Common Files" -o qttextindex QTTextIndexTool.c QTTextIndex.c QTTextFile.c QTTextEncoding.c "Common Files/QTFile.c" -lpthread
+//
+// NOTES:
+//
+// *** (1) ***
+// The index is a UTF-8 text file with one record per line; the fields of a record are separated by tabs. For
+// each movie file, in no particular order, the index contains these records:
+//
+//		movie	<path>	<duration>						(or: failed	<path>	<error>, if the file isn't a movie)
+//		track	<track ID>	<kind>	<track name>		(for each text track; kind is text, chapter or href)
+//		<kind>	<start time>	<text or URL>			(for each non-empty sample of the track)
+//		done	<path>
+//
+// Times are in milliseconds. Tabs, line breaks and backslashes in paths and text are written as \t, \n, \r and
+// \\; other control characters are written as spaces.
+//
+// *** (2) ***
+// We find all the movie files first (the walk keeps only one directory open at a time), sort them, and then
+// hand them to a set of worker threads, each with a contiguous range of the list. A worker indexes its own
+// range from the front; once it's done, it steals the back half of the remaining range of another worker, so
+// that a few very big movies in one corner of the library don't hold up the whole run. Each worker formats
+// the records of a movie in its own buffer and appends them to the index in one piece, so the records of
+// different movies never interleave.
+//
+// *** (3) ***
+// Each worker has at most one movie file open, so the number of open files is bounded by the number of
+// workers plus the index file; we run fewer workers if the caller asks for a lower limit.
+//
+// *** (4) ***
+// A movie is in the index once its "done" record is. If an earlier run was interrupted, we cut the index off
+// after its last "done" record (throwing away any partial records of the movie being written at the time),
+// skip the movies already indexed, and add the rest to the end of the index.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#if !defined(_WIN32)
+#define _FILE_OFFSET_BITS				64				// for index files larger than 2 GB
+#endif
+
+#include "QTTextIndex.h"
+
+#include <stdio.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kInitialListSize				1024			// initial number of items in a list of paths
+#define kPollInterval					100				// milliseconds between checks for the end of the workers
+#define kMaxNumberSize					24				// room for a 64-bit decimal number
+#define kMaxDoneLineSize				((2 * kQTIndex_MaxPathSize) + 16)	// longest "done" record we recognize
+
+#define kMovieRecord					"movie"
+#define kFailedRecord					"failed"
+#define kTrackRecord					"track"
+#define kDoneRecord						"done"
+#define kTextRecord						"text"
+#define kChapterRecord					"chapter"
+#define kHREFRecord						"href"
+
+#if defined(_WIN32)
+#define kPathSeparator					'\\'
+#else
+#define kPathSeparator					'/'
+#endif
+
+
+//////////
+//
+// data types
+//
+//////////
+
+#if defined(_WIN32)
+typedef HANDLE							QTIndexThread;
+typedef CRITICAL_SECTION				QTIndexLock;
+#else
+typedef pthread_t						QTIndexThread;
+typedef pthread_mutex_t					QTIndexLock;
+#endif
+
+// a growable buffer of index records
+typedef struct QTIndexBuffer {
+	char							*fData;			// the records
+	long							fLength;		// the number of bytes in the buffer
+	long							fSize;			// the size of fData
+	int								fFailed;		// did we run out of memory?
+} QTIndexBuffer, *QTIndexBufferPtr;
+
+// an indexer; the fields from fIndexFile on are shared by the workers, and guarded by fLock
+typedef struct QTIndexer {
+	QTIndexList						fMovies;		// the paths of the movie files to index, sorted
+	struct QTIndexWorker			*fWorkers;		// the worker threads
+	long							fWorkerCount;	// the number of worker threads
+	QTIndexLock						fLock;
+	FILE							*fIndexFile;	// the index
+	long							fError;			// the first error writing the index
+	long							fActiveCount;	// the number of workers still running
+	QTIndexStats					fStats;			// the progress so far
+} QTIndexer, *QTIndexerPtr;
+
+// a worker thread; fNext and fEnd are guarded by fLock, since other workers can steal from the range
+typedef struct QTIndexWorker {
+	QTIndexerPtr					fIndexer;		// the indexer this worker belongs to
+	long							fNumber;		// the index of this worker in the indexer's fWorkers
+	QTIndexThread					fThread;		// the thread
+	QTIndexLock						fLock;
+	long							fNext;			// the index in fMovies of the next movie to index
+	long							fEnd;			// the index in fMovies just past the last movie to index
+	QTTextCachePtr					fCache;			// the cache for converting sample text to UTF-8
+	QTIndexBuffer					fRecords;		// the records of the movie being indexed
+} QTIndexWorker, *QTIndexWorkerPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTIndex_RunWorker (QTIndexWorkerPtr theWorker);
+static int					QTIndex_GetWork (QTIndexWorkerPtr theWorker, long *theIndex);
+static void					QTIndex_IndexMovie (QTIndexWorkerPtr theWorker, const char *thePath, long *theTrackCount, long *theSampleCount, int *wasFailed);
+static void					QTIndex_IndexTrack (QTIndexWorkerPtr theWorker, QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, long *theSampleCount);
+static long					QTIndex_WriteRecords (QTIndexWorkerPtr theWorker, long theTrackCount, long theSampleCount, int wasFailed);
+static const char *			QTIndex_GetURL (const char *theText, long theLength, long *theURLLength);
+static long					QTIndex_TimeToMilliseconds (QTFileTimeValue theTime, long theTimeScale);
+static long					QTIndex_ReadDirectory (const char *theDirPath, QTIndexListPtr theDirs, QTIndexListPtr theMovies);
+static int					QTIndex_MakePath (char *thePath, const char *theDirPath, const char *theName);
+static int					QTIndex_IsMovieFile (const char *theName);
+static long					QTIndex_ReadIndex (const char *theIndexPath, QTIndexListPtr theDone);
+static long					QTIndex_TruncateFile (const char *thePath, QTFileUInt64 theSize);
+static long					QTIndex_RemoveDone (QTIndexListPtr theMovies, const QTIndexList *theDone);
+static long					QTIndex_AddToList (QTIndexListPtr theList, const char *thePath);
+static int					QTIndex_ComparePaths (const void *theFirst, const void *theSecond);
+static void					QTIndex_Append (QTIndexBufferPtr theBuffer, const char *theData, long theLength);
+static void					QTIndex_AppendEscaped (QTIndexBufferPtr theBuffer, const char *theText, long theLength);
+static void					QTIndex_AppendNumber (QTIndexBufferPtr theBuffer, QTFileInt64 theNumber);
+static void					QTIndex_AppendField (QTIndexBufferPtr theBuffer, const char *theText, long theLength, int isLast);
+static long					QTIndex_Unescape (const char *theText, long theLength, char *theDst);
+#if defined(_WIN32)
+static DWORD WINAPI			QTIndex_ThreadEntry (LPVOID theWorker);
+#else
+static void *				QTIndex_ThreadEntry (void *theWorker);
+#endif
+static int					QTIndex_StartThread (QTIndexWorkerPtr theWorker);
+static void					QTIndex_WaitThread (QTIndexThread theThread);
+static void					QTIndex_InitLock (QTIndexLock *theLock);
+static void					QTIndex_DisposeLock (QTIndexLock *theLock);
+static void					QTIndex_Lock (QTIndexLock *theLock);
+static void					QTIndex_Unlock (QTIndexLock *theLock);
+static unsigned long		QTIndex_GetMilliseconds (void);
+static void					QTIndex_Sleep (long theMilliseconds);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Indexing utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTIndex_IndexDirectory
+// Add the text, chapter and HREF tracks of all the movie files in the directory tree at theDirPath to the
+// index at theIndexPath, using the specified number of worker threads (or one per processor, if theThreadCount
+// is 0) and keeping at most theMaxOpenFiles files open at once (or kQTIndex_DefaultMaxOpenFiles, if it's 0).
+//
+// If the index already exists, the movies already in it are skipped; see note (4). theProgressProc, if it isn't
+// NULL, is called about once every kQTIndex_ProgressInterval milliseconds, and once more at the end; theStats,
+// if it isn't NULL, receives the final progress.
+//
+//////////
+
+long QTIndex_IndexDirectory (const char *theDirPath, const char *theIndexPath, long theThreadCount, long theMaxOpenFiles, QTIndexProgressProcPtr theProgressProc, void *theRefCon, QTIndexStatsPtr theStats)
+{
+	QTIndexer			myIndexer;
+	QTIndexList			myDone;
+	QTIndexStats		myStats;
+	unsigned long		myStartTime = QTIndex_GetMilliseconds();
+	unsigned long		myReportTime = myStartTime;
+	long				myStartCount = 0;
+	long				myActiveCount;
+	long				myIndex;
+	long				myErr = kQTFileErr_NoErr;
+
+	memset(&myIndexer, 0, sizeof(myIndexer));
+	memset(&myDone, 0, sizeof(myDone));
+
+	if (theStats != NULL)
+		memset(theStats, 0, sizeof(QTIndexStats));
+
+	if ((theDirPath == NULL) || (theIndexPath == NULL))
+		return(kQTFileErr_Param);
+
+	// each worker keeps one movie file open; see note (3)
+	if (theThreadCount <= 0)
+		theThreadCount = QTIndex_GetProcessorCount();
+
+	if (theMaxOpenFiles <= 0)
+		theMaxOpenFiles = kQTIndex_DefaultMaxOpenFiles;
+
+	if (theThreadCount > theMaxOpenFiles - kQTIndex_ReservedFiles)
+		theThreadCount = theMaxOpenFiles - kQTIndex_ReservedFiles;
+
+	if (theThreadCount > kQTIndex_MaxThreads)
+		theThreadCount = kQTIndex_MaxThreads;
+
+	if (theThreadCount < 1)
+		theThreadCount = 1;
+
+	// find out what's left to do
+	myErr = QTIndex_ReadIndex(theIndexPath, &myDone);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	myErr = QTIndex_FindMovies(theDirPath, &myIndexer.fMovies);
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	myIndexer.fStats.fMovieCount = myIndexer.fMovies.fCount;
+	myIndexer.fStats.fSkippedCount = QTIndex_RemoveDone(&myIndexer.fMovies, &myDone);
+	myIndexer.fStats.fThreadCount = theThreadCount;
+
+	myIndexer.fIndexFile = fopen(theIndexPath, "ab");
+	if (myIndexer.fIndexFile == NULL) {
+		myErr = kQTFileErr_IO;
+		goto bail;
+	}
+
+	// set up the workers, and give each of them an equal share of the movies
+	myIndexer.fWorkers = (QTIndexWorkerPtr)calloc(theThreadCount, sizeof(QTIndexWorker));
+	if (myIndexer.fWorkers == NULL) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	QTIndex_InitLock(&myIndexer.fLock);
+
+	for (myIndex = 0; myIndex < theThreadCount; myIndex++) {
+		QTIndexWorkerPtr	myWorker = &myIndexer.fWorkers[myIndex];
+
+		myWorker->fIndexer = &myIndexer;
+		myWorker->fNumber = myIndex;
+		myWorker->fNext = (long)(((QTFileInt64)myIndexer.fMovies.fCount * myIndex) / theThreadCount);
+		myWorker->fEnd = (long)(((QTFileInt64)myIndexer.fMovies.fCount * (myIndex + 1)) / theThreadCount);
+		QTIndex_InitLock(&myWorker->fLock);
+
+		myWorker->fCache = QTTextEnc_NewCache(kQTTextEnc_DefaultCacheSize);
+		if (myWorker->fCache == NULL)
+			myErr = kQTFileErr_MemFull;
+	}
+
+	myIndexer.fWorkerCount = theThreadCount;
+	if (myErr != kQTFileErr_NoErr)
+		goto bail;
+
+	// start the workers; any work of a worker that doesn't start is stolen by the others
+	myIndexer.fActiveCount = theThreadCount;
+	for (myStartCount = 0; myStartCount < theThreadCount; myStartCount++)
+		if (!QTIndex_StartThread(&myIndexer.fWorkers[myStartCount]))
+			break;
+
+	// if no thread starts at all, we do the work ourselves
+	if (myStartCount == 0) {
+		myIndexer.fActiveCount = 1;
+		myIndexer.fStats.fThreadCount = 1;
+		QTIndex_RunWorker(&myIndexer.fWorkers[0]);
+	} else if (myStartCount < theThreadCount) {
+		QTIndex_Lock(&myIndexer.fLock);
+		myIndexer.fActiveCount -= theThreadCount - myStartCount;
+		myIndexer.fStats.fThreadCount = myStartCount;
+		QTIndex_Unlock(&myIndexer.fLock);
+	}
+
+	// report on the progress of the workers until they're all done
+	do {
+		QTIndex_Sleep(kPollInterval);
+
+		QTIndex_Lock(&myIndexer.fLock);
+		myActiveCount = myIndexer.fActiveCount;
+		myIndexer.fStats.fElapsed = (long)(QTIndex_GetMilliseconds() - myStartTime);
+		myStats = myIndexer.fStats;
+		QTIndex_Unlock(&myIndexer.fLock);
+
+		if ((theProgressProc != NULL) && (myActiveCount > 0) && (QTIndex_GetMilliseconds() - myReportTime >= kQTIndex_ProgressInterval)) {
+			(*theProgressProc)(theRefCon, &myStats);
+			myReportTime = QTIndex_GetMilliseconds();
+		}
+	} while (myActiveCount > 0);
+
+	for (myIndex = 0; myIndex < myStartCount; myIndex++)
+		QTIndex_WaitThread(myIndexer.fWorkers[myIndex].fThread);
+
+	myErr = myIndexer.fError;
+
+bail:
+	myIndexer.fStats.fElapsed = (long)(QTIndex_GetMilliseconds() - myStartTime);
+	if (theProgressProc != NULL)
+		(*theProgressProc)(theRefCon, &myIndexer.fStats);
+
+	if (theStats != NULL)
+		*theStats = myIndexer.fStats;
+
+	if (myIndexer.fWorkers != NULL) {
+		for (myIndex = 0; myIndex < myIndexer.fWorkerCount; myIndex++) {
+			QTIndexWorkerPtr	myWorker = &myIndexer.fWorkers[myIndex];
+
+			if (myWorker->fCache != NULL)
+				QTTextEnc_DisposeCache(myWorker->fCache);
+
+			free(myWorker->fRecords.fData);
+			QTIndex_DisposeLock(&myWorker->fLock);
+		}
+
+		QTIndex_DisposeLock(&myIndexer.fLock);
+		free(myIndexer.fWorkers);
+	}
+
+	if ((myIndexer.fIndexFile != NULL) && (fclose(myIndexer.fIndexFile) != 0) && (myErr == kQTFileErr_NoErr))
+		myErr = kQTFileErr_IO;
+
+	QTIndex_DisposeList(&myIndexer.fMovies);
+	QTIndex_DisposeList(&myDone);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTIndex_GetProcessorCount
+// Return the number of processors in this computer.
+//
+//////////
+
+long QTIndex_GetProcessorCount (void)
+{
+	long				myCount;
+
+#if defined(_WIN32)
+	SYSTEM_INFO			mySystemInfo;
+
+	GetSystemInfo(&mySystemInfo);
+	myCount = (long)mySystemInfo.dwNumberOfProcessors;
+#else
+	myCount = (long)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	return((myCount > 0) ? myCount : 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Worker utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTIndex_RunWorker
+// Index movies until there are none left (or until the index can't be written).
+//
+//////////
+
+static void QTIndex_RunWorker (QTIndexWorkerPtr theWorker)
+{
+	QTIndexerPtr		myIndexer = theWorker->fIndexer;
+	long				myIndex;
+	long				myTrackCount;
+	long				mySampleCount;
+	int					wasFailed;
+
+	while (QTIndex_GetWork(theWorker, &myIndex)) {
+		QTIndex_IndexMovie(theWorker, myIndexer->fMovies.fItems[myIndex], &myTrackCount, &mySampleCount, &wasFailed);
+		if (QTIndex_WriteRecords(theWorker, myTrackCount, mySampleCount, wasFailed) != kQTFileErr_NoErr)
+			break;
+	}
+
+	QTIndex_Lock(&myIndexer->fLock);
+	myIndexer->fActiveCount--;
+	QTIndex_Unlock(&myIndexer->fLock);
+}
+
+
+//////////
+//
+// QTIndex_GetWork
+// Return, through theIndex, the index of the next movie that the specified worker should index; return 0 if
+// there are no movies left.
+//
+//////////
+
+static int QTIndex_GetWork (QTIndexWorkerPtr theWorker, long *theIndex)
+{
+	QTIndexerPtr		myIndexer = theWorker->fIndexer;
+	long				myCount;
+
+	// take the next movie in our own range, if there is one
+	QTIndex_Lock(&theWorker->fLock);
+	if (theWorker->fNext < theWorker->fEnd) {
+		*theIndex = theWorker->fNext++;
+		QTIndex_Unlock(&theWorker->fLock);
+		return(1);
+	}
+	QTIndex_Unlock(&theWorker->fLock);
+
+	// otherwise, steal the back half of the range of the next worker that has any movies left
+	for (myCount = 1; myCount < myIndexer->fWorkerCount; myCount++) {
+		QTIndexWorkerPtr	myVictim = &myIndexer->fWorkers[(theWorker->fNumber + myCount) % myIndexer->fWorkerCount];
+		long				myBegin;
+		long				myEnd;
+
+		QTIndex_Lock(&myVictim->fLock);
+		myBegin = myVictim->fNext + ((myVictim->fEnd - myVictim->fNext) / 2);
+		myEnd = myVictim->fEnd;
+		myVictim->fEnd = myBegin;
+		QTIndex_Unlock(&myVictim->fLock);
+
+		if (myBegin < myEnd) {
+			QTIndex_Lock(&theWorker->fLock);
+			theWorker->fNext = myBegin + 1;
+			theWorker->fEnd = myEnd;
+			QTIndex_Unlock(&theWorker->fLock);
+
+			*theIndex = myBegin;
+			return(1);
+		}
+	}
+
+	return(0);
+}
+
+
+//////////
+//
+// QTIndex_IndexMovie
+// Format the index records of the movie file at the specified path in the record buffer of the specified worker.
+//
+//////////
+
+static void QTIndex_IndexMovie (QTIndexWorkerPtr theWorker, const char *thePath, long *theTrackCount, long *theSampleCount, int *wasFailed)
+{
+	QTIndexBufferPtr	myRecords = &theWorker->fRecords;
+	QTFileMoviePtr		myMovie = NULL;
+	QTFileTrackPtr		myTrack = NULL;
+	long				myPathLength = (long)strlen(thePath);
+	long				myIndex;
+	long				myErr = kQTFileErr_NoErr;
+
+	*theTrackCount = 0;
+	*theSampleCount = 0;
+	*wasFailed = 0;
+
+	myRecords->fLength = 0;
+	myRecords->fFailed = 0;
+
+	myErr = QTFile_OpenMovie(thePath, &myMovie);
+	if (myErr != kQTFileErr_NoErr) {
+		QTIndex_AppendField(myRecords, kFailedRecord, -1, 0);
+		QTIndex_AppendField(myRecords, thePath, myPathLength, 0);
+		QTIndex_AppendNumber(myRecords, myErr);
+		QTIndex_Append(myRecords, "\n", 1);
+		*wasFailed = 1;
+	} else {
+		QTIndex_AppendField(myRecords, kMovieRecord, -1, 0);
+		QTIndex_AppendField(myRecords, thePath, myPathLength, 0);
+		QTIndex_AppendNumber(myRecords, QTIndex_TimeToMilliseconds(myMovie->fDuration, myMovie->fTimeScale));
+		QTIndex_Append(myRecords, "\n", 1);
+
+		for (myIndex = 1; myIndex <= QTFile_GetTrackCount(myMovie); myIndex++) {
+			myTrack = QTFile_GetIndTrack(myMovie, myIndex);
+			if (!QTFile_IsTextTrack(myTrack))
+				continue;
+
+			QTIndex_IndexTrack(theWorker, myMovie, myTrack, theSampleCount);
+			(*theTrackCount)++;
+		}
+
+		// the cache entries are keyed on the tracks, which are about to go away
+		QTTextEnc_CacheFlushAll(theWorker->fCache);
+		QTFile_CloseMovie(myMovie);
+	}
+
+	QTIndex_AppendField(myRecords, kDoneRecord, -1, 0);
+	QTIndex_AppendField(myRecords, thePath, myPathLength, 1);
+}
+
+
+//////////
+//
+// QTIndex_IndexTrack
+// Format the index records of the specified text track in the record buffer of the specified worker, and add
+// the number of samples indexed to theSampleCount.
+//
+//////////
+
+static void QTIndex_IndexTrack (QTIndexWorkerPtr theWorker, QTFileMoviePtr theMovie, QTFileTrackPtr theTrack, long *theSampleCount)
+{
+	QTIndexBufferPtr	myRecords = &theWorker->fRecords;
+	const char			*myKind = kTextRecord;
+	const char			*myText = NULL;
+	int					isHREFTrack = QTTextFile_IsHREFTrack(theTrack);
+	QTFileTimeValue		myTime;
+	long				mySampleNum;
+	long				myLength;
+	long				mySampleCount;
+	long				myIndex;
+
+	if (isHREFTrack)
+		myKind = kHREFRecord;
+	else if (QTTextFile_IsChapterTrack(theMovie, theTrack))
+		myKind = kChapterRecord;
+
+	QTIndex_AppendField(myRecords, kTrackRecord, -1, 0);
+	QTIndex_AppendNumber(myRecords, theTrack->fTrackID);
+	QTIndex_Append(myRecords, "\t", 1);
+	QTIndex_AppendField(myRecords, myKind, -1, 0);
+	QTIndex_AppendField(myRecords, theTrack->fName, -1, 1);
+
+	// read all the text in one batch, rather than one sample at a time; if we can't, we still get it sample by sample
+	QTFile_LoadTrackData(theMovie, theTrack);
+
+	// index the samples that the track plays, when it plays them; an edited sample's old text isn't indexed
+	mySampleCount = QTFile_GetTrackSampleCount(theTrack);
+	for (myIndex = 1; myIndex <= mySampleCount; myIndex++) {
+		if (QTFile_GetIndTrackSample(theTrack, myIndex, &mySampleNum, &myTime) != kQTFileErr_NoErr)
+			break;
+
+		myText = QTTextFile_GetSampleTextUTF8(theMovie, theTrack, mySampleNum, theWorker->fCache, &myLength);
+		if ((myText != NULL) && isHREFTrack)
+			myText = QTIndex_GetURL(myText, myLength, &myLength);
+
+		if ((myText == NULL) || (myLength == 0))
+			continue;
+
+		QTIndex_AppendField(myRecords, myKind, -1, 0);
+		QTIndex_AppendNumber(myRecords, QTIndex_TimeToMilliseconds(myTime, theMovie->fTimeScale));
+		QTIndex_Append(myRecords, "\t", 1);
+		QTIndex_AppendField(myRecords, myText, myLength, 1);
+		(*theSampleCount)++;
+	}
+}
+
+
+//////////
+//
+// QTIndex_WriteRecords
+// Append the records in the record buffer of the specified worker to the index, and update the progress.
+//
+//////////
+
+static long QTIndex_WriteRecords (QTIndexWorkerPtr theWorker, long theTrackCount, long theSampleCount, int wasFailed)
+{
+	QTIndexerPtr		myIndexer = theWorker->fIndexer;
+	QTIndexBufferPtr	myRecords = &theWorker->fRecords;
+	long				myErr = kQTFileErr_NoErr;
+
+	QTIndex_Lock(&myIndexer->fLock);
+
+	if (myIndexer->fError == kQTFileErr_NoErr) {
+		if (myRecords->fFailed)
+			myIndexer->fError = kQTFileErr_MemFull;
+		else if ((fwrite(myRecords->fData, 1, myRecords->fLength, myIndexer->fIndexFile) != (size_t)myRecords->fLength) || (fflush(myIndexer->fIndexFile) != 0))
+			myIndexer->fError = kQTFileErr_IO;
+	}
+
+	myErr = myIndexer->fError;
+	if (myErr == kQTFileErr_NoErr) {
+		myIndexer->fStats.fIndexedCount++;
+		myIndexer->fStats.fTrackCount += theTrackCount;
+		myIndexer->fStats.fSampleCount += theSampleCount;
+		myIndexer->fStats.fBytesWritten += myRecords->fLength;
+		if (wasFailed)
+			myIndexer->fStats.fFailedCount++;
+	}
+
+	QTIndex_Unlock(&myIndexer->fLock);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTIndex_GetURL
+// Return the URL in the specified HREF track sample text, and its length through theURLLength.
+//
+// An HREF sample is a URL in angle brackets, possibly followed by a target frame ("<http://...> T<frame>");
+// we also accept a bare URL.
+//
+//////////
+
+static const char *QTIndex_GetURL (const char *theText, long theLength, long *theURLLength)
+{
+	const char			*myEnd = theText + theLength;
+	const char			*myURL = NULL;
+
+	while ((theText < myEnd) && ((*theText == ' ') || (*theText == '\t') || (*theText == '\r') || (*theText == '\n')))
+		theText++;
+
+	if ((theText < myEnd) && (*theText == '<')) {
+		myURL = ++theText;
+		while ((theText < myEnd) && (*theText != '>'))
+			theText++;
+	} else {
+		myURL = theText;
+		while ((theText < myEnd) && (*theText != ' ') && (*theText != '\t') && (*theText != '\r') && (*theText != '\n'))
+			theText++;
+	}
+
+	*theURLLength = (long)(theText - myURL);
+	return(myURL);
+}
+
+
+//////////
+//
+// QTIndex_TimeToMilliseconds
+// Convert the specified time, in the specified time scale, to milliseconds.
+//
+//////////
+
+static long QTIndex_TimeToMilliseconds (QTFileTimeValue theTime, long theTimeScale)
+{
+	if (theTimeScale <= 0)
+		return(0);
+
+	// convert whole seconds and the remainder separately, so that long movies don't overflow
+	return((long)(((theTime / theTimeScale) * 1000) + (((theTime % theTimeScale) * 1000) / theTimeScale)));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTIndex_FindMovies
+// Add the paths of all the movie files in the directory tree at theDirPath to theMovies, and sort them.
+//
+//////////
+
+long QTIndex_FindMovies (const char *theDirPath, QTIndexListPtr theMovies)
+{
+	QTIndexList			myDirs;
+	char				*myDirPath = NULL;
+	long				myErr = kQTFileErr_NoErr;
+
+	memset(&myDirs, 0, sizeof(myDirs));
+
+	myErr = QTIndex_ReadDirectory(theDirPath, &myDirs, theMovies);
+
+	// walk the tree depth-first, with only one directory open at a time; skip directories we can't read
+	while ((myErr == kQTFileErr_NoErr) && (myDirs.fCount > 0)) {
+		myDirPath = myDirs.fItems[--myDirs.fCount];
+		myErr = QTIndex_ReadDirectory(myDirPath, &myDirs, theMovies);
+		if (myErr == kQTFileErr_FileNotFound)
+			myErr = kQTFileErr_NoErr;
+
+		free(myDirPath);
+	}
+
+	QTIndex_DisposeList(&myDirs);
+
+	if ((myErr == kQTFileErr_NoErr) && (theMovies->fCount > 1))
+		qsort(theMovies->fItems, theMovies->fCount, sizeof(char *), QTIndex_ComparePaths);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTIndex_ReadDirectory
+// Add the paths of the subdirectories of the directory at theDirPath to theDirs, and the paths of the movie files
+// in it to theMovies.
+//
+// We don't follow symbolic links (or, on Windows, other reparse points), so we can't walk around in circles.
+//
+//////////
+
+static long QTIndex_ReadDirectory (const char *theDirPath, QTIndexListPtr theDirs, QTIndexListPtr theMovies)
+{
+	char				myPath[kQTIndex_MaxPathSize];
+	long				myErr = kQTFileErr_NoErr;
+#if defined(_WIN32)
+	WIN32_FIND_DATAA	myData;
+	HANDLE				myFind;
+
+	if (!QTIndex_MakePath(myPath, theDirPath, "*"))
+		return(kQTFileErr_FileNotFound);
+
+	myFind = FindFirstFileA(myPath, &myData);
+	if (myFind == INVALID_HANDLE_VALUE)
+		return(kQTFileErr_FileNotFound);
+
+	do {
+		if ((strcmp(myData.cFileName, ".") == 0) || (strcmp(myData.cFileName, "..") == 0))
+			continue;
+
+		if ((myData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) || !QTIndex_MakePath(myPath, theDirPath, myData.cFileName))
+			continue;
+
+		if (myData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			myErr = QTIndex_AddToList(theDirs, myPath);
+		else if (QTIndex_IsMovieFile(myData.cFileName))
+			myErr = QTIndex_AddToList(theMovies, myPath);
+	} while ((myErr == kQTFileErr_NoErr) && FindNextFileA(myFind, &myData));
+
+	FindClose(myFind);
+#else
+	DIR					*myDir = NULL;
+	struct dirent		*myEntry = NULL;
+	struct stat			myStat;
+
+	myDir = opendir(theDirPath);
+	if (myDir == NULL)
+		return(kQTFileErr_FileNotFound);
+
+	while ((myErr == kQTFileErr_NoErr) && ((myEntry = readdir(myDir)) != NULL)) {
+		if ((strcmp(myEntry->d_name, ".") == 0) || (strcmp(myEntry->d_name, "..") == 0))
+			continue;
+
+		if (!QTIndex_MakePath(myPath, theDirPath, myEntry->d_name) || (lstat(myPath, &myStat) != 0))
+			continue;
+
+		if (S_ISDIR(myStat.st_mode))
+			myErr = QTIndex_AddToList(theDirs, myPath);
+		else if (S_ISREG(myStat.st_mode) && QTIndex_IsMovieFile(myEntry->d_name))
+			myErr = QTIndex_AddToList(theMovies, myPath);
+	}
+
+	closedir(myDir);
+#endif
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTIndex_MakePath
+// Put the path of the item having the specified name in the directory at theDirPath into thePath, which has room
+// for kQTIndex_MaxPathSize bytes; return 0 if the path doesn't fit.
+//
+//////////
+
+static int QTIndex_MakePath (char *thePath, const char *theDirPath, const char *theName)
+{
+	size_t				myDirLength = strlen(theDirPath);
+	size_t				myNameLength = strlen(theName);
+	int					needSeparator = (myDirLength > 0) && (theDirPath[myDirLength - 1] != kPathSeparator);
+
+	if (myDirLength + needSeparator + myNameLength >= kQTIndex_MaxPathSize)
+		return(0);
+
+	memcpy(thePath, theDirPath, myDirLength);
+	if (needSeparator)
+		thePath[myDirLength++] = kPathSeparator;
+
+	memcpy(thePath + myDirLength, theName, myNameLength + 1);
+	return(1);
+}
+
+
+//////////
+//
+// QTIndex_IsMovieFile
+// Does the specified file name have one of the extensions of the movie files we index?
+//
+//////////
+
+static int QTIndex_IsMovieFile (const char *theName)
+{
+	static const char	*myExtensions[] = {"mov", "qt", "mp4", "m4v", "m4a", "3gp", "3g2", NULL};
+	const char			*myExtension = strrchr(theName, '.');
+	char				myLowerCase[4];
+	long				myIndex;
+
+	if ((myExtension == NULL) || (strlen(++myExtension) >= sizeof(myLowerCase)))
+		return(0);
+
+	for (myIndex = 0; myExtension[myIndex] != '\0'; myIndex++)
+		myLowerCase[myIndex] = ((myExtension[myIndex] >= 'A') && (myExtension[myIndex] <= 'Z')) ? myExtension[myIndex] - 'A' + 'a' : myExtension[myIndex];
+	myLowerCase[myIndex] = '\0';
+
+	for (myIndex = 0; myExtensions[myIndex] != NULL; myIndex++)
+		if (strcmp(myLowerCase, myExtensions[myIndex]) == 0)
+			return(1);
+
+	return(0);
+}
+
+
+//////////
+//
+// QTIndex_ReadIndex
+// Add the paths of the movies already in the index at theIndexPath to theDone, and sort them; cut the index off
+// after its last "done" record. It's not an error if there's no index yet.
+//
+//////////
+
+static long QTIndex_ReadIndex (const char *theIndexPath, QTIndexListPtr theDone)
+{
+	FILE				*myFile = NULL;
+	char				*myLine = NULL;
+	char				*myPath = NULL;
+	QTFileUInt64		myOffset = 0;
+	QTFileUInt64		myDoneOffset = 0;
+	long				myPrefixLength = (long)strlen(kDoneRecord "\t");
+	long				myLength;
+	int					atLineStart = 1;
+	int					isDoneLine = 0;
+	long				myErr = kQTFileErr_NoErr;
+
+	myFile = fopen(theIndexPath, "rb");
+	if (myFile == NULL)
+		return(kQTFileErr_NoErr);
+
+	myLine = (char *)malloc(kMaxDoneLineSize);
+	myPath = (char *)malloc(kMaxDoneLineSize);
+	if ((myLine == NULL) || (myPath == NULL)) {
+		myErr = kQTFileErr_MemFull;
+		goto bail;
+	}
+
+	// read the index a piece at a time; a "done" record always fits in one piece, but other records may not
+	while (fgets(myLine, kMaxDoneLineSize, myFile) != NULL) {
+		myLength = (long)strlen(myLine);
+		myOffset += myLength;
+
+		if (atLineStart)
+			isDoneLine = (strncmp(myLine, kDoneRecord "\t", myPrefixLength) == 0);
+
+		atLineStart = (myLength > 0) && (myLine[myLength - 1] == '\n');
+		if (!atLineStart) {
+			isDoneLine = 0;
+			continue;
+		}
+
+		if (isDoneLine) {
+			myLength = QTIndex_Unescape(myLine + myPrefixLength, myLength - myPrefixLength - 1, myPath);
+			myPath[myLength] = '\0';
+
+			myErr = QTIndex_AddToList(theDone, myPath);
+			if (myErr != kQTFileErr_NoErr)
+				goto bail;
+
+			myDoneOffset = myOffset;
+		}
+	}
+
+	if (ferror(myFile)) {
+		myErr = kQTFileErr_IO;
+		goto bail;
+	}
+
+	fclose(myFile);
+	myFile = NULL;
+
+	// throw away the records of a movie that was only partly written
+	if (myDoneOffset < myOffset)
+		myErr = QTIndex_TruncateFile(theIndexPath, myDoneOffset);
+
+	if (theDone->fCount > 1)
+		qsort(theDone->fItems, theDone->fCount, sizeof(char *), QTIndex_ComparePaths);
+
+bail:
+	if (myFile != NULL)
+		fclose(myFile);
+
+	free(myLine);
+	free(myPath);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTIndex_TruncateFile
+// Cut the file at the specified path off at the specified size.
+//
+//////////
+
+static long QTIndex_TruncateFile (const char *thePath, QTFileUInt64 theSize)
+{
+#if defined(_WIN32)
+	HANDLE				myFile;
+	LARGE_INTEGER		mySize;
+	BOOL				isDone;
+
+	myFile = CreateFileA(thePath, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (myFile == INVALID_HANDLE_VALUE)
+		return(kQTFileErr_IO);
+
+	mySize.QuadPart = (LONGLONG)theSize;
+	isDone = SetFilePointerEx(myFile, mySize, NULL, FILE_BEGIN) && SetEndOfFile(myFile);
+	CloseHandle(myFile);
+
+	return(isDone ? kQTFileErr_NoErr : kQTFileErr_IO);
+#else
+	return((truncate(thePath, (off_t)theSize) == 0) ? kQTFileErr_NoErr : kQTFileErr_IO);
+#endif
+}
+
+
+//////////
+//
+// QTIndex_RemoveDone
+// Remove from theMovies the paths that are in theDone; both lists must be sorted. Return the number of paths
+// removed.
+//
+//////////
+
+static long QTIndex_RemoveDone (QTIndexListPtr theMovies, const QTIndexList *theDone)
+{
+	long				myDoneIndex = 0;
+	long				myIndex;
+	long				myCount = 0;
+	int					myOrder = 1;
+
+	for (myIndex = 0; myIndex < theMovies->fCount; myIndex++) {
+		// skip the done paths that come before this one
+		while ((myDoneIndex < theDone->fCount) && ((myOrder = strcmp(theDone->fItems[myDoneIndex], theMovies->fItems[myIndex])) < 0))
+			myDoneIndex++;
+
+		if ((myDoneIndex < theDone->fCount) && (myOrder == 0))
+			free(theMovies->fItems[myIndex]);
+		else
+			theMovies->fItems[myCount++] = theMovies->fItems[myIndex];
+	}
+
+	myIndex = theMovies->fCount - myCount;
+	theMovies->fCount = myCount;
+
+	return(myIndex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// List and buffer utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTIndex_AddToList
+// Add a copy of the specified path to the end of the specified list.
+//
+//////////
+
+static long QTIndex_AddToList (QTIndexListPtr theList, const char *thePath)
+{
+	size_t				myLength = strlen(thePath) + 1;
+	char				*myItem = NULL;
+
+	if (theList->fCount == theList->fSize) {
+		long		mySize = (theList->fSize > 0) ? (2 * theList->fSize) : kInitialListSize;
+		char		**myItems = (char **)realloc(theList->fItems, mySize * sizeof(char *));
+
+		if (myItems == NULL)
+			return(kQTFileErr_MemFull);
+
+		theList->fItems = myItems;
+		theList->fSize = mySize;
+	}
+
+	myItem = (char *)malloc(myLength);
+	if (myItem == NULL)
+		return(kQTFileErr_MemFull);
+
+	memcpy(myItem, thePath, myLength);
+	theList->fItems[theList->fCount++] = myItem;
+
+	return(kQTFileErr_NoErr);
+}
+
+
+//////////
+//
+// QTIndex_DisposeList
+// Dispose of the paths in the specified list, and of the list itself.
+//
+//////////
+
+void QTIndex_DisposeList (QTIndexListPtr theList)
+{
+	long				myIndex;
+
+	for (myIndex = 0; myIndex < theList->fCount; myIndex++)
+		free(theList->fItems[myIndex]);
+
+	free(theList->fItems);
+	memset(theList, 0, sizeof(QTIndexList));
+}
+
+
+//////////
+//
+// QTIndex_ComparePaths
+// Compare two paths in a list, for qsort.
+//
+//////////
+
+static int QTIndex_ComparePaths (const void *theFirst, const void *theSecond)
+{
+	return(strcmp(*(char * const *)theFirst, *(char * const *)theSecond));
+}
+
+
+//////////
+//
+// QTIndex_Append
+// Append the specified data to the specified buffer.
+//
+//////////
+
+static void QTIndex_Append (QTIndexBufferPtr theBuffer, const char *theData, long theLength)
+{
+	if (theBuffer->fFailed)
+		return;
+
+	if (theBuffer->fLength + theLength > theBuffer->fSize) {
+		long		mySize = (theBuffer->fSize > 0) ? theBuffer->fSize : kQTIndex_RecordBufferSize;
+		char		*myData = NULL;
+
+		while (mySize < theBuffer->fLength + theLength)
+			mySize *= 2;
+
+		myData = (char *)realloc(theBuffer->fData, mySize);
+		if (myData == NULL) {
+			theBuffer->fFailed = 1;
+			return;
+		}
+
+		theBuffer->fData = myData;
+		theBuffer->fSize = mySize;
+	}
+
+	memcpy(theBuffer->fData + theBuffer->fLength, theData, theLength);
+	theBuffer->fLength += theLength;
+}
+
+
+//////////
+//
+// QTIndex_AppendEscaped
+// Append the specified text to the specified buffer, escaping the characters that would end a field or a record.
+//
+//////////
+
+static void QTIndex_AppendEscaped (QTIndexBufferPtr theBuffer, const char *theText, long theLength)
+{
+	const char			*myRun = theText;
+	const char			*myEnd = theText + theLength;
+
+	for (; theText < myEnd; theText++) {
+		const char		*myEscape = NULL;
+
+		if (((unsigned char)*theText >= ' ') && (*theText != '\\'))
+			continue;
+
+		// append the characters that don't need escaping in one go
+		QTIndex_Append(theBuffer, myRun, (long)(theText - myRun));
+		myRun = theText + 1;
+
+		switch (*theText) {
+			case '\\':	myEscape = "\\\\";	break;
+			case '\t':	myEscape = "\\t";	break;
+			case '\n':	myEscape = "\\n";	break;
+			case '\r':	myEscape = "\\r";	break;
+			default:	myEscape = " ";		break;
+		}
+
+		QTIndex_Append(theBuffer, myEscape, (long)strlen(myEscape));
+	}
+
+	QTIndex_Append(theBuffer, myRun, (long)(theText - myRun));
+}
+
+
+//////////
+//
+// QTIndex_AppendNumber
+// Append the specified number, in decimal, to the specified buffer.
+//
+//////////
+
+static void QTIndex_AppendNumber (QTIndexBufferPtr theBuffer, QTFileInt64 theNumber)
+{
+	char				myDigits[kMaxNumberSize];
+	long				myIndex = kMaxNumberSize;
+	QTFileUInt64		myValue = (theNumber < 0) ? (QTFileUInt64)(-theNumber) : (QTFileUInt64)theNumber;
+
+	do {
+		myDigits[--myIndex] = (char)('0' + (myValue % 10));
+		myValue /= 10;
+	} while (myValue > 0);
+
+	if (theNumber < 0)
+		myDigits[--myIndex] = '-';
+
+	QTIndex_Append(theBuffer, myDigits + myIndex, kMaxNumberSize - myIndex);
+}
+
+
+//////////
+//
+// QTIndex_AppendField
+// Append the specified text (or, if theLength is -1, the specified C string) to the specified buffer, followed
+// by a tab or, if isLast is true, by the end of the record.
+//
+//////////
+
+static void QTIndex_AppendField (QTIndexBufferPtr theBuffer, const char *theText, long theLength, int isLast)
+{
+	if (theLength < 0)
+		theLength = (long)strlen(theText);
+
+	QTIndex_AppendEscaped(theBuffer, theText, theLength);
+	QTIndex_Append(theBuffer, isLast ? "\n" : "\t", 1);
+}
+
+
+//////////
+//
+// QTIndex_Unescape
+// Undo the escaping done by QTIndex_AppendEscaped, putting the result at theDst (which may be theText); return
+// the length of the result.
+//
+//////////
+
+static long QTIndex_Unescape (const char *theText, long theLength, char *theDst)
+{
+	long				myIndex;
+	long				myLength = 0;
+
+	for (myIndex = 0; myIndex < theLength; myIndex++) {
+		char		myChar = theText[myIndex];
+
+		if ((myChar == '\\') && (myIndex + 1 < theLength)) {
+			myChar = theText[++myIndex];
+			if (myChar == 't')
+				myChar = '\t';
+			else if (myChar == 'n')
+				myChar = '\n';
+			else if (myChar == 'r')
+				myChar = '\r';
+		}
+
+		theDst[myLength++] = myChar;
+	}
+
+	return(myLength);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Thread utilities.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTIndex_ThreadEntry
+// The entry point of a worker thread.
+//
+//////////
+
+#if defined(_WIN32)
+static DWORD WINAPI QTIndex_ThreadEntry (LPVOID theWorker)
+#else
+static void *QTIndex_ThreadEntry (void *theWorker)
+#endif
+{
+	QTIndex_RunWorker((QTIndexWorkerPtr)theWorker);
+	return(0);
+}
+
+
+//////////
+//
+// QTIndex_StartThread
+// Start the thread of the specified worker; return 0 if we can't.
+//
+//////////
+
+static int QTIndex_StartThread (QTIndexWorkerPtr theWorker)
+{
+#if defined(_WIN32)
+	theWorker->fThread = CreateThread(NULL, 0, QTIndex_ThreadEntry, theWorker, 0, NULL);
+	return(theWorker->fThread != NULL);
+#else
+	return(pthread_create(&theWorker->fThread, NULL, QTIndex_ThreadEntry, theWorker) == 0);
+#endif
+}
+
+
+//////////
+//
+// QTIndex_WaitThread
+// Wait for the specified thread to finish.
+//
+//////////
+
+static void QTIndex_WaitThread (QTIndexThread theThread)
+{
+#if defined(_WIN32)
+	WaitForSingleObject(theThread, INFINITE);
+	CloseHandle(theThread);
+#else
+	pthread_join(theThread, NULL);
+#endif
+}
+
+
+//////////
+//
+// QTIndex_InitLock
+// Initialize the specified lock.
+//
+//////////
+
+static void QTIndex_InitLock (QTIndexLock *theLock)
+{
+#if defined(_WIN32)
+	InitializeCriticalSection(theLock);
+#else
+	pthread_mutex_init(theLock, NULL);
+#endif
+}
+
+
+//////////
+//
+// QTIndex_DisposeLock
+// Dispose of the specified lock.
+//
+//////////
+
+static void QTIndex_DisposeLock (QTIndexLock *theLock)
+{
+#if defined(_WIN32)
+	DeleteCriticalSection(theLock);
+#else
+	pthread_mutex_destroy(theLock);
+#endif
+}
+
+
+//////////
+//
+// QTIndex_Lock
+// Acquire the specified lock.
+//
+//////////
+
+static void QTIndex_Lock (QTIndexLock *theLock)
+{
+#if defined(_WIN32)
+	EnterCriticalSection(theLock);
+#else
+	pthread_mutex_lock(theLock);
+#endif
+}
+
+
+//////////
+//
+// QTIndex_Unlock
+// Release the specified lock.
+//
+//////////
+
+static void QTIndex_Unlock (QTIndexLock *theLock)
+{
+#if defined(_WIN32)
+	LeaveCriticalSection(theLock);
+#else
+	pthread_mutex_unlock(theLock);
+#endif
+}
+
+
+//////////
+//
+// QTIndex_GetMilliseconds
+// Return the number of milliseconds since some fixed time.
+//
+//////////
+
+static unsigned long QTIndex_GetMilliseconds (void)
+{
+#if defined(_WIN32)
+	return((unsigned long)GetTickCount());
+#else
+	struct timespec		myTime;
+
+	clock_gettime(CLOCK_MONOTONIC, &myTime);
+	return((unsigned long)((myTime.tv_sec * 1000) + (myTime.tv_nsec / 1000000)));
+#endif
+}
+
+
+//////////
+//
+// QTIndex_Sleep
+// Wait for the specified number of milliseconds.
+//
+//////////
+
+static void QTIndex_Sleep (long theMilliseconds)
+{
+#if defined(_WIN32)
+	Sleep((DWORD)theMilliseconds);
+#else
+	struct timespec		myTime;
+
+	myTime.tv_sec = theMilliseconds / 1000;
+	myTime.tv_nsec = (theMilliseconds % 1000) * 1000000L;
+	nanosleep(&myTime, NULL);
+#endif
+}
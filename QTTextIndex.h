@@ -0,0 +1,85 @@
+//////////
+//
+//	File:		QTTextIndex.h
+//
+//	Contains:	Building an index of the text, chapter and HREF tracks of all the movie files in a directory tree.
+//				All utilities start with the prefix "QTIndex_".
+//
+//	Written by:	QuickTime Team
+//
+//////////
+
+#pragma once
+
+#ifndef __QTTextIndex__
+#define __QTTextIndex__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#ifndef __QTTextFile__
+#include "QTTextFile.h"
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kQTIndex_MaxThreads				64				// the most worker threads an indexer runs
+#define kQTIndex_DefaultMaxOpenFiles	32				// the default limit on the number of files open at once
+#define kQTIndex_ReservedFiles			2				// files open besides the movies: the index and a directory
+#define kQTIndex_ProgressInterval		1000			// milliseconds between calls to the progress procedure
+#define kQTIndex_RecordBufferSize		(64L * 1024L)	// initial size of the record buffer of a worker thread
+#define kQTIndex_MaxPathSize			4096			// longer paths are skipped
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// the progress of an indexer
+typedef struct QTIndexStats {
+	long							fMovieCount;	// the number of movie files found in the directory tree
+	long							fSkippedCount;	// the number of them already in the index (from an earlier run)
+	long							fIndexedCount;	// the number of them indexed so far in this run
+	long							fFailedCount;	// the number of those that couldn't be opened as movies
+	long							fTrackCount;	// the number of text tracks indexed so far
+	long							fSampleCount;	// the number of text samples indexed so far
+	QTFileUInt64					fBytesWritten;	// the number of bytes added to the index so far
+	long							fThreadCount;	// the number of worker threads
+	long							fElapsed;		// the time since the indexer started, in milliseconds
+} QTIndexStats, *QTIndexStatsPtr;
+
+// a list of paths
+typedef struct QTIndexList {
+	char							**fItems;		// the paths
+	long							fCount;			// the number of paths in the list
+	long							fSize;			// the number of elements in fItems
+} QTIndexList, *QTIndexListPtr;
+
+// a procedure that's called periodically while an index is being built, and once more when it's done
+typedef void (*QTIndexProgressProcPtr) (void *theRefCon, const QTIndexStats *theStats);
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+long						QTIndex_IndexDirectory (const char *theDirPath, const char *theIndexPath, long theThreadCount, long theMaxOpenFiles, QTIndexProgressProcPtr theProgressProc, void *theRefCon, QTIndexStatsPtr theStats);
+long						QTIndex_GetProcessorCount (void);
+
+long						QTIndex_FindMovies (const char *theDirPath, QTIndexListPtr theMovies);
+void						QTIndex_DisposeList (QTIndexListPtr theList);
+
+#endif	// __QTTextIndex__
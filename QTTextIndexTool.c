@@ -0,0 +1,125 @@
+//////////
+//
+//	File:		QTTextIndexTool.c
+//
+//	Contains:	A command-line tool that indexes the text, chapter and HREF tracks of a library of movie files.
+//
+//	Written by:	QuickTime Team
+//
+//	Usage:		qttextindex [-j threads] [-n max-open-files] directory index-file
+//
+//	The index format is described in QTTextIndex.c. If the tool is interrupted, run it again with the same
+//	arguments; it picks up where it left off.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTTextIndex.h"
+
+#include <stdio.h>
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kBytesPerMegabyte				(1024.0 * 1024.0)
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTIndexTool_ShowProgress (void *theRefCon, const QTIndexStats *theStats);
+static void					QTIndexTool_ShowUsage (const char *theToolName);
+
+
+//////////
+//
+// main
+// Parse the command line and build the index.
+//
+//////////
+
+int main (int argc, char *argv[])
+{
+	QTIndexStats		myStats;
+	long				myThreadCount = 0;
+	long				myMaxOpenFiles = 0;
+	int					myIndex = 1;
+	long				myErr = kQTFileErr_NoErr;
+
+	for (; (myIndex + 1 < argc) && (argv[myIndex][0] == '-'); myIndex += 2) {
+		if (strcmp(argv[myIndex], "-j") == 0) {
+			myThreadCount = atol(argv[myIndex + 1]);
+		} else if (strcmp(argv[myIndex], "-n") == 0) {
+			myMaxOpenFiles = atol(argv[myIndex + 1]);
+		} else {
+			QTIndexTool_ShowUsage(argv[0]);
+			return(1);
+		}
+	}
+
+	if (argc - myIndex != 2) {
+		QTIndexTool_ShowUsage(argv[0]);
+		return(1);
+	}
+
+	myErr = QTIndex_IndexDirectory(argv[myIndex], argv[myIndex + 1], myThreadCount, myMaxOpenFiles, QTIndexTool_ShowProgress, NULL, &myStats);
+	fprintf(stderr, "\n");
+
+	if (myErr != kQTFileErr_NoErr) {
+		fprintf(stderr, "%s: couldn't index %s (error %ld)\n", argv[0], argv[myIndex], myErr);
+		return(1);
+	}
+
+	return(0);
+}
+
+
+//////////
+//
+// QTIndexTool_ShowProgress
+// Show the progress of the indexer on the standard error stream.
+//
+//////////
+
+static void QTIndexTool_ShowProgress (void *theRefCon, const QTIndexStats *theStats)
+{
+	double				mySeconds = (theStats->fElapsed > 0) ? (theStats->fElapsed / 1000.0) : 1.0;
+
+	(void)theRefCon;
+
+	fprintf(stderr, "\r%ld of %ld movies indexed (%ld skipped, %ld failed), %ld text tracks, %ld samples; %.1f movies/s, %.1f MB/s, %ld threads  ",
+				theStats->fIndexedCount,
+				theStats->fMovieCount - theStats->fSkippedCount,
+				theStats->fSkippedCount,
+				theStats->fFailedCount,
+				theStats->fTrackCount,
+				theStats->fSampleCount,
+				theStats->fIndexedCount / mySeconds,
+				(double)(QTFileInt64)theStats->fBytesWritten / kBytesPerMegabyte / mySeconds,
+				theStats->fThreadCount);
+}
+
+
+//////////
+//
+// QTIndexTool_ShowUsage
+// Show how to use the tool on the standard error stream.
+//
+//////////
+
+static void QTIndexTool_ShowUsage (const char *theToolName)
+{
+	fprintf(stderr, "usage: %s [-j threads] [-n max-open-files] directory index-file\n", theToolName);
+}